@@ -0,0 +1,432 @@
+#include "adaptivesubdivision.hpp"
+#include "subdivision.hpp"
+#include "meshanalysis.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+AdaptiveSubdivision::AdaptiveSubdivision(const CompactMesh& base)
+{
+	mesh = base;
+	leafVertices = base.cornerVertices;
+	leafLevels.assign(base.GetNumberOfTriangles(), 0);
+	faceLevels = leafLevels;
+	faceLeaves.resize(base.GetNumberOfTriangles());
+	for (int32_t t = 0; t < base.GetNumberOfTriangles(); ++t)
+	{
+		faceLeaves[t] = t;
+	}
+	vertexEdges.assign(base.GetNumberOfVertices(), std::make_pair(-1, -1));
+}
+
+AdaptiveSubdivision::~AdaptiveSubdivision() {}
+
+void AdaptiveSubdivision::Refine(const std::vector<char>& marked)
+{
+	const CompactMesh& m = mesh;
+	int32_t numVertices = m.GetNumberOfVertices();
+	int32_t numLeaves = leafLevels.size();
+
+	std::vector<int32_t> queue;
+	for (int32_t t = 0; t < m.GetNumberOfTriangles(); ++t)
+	{
+		if (marked[t])
+			queue.push_back(faceLeaves[t]);
+	}
+	if (queue.empty())
+		return;
+
+	// The leaves on each edge, at most two. A leaf that is cut leaves the table and its children come in.
+	EdgeMap<std::pair<int32_t, int32_t>> edgeLeaves;
+	edgeLeaves.Reserve(3 * numLeaves / 2 + 6 * queue.size());
+	auto link = [&](int32_t leaf, bool add)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			uint64_t key = GetKey(leafVertices[3 * leaf + k], leafVertices[3 * leaf + (k + 1) % 3]);
+			std::pair<int32_t, int32_t>& pair = edgeLeaves.Insert(key, std::make_pair(-1, -1));
+			int32_t from = add ? -1 : leaf;
+			int32_t to = add ? leaf : -1;
+			if (pair.first == from)
+				pair.first = to;
+			else if (pair.second == from)
+				pair.second = to;
+		}
+	};
+	for (int32_t leaf = 0; leaf < numLeaves; ++leaf)
+	{
+		link(leaf, true);
+	}
+
+	/** Closure:
+	 * Cutting a leaf puts a vertex on the edges of its neighbours, and the children of an edge's vertex on the edges
+	 * of a coarser neighbour, so those and the children are the leaves to look at again.
+	 */
+	std::vector<int32_t> children(numLeaves, -1);
+	int32_t numCreated = 0;
+	auto check = [&](int32_t leaf)
+	{
+		if (leaf >= 0 && children[leaf] < 0 && NeedsCutting(&leafVertices[3 * leaf]))
+			queue.push_back(leaf);
+	};
+	auto checkEdge = [&](int32_t a, int32_t b)
+	{
+		const std::pair<int32_t, int32_t>* pair = edgeLeaves.Find(GetKey(a, b));
+		if (pair == NULL)
+			return;
+		check(pair->first);
+		check(pair->second);
+	};
+
+	while (!queue.empty())
+	{
+		int32_t leaf = queue.back();
+		queue.pop_back();
+		if (children[leaf] >= 0)
+			continue;
+
+		int32_t v[3] = { leafVertices[3 * leaf], leafVertices[3 * leaf + 1], leafVertices[3 * leaf + 2] };
+		int32_t w[3];
+		bool finer = false;
+		for (int k = 0; k < 3; ++k)
+		{
+			w[k] = GetMidpoint(v[k], v[(k + 1) % 3]);
+			if (w[k] >= 0)
+				finer = finer || GetMidpoint(v[k], w[k]) >= 0 || GetMidpoint(w[k], v[(k + 1) % 3]) >= 0;
+			else
+			{
+				w[k] = vertexEdges.size();
+				midpoints.Insert(GetKey(v[k], v[(k + 1) % 3]), w[k]);
+				vertexEdges.push_back(std::make_pair(v[k], v[(k + 1) % 3]));
+				++numCreated;
+			}
+		}
+
+		link(leaf, false);
+		int32_t first = leafLevels.size();
+		children[leaf] = first;
+		int32_t child[12] = { v[0], w[0], w[2], w[0], v[1], w[1], w[1], v[2], w[2], w[0], w[1], w[2] };
+		leafVertices.insert(leafVertices.end(), child, child + 12);
+		leafLevels.insert(leafLevels.end(), 4, leafLevels[leaf] + 1);
+		children.insert(children.end(), 4, -1);
+		for (int32_t c = first; c < first + 4; ++c)
+		{
+			link(c, true);
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			int32_t a = v[k];
+			int32_t b = v[(k + 1) % 3];
+			checkEdge(a, b);
+			if (vertexEdges[b].first == a || vertexEdges[b].second == a)
+				checkEdge(vertexEdges[b].first, vertexEdges[b].second);
+			if (vertexEdges[a].first == b || vertexEdges[a].second == b)
+				checkEdge(vertexEdges[a].first, vertexEdges[a].second);
+		}
+
+		// A child can only need cutting already if a neighbour was two levels finer.
+		for (int32_t c = first; c < first + 4 && finer; ++c)
+		{
+			check(c);
+		}
+	}
+	edgeLeaves = EdgeMap<std::pair<int32_t, int32_t>>();
+
+	/** Vertex numbering:
+	 * The new vertices on the edges of the mesh first, in edge order, then the others in the order they were made.
+	 */
+	std::vector<int32_t> renumber(numCreated, -1);
+	std::vector<int32_t> halfEdges;
+	for (int32_t e = 0; e < m.GetNumberOfEdges(); ++e)
+	{
+		int32_t h = m.edgeHalfEdges[e];
+		int32_t w = GetMidpoint(m.V(h), m.V(CompactMesh::N(h)));
+		if (w >= numVertices)
+		{
+			renumber[w - numVertices] = numVertices + halfEdges.size();
+			halfEdges.push_back(h);
+		}
+	}
+	int32_t numOnEdges = halfEdges.size();
+	int32_t next = numVertices + numOnEdges;
+	for (int32_t& index : renumber)
+	{
+		if (index < 0)
+			index = next++;
+	}
+	auto map = [&](int32_t w) { return (w < numVertices) ? w : renumber[w - numVertices]; };
+	for (int32_t& w : leafVertices)
+	{
+		w = map(w);
+	}
+	midpoints.ForEachValue([&](int32_t& w) { w = map(w); });
+	std::vector<std::pair<int32_t, int32_t>> created(vertexEdges.begin() + numVertices, vertexEdges.end());
+	for (int32_t i = 0; i < numCreated; ++i)
+	{
+		vertexEdges[renumber[i]] = std::make_pair(map(created[i].first), map(created[i].second));
+	}
+
+	/** Positions:
+	 * Even and odd vertices by the Loop rules on the old mesh; see the class description.
+	 */
+	std::vector<glm::dvec3> positions(numVertices + numCreated);
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<int32_t> connected;
+		std::vector<glm::dvec3> neighbours;
+		for (int32_t v = begin; v < end; ++v)
+		{
+			CompactMesh::Range fan = m.GetFan(v);
+			bool refined = !fan.empty();
+			for (int32_t c : fan)
+			{
+				refined = refined && children[faceLeaves[CompactMesh::T(c)]] >= 0;
+			}
+			if (!refined)
+			{
+				positions[v] = m.positions[v];
+				continue;
+			}
+
+			CompactMesh::Range ring = m.GetRing(v);
+			connected.assign(ring.begin(), ring.end());
+			std::sort(connected.begin(), connected.end());
+			connected.erase(std::unique(connected.begin(), connected.end()), connected.end());
+
+			neighbours.clear();
+			for (int32_t w : connected)
+			{
+				if (w != v)
+					neighbours.push_back(m.positions[w]);
+			}
+			positions[v] = Subdivision::GetEvenPosition(m.positions[v], m.valences[v], neighbours);
+		}
+	});
+	Parallel::ForBlocks(numOnEdges, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int32_t i = begin; i < end; ++i)
+		{
+			positions[numVertices + i] = Subdivision::GetOddPosition(m, m.positions, halfEdges[i]);
+		}
+	});
+	for (int32_t w = numVertices + numOnEdges; w < next; ++w)
+	{
+		positions[w] = 0.5 * (positions[vertexEdges[w].first] + positions[vertexEdges[w].second]);
+	}
+
+	/** Leaves:
+	 * The leaves that were not cut stay in order, and a cut one gives way to its children, in the order of Subdivision.
+	 */
+	std::vector<int32_t> order;
+	std::vector<int32_t> stack;
+	for (int32_t leaf = numLeaves - 1; leaf >= 0; --leaf)
+	{
+		stack.push_back(leaf);
+	}
+	while (!stack.empty())
+	{
+		int32_t leaf = stack.back();
+		stack.pop_back();
+		if (children[leaf] < 0)
+		{
+			order.push_back(leaf);
+			continue;
+		}
+		for (int32_t c = children[leaf] + 3; c >= children[leaf]; --c)
+		{
+			stack.push_back(c);
+		}
+	}
+	std::vector<int32_t> vertices(3 * order.size());
+	std::vector<int32_t> levels(order.size());
+	for (int32_t i = 0; i < order.size(); ++i)
+	{
+		std::copy(&leafVertices[3 * order[i]], &leafVertices[3 * order[i]] + 3, &vertices[3 * i]);
+		levels[i] = leafLevels[order[i]];
+	}
+	leafVertices = std::move(vertices);
+	leafLevels = std::move(levels);
+
+	// Only the vertices on the edges of leaves are still needed.
+	EdgeMap<int32_t> kept;
+	for (int32_t i = 0; i < leafVertices.size(); ++i)
+	{
+		uint64_t key = GetKey(leafVertices[i], leafVertices[(i % 3 == 2) ? i - 2 : i + 1]);
+		const int32_t* w = midpoints.Find(key);
+		if (w != NULL)
+			kept.Insert(key, *w);
+	}
+	midpoints = std::move(kept);
+
+	std::vector<int32_t> triangles;
+	GetTriangles(triangles);
+	mesh = CompactMesh(positions, triangles);
+	mesh.Initialize();
+	faceLevels.resize(faceLeaves.size());
+	for (int32_t t = 0; t < faceLeaves.size(); ++t)
+	{
+		faceLevels[t] = leafLevels[faceLeaves[t]];
+	}
+}
+
+void AdaptiveSubdivision::GetTriangles(std::vector<int32_t>& triangles)
+{
+	triangles.clear();
+	faceLeaves.clear();
+	for (int32_t leaf = 0; leaf < leafLevels.size(); ++leaf)
+	{
+		const int32_t* v = &leafVertices[3 * leaf];
+		int k = 0;
+		int32_t w = -1;
+		for (int j = 0; j < 3 && w < 0; ++j)
+		{
+			w = GetMidpoint(v[j], v[(j + 1) % 3]);
+			k = j;
+		}
+		if (w < 0)
+		{
+			triangles.insert(triangles.end(), v, v + 3);
+			faceLeaves.push_back(leaf);
+			continue;
+		}
+
+		// Green: the vertex on edge k to the corner across from it, keeping the orientation of the leaf.
+		int32_t green[6] = { v[k], w, v[(k + 2) % 3], w, v[(k + 1) % 3], v[(k + 2) % 3] };
+		triangles.insert(triangles.end(), green, green + 6);
+		faceLeaves.push_back(leaf);
+		faceLeaves.push_back(leaf);
+	}
+}
+
+uint64_t AdaptiveSubdivision::GetKey(int32_t a, int32_t b)
+{
+	uint64_t low = std::min(a, b);
+	uint64_t high = std::max(a, b);
+	return (high << 32) | (low + 1);
+}
+
+int32_t AdaptiveSubdivision::GetMidpoint(int32_t a, int32_t b) const
+{
+	const int32_t* w = midpoints.Find(GetKey(a, b));
+	return (w == NULL) ? -1 : *w;
+}
+
+bool AdaptiveSubdivision::NeedsCutting(const int32_t* vertices) const
+{
+	int count = 0;
+	for (int k = 0; k < 3; ++k)
+	{
+		int32_t a = vertices[k];
+		int32_t b = vertices[(k + 1) % 3];
+		int32_t w = GetMidpoint(a, b);
+		if (w < 0)
+			continue;
+		if (GetMidpoint(a, w) >= 0 || GetMidpoint(w, b) >= 0)
+			return true;
+		++count;
+	}
+	return count >= 2;
+}
+
+std::vector<char> AdaptiveSubdivision::MarkByCurvature(const CompactMesh& m, Curvature curvature, double threshold)
+{
+	std::vector<double> values = MeshAnalysis::GetVertexCurvatures(m, curvature);
+	std::vector<char> marked(m.GetNumberOfTriangles(), 0);
+	Parallel::ForBlocks(m.GetNumberOfTriangles(), 4096, [&](int begin, int end)
+	{
+		for (int32_t t = begin; t < end; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				if (std::abs(values[m.V(3 * t + k)]) > threshold)
+					marked[t] = 1;
+			}
+		}
+	});
+	return marked;
+}
+
+std::vector<char> AdaptiveSubdivision::MarkByEdgeLength(const CompactMesh& m, double maxLength)
+{
+	std::vector<char> marked(m.GetNumberOfTriangles(), 0);
+	Parallel::ForBlocks(m.GetNumberOfTriangles(), 4096, [&](int begin, int end)
+	{
+		for (int32_t t = begin; t < end; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				if (m.GetOppositeEdgeLength(3 * t + k) > maxLength)
+					marked[t] = 1;
+			}
+		}
+	});
+	return marked;
+}
+
+std::vector<char> AdaptiveSubdivision::MarkByScreenSize(const CompactMesh& m, const glm::dmat4& viewProjection, const glm::dvec2& viewport, double maxPixels)
+{
+	std::vector<char> marked(m.GetNumberOfTriangles(), 0);
+	Parallel::ForBlocks(m.GetNumberOfTriangles(), 4096, [&](int begin, int end)
+	{
+		for (int32_t t = begin; t < end; ++t)
+		{
+			glm::dvec4 clip[3];
+			bool behind = false;
+			for (int k = 0; k < 3; ++k)
+			{
+				clip[k] = viewProjection * glm::dvec4(m.positions[m.V(3 * t + k)], 1.0);
+				behind = behind || clip[k].w <= 0.0;
+			}
+			if (behind)
+				continue;
+
+			// Wholly outside one of the planes of the view.
+			bool outside = false;
+			for (int axis = 0; axis < 3 && !outside; ++axis)
+			{
+				bool below = true;
+				bool above = true;
+				for (int k = 0; k < 3; ++k)
+				{
+					below = below && clip[k][axis] < -clip[k].w;
+					above = above && clip[k][axis] > clip[k].w;
+				}
+				outside = below || above;
+			}
+			if (outside)
+				continue;
+
+			glm::dvec2 screen[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				screen[k] = 0.5 * viewport * glm::dvec2(clip[k].x / clip[k].w, clip[k].y / clip[k].w);
+			}
+			for (int k = 0; k < 3; ++k)
+			{
+				if (glm::length(screen[(k + 1) % 3] - screen[k]) > maxPixels)
+					marked[t] = 1;
+			}
+		}
+	});
+	return marked;
+}
+
+std::vector<char> AdaptiveSubdivision::MarkByRegion(const CompactMesh& m, const glm::dvec3& center, double radius)
+{
+	std::vector<char> marked(m.GetNumberOfTriangles(), 0);
+	Parallel::ForBlocks(m.GetNumberOfTriangles(), 4096, [&](int begin, int end)
+	{
+		for (int32_t t = begin; t < end; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				if (glm::length(m.positions[m.V(3 * t + k)] - center) <= radius)
+					marked[t] = 1;
+			}
+		}
+	});
+	return marked;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "compactmesh.hpp"
+#include "utilities.hpp"
+
+/** Loop subdivision of only some faces of a mesh, with red-green closure.
+ * Goal: refine a mesh where a per-face criterion asks for it, such as high curvature, faces too large on screen,
+ * or a region of interest, so that the faces multiply only there instead of everywhere.
+ *
+ * The refinement is kept as a set of leaf triangles, cut into four (red) like Subdivision::LoopSubdivision() does,
+ * by the level of Loop subdivision they are at. A leaf beside a finer one has the vertex of the finer side on its edge.
+ * Each call to Refine() cuts the leaves of the marked faces, and then any leaf with vertices on two or three of its edges,
+ * or with a vertex on an edge of its neighbour that is not on its own; so a leaf never has more than one such vertex,
+ * and never lies beside a leaf more than one level finer. Each leaf with one such vertex is cut in two (green)
+ * to keep the mesh conforming. The green halves are only in the mesh that comes out: the next call cuts the leaf
+ * they came from, never the halves, so the triangles do not get thinner from level to level.
+ *
+ * Positions follow the Loop rules of Subdivision on the mesh before the call: the new vertex on an edge of that mesh is
+ * placed by the odd rule, and a vertex all of whose triangles are cut is moved by the even rule. A vertex on the border
+ * of the refined region stays where it is. A new vertex on an edge that only appears within the call, which happens where
+ * cutting one leaf forces cutting its children, is put halfway between its ends.
+ *
+ * The vertices keep their indices, and the new ones follow, those on the edges of the old mesh first in edge order;
+ * the faces of a leaf follow in the order of the leaves, the four of a cut leaf in the order of Subdivision.
+ * So marking every face gives the same mesh as Subdivision::LoopSubdivision().
+ *
+ * This needs every edge to have one or two triangles, as Subdivision does for its direct path; elsewhere the closure
+ * may leave a vertex on an edge of a third triangle.
+ */
+class AdaptiveSubdivision
+{
+
+public:
+
+	// Start from an initialized mesh, at level 0 everywhere.
+	AdaptiveSubdivision(const CompactMesh& base);
+	~AdaptiveSubdivision();
+
+	// One level of refinement of the faces of mesh with marked[t] set, with the closure above. The mesh is initialized after.
+	void Refine(const std::vector<char>& marked);
+
+
+	/*** Criteria ***/
+
+	// One char per face of m, to be combined as needed.
+
+	// Faces with a vertex where the absolute value of a curvature is above the threshold.
+	static std::vector<char> MarkByCurvature(const CompactMesh& m, Curvature curvature, double threshold);
+
+	// Faces with an edge longer than maxLength.
+	static std::vector<char> MarkByEdgeLength(const CompactMesh& m, double maxLength);
+
+	// Faces in front of the camera, not wholly outside the view, with an edge longer than maxPixels on screen.
+	// The viewport is the width and height of the screen in pixels.
+	static std::vector<char> MarkByScreenSize(const CompactMesh& m, const glm::dmat4& viewProjection, const glm::dvec2& viewport, double maxPixels);
+
+	// Faces with a vertex within the radius of the center.
+	static std::vector<char> MarkByRegion(const CompactMesh& m, const glm::dvec3& center, double radius);
+
+
+	// The refined mesh, initialized.
+	CompactMesh mesh;
+
+	// Per face of mesh: the level of Loop subdivision of its leaf.
+	std::vector<int32_t> faceLevels;
+
+private:
+
+	// The leaves that are not cut, three vertices each, and their levels.
+	std::vector<int32_t> leafVertices;
+	std::vector<int32_t> leafLevels;
+
+	// Per face of mesh: the leaf it belongs to. The two halves of a green leaf belong to the same one.
+	std::vector<int32_t> faceLeaves;
+
+	// A hash table from the key of an edge to a value, with open addressing: a key is found in one run of probes
+	// over a flat array, where std::unordered_map follows a pointer per entry. The closure looks up a few dozen edges
+	// for every leaf it cuts, so this is most of its time. A key of 0 marks an empty slot, and nothing is erased.
+	template <typename T> class EdgeMap
+	{
+
+	public:
+
+		EdgeMap() : keys(16, 0), values(16), shift(60) {}
+
+		// Make room for n keys without growing.
+		void Reserve(size_t n)
+		{
+			size_t capacity = keys.size();
+			while (capacity < 2 * n)
+			{
+				capacity *= 2;
+			}
+			if (capacity > keys.size())
+				Resize(capacity);
+		}
+
+		// The value of a key, or NULL.
+		const T* Find(uint64_t key) const
+		{
+			size_t mask = keys.size() - 1;
+			for (size_t i = Hash(key); keys[i] != 0; i = (i + 1) & mask)
+			{
+				if (keys[i] == key)
+					return &values[i];
+			}
+			return NULL;
+		}
+
+		// The value of a key, set to initial first if the key is new.
+		T& Insert(uint64_t key, const T& initial)
+		{
+			if (2 * (count + 1) > keys.size())
+				Resize(2 * keys.size());
+			size_t mask = keys.size() - 1;
+			size_t i = Hash(key);
+			while (keys[i] != 0 && keys[i] != key)
+			{
+				i = (i + 1) & mask;
+			}
+			if (keys[i] == 0)
+			{
+				keys[i] = key;
+				values[i] = initial;
+				++count;
+			}
+			return values[i];
+		}
+
+		size_t Size() const { return count; }
+
+		// Call f(value) on every value.
+		template <typename F> void ForEachValue(F f)
+		{
+			for (size_t i = 0; i < keys.size(); ++i)
+			{
+				if (keys[i] != 0)
+					f(values[i]);
+			}
+		}
+
+	private:
+
+		// Fibonacci hashing: the top bits of the product depend on every bit of the key.
+		size_t Hash(uint64_t key) const { return (key * 0x9E3779B97F4A7C15ull) >> shift; }
+
+		void Resize(size_t capacity)
+		{
+			std::vector<uint64_t> oldKeys(capacity, 0);
+			std::vector<T> oldValues(capacity);
+			oldKeys.swap(keys);
+			oldValues.swap(values);
+			count = 0;
+			shift = 64;
+			while (((size_t)1 << (64 - shift)) < capacity)
+			{
+				--shift;
+			}
+			for (size_t i = 0; i < oldKeys.size(); ++i)
+			{
+				if (oldKeys[i] != 0)
+					Insert(oldKeys[i], oldValues[i]);
+			}
+		}
+
+		std::vector<uint64_t> keys;
+		std::vector<T> values;
+		size_t count = 0;
+
+		// 64 minus the log of the capacity, which is a power of 2.
+		int shift;
+
+	};
+
+	// The vertex made on each edge that has been cut, by its two ends (see GetKey()),
+	// and per vertex the two ends of the edge it was made on, or -1 for the vertices of the base.
+	EdgeMap<int32_t> midpoints;
+	std::vector<std::pair<int32_t, int32_t>> vertexEdges;
+
+	// The key of the edge between two vertices, the same either way round, and never 0.
+	static uint64_t GetKey(int32_t a, int32_t b);
+
+	// The vertex on the edge from a to b, or -1.
+	int32_t GetMidpoint(int32_t a, int32_t b) const;
+
+	// True if the leaf with these vertices must be cut to close the refinement: it has vertices on two or three edges,
+	// or a vertex on an edge has a vertex on one of its halves.
+	bool NeedsCutting(const int32_t* vertices) const;
+
+	// Write the faces of mesh from the leaves, green where a leaf has a vertex on one edge, into triangles and faceLeaves.
+	void GetTriangles(std::vector<int32_t>& triangles);
+
+};
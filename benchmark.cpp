@@ -0,0 +1,1926 @@
+#include "benchmark.hpp"
+
+int Benchmark::Run(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: " << argv[0] << " --benchmark <name> [arguments]" << std::endl;
+		std::cout << "Benchmarks:" << std::endl;
+		std::cout << "  edges [maxFaces]" << std::endl;
+		std::cout << "  load [maxFaces]" << std::endl;
+		std::cout << "  parallel-load [faces]" << std::endl;
+		std::cout << "  cache [maxFaces]" << std::endl;
+		std::cout << "  compact [maxFaces]" << std::endl;
+		std::cout << "  curvatures [maxVertices]" << std::endl;
+		std::cout << "  kernels [vertices]" << std::endl;
+		std::cout << "  dihedral [edges]" << std::endl;
+		std::cout << "  edit [vertices]" << std::endl;
+		std::cout << "  tensor [vertices]" << std::endl;
+		std::cout << "  tensor-smooth [vertices] [iterations]" << std::endl;
+		std::cout << "  smooth [vertices] [steps]" << std::endl;
+		std::cout << "  streamlines [faces] [spacing]" << std::endl;
+		std::cout << "  init [faces]" << std::endl;
+		std::cout << "  subdivide [faces] [levels]" << std::endl;
+		std::cout << "  subdivide-threads [faces] [levels]" << std::endl;
+		std::cout << "  stencil [faces] [levels]" << std::endl;
+		std::cout << "  adaptive [faces] [levels]" << std::endl;
+		std::cout << "  stream [faces] [levels]" << std::endl;
+		std::cout << "  flipped [size]" << std::endl;
+		return -1;
+	}
+
+	std::string name = argv[2];
+	if (name == "edges")
+	{
+		int maxFaces = (argc > 3) ? std::stoi(argv[3]) : 10000000;
+		EdgeConstruction(maxFaces);
+		return 0;
+	}
+	if (name == "load")
+	{
+		int maxFaces = (argc > 3) ? std::stoi(argv[3]) : 10000000;
+		TextLoading(maxFaces);
+		return 0;
+	}
+	if (name == "parallel-load")
+	{
+		int faces = (argc > 3) ? std::stoi(argv[3]) : 10000000;
+		ParallelLoading(faces);
+		return 0;
+	}
+	if (name == "cache")
+	{
+		int maxFaces = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+		CacheLoading(maxFaces);
+		return 0;
+	}
+	if (name == "compact")
+	{
+		int maxFaces = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+		CompactMeshes(maxFaces);
+		return 0;
+	}
+	if (name == "curvatures")
+	{
+		int maxVertices = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+		BatchedCurvatures(maxVertices);
+		return 0;
+	}
+	if (name == "kernels")
+	{
+		int vertices = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+		KernelDispatch(vertices);
+		return 0;
+	}
+	if (name == "dihedral")
+	{
+		int edges = (argc > 3) ? std::stoi(argv[3]) : 4000000;
+		DihedralAngles(edges);
+		return 0;
+	}
+	if (name == "edit")
+	{
+		int vertices = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+		LocalEdits(vertices);
+		return 0;
+	}
+	if (name == "tensor")
+	{
+		int vertices = (argc > 3) ? std::stoi(argv[3]) : 10000000;
+		PrincipalCurvatureTensors(vertices);
+		return 0;
+	}
+	if (name == "tensor-smooth")
+	{
+		int vertices = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+		int iterations = (argc > 4) ? std::stoi(argv[4]) : 100;
+		TensorSmoothing(vertices, iterations);
+		return 0;
+	}
+	if (name == "smooth")
+	{
+		int vertices = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+		int steps = (argc > 4) ? std::stoi(argv[4]) : 10;
+		MeanCurvatureFlow(vertices, steps);
+		return 0;
+	}
+	if (name == "streamlines")
+	{
+		int faces = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+		double spacing = (argc > 4) ? std::stod(argv[4]) : 4.0;
+		LinesOfCurvature(faces, spacing);
+		return 0;
+	}
+	if (name == "init")
+	{
+		int faces = (argc > 3) ? std::stoi(argv[3]) : 2000000;
+		InitializeStages(faces);
+		return 0;
+	}
+	if (name == "subdivide")
+	{
+		int faces = (argc > 3) ? std::stoi(argv[3]) : 2000;
+		int levels = (argc > 4) ? std::stoi(argv[4]) : 5;
+		RepeatedSubdivision(faces, levels);
+		return 0;
+	}
+	if (name == "subdivide-threads")
+	{
+		int faces = (argc > 3) ? std::stoi(argv[3]) : 2000;
+		int levels = (argc > 4) ? std::stoi(argv[4]) : 5;
+		SubdivisionScaling(faces, levels);
+		return 0;
+	}
+	if (name == "stencil")
+	{
+		int faces = (argc > 3) ? std::stoi(argv[3]) : 2000;
+		int levels = (argc > 4) ? std::stoi(argv[4]) : 3;
+		SubdivisionStencils(faces, levels);
+		return 0;
+	}
+	if (name == "adaptive")
+	{
+		int faces = (argc > 3) ? std::stoi(argv[3]) : 20000;
+		int levels = (argc > 4) ? std::stoi(argv[4]) : 4;
+		AdaptiveRefinement(faces, levels);
+		return 0;
+	}
+	if (name == "stream")
+	{
+		int faces = (argc > 3) ? std::stoi(argv[3]) : 2000;
+		int levels = (argc > 4) ? std::stoi(argv[4]) : 6;
+		StreamingSubdivisionToDisk(faces, levels);
+		return 0;
+	}
+	if (name == "flipped")
+	{
+		int size = (argc > 3) ? std::stoi(argv[3]) : 8;
+		FlippedTriangles(size);
+		return 0;
+	}
+
+	std::cout << "UNKNOWN BENCHMARK: " << name << std::endl;
+	return -1;
+}
+
+void Benchmark::EdgeConstruction(int maxFaces)
+{
+	std::cout << "***** Edge construction: star scan vs. edge table *****" << std::endl;
+	std::cout << std::setw(12) << "faces"
+		<< std::setw(12) << "edges"
+		<< std::setw(16) << "star scan (ms)"
+		<< std::setw(16) << "edge table (ms)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "match" << std::endl;
+
+	for (int faces : GetFaceCounts(maxFaces))
+	{
+		// Reference construction.
+		Polyhedron* p = CreateTorus(faces);
+		p->ConnectVerticesToTriangles();
+		Timer timer;
+		CreateEdgesByStarScan(p);
+		double starScan = timer.Milliseconds();
+
+		// Record the edge of every triangle so the two constructions can be compared.
+		std::vector<int> reference;
+		reference.reserve(3 * p->tlist.size());
+		for (Triangle& t : p->tlist)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				reference.push_back(t.edges[j] ? t.edges[j]->index : -1);
+			}
+		}
+		int referenceEdges = p->elist.size();
+		delete(p);
+
+		// Edge table construction.
+		Polyhedron* q = CreateTorus(faces);
+		q->ConnectVerticesToTriangles();
+		timer.Start();
+		q->CreateEdges();
+		double edgeTable = timer.Milliseconds();
+
+		bool match = (referenceEdges == (int)q->elist.size());
+		for (int i = 0; match && i < (int)q->tlist.size(); ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				if (q->tlist[i].edges[j]->index != reference[3 * i + j])
+				{
+					match = false;
+				}
+			}
+		}
+
+		std::cout << std::setw(12) << q->tlist.size()
+			<< std::setw(12) << q->elist.size()
+			<< std::setw(16) << std::fixed << std::setprecision(1) << starScan
+			<< std::setw(16) << edgeTable
+			<< std::setw(9) << std::setprecision(2) << starScan / edgeTable << "x"
+			<< std::setw(8) << (match ? "yes" : "NO") << std::endl;
+		delete(q);
+	}
+}
+
+void Benchmark::TextLoading(int maxFaces)
+{
+	std::cout << "***** Text loading: line by line vs. tokenizer *****" << std::endl;
+	std::cout << "(files are read back from the page cache; \"read\" is the rate of just scanning the bytes)" << std::endl;
+	std::cout << std::setw(8) << "format"
+		<< std::setw(12) << "faces"
+		<< std::setw(12) << "size (MB)"
+		<< std::setw(14) << "read (MB/s)"
+		<< std::setw(14) << "lines (MB/s)"
+		<< std::setw(18) << "tokenizer (MB/s)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "match" << std::endl;
+
+	std::string directory = std::filesystem::temp_directory_path().string();
+	for (int faces : GetFaceCounts(maxFaces))
+	{
+		Polyhedron* mesh = CreateTorus(faces);
+		for (std::string format : { "obj", "ply" })
+		{
+			std::string file = directory + "/benchmark." + format;
+			if (format == "obj")
+				ObjFile::Write(file, *mesh);
+			else
+				WriteAsciiPly(mesh, file);
+			double megabytes = std::filesystem::file_size(file) / 1.0e6;
+
+			// Count the lines of the mapped file: every byte is looked at once.
+			Timer timer;
+			MappedFile mapping;
+			mapping.Open(file);
+			long lines = std::count(mapping.Data(), mapping.Data() + mapping.Size(), '\n');
+			mapping.Close();
+			double read = timer.Milliseconds();
+
+			// Reference loader.
+			Polyhedron* p = new Polyhedron();
+			timer.Start();
+			if (format == "obj")
+				ReadObjByLines(p, file);
+			else
+				ReadPlyByLines(p, file);
+			double byLines = timer.Milliseconds();
+
+			// Tokenizer.
+			Polyhedron* q = new Polyhedron(0, 0, 0);
+			timer.Start();
+			IOResult result = (format == "obj") ? ObjFile::Read(file, *q) : PlyFile::Read(file, *q);
+			double tokenizer = timer.Milliseconds();
+
+			bool match = result.success && lines > 0 && SameMesh(mesh, p) && SameMesh(mesh, q);
+
+			std::cout << std::setw(8) << format
+				<< std::setw(12) << mesh->tlist.size()
+				<< std::setw(12) << std::fixed << std::setprecision(1) << megabytes
+				<< std::setw(14) << megabytes / (read / 1000.0)
+				<< std::setw(14) << megabytes / (byLines / 1000.0)
+				<< std::setw(18) << megabytes / (tokenizer / 1000.0)
+				<< std::setw(9) << std::setprecision(2) << byLines / tokenizer << "x"
+				<< std::setw(8) << (match ? "yes" : "NO") << std::endl;
+
+			delete(p);
+			delete(q);
+			std::filesystem::remove(file);
+		}
+		delete(mesh);
+	}
+}
+
+void Benchmark::ParallelLoading(int faces)
+{
+	int hardwareThreads = Parallel::GetNumberOfThreads();
+	std::cout << "***** Parallel text loading *****" << std::endl;
+	std::cout << "(" << hardwareThreads << " hardware threads; files are read back from the page cache)" << std::endl;
+	std::cout << std::setw(8) << "format"
+		<< std::setw(12) << "faces"
+		<< std::setw(12) << "size (MB)"
+		<< std::setw(10) << "threads"
+		<< std::setw(12) << "load (ms)"
+		<< std::setw(10) << "MB/s"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "match" << std::endl;
+
+	std::string directory = std::filesystem::temp_directory_path().string();
+	Polyhedron* mesh = CreateTorus(faces);
+	for (std::string format : { "obj", "ply" })
+	{
+		std::string file = directory + "/benchmark." + format;
+		if (format == "obj")
+			ObjFile::Write(file, *mesh);
+		else
+			WriteAsciiPly(mesh, file);
+		double megabytes = std::filesystem::file_size(file) / 1.0e6;
+
+		double serial = 0.0;
+		for (int threads = 1; threads <= std::max(16, hardwareThreads); threads *= 2)
+		{
+			Parallel::SetNumberOfThreads(threads);
+			Polyhedron* p = new Polyhedron(0, 0, 0);
+			Timer timer;
+			IOResult result = (format == "obj") ? ObjFile::Read(file, *p) : PlyFile::Read(file, *p);
+			double load = timer.Milliseconds();
+			if (threads == 1)
+				serial = load;
+
+			std::cout << std::setw(8) << format
+				<< std::setw(12) << mesh->tlist.size()
+				<< std::setw(12) << std::fixed << std::setprecision(1) << megabytes
+				<< std::setw(10) << threads
+				<< std::setw(12) << load
+				<< std::setw(10) << megabytes / (load / 1000.0)
+				<< std::setw(9) << std::setprecision(2) << serial / load << "x"
+				<< std::setw(8) << ((result.success && SameMesh(mesh, p)) ? "yes" : "NO") << std::endl;
+			delete(p);
+		}
+		std::filesystem::remove(file);
+	}
+	Parallel::SetNumberOfThreads(0);
+	delete(mesh);
+}
+
+void Benchmark::CacheLoading(int maxFaces)
+{
+	std::cout << "***** Mesh cache: read and initialize vs. load cache *****" << std::endl;
+	std::cout << std::setw(12) << "faces"
+		<< std::setw(12) << ".obj (MB)"
+		<< std::setw(14) << "cache (MB)"
+		<< std::setw(18) << "read + init (ms)"
+		<< std::setw(12) << "save (ms)"
+		<< std::setw(12) << "hash (ms)"
+		<< std::setw(12) << "load (ms)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "match" << std::endl;
+
+	std::string directory = std::filesystem::temp_directory_path().string();
+	std::string source = directory + "/benchmark.obj";
+	std::string cache = MeshCache::GetCachePath(source, 0);
+	for (int faces : GetFaceCounts(maxFaces))
+	{
+		Polyhedron* mesh = CreateTorus(faces);
+		ObjFile::Write(source, *mesh);
+		delete(mesh);
+
+		Polyhedron* p = new Polyhedron(0, 0, 0);
+		Timer timer;
+		IOResult read = ObjFile::Read(source, *p);
+		p->Initialize();
+		double readAndInitialize = timer.Milliseconds();
+
+		timer.Start();
+		uint64_t hash = 0;
+		MeshCache::HashFile(source, hash);
+		double hashing = timer.Milliseconds();
+
+		timer.Start();
+		IOResult saved = MeshCache::Save(cache, *p, hash, 0);
+		double save = timer.Milliseconds();
+
+		Polyhedron* q = new Polyhedron(0, 0, 0);
+		timer.Start();
+		IOResult loaded = MeshCache::Load(cache, *q, hash, 0);
+		double load = timer.Milliseconds();
+
+		bool match = read.success && saved.success && loaded.success && SameMesh(p, q) && SameTopology(p, q);
+
+		std::cout << std::setw(12) << p->tlist.size()
+			<< std::setw(12) << std::fixed << std::setprecision(1) << std::filesystem::file_size(source) / 1.0e6
+			<< std::setw(14) << std::filesystem::file_size(cache) / 1.0e6
+			<< std::setw(18) << readAndInitialize
+			<< std::setw(12) << save
+			<< std::setw(12) << hashing
+			<< std::setw(12) << load
+			<< std::setw(9) << std::setprecision(2) << readAndInitialize / (hashing + load) << "x"
+			<< std::setw(8) << (match ? "yes" : "NO") << std::endl;
+
+		delete(p);
+		delete(q);
+		std::filesystem::remove(cache);
+	}
+	std::filesystem::remove(source);
+}
+
+void Benchmark::CompactMeshes(int maxFaces)
+{
+	std::cout << "***** Polyhedron vs. compact mesh *****" << std::endl;
+	std::cout << "(curvatures: all " << (int)Curvature::DIFFERENCE + 1 << " measures; subdivide: one Loop step, which comes out initialized)" << std::endl;
+	std::cout << std::setw(12) << "faces"
+		<< std::setw(8) << "mesh"
+		<< std::setw(14) << "memory (MB)"
+		<< std::setw(12) << "init (ms)"
+		<< std::setw(18) << "curvatures (ms)"
+		<< std::setw(16) << "subdivide (ms)"
+		<< std::setw(8) << "match" << std::endl;
+
+	for (int faces : GetFaceCounts(maxFaces))
+	{
+		Polyhedron* p = CreateTorus(faces);
+		CompactMesh m(*p);
+		Timer timer;
+		p->Initialize();
+		double polyhedronInitialize = timer.Milliseconds();
+
+		timer.Start();
+		m.Initialize();
+		double compactInitialize = timer.Milliseconds();
+
+		// Every curvature, on both, compared value for value.
+		bool match = true;
+		double polyhedronCurvatures = 0.0;
+		double compactCurvatures = 0.0;
+		for (int i = 0; i <= (int)Curvature::DIFFERENCE; ++i)
+		{
+			timer.Start();
+			std::vector<double> reference = MeshAnalysis::GetVertexCurvatures(p, (Curvature)i);
+			polyhedronCurvatures += timer.Milliseconds();
+
+			timer.Start();
+			std::vector<double> curvatures = MeshAnalysis::GetVertexCurvatures(m, (Curvature)i);
+			compactCurvatures += timer.Milliseconds();
+
+			// Some measures are NaN at degenerate stars; those must be NaN on both.
+			for (int j = 0; match && j < reference.size(); ++j)
+			{
+				match = (reference[j] == curvatures[j]) || (std::isnan(reference[j]) && std::isnan(curvatures[j]));
+			}
+		}
+
+		timer.Start();
+		Polyhedron* loop = Subdivision::LoopSubdivisionHeap(p);
+		double polyhedronSubdivide = timer.Milliseconds();
+
+		timer.Start();
+		CompactMesh compactLoop = Subdivision::LoopSubdivision(m);
+		double compactSubdivide = timer.Milliseconds();
+
+		match = match && loop->vlist.size() == compactLoop.positions.size() && loop->elist.size() == compactLoop.edgeHalfEdges.size();
+		for (int i = 0; match && i < loop->vlist.size(); ++i)
+		{
+			match = (loop->vlist[i].GetPosition() == compactLoop.positions[i]) && (loop->vlist[i].normal == compactLoop.normals[i]);
+		}
+
+		std::cout << std::setw(12) << p->tlist.size()
+			<< std::setw(8) << "poly"
+			<< std::setw(14) << std::fixed << std::setprecision(1) << GetMemoryUsage(p) / 1.0e6
+			<< std::setw(12) << polyhedronInitialize
+			<< std::setw(18) << polyhedronCurvatures
+			<< std::setw(16) << polyhedronSubdivide << std::endl;
+		std::cout << std::setw(12) << ""
+			<< std::setw(8) << "compact"
+			<< std::setw(14) << m.GetMemoryUsage() / 1.0e6
+			<< std::setw(12) << compactInitialize
+			<< std::setw(18) << compactCurvatures
+			<< std::setw(16) << compactSubdivide
+			<< std::setw(8) << (match ? "yes" : "NO") << std::endl;
+
+		delete(p);
+		delete(loop);
+	}
+}
+
+void Benchmark::BatchedCurvatures(int maxVertices)
+{
+	int hardwareThreads = Parallel::GetNumberOfThreads();
+	std::cout << "***** All 14 curvatures: one pass each vs. one batched pass *****" << std::endl;
+	std::cout << std::setw(12) << "vertices"
+		<< std::setw(18) << "14 passes (ms)"
+		<< std::setw(18) << "batched (ms)"
+		<< std::setw(24) << "batched, " + std::to_string(hardwareThreads) + " threads (ms)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "match" << std::endl;
+
+	std::vector<Curvature> curvatures;
+	for (int i = 0; i <= (int)Curvature::DIFFERENCE; ++i)
+	{
+		curvatures.push_back((Curvature)i);
+	}
+
+	for (int vertices = 100000; vertices <= maxVertices; vertices *= 10)
+	{
+		// A closed torus has two faces per vertex.
+		Polyhedron* p = CreateTorus(2 * vertices);
+		p->Initialize();
+
+		// One curvature at a time on one thread, the way main.cpp used to ask for them.
+		Parallel::SetNumberOfThreads(1);
+		Timer timer;
+		std::vector<std::vector<double>> reference;
+		for (Curvature curvature : curvatures)
+		{
+			reference.push_back(MeshAnalysis::GetVertexCurvatures(p, curvature));
+		}
+		double separate = timer.Milliseconds();
+
+		timer.Start();
+		std::vector<std::vector<double>> serial = MeshAnalysis::GetVertexCurvatures(p, curvatures);
+		double batched = timer.Milliseconds();
+
+		Parallel::SetNumberOfThreads(0);
+		timer.Start();
+		std::vector<std::vector<double>> parallel = MeshAnalysis::GetVertexCurvatures(p, curvatures);
+		double batchedParallel = timer.Milliseconds();
+
+		// Some measures are NaN at degenerate stars; those must be NaN in all three.
+		bool match = true;
+		for (int k = 0; match && k < curvatures.size(); ++k)
+		{
+			for (int i = 0; match && i < reference[k].size(); ++i)
+			{
+				double a = reference[k][i];
+				match = (a == serial[k][i] && a == parallel[k][i])
+					|| (std::isnan(a) && std::isnan(serial[k][i]) && std::isnan(parallel[k][i]));
+			}
+		}
+
+		std::cout << std::setw(12) << p->vlist.size()
+			<< std::setw(18) << std::fixed << std::setprecision(1) << separate
+			<< std::setw(18) << batched
+			<< std::setw(24) << batchedParallel
+			<< std::setw(9) << std::setprecision(2) << separate / batchedParallel << "x"
+			<< std::setw(8) << (match ? "yes" : "NO") << std::endl;
+		delete(p);
+	}
+}
+
+template <Curvature... Cs>
+void Benchmark::TimeKernels(Polyhedron* p, const std::string& name)
+{
+	std::vector<Curvature> curvatures = { Cs... };
+	double runtime = std::numeric_limits<double>::max();
+	double compiled = std::numeric_limits<double>::max();
+	bool match = true;
+	for (int i = 0; i < 3; ++i)
+	{
+		Timer timer;
+		std::vector<std::vector<double>> reference = MeshAnalysis::GetVertexCurvatures(p, curvatures);
+		runtime = std::min(runtime, timer.Milliseconds());
+
+		timer.Start();
+		std::vector<std::vector<double>> values = MeshAnalysis::GetVertexCurvatures<Cs...>(p);
+		compiled = std::min(compiled, timer.Milliseconds());
+
+		for (int k = 0; match && k < curvatures.size(); ++k)
+		{
+			for (int j = 0; match && j < values[k].size(); ++j)
+			{
+				match = (reference[k][j] == values[k][j]) || (std::isnan(reference[k][j]) && std::isnan(values[k][j]));
+			}
+		}
+	}
+
+	double nanoseconds = 1e6 / p->vlist.size();
+	std::cout << std::setw(28) << std::left << name << std::right
+		<< std::setw(16) << std::fixed << std::setprecision(1) << runtime * nanoseconds
+		<< std::setw(20) << compiled * nanoseconds
+		<< std::setw(9) << std::setprecision(2) << runtime / compiled << "x"
+		<< std::setw(8) << (match ? "yes" : "NO") << std::endl;
+}
+
+void Benchmark::KernelDispatch(int vertices)
+{
+	// A closed torus has two faces per vertex.
+	Polyhedron* p = CreateTorus(2 * vertices);
+	p->Initialize();
+
+	std::cout << "***** Curvature kernels: runtime table vs. compile time *****" << std::endl;
+	std::cout << "(" << p->vlist.size() << " vertices, 1 thread)" << std::endl;
+	std::cout << std::setw(28) << std::left << "curvature" << std::right
+		<< std::setw(16) << "runtime (ns)"
+		<< std::setw(20) << "compile time (ns)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "match" << std::endl;
+
+	Parallel::SetNumberOfThreads(1);
+	TimeKernels<Curvature::HORIZON>(p, "horizon");
+	TimeKernels<Curvature::MEAN>(p, "mean");
+	TimeKernels<Curvature::GAUSSIAN>(p, "gaussian");
+	TimeKernels<Curvature::ORIGINAL>(p, "original");
+	TimeKernels<Curvature::DISTORTION>(p, "distortion");
+	TimeKernels<Curvature::CONE>(p, "cone");
+	TimeKernels<Curvature::DISTORTION_SIGNED>(p, "signed distortion");
+	TimeKernels<Curvature::MEAN_SIGNED>(p, "signed mean");
+	TimeKernels<Curvature::MAX_PRINCIPAL_DISTORTION>(p, "max principal distortion");
+	TimeKernels<Curvature::MIN_PRINCIPAL_DISTORTION>(p, "min principal distortion");
+	TimeKernels<Curvature::FALSE_GAUSSIAN>(p, "false gaussian");
+	TimeKernels<Curvature::FALSE_MEAN>(p, "false mean");
+	TimeKernels<Curvature::PRINCIPAL_DEVIATION>(p, "principal deviation");
+	TimeKernels<Curvature::DIFFERENCE>(p, "difference");
+	TimeKernels<Curvature::HORIZON, Curvature::MEAN, Curvature::GAUSSIAN, Curvature::ORIGINAL, Curvature::DISTORTION,
+		Curvature::CONE, Curvature::DISTORTION_SIGNED, Curvature::MEAN_SIGNED, Curvature::MAX_PRINCIPAL_DISTORTION,
+		Curvature::MIN_PRINCIPAL_DISTORTION, Curvature::FALSE_GAUSSIAN, Curvature::FALSE_MEAN, Curvature::PRINCIPAL_DEVIATION,
+		Curvature::DIFFERENCE>(p, "all 14 in one pass");
+	Parallel::SetNumberOfThreads(0);
+	delete(p);
+}
+
+void Benchmark::DihedralAngles(int edges)
+{
+	// Pairs of unit normals a little apart, like neighbouring faces, and random tangents.
+	std::mt19937 generator(1);
+	std::normal_distribution<double> normal(0.0, 1.0);
+	std::vector<glm::dvec3> currents(edges);
+	std::vector<glm::dvec3> nexts(edges);
+	std::vector<glm::dvec3> tangents(edges);
+	Dihedral::Batch batch(edges);
+	for (int i = 0; i < edges; ++i)
+	{
+		glm::dvec3 current(normal(generator), normal(generator), normal(generator));
+		glm::dvec3 bend(normal(generator), normal(generator), normal(generator));
+		currents[i] = glm::normalize(current);
+		nexts[i] = glm::normalize(currents[i] + 0.2 * bend);
+		tangents[i] = glm::dvec3(normal(generator), normal(generator), normal(generator));
+		batch.Set(i, currents[i], nexts[i], tangents[i]);
+	}
+
+	// What MeshAnalysis did per edge before.
+	std::vector<double> reference(edges);
+	Timer timer;
+	for (int i = 0; i < edges; ++i)
+	{
+		double dot = glm::clamp(glm::dot(currents[i], nexts[i]), -1.0, 1.0);
+		double angle = acos(dot);
+		if (glm::dot(glm::cross(currents[i], nexts[i]), tangents[i]) > 0)
+			angle *= -1.0;
+		reference[i] = angle;
+	}
+	double separate = timer.Milliseconds();
+
+	std::vector<double> scalar(edges);
+	Dihedral::SetScalar(true);
+	timer.Start();
+	Dihedral::ComputeSignedAngles(batch.GetEdges(), edges, scalar.data());
+	double scalarTime = timer.Milliseconds();
+
+	std::vector<double> vector(edges);
+	Dihedral::SetScalar(false);
+	timer.Start();
+	Dihedral::ComputeSignedAngles(batch.GetEdges(), edges, vector.data());
+	double vectorTime = timer.Milliseconds();
+
+	bool same = true;
+	double difference = 0.0;
+	for (int i = 0; i < edges; ++i)
+	{
+		same = same && (scalar[i] == vector[i]);
+		difference = std::max(difference, std::abs(vector[i] - reference[i]));
+	}
+
+	double nanoseconds = 1e6 / edges;
+	std::cout << "***** Signed dihedral angles of " << edges << " edges, 1 thread *****" << std::endl;
+	std::cout << std::setw(28) << std::left << "std::acos, per edge" << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+		<< separate * nanoseconds << " ns" << std::endl;
+	std::cout << std::setw(28) << std::left << "ComputeSignedAngles, scalar" << std::right << std::setw(10)
+		<< scalarTime * nanoseconds << " ns" << std::endl;
+	std::cout << std::setw(28) << std::left << std::string("ComputeSignedAngles, ") + Dihedral::GetInstructionSet() << std::right << std::setw(10)
+		<< vectorTime * nanoseconds << " ns" << std::endl;
+	std::cout << "scalar and vector agree: " << (same ? "yes" : "NO")
+		<< "; largest difference from std::acos: " << std::scientific << std::setprecision(2) << difference << std::endl;
+	std::cout << std::defaultfloat;
+}
+
+void Benchmark::LocalEdits(int vertices)
+{
+	std::vector<Curvature> curvatures;
+	for (int i = 0; i <= (int)Curvature::DIFFERENCE; ++i)
+	{
+		curvatures.push_back((Curvature)i);
+	}
+
+	Polyhedron* p = CreateTorus(2 * vertices);
+	p->Initialize();
+	std::vector<std::vector<double>> values = MeshAnalysis::GetVertexCurvatures(p, curvatures);
+
+	std::cout << "***** Local edits of " << p->vlist.size() << " vertices, all 14 curvatures *****" << std::endl;
+	std::cout << "(match: the same normals, angles, mixed areas and curvatures as initializing the moved mesh)" << std::endl;
+	std::cout << std::setw(10) << "moved"
+		<< std::setw(10) << "updated"
+		<< std::setw(18) << "incremental (ms)"
+		<< std::setw(12) << "full (ms)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "match" << std::endl;
+
+	// Push a run of vertices a little along their normals. The edits add up, so each full pass sees all of them.
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<double> offset(-0.01, 0.01);
+	for (int moved = 1; moved <= p->vlist.size() / 10; moved *= 10)
+	{
+		int first = std::uniform_int_distribution<int>(0, p->vlist.size() - moved)(generator);
+		Timer timer;
+		for (int i = first; i < first + moved; ++i)
+		{
+			Vert& v = p->vlist[i];
+			p->MoveVertex(i, v.GetPosition() + offset(generator) * v.normal);
+		}
+		std::vector<int> updated = p->Update();
+		MeshAnalysis::UpdateVertexCurvatures(p, updated, curvatures, values);
+		double incremental = timer.Milliseconds();
+
+		Polyhedron* q = CreateTorus(2 * vertices);
+		for (int i = 0; i < q->vlist.size(); ++i)
+		{
+			q->vlist[i].x = p->vlist[i].x;
+			q->vlist[i].y = p->vlist[i].y;
+			q->vlist[i].z = p->vlist[i].z;
+		}
+		timer.Start();
+		q->Initialize();
+		std::vector<std::vector<double>> reference = MeshAnalysis::GetVertexCurvatures(q, curvatures);
+		double full = timer.Milliseconds();
+
+		auto same = [](double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); };
+		bool match = true;
+		for (int i = 0; match && i < p->vlist.size(); ++i)
+		{
+			Vert& v = p->vlist[i];
+			Vert& w = q->vlist[i];
+			match = v.normal == w.normal && v.totalAngle == w.totalAngle
+				&& same(v.mixedArea, w.mixedArea) && same(v.mixedPerimeter, w.mixedPerimeter);
+			for (int k = 0; match && k < curvatures.size(); ++k)
+			{
+				match = same(values[k][i], reference[k][i]);
+			}
+		}
+
+		std::cout << std::setw(10) << moved
+			<< std::setw(10) << updated.size()
+			<< std::setw(18) << std::fixed << std::setprecision(3) << incremental
+			<< std::setw(12) << std::setprecision(1) << full
+			<< std::setw(9) << std::setprecision(0) << full / incremental << "x"
+			<< std::setw(8) << (match ? "yes" : "NO") << std::endl;
+		delete(q);
+	}
+	delete(p);
+}
+
+void Benchmark::PrincipalCurvatureTensors(int vertices)
+{
+	int hardwareThreads = Parallel::GetNumberOfThreads();
+	Polyhedron* p = CreateTorus(2 * vertices);
+	p->Initialize();
+
+	// On the torus of CreateTorus(), the vertex in column j of a ring is at the angle phi = 2 pi j / sides around the tube,
+	// where the principal curvatures are 1 / r around the tube and cos(phi) / (R + r cos(phi)) around the axis.
+	int sides = std::max(3, (int)std::round(std::sqrt(2 * vertices / 6.0)));
+	const double R = 1.0;
+	const double r = 0.35;
+
+	std::cout << "***** Principal curvatures of " << p->vlist.size() << " vertices *****" << std::endl;
+	std::cout << std::setw(24) << std::left << "" << std::right
+		<< std::setw(14) << "1 thread (ms)"
+		<< std::setw(24) << std::to_string(hardwareThreads) + " threads (ms)"
+		<< std::setw(16) << "ns per vertex"
+		<< std::setw(16) << "largest error" << std::endl;
+
+	for (int fused = 1; fused >= 0; --fused)
+	{
+		double times[2];
+		PrincipalCurvatures principal;
+		for (int all = 0; all < 2; ++all)
+		{
+			Parallel::SetNumberOfThreads(all ? 0 : 1);
+			Timer timer;
+			if (fused)
+				principal = CurvatureTensor::GetPrincipalCurvatures(p);
+			else
+				principal = CurvatureTensor::GetEigenSpaces(CurvatureTensor::GetCurvatureTensors(p));
+			times[all] = timer.Milliseconds();
+		}
+
+		double error = 0.0;
+		for (int i = 0; i < p->vlist.size(); ++i)
+		{
+			double phi = 2.0 * M_PI * (i % sides) / sides;
+			double tube = 1.0 / r;
+			double axis = cos(phi) / (R + r * cos(phi));
+			error = std::max(error, std::abs(principal.k1[i] - std::min(tube, axis)));
+			error = std::max(error, std::abs(principal.k2[i] - std::max(tube, axis)));
+		}
+
+		std::cout << std::setw(24) << std::left << (fused ? "fused" : "tensors, then eigen") << std::right
+			<< std::setw(14) << std::fixed << std::setprecision(1) << times[0]
+			<< std::setw(24) << times[1]
+			<< std::setw(16) << 1e6 * times[1] / p->vlist.size()
+			<< std::setw(16) << std::scientific << std::setprecision(2) << error << std::defaultfloat << std::endl;
+	}
+	delete(p);
+}
+
+void Benchmark::TensorSmoothing(int vertices, int iterations)
+{
+	Polyhedron* p = CreateTorus(2 * vertices);
+	p->Initialize();
+	std::vector<TangentSpace> tensors = CurvatureTensor::GetCurvatureTensors(p);
+
+	// A quarter of the smallest mixed area keeps the explicit steps stable.
+	double minArea = std::numeric_limits<double>::max();
+	for (Vert& v : p->vlist)
+	{
+		minArea = std::min(minArea, v.mixedArea);
+	}
+	double dt = 0.25 * minArea;
+	const int IMPLICIT_STEPS = std::max(1, iterations / 10);
+
+	// The largest difference of a smoothed tensor entry from the reference.
+	auto difference = [&](const std::vector<TangentSpace>& a, const std::vector<TangentSpace>& b)
+	{
+		double largest = 0.0;
+		for (int i = 0; i < a.size(); ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					largest = std::max(largest, std::abs(a[i].curvatureTensorGlobal[j][k] - b[i].curvatureTensorGlobal[j][k]));
+				}
+			}
+		}
+		return largest;
+	};
+
+	std::vector<TangentSpace> reference = tensors;
+	Timer timer;
+	SmoothTensorEntries(p, reference, dt, iterations);
+	double entries = timer.Milliseconds();
+
+	std::vector<TangentSpace> block = tensors;
+	timer.Start();
+	CurvatureTensor::SmoothCurvatureTensor(p, block, dt, iterations);
+	double explicitTime = timer.Milliseconds();
+
+	std::vector<TangentSpace> implicit = tensors;
+	timer.Start();
+	CurvatureTensor::SmoothCurvatureTensor(p, implicit, dt * iterations / IMPLICIT_STEPS, IMPLICIT_STEPS, true);
+	double implicitTime = timer.Milliseconds();
+
+	std::cout << "***** Curvature tensor smoothing, " << p->vlist.size() << " vertices, "
+		<< Parallel::GetNumberOfThreads() << " threads *****" << std::endl;
+	std::cout << "(the same total time dt * steps for each; difference: largest change of a tensor entry from the first row)" << std::endl;
+	std::cout << std::setw(34) << std::left << "" << std::right
+		<< std::setw(8) << "steps"
+		<< std::setw(12) << "time (ms)"
+		<< std::setw(16) << "difference" << std::endl;
+	std::cout << std::setw(34) << std::left << "9 entries, one pass each" << std::right
+		<< std::setw(8) << iterations
+		<< std::setw(12) << std::fixed << std::setprecision(1) << entries
+		<< std::setw(16) << "" << std::endl;
+	std::cout << std::setw(34) << std::left << "Laplacian, explicit, 6 channels" << std::right
+		<< std::setw(8) << iterations
+		<< std::setw(12) << explicitTime
+		<< std::setw(16) << std::scientific << std::setprecision(2) << difference(reference, block) << std::defaultfloat << std::endl;
+	std::cout << std::setw(34) << std::left << "Laplacian, backward Euler" << std::right
+		<< std::setw(8) << IMPLICIT_STEPS
+		<< std::setw(12) << std::fixed << std::setprecision(1) << implicitTime
+		<< std::setw(16) << std::scientific << std::setprecision(2) << difference(reference, implicit) << std::defaultfloat << std::endl;
+	delete(p);
+}
+
+void Benchmark::MeanCurvatureFlow(int vertices, int steps)
+{
+	// Each run starts from the same noisy torus: every vertex pushed off the surface by up to a fifth of an edge.
+	Polyhedron* original = CreateTorus(2 * vertices);
+	double edge = 2.0 * M_PI * 0.35 / std::max(3, (int)std::round(std::sqrt(vertices / 3.0)));
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<double> offset(-0.2 * edge, 0.2 * edge);
+	for (Vert& v : original->vlist)
+	{
+		v.x += offset(generator);
+		v.y += offset(generator);
+		v.z += offset(generator);
+	}
+	original->Initialize();
+
+	// Root mean square of the dihedral angles, which the noise makes large and the flow brings down to the bend of the torus.
+	auto noise = [](Polyhedron* p)
+	{
+		double sum = 0.0;
+		for (Edge& e : p->elist)
+		{
+			sum += e.dihedral * e.dihedral;
+		}
+		return std::sqrt(sum / p->elist.size());
+	};
+
+	// A fiftieth of the time it takes the tube to shrink away, r^2 / 2, in the given number of implicit steps.
+	double totalTime = 0.02 * 0.5 * 0.35 * 0.35;
+	double dt = totalTime / steps;
+
+	std::cout << "***** Mean curvature flow, " << original->vlist.size() << " vertices, "
+		<< Parallel::GetNumberOfThreads() << " threads, flow time " << totalTime << " *****" << std::endl;
+	std::cout << "(setup: building the Laplacian, and factoring it; each step includes Polyhedron::Update(); noise: rms dihedral angle, before: "
+		<< std::scientific << std::setprecision(2) << noise(original) << std::defaultfloat << ")" << std::endl;
+	std::cout << std::setw(28) << std::left << "" << std::right
+		<< std::setw(10) << "steps"
+		<< std::setw(14) << "setup (ms)"
+		<< std::setw(14) << "steps (ms)"
+		<< std::setw(14) << "total (ms)"
+		<< std::setw(12) << "noise" << std::endl;
+
+	auto row = [&](const std::string& name, int numSteps, double setup, double stepping, double remaining, Polyhedron* p)
+	{
+		std::cout << std::setw(28) << std::left << name << std::right
+			<< std::setw(10) << numSteps
+			<< std::setw(14) << std::fixed << std::setprecision(1) << setup
+			<< std::setw(14) << stepping
+			<< std::setw(14) << setup + stepping + remaining;
+		if (p != NULL)
+			std::cout << std::setw(12) << std::scientific << std::setprecision(2) << noise(p);
+		std::cout << std::defaultfloat << std::endl;
+	};
+
+	const Smoothing::Method IMPLICIT_METHODS[2] = { Smoothing::Method::IMPLICIT, Smoothing::Method::IMPLICIT_ITERATIVE };
+	const std::string IMPLICIT_NAMES[2] = { "implicit, Cholesky", "implicit, conjugate gradients" };
+	for (int k = 0; k < 2; ++k)
+	{
+		Polyhedron p = *original;
+		Timer timer;
+		Smoothing smoothing(&p, IMPLICIT_METHODS[k], dt);
+		double setup = timer.Milliseconds();
+		timer.Start();
+		std::vector<int> moved;
+		int step = 0;
+		while (step < steps && smoothing.Step(moved))
+		{
+			++step;
+		}
+		row(IMPLICIT_NAMES[k], step, setup, timer.Milliseconds(), 0.0, &p);
+	}
+
+	// Explicit steps rebuild the Laplacian every step, as the flow would. If they would take too long, the first
+	// hundred are timed and the rest estimated from them.
+	Polyhedron p = *original;
+	Timer timer;
+	Laplacian laplacian;
+	laplacian.Build(&p);
+	double limit = laplacian.GetExplicitLimit();
+	int explicitSteps = (int)std::ceil(totalTime / limit);
+	int timedSteps = std::min(explicitSteps, 100);
+	Smoothing smoothing(&p, Smoothing::Method::EXPLICIT, totalTime / explicitSteps);
+	double setup = timer.Milliseconds();
+	timer.Start();
+	std::vector<int> moved;
+	for (int step = 0; step < timedSteps; ++step)
+	{
+		smoothing.Step(moved);
+	}
+	double stepping = timer.Milliseconds();
+	double remaining = stepping * (explicitSteps - timedSteps) / timedSteps;
+	row(timedSteps < explicitSteps ? "explicit (estimated)" : "explicit", explicitSteps, setup, stepping, remaining,
+		timedSteps < explicitSteps ? NULL : &p);
+	delete(original);
+}
+
+void Benchmark::LinesOfCurvature(int faces, double spacing)
+{
+	int hardwareThreads = Parallel::GetNumberOfThreads();
+	Polyhedron* p = CreateTorus(faces);
+	p->Initialize();
+	double edge = 0.0;
+	for (Edge& e : p->elist)
+	{
+		edge += e.length;
+	}
+	edge /= p->elist.size();
+
+	Timer timer;
+	PrincipalCurvatures principal = CurvatureTensor::GetPrincipalCurvatures(p);
+	std::vector<glm::dvec3> minorStream(p->tlist.size());
+	std::vector<glm::dvec3> majorStream(p->tlist.size());
+	CurvatureTensor::GetTriangleStreamlines(p, principal, minorStream, majorStream);
+	double fieldTime = timer.Milliseconds();
+
+	std::cout << "***** Lines of curvature, " << p->tlist.size() << " faces, a line per " << spacing << " x " << spacing
+		<< " edges *****" << std::endl;
+	std::cout << "(principal curvatures and triangle directions on " << hardwareThreads << " threads: " << std::fixed
+		<< std::setprecision(1) << fieldTime << " ms; off line: the distance a line travels across its exact line of curvature,"
+		<< " per unit of length)" << std::defaultfloat << std::endl;
+	std::cout << std::setw(24) << std::left << "" << std::right
+		<< std::setw(14) << "segments"
+		<< std::setw(14) << "1 thread (ms)"
+		<< std::setw(24) << std::to_string(hardwareThreads) + " threads (ms)"
+		<< std::setw(12) << "off line" << std::endl;
+
+	// The larger principal curvature is the one around the tube, so its lines keep the angle theta around the axis,
+	// and those of the smaller keep the angle phi around the tube.
+	const std::vector<glm::dvec3>* fields[2] = { &majorStream, &minorStream };
+	const std::string NAMES[2] = { "around the tube", "around the axis" };
+	for (int k = 0; k < 2; ++k)
+	{
+		std::vector<LineVertex> vertices;
+		double times[2];
+		for (int all = 0; all < 2; ++all)
+		{
+			vertices.clear();
+			Parallel::SetNumberOfThreads(all ? 0 : 1);
+			timer.Start();
+			Streamlines::Trace(p, *fields[k], spacing * edge, 10.0 * spacing * edge, glm::vec3(1.0f), vertices);
+			times[all] = timer.Milliseconds();
+		}
+
+		double across = 0.0;
+		double length = 0.0;
+		for (int i = 0; i + 1 < vertices.size(); i += 2)
+		{
+			glm::dvec3 a = (glm::dvec3)vertices[i].GetPosition();
+			glm::dvec3 b = (glm::dvec3)vertices[i + 1].GetPosition();
+			double rhoA = std::sqrt(a.x * a.x + a.y * a.y);
+			double rhoB = std::sqrt(b.x * b.x + b.y * b.y);
+			if (k == 0)
+				across += std::abs(std::remainder(std::atan2(b.y, b.x) - std::atan2(a.y, a.x), 2.0 * M_PI)) * rhoA;
+			else
+				across += std::abs(std::remainder(std::atan2(b.z, rhoB - 1.0) - std::atan2(a.z, rhoA - 1.0), 2.0 * M_PI)) * 0.35;
+			length += glm::length(b - a);
+		}
+
+		std::cout << std::setw(24) << std::left << NAMES[k] << std::right
+			<< std::setw(14) << vertices.size() / 2
+			<< std::setw(14) << std::fixed << std::setprecision(1) << times[0]
+			<< std::setw(24) << times[1]
+			<< std::setw(12) << std::scientific << std::setprecision(2) << ((length > 0) ? across / length : 0.0)
+			<< std::defaultfloat << std::endl;
+	}
+	delete(p);
+}
+
+void Benchmark::SmoothTensorEntries(Polyhedron* p, std::vector<TangentSpace>& tangentSpaces, double dt, int iterations)
+{
+	// What SmoothCurvatureTensor() did before the Laplacian was assembled: every entry on its own,
+	// with the cotangent weights gathered around every vertex again at every step.
+	std::vector<double> values(p->vlist.size());
+	std::vector<double> next(p->vlist.size());
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			for (Vert& v : p->vlist)
+			{
+				values[v.index] = tangentSpaces[v.index].curvatureTensorGlobal[j][i];
+			}
+
+			for (int iteration = 0; iteration < iterations; ++iteration)
+			{
+				for (Vert& v : p->vlist)
+				{
+					int k = v.index;
+					next[k] = values[k];
+					if (v.mixedArea <= 0)
+						continue;
+
+					double laplacian = 0.0;
+					for (Triangle* t : v.triangles)
+					{
+						Corner& c = p->clist[3 * t->index + t->Contains(&v)];
+						laplacian += c.p->cotangent * (values[c.n->v->index] - values[k]);
+						laplacian += c.n->cotangent * (values[c.p->v->index] - values[k]);
+					}
+					next[k] += dt * laplacian / (2.0 * v.mixedArea);
+				}
+				values.swap(next);
+			}
+
+			for (Vert& v : p->vlist)
+			{
+				tangentSpaces[v.index].curvatureTensorGlobal[j][i] = values[v.index];
+			}
+		}
+	}
+}
+
+void Benchmark::InitializeStages(int faces)
+{
+	int hardwareThreads = Parallel::GetNumberOfThreads();
+	std::cout << "***** Polyhedron::Initialize() by stage *****" << std::endl;
+
+	// The same mesh, initialized on one thread and then on all of them.
+	Parallel::SetNumberOfThreads(1);
+	Polyhedron* serial = CreateTorus(faces);
+	serial->Initialize();
+	Parallel::SetNumberOfThreads(0);
+	Polyhedron* parallel = CreateTorus(faces);
+	parallel->Initialize();
+
+	bool match = SameTopology(serial, parallel)
+		&& serial->surfaceArea == parallel->surfaceArea
+		&& serial->angleDeficit == parallel->angleDeficit
+		&& serial->radius == parallel->radius;
+	for (int i = 0; match && i < serial->vlist.size(); ++i)
+	{
+		match = serial->vlist[i].normal == parallel->vlist[i].normal;
+	}
+
+	std::cout << "(" << serial->tlist.size() << " faces; results " << (match ? "match" : "DO NOT MATCH") << ")" << std::endl;
+	std::cout << std::setw(32) << std::left << "stage" << std::right
+		<< std::setw(14) << "1 thread (ms)"
+		<< std::setw(24) << std::to_string(hardwareThreads) + " threads (ms)"
+		<< std::setw(10) << "speedup" << std::endl;
+
+	const std::vector<StageTimer::Stage>& serialStages = serial->initializeTimes.GetStages();
+	const std::vector<StageTimer::Stage>& parallelStages = parallel->initializeTimes.GetStages();
+	for (int i = 0; i < serialStages.size(); ++i)
+	{
+		double one = serialStages[i].milliseconds;
+		double all = parallelStages[i].milliseconds;
+		std::cout << std::setw(32) << std::left << serialStages[i].name << std::right
+			<< std::setw(14) << std::fixed << std::setprecision(1) << one
+			<< std::setw(24) << all
+			<< std::setw(9) << std::setprecision(2) << one / all << "x" << std::endl;
+	}
+	double one = serial->initializeTimes.GetTotalMilliseconds();
+	double all = parallel->initializeTimes.GetTotalMilliseconds();
+	std::cout << std::setw(32) << std::left << "total" << std::right
+		<< std::setw(14) << std::fixed << std::setprecision(1) << one
+		<< std::setw(24) << all
+		<< std::setw(9) << std::setprecision(2) << one / all << "x" << std::endl;
+
+	delete(serial);
+	delete(parallel);
+}
+
+void Benchmark::RepeatedSubdivision(int faces, int levels)
+{
+	std::cout << "***** Repeated Loop subdivision *****" << std::endl;
+	std::cout << "(release: moving the new level over the old one frees the old one)" << std::endl;
+	std::cout << std::setw(8) << "level"
+		<< std::setw(12) << "faces"
+		<< std::setw(16) << "subdivide (ms)"
+		<< std::setw(14) << "release (ms)"
+		<< std::setw(12) << "total (ms)"
+		<< std::setw(16) << "peak RSS (MB)" << std::endl;
+
+	Polyhedron* p = CreateTorus(faces);
+	p->Initialize();
+
+	double total = 0.0;
+	for (int level = 1; level <= levels; ++level)
+	{
+		Timer timer;
+		Polyhedron loop = Subdivision::LoopSubdivision(p);
+		double subdivide = timer.Milliseconds();
+
+		timer.Start();
+		*p = std::move(loop);
+		double release = timer.Milliseconds();
+
+		total += subdivide + release;
+		std::cout << std::setw(8) << level
+			<< std::setw(12) << p->tlist.size()
+			<< std::setw(16) << std::fixed << std::setprecision(1) << subdivide
+			<< std::setw(14) << release
+			<< std::setw(12) << total
+			<< std::setw(16) << GetPeakMemory() << std::endl;
+	}
+
+	// Where the time of the last level went: the new topology, then the geometry on it.
+	std::cout << "Stages of the last level:" << std::endl;
+	p->initializeTimes.Print(std::cout);
+
+	Timer timer;
+	delete(p);
+	std::cout << "Releasing the last level took " << std::fixed << std::setprecision(1) << timer.Milliseconds() << " ms." << std::endl;
+}
+
+void Benchmark::SubdivisionScaling(int faces, int levels)
+{
+	int hardwareThreads = Parallel::GetNumberOfThreads();
+	std::cout << "***** Loop subdivision across thread counts *****" << std::endl;
+	std::cout << "(" << hardwareThreads << " hardware threads; " << levels << " levels, each initialized;"
+		<< " match: the same positions and normals as on one thread)" << std::endl;
+	std::cout << std::setw(10) << "threads"
+		<< std::setw(12) << "faces"
+		<< std::setw(16) << "subdivide (ms)"
+		<< std::setw(18) << "last level (ms)"
+		<< std::setw(18) << "Mfaces/s (last)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(8) << "match" << std::endl;
+
+	std::vector<glm::dvec3> reference;
+	double serial = 0.0;
+	for (int threads = 1; threads <= std::max(16, hardwareThreads); threads *= 2)
+	{
+		Parallel::SetNumberOfThreads(threads);
+		Polyhedron* p = CreateTorus(faces);
+		p->Initialize();
+
+		double total = 0.0;
+		double last = 0.0;
+		for (int level = 1; level <= levels; ++level)
+		{
+			Timer timer;
+			*p = Subdivision::LoopSubdivision(p);
+			last = timer.Milliseconds();
+			total += last;
+		}
+		if (threads == 1)
+			serial = total;
+
+		// The vertex normals come last out of the faces, so they differ if anything before them does.
+		bool match = true;
+		for (int i = 0; i < p->vlist.size(); ++i)
+		{
+			Vert& v = p->vlist[i];
+			if (threads == 1)
+			{
+				reference.push_back(v.GetPosition());
+				reference.push_back(v.normal);
+			}
+			else
+			{
+				match = match && reference[2 * i] == v.GetPosition() && reference[2 * i + 1] == v.normal;
+			}
+		}
+		match = match && reference.size() == 2 * p->vlist.size();
+
+		std::cout << std::setw(10) << threads
+			<< std::setw(12) << p->tlist.size()
+			<< std::setw(16) << std::fixed << std::setprecision(1) << total
+			<< std::setw(18) << last
+			<< std::setw(18) << std::setprecision(2) << p->tlist.size() / (last * 1000.0)
+			<< std::setw(9) << serial / total << "x"
+			<< std::setw(8) << (match ? "yes" : "NO") << std::endl;
+		delete(p);
+	}
+	Parallel::SetNumberOfThreads(0);
+}
+
+void Benchmark::SubdivisionStencils(int faces, int levels)
+{
+	Polyhedron* p = CreateTorus(faces);
+	p->Initialize();
+	CompactMesh base(*p);
+	base.Initialize();
+	delete(p);
+
+	std::cout << "***** Loop subdivision by precomputed stencils *****" << std::endl;
+	std::cout << "(" << base.GetNumberOfTriangles() << " base faces, " << levels << " levels, "
+		<< Parallel::GetNumberOfThreads() << " threads)" << std::endl;
+	std::cout << std::setw(10) << "stencils"
+		<< std::setw(12) << "faces"
+		<< std::setw(14) << "entries"
+		<< std::setw(14) << "memory (MB)"
+		<< std::setw(14) << "build (ms)" << std::endl;
+
+	SubdivisionStencil level;
+	SubdivisionStencil limit;
+	for (SubdivisionStencil* stencil : { &level, &limit })
+	{
+		bool isLimit = (stencil == &limit);
+		Timer timer;
+		stencil->Build(base, levels, isLimit ? SubdivisionStencil::Evaluation::LIMIT : SubdivisionStencil::Evaluation::LEVEL);
+		double build = timer.Milliseconds();
+		std::cout << std::setw(10) << (isLimit ? "limit" : "level")
+			<< std::setw(12) << stencil->topology.GetNumberOfTriangles()
+			<< std::setw(14) << stencil->columns.size()
+			<< std::setw(14) << std::fixed << std::setprecision(1) << stencil->GetMemoryUsage() / 1.0e6
+			<< std::setw(14) << build << std::endl;
+	}
+
+	// Each frame moves the base vertices along a wave over the torus, and subdivides the result both ways.
+	// The limit points are compared with three more levels of the same frame, where the even vertices keep their
+	// indices and have nearly reached the limit surface; the distance at the last level is shown for scale.
+	std::cout << std::setw(10) << "frame"
+		<< std::setw(16) << "subdivide (ms)"
+		<< std::setw(14) << "apply (ms)"
+		<< std::setw(10) << "speedup"
+		<< std::setw(14) << "max |diff|"
+		<< std::setw(18) << "limit apply (ms)"
+		<< std::setw(16) << "level to deep"
+		<< std::setw(16) << "limit to deep" << std::endl;
+	const int FRAMES = 3;
+	for (int frame = 0; frame < FRAMES; ++frame)
+	{
+		CompactMesh deformed = base;
+		for (int32_t i = 0; i < deformed.GetNumberOfVertices(); ++i)
+		{
+			glm::dvec3& x = deformed.positions[i];
+			x += 0.05 * sin(4.0 * atan2(x.y, x.x) + 2.0 * M_PI * frame / FRAMES) * glm::normalize(base.normals[i]);
+		}
+		deformed.Initialize();
+
+		Timer timer;
+		CompactMesh subdivided = deformed;
+		for (int l = 0; l < levels; ++l)
+		{
+			subdivided = Subdivision::LoopSubdivision(subdivided);
+		}
+		double direct = timer.Milliseconds();
+
+		std::vector<glm::dvec3> positions;
+		timer.Start();
+		level.Apply(deformed.positions, positions);
+		double apply = timer.Milliseconds();
+
+		double difference = 0.0;
+		for (int32_t i = 0; i < subdivided.GetNumberOfVertices(); ++i)
+		{
+			difference = std::max(difference, glm::length(positions[i] - subdivided.positions[i]));
+		}
+
+		std::vector<glm::dvec3> limitPositions;
+		std::vector<glm::dvec3> limitNormals;
+		timer.Start();
+		limit.Apply(deformed.positions, limitPositions, &limitNormals);
+		double limitApply = timer.Milliseconds();
+
+		CompactMesh deep = subdivided;
+		for (int l = 0; l < 3; ++l)
+		{
+			deep = Subdivision::LoopSubdivision(deep);
+		}
+		double levelDistance = 0.0;
+		double limitDistance = 0.0;
+		for (int32_t i = 0; i < subdivided.GetNumberOfVertices(); ++i)
+		{
+			levelDistance = std::max(levelDistance, glm::length(subdivided.positions[i] - deep.positions[i]));
+			limitDistance = std::max(limitDistance, glm::length(limitPositions[i] - deep.positions[i]));
+		}
+
+		std::cout << std::setw(10) << frame
+			<< std::setw(16) << std::fixed << std::setprecision(1) << direct
+			<< std::setw(14) << apply
+			<< std::setw(9) << direct / apply << "x"
+			<< std::setw(14) << std::scientific << std::setprecision(2) << difference
+			<< std::setw(18) << std::fixed << std::setprecision(1) << limitApply
+			<< std::setw(16) << std::scientific << std::setprecision(2) << levelDistance
+			<< std::setw(16) << limitDistance << std::endl;
+		std::cout << std::defaultfloat;
+	}
+}
+
+void Benchmark::AdaptiveRefinement(int faces, int levels)
+{
+	Polyhedron* p = CreateTorus(faces);
+	p->Initialize();
+	CompactMesh base(*p);
+	base.Initialize();
+	delete(p);
+
+	std::vector<double> curvatures = MeshAnalysis::GetVertexCurvatures(base, Curvature::MEAN);
+	for (double& curvature : curvatures)
+	{
+		curvature = std::abs(curvature);
+	}
+	std::nth_element(curvatures.begin(), curvatures.begin() + 3 * curvatures.size() / 4, curvatures.end());
+	double threshold = curvatures[3 * curvatures.size() / 4];
+
+	std::cout << "***** Adaptive vs. uniform Loop subdivision *****" << std::endl;
+	std::cout << "(" << base.GetNumberOfTriangles() << " base faces, refined where |H| > " << threshold
+		<< "; vertices: base vertices with every face at the level, |dH|: their largest difference from uniform)" << std::endl;
+	std::cout << std::setw(8) << "level"
+		<< std::setw(14) << "uniform faces"
+		<< std::setw(16) << "adaptive faces"
+		<< std::setw(14) << "uniform (MB)"
+		<< std::setw(15) << "adaptive (MB)"
+		<< std::setw(14) << "uniform (ms)"
+		<< std::setw(15) << "adaptive (ms)"
+		<< std::setw(10) << "vertices"
+		<< std::setw(12) << "|dH|" << std::endl;
+
+	CompactMesh uniform = base;
+	AdaptiveSubdivision adaptive(base);
+	for (int level = 1; level <= levels; ++level)
+	{
+		Timer timer;
+		uniform = Subdivision::LoopSubdivision(uniform);
+		double uniformTime = timer.Milliseconds();
+
+		timer.Start();
+		adaptive.Refine(AdaptiveSubdivision::MarkByCurvature(adaptive.mesh, Curvature::MEAN, threshold));
+		double adaptiveTime = timer.Milliseconds();
+
+		// The base vertices keep their indices in both meshes.
+		std::vector<double> uniformCurvatures = MeshAnalysis::GetVertexCurvatures(uniform, Curvature::MEAN);
+		std::vector<double> adaptiveCurvatures = MeshAnalysis::GetVertexCurvatures(adaptive.mesh, Curvature::MEAN);
+		int compared = 0;
+		double difference = 0.0;
+		for (int32_t v = 0; v < base.GetNumberOfVertices(); ++v)
+		{
+			CompactMesh::Range fan = adaptive.mesh.GetFan(v);
+			bool refined = !fan.empty();
+			for (int32_t c : fan)
+			{
+				refined = refined && adaptive.faceLevels[CompactMesh::T(c)] == level;
+			}
+			if (!refined)
+				continue;
+			++compared;
+			difference = std::max(difference, std::abs(adaptiveCurvatures[v] - uniformCurvatures[v]));
+		}
+
+		std::cout << std::setw(8) << level
+			<< std::setw(14) << uniform.GetNumberOfTriangles()
+			<< std::setw(16) << adaptive.mesh.GetNumberOfTriangles()
+			<< std::setw(14) << std::fixed << std::setprecision(1) << uniform.GetMemoryUsage() / 1.0e6
+			<< std::setw(15) << adaptive.mesh.GetMemoryUsage() / 1.0e6
+			<< std::setw(14) << uniformTime
+			<< std::setw(15) << adaptiveTime
+			<< std::setw(10) << compared
+			<< std::setw(12) << std::scientific << std::setprecision(2) << difference << std::endl;
+		std::cout << std::defaultfloat;
+	}
+}
+
+void Benchmark::StreamingSubdivisionToDisk(int faces, int levels)
+{
+	Polyhedron* p = CreateTorus(faces);
+	p->Initialize();
+	CompactMesh base(*p);
+	base.Initialize();
+	delete(p);
+
+	uint64_t numVertices, numFaces;
+	StreamingSubdivision::GetCounts(base, levels, numVertices, numFaces);
+	int batchFaces = StreamingSubdivision::GetDefaultBatchFaces(levels);
+	std::cout << "***** Loop subdivision streamed to disk *****" << std::endl;
+	std::cout << "(" << base.GetNumberOfTriangles() << " base faces, " << levels << " levels: " << numFaces << " faces, "
+		<< numVertices << " vertices; " << (base.GetNumberOfTriangles() + batchFaces - 1) / batchFaces << " batches of "
+		<< batchFaces << " base faces)" << std::endl;
+
+	// Stream first, so the peak memory is that of streaming alone.
+	std::string file = std::filesystem::temp_directory_path().string() + "/benchmark-stream.ply";
+	std::vector<Curvature> curvatures = { Curvature::MEAN, Curvature::GAUSSIAN };
+	std::vector<Statistics> statistics;
+	Timer timer;
+	IOResult result = StreamingSubdivision::Subdivide(base, levels, file, curvatures, statistics, batchFaces);
+	double streamTime = timer.Milliseconds();
+	double streamPeak = GetPeakMemory();
+	if (!result.success)
+	{
+		std::cout << result.message << std::endl;
+		return;
+	}
+	std::cout << std::setw(12) << "file (MB)"
+		<< std::setw(16) << "stream (ms)"
+		<< std::setw(18) << "peak memory (MB)" << std::endl;
+	std::cout << std::setw(12) << std::fixed << std::setprecision(1) << std::filesystem::file_size(file) / 1.0e6
+		<< std::setw(16) << streamTime
+		<< std::setw(18) << streamPeak << std::endl;
+	std::cout << std::defaultfloat;
+
+	// Against the whole subdivided mesh in memory, when it fits comfortably.
+	const uint64_t MAX_COMPARED_FACES = 1 << 22;
+	if (numFaces > MAX_COMPARED_FACES)
+	{
+		std::filesystem::remove(file);
+		return;
+	}
+	timer.Start();
+	CompactMesh child = base;
+	for (int level = 0; level < levels; ++level)
+	{
+		child = Subdivision::LoopSubdivision(child);
+	}
+	double memoryTime = timer.Milliseconds();
+
+	Polyhedron streamed;
+	result = PlyFile::Read(file, streamed);
+	std::filesystem::remove(file);
+	if (!result.success)
+	{
+		std::cout << result.message << std::endl;
+		return;
+	}
+	bool match = streamed.vlist.size() == child.GetNumberOfVertices() && streamed.tlist.size() == child.GetNumberOfTriangles();
+	double difference = 0.0;
+	for (int32_t t = 0; match && t < child.GetNumberOfTriangles(); ++t)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const Vert* v = streamed.tlist[t].vertices[k];
+			difference = std::max(difference, glm::length(glm::dvec3(v->x, v->y, v->z) - child.positions[child.V(3 * t + k)]));
+		}
+	}
+	std::cout << "In memory: " << std::fixed << std::setprecision(1) << memoryTime << " ms, "
+		<< child.GetMemoryUsage() / 1.0e6 << " MB for the mesh; "
+		<< (match ? "same counts" : "DIFFERENT COUNTS") << ", largest corner difference "
+		<< std::scientific << std::setprecision(2) << difference << std::endl;
+
+	std::cout << std::setw(12) << "curvature"
+		<< std::setw(14) << "min"
+		<< std::setw(14) << "max"
+		<< std::setw(14) << "mean"
+		<< std::setw(14) << "|d min|"
+		<< std::setw(14) << "|d max|"
+		<< std::setw(14) << "|d mean|" << std::endl;
+	for (int j = 0; j < curvatures.size(); ++j)
+	{
+		std::vector<double> values = MeshAnalysis::GetVertexCurvatures(child, curvatures[j]);
+		Statistics reference(*std::min_element(values.begin(), values.end()), *std::max_element(values.begin(), values.end()),
+			std::accumulate(values.begin(), values.end(), 0.0) / values.size());
+		std::cout << std::setw(12) << (curvatures[j] == Curvature::MEAN ? "mean" : "gaussian")
+			<< std::setw(14) << statistics[j].min
+			<< std::setw(14) << statistics[j].max
+			<< std::setw(14) << statistics[j].mean
+			<< std::setw(14) << std::abs(statistics[j].min - reference.min)
+			<< std::setw(14) << std::abs(statistics[j].max - reference.max)
+			<< std::setw(14) << std::abs(statistics[j].mean - reference.mean) << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
+
+void Benchmark::FlippedTriangles(int size)
+{
+	// A size x size grid on a saddle, two triangles per square.
+	std::vector<glm::dvec3> positions;
+	std::vector<int32_t> triangles;
+	for (int i = 0; i < size; ++i)
+	{
+		for (int j = 0; j < size; ++j)
+		{
+			double x = -1.0 + 2.0 * i / (size - 1);
+			double y = -1.0 + 2.0 * j / (size - 1);
+			positions.push_back(glm::dvec3(x, y, 0.5 * (x * x - 0.5 * y * y)));
+		}
+	}
+	for (int i = 0; i + 1 < size; ++i)
+	{
+		for (int j = 0; j + 1 < size; ++j)
+		{
+			int32_t q0 = i * size + j;
+			int32_t q1 = (i + 1) * size + j;
+			int32_t q2 = (i + 1) * size + j + 1;
+			int32_t q3 = i * size + j + 1;
+			triangles.insert(triangles.end(), { q0, q1, q2, q0, q2, q3 });
+		}
+	}
+
+	std::cout << "***** Curvatures with one triangle wound the other way *****" << std::endl;
+	std::cout << "(" << size << " x " << size << " grid; every triangle flipped in turn, all "
+		<< (int)Curvature::DIFFERENCE + 1 << " measures on a compact mesh)" << std::endl;
+	std::vector<Curvature> curvatures;
+	for (int i = 0; i <= (int)Curvature::DIFFERENCE; ++i)
+	{
+		curvatures.push_back((Curvature)i);
+	}
+	int numTriangles = triangles.size() / 3;
+	int finite = 0;
+	Timer timer;
+	for (int t = 0; t < numTriangles; ++t)
+	{
+		std::vector<int32_t> flipped = triangles;
+		std::swap(flipped[3 * t + 1], flipped[3 * t + 2]);
+		CompactMesh m(positions, flipped);
+		m.Initialize();
+		bool all = true;
+		for (const std::vector<double>& values : MeshAnalysis::GetVertexCurvatures(m, curvatures))
+		{
+			for (double value : values)
+			{
+				all = all && !std::isinf(value);
+			}
+		}
+		finite += all;
+	}
+	std::cout << std::setw(12) << "meshes"
+		<< std::setw(18) << "without infinity"
+		<< std::setw(12) << "time (ms)" << std::endl;
+	std::cout << std::setw(12) << numTriangles
+		<< std::setw(18) << finite
+		<< std::setw(12) << std::fixed << std::setprecision(1) << timer.Milliseconds() << std::endl;
+	std::cout << std::defaultfloat;
+}
+
+Polyhedron* Benchmark::CreateTorus(int faces)
+{
+	// A (rings x sides) grid wrapped around a torus has 2 * rings * sides faces.
+	// Use three times as many rings as sides so the triangles are not too thin.
+	int sides = std::max(3, (int)std::round(std::sqrt(faces / 6.0)));
+	int rings = std::max(3, faces / (2 * sides));
+	int numVertices = rings * sides;
+	int numTriangles = 2 * rings * sides;
+
+	Polyhedron* p = new Polyhedron(numVertices, 3 * numVertices, numTriangles);
+	const double R = 1.0;
+	const double r = 0.35;
+	for (int i = 0; i < rings; ++i)
+	{
+		double theta = 2.0 * M_PI * i / rings;
+		for (int j = 0; j < sides; ++j)
+		{
+			double phi = 2.0 * M_PI * j / sides;
+			Vert v((R + r * cos(phi)) * cos(theta), (R + r * cos(phi)) * sin(theta), r * sin(phi));
+			v.index = p->vlist.size();
+			p->vlist.push_back(v);
+		}
+	}
+
+	for (int i = 0; i < rings; ++i)
+	{
+		for (int j = 0; j < sides; ++j)
+		{
+			// Corners of the grid quad, counterclockwise seen from outside.
+			int a = i * sides + j;
+			int b = ((i + 1) % rings) * sides + j;
+			int c = ((i + 1) % rings) * sides + (j + 1) % sides;
+			int d = i * sides + (j + 1) % sides;
+
+			Triangle t1;
+			t1.index = p->tlist.size();
+			t1.vertices[0] = &p->vlist[a];
+			t1.vertices[1] = &p->vlist[b];
+			t1.vertices[2] = &p->vlist[c];
+			p->tlist.push_back(t1);
+
+			Triangle t2;
+			t2.index = p->tlist.size();
+			t2.vertices[0] = &p->vlist[a];
+			t2.vertices[1] = &p->vlist[c];
+			t2.vertices[2] = &p->vlist[d];
+			p->tlist.push_back(t2);
+		}
+	}
+
+	Corner c;
+	p->clist = std::vector<Corner>(3 * p->tlist.size(), c);
+	return p;
+}
+
+void Benchmark::CreateEdgesByStarScan(Polyhedron* p)
+{
+	// Reserve up front: CreateEdgeByStarScan() hands out pointers into elist as it grows.
+	p->elist.clear();
+	p->elist.reserve(3 * p->tlist.size());
+	for (Triangle& t : p->tlist)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			t.edges[j] = NULL;
+		}
+	}
+
+	for (Triangle& t : p->tlist)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			// If this edge exists, skip.
+			if (!t.edges[j])
+			{
+				CreateEdgeByStarScan(p, t.vertices[j], t.vertices[(j+1)%3]);
+			}
+		}
+	}
+}
+
+void Benchmark::CreateEdgeByStarScan(Polyhedron* p, Vert* v0, Vert* v1)
+{
+	Edge edge;
+	edge.index = p->elist.size();
+	edge.vertices[0] = v0;
+	edge.vertices[1] = v1;
+	p->elist.push_back(edge);
+	Edge* e = &p->elist[edge.index];
+
+	// Go through the triangles of v0 and attach the edge to each one that also contains v1.
+	for (int i = 0; i < v0->GetNumberOfTriangles(); ++i)
+	{
+		Triangle* t = v0->triangles[i];
+
+		int k = t->Contains(v1);
+		if (k != -1)
+		{
+			e->triangles.push_back(t);
+
+			int index0 = t->Contains(v0);
+			if ((k + 1) % 3 == index0)
+			{
+				t->edges[k] = e;
+			}
+			else if ((k + 2) % 3 == index0)
+			{
+				t->edges[(k+2)%3] = e;
+			}
+		}
+	}
+}
+
+void Benchmark::ReadObjByLines(Polyhedron* p, const std::string& file)
+{
+	std::ifstream f(file);
+	std::string line;
+	std::getline(f, line);
+	while (f)
+	{
+		// Vertex:
+		if (line[0] == 'v' && line[1] != 't')
+		{
+			// Remove the 'v' at the start of the line.
+			line.erase(0, line.find(" ") + 1);
+
+			Vert v;
+			glm::vec3 position;
+			for (int i = 0; i < 3; ++i)
+			{
+				std::string word = line.substr(0, line.find(" "));
+				position[i] = std::stof(word);
+				line.erase(0, line.find(" ") + 1);
+			}
+			v.x = position.x;
+			v.y = position.y;
+			v.z = position.z;
+			v.index = p->vlist.size();
+			p->vlist.push_back(v);
+		}
+
+		// Triangle:
+		if (line[0] == 'f')
+		{
+			line.erase(0, line.find(" ") + 1);
+			Triangle t;
+
+			// Take only the first element of each /.
+			for (int i = 0; i < 3; ++i)
+			{
+				std::string word = line.substr(0, line.find("/"));
+				t.vertices[i] = &p->vlist[std::stoi(word) - 1];
+				line.erase(0, line.find(" ") + 1);
+			}
+			t.index = p->tlist.size();
+			p->tlist.push_back(t);
+		}
+
+		std::getline(f, line);
+	}
+
+	Corner c;
+	p->clist = std::vector<Corner>(3 * p->tlist.size(), c);
+}
+
+void Benchmark::ReadPlyByLines(Polyhedron* p, const std::string& file)
+{
+	std::ifstream f(file);
+	std::string line;
+	std::getline(f, line);
+
+	// Go through the header to figure out how many vertices and triangles there are.
+	int numberOfVertices = 0;
+	while (f && line.substr(0, 10) != "end_header")
+	{
+		std::getline(f, line);
+		std::string word = line.substr(0, line.find(" "));
+		if (word == "element")
+		{
+			line.erase(0, line.find(" ") + 1);
+			word = line.substr(0, line.find(" "));
+			if (word == "vertex")
+			{
+				line.erase(0, line.find(" ") + 1);
+				numberOfVertices = std::stoi(line);
+			}
+		}
+	}
+
+	int count = 0;
+	std::getline(f, line);
+	while (f && line != "")
+	{
+		// Vertex:
+		if (count < numberOfVertices)
+		{
+			Vert v;
+			glm::vec3 position;
+			for (int i = 0; i < 3; ++i)
+			{
+				std::string word = line.substr(0, line.find(" "));
+				position[i] = std::stof(word);
+				line.erase(0, line.find(" ") + 1);
+			}
+			v.x = position.x;
+			v.y = position.y;
+			v.z = position.z;
+			v.index = p->vlist.size();
+			p->vlist.push_back(v);
+		}
+		// Triangle:
+		else
+		{
+			line.erase(0, line.find(" ") + 1);
+			Triangle t;
+			for (int i = 0; i < 3; ++i)
+			{
+				std::string word = line.substr(0, line.find(" "));
+				t.vertices[i] = &p->vlist[std::stoi(word)];
+				line.erase(0, line.find(" ") + 1);
+			}
+			t.index = p->tlist.size();
+			p->tlist.push_back(t);
+		}
+		++count;
+		std::getline(f, line);
+	}
+
+	Corner c;
+	p->clist = std::vector<Corner>(3 * p->tlist.size(), c);
+}
+
+void Benchmark::WriteAsciiPly(Polyhedron* p, const std::string& file)
+{
+	std::ofstream f(file);
+	f << "ply\n";
+	f << "format ascii 1.0\n";
+	f << "element vertex " << p->vlist.size() << "\n";
+	f << "property float x\n";
+	f << "property float y\n";
+	f << "property float z\n";
+	f << "element face " << p->tlist.size() << "\n";
+	f << "property list uchar int vertex_indices\n";
+	f << "end_header\n";
+
+	f << std::setprecision(7);
+	for (Vert& v : p->vlist)
+	{
+		f << v.x << " " << v.y << " " << v.z << "\n";
+	}
+	for (Triangle& t : p->tlist)
+	{
+		f << "3 " << t.vertices[0]->index << " " << t.vertices[1]->index << " " << t.vertices[2]->index << "\n";
+	}
+}
+
+bool Benchmark::SameTopology(Polyhedron* p, Polyhedron* q)
+{
+	if (p->clist.size() != q->clist.size() || p->elist.size() != q->elist.size())
+		return false;
+	if (p->valenceDeficit != q->valenceDeficit || p->angleDeficit != q->angleDeficit)
+		return false;
+
+	for (int i = 0; i < (int)p->clist.size(); ++i)
+	{
+		Corner& a = p->clist[i];
+		Corner& b = q->clist[i];
+		bool bothBoundary = (a.o == NULL && b.o == NULL);
+		bool sameOpposite = (a.o != NULL && b.o != NULL && a.o->index == b.o->index);
+		if (a.v->index != b.v->index || a.e->index != b.e->index || a.n->index != b.n->index
+			|| !(bothBoundary || sameOpposite) || a.angle != b.angle)
+			return false;
+	}
+	for (int i = 0; i < (int)p->vlist.size(); ++i)
+	{
+		if (p->vlist[i].valence != q->vlist[i].valence || p->vlist[i].c->index != q->vlist[i].c->index)
+			return false;
+	}
+	return true;
+}
+
+bool Benchmark::SameMesh(Polyhedron* p, Polyhedron* q)
+{
+	if (p->vlist.size() != q->vlist.size() || p->tlist.size() != q->tlist.size())
+		return false;
+
+	for (int i = 0; i < (int)p->vlist.size(); ++i)
+	{
+		glm::dvec3 difference = p->vlist[i].GetPosition() - q->vlist[i].GetPosition();
+		if (glm::length(difference) > 1.0e-5)
+			return false;
+	}
+	for (int i = 0; i < (int)p->tlist.size(); ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			if (p->tlist[i].vertices[j]->index != q->tlist[i].vertices[j]->index)
+				return false;
+		}
+	}
+	return true;
+}
+
+size_t Benchmark::GetMemoryUsage(Polyhedron* p)
+{
+	// Heap block overhead is not counted, which flatters the per-vertex and per-edge lists.
+	size_t bytes = p->vlist.capacity() * sizeof(Vert)
+		+ p->elist.capacity() * sizeof(Edge)
+		+ p->tlist.capacity() * sizeof(Triangle)
+		+ p->clist.capacity() * sizeof(Corner);
+	for (Vert& v : p->vlist)
+	{
+		bytes += v.triangles.capacity() * sizeof(Triangle*);
+	}
+	for (Edge& e : p->elist)
+	{
+		bytes += e.triangles.capacity() * sizeof(Triangle*);
+	}
+	return bytes;
+}
+
+double Benchmark::GetPeakMemory()
+{
+	// Linux reports the peak in kilobytes.
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / 1024.0;
+}
+
+std::vector<int> Benchmark::GetFaceCounts(int maxFaces)
+{
+	std::vector<int> counts;
+	for (int faces = 10000; faces <= maxFaces; faces *= 10)
+	{
+		counts.push_back(faces);
+	}
+	return counts;
+}
+
+Benchmark::Benchmark() {}
+Benchmark::~Benchmark() {}
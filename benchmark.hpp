@@ -0,0 +1,166 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <random>
+#include <numeric>
+#include <sys/resource.h>
+#include "polyhedron.hpp"
+#include "timing.hpp"
+#include "mappedfile.hpp"
+#include "objfile.hpp"
+#include "plyfile.hpp"
+#include "parallel.hpp"
+#include "meshcache.hpp"
+#include "compactmesh.hpp"
+#include "subdivision.hpp"
+#include "subdivisionstencil.hpp"
+#include "adaptivesubdivision.hpp"
+#include "streamingsubdivision.hpp"
+#include "dihedral.hpp"
+#include "curvature.hpp"
+#include "smoothing.hpp"
+#include "streamlines.hpp"
+
+/** Headless timing harnesses for the mesh processing pipeline.
+ * These run from the command line without opening a window:
+ *
+ *     ./build --benchmark <name> [arguments]
+ *
+ * Each benchmark generates its own meshes, so no model files are needed.
+ * Results are printed as a table, one row per mesh size.
+ */
+class Benchmark
+{
+
+public:
+
+	// Dispatch on the benchmark name in argv[2]. Returns the exit code for main().
+	static int Run(int argc, char* argv[]);
+
+	// Sort-and-merge edge construction against the star-scanning construction it replaced.
+	static void EdgeConstruction(int maxFaces);
+
+	// Text .obj and .ply loading through the tokenizer against the line-by-line loaders it replaced, in MB/s.
+	// The meshes are written to the temporary directory first.
+	static void TextLoading(int maxFaces);
+
+	// Thread scaling of text .obj and .ply loading for one mesh size.
+	static void ParallelLoading(int faces);
+
+	// Opening a mesh from the binary cache against reading the .obj file and initializing it.
+	static void CacheLoading(int maxFaces);
+
+	// Memory and run time of the compact mesh against the Polyhedron: initialization, every curvature, and a Loop subdivision.
+	static void CompactMeshes(int maxFaces);
+
+	// All 14 curvatures of a Polyhedron one at a time, as separate passes, against one batched pass on one thread and on all of them.
+	// Meshes of 100k vertices up to the given maximum, by factors of ten.
+	static void BatchedCurvatures(int maxVertices);
+
+	// Time per vertex of each curvature kernel on one thread, looked up in the runtime table and fixed at compile time,
+	// then of all 14 in one pass both ways.
+	static void KernelDispatch(int vertices);
+
+	// Signed dihedral angles of random edges with std::acos one edge at a time, against Dihedral::ComputeSignedAngles()
+	// on the scalar loop and on AVX2, in ns per edge.
+	static void DihedralAngles(int edges);
+
+	// Moving patches of vertices of one mesh and bringing it up to date with Polyhedron::Update() and
+	// MeshAnalysis::UpdateVertexCurvatures(), against initializing the moved mesh and computing every curvature again.
+	static void LocalEdits(int vertices);
+
+	// Principal curvatures of a torus from the curvature tensors, on one thread and on all of them,
+	// in one fused pass and as tensors followed by their eigen decomposition, with the error against the exact values.
+	static void PrincipalCurvatureTensors(int vertices);
+
+	// Smoothing the curvature tensors of a torus: the nine scalar passes per step SmoothCurvatureTensor() made before,
+	// against explicit steps on all channels at once with the assembled Laplacian, and fewer, larger backward Euler steps.
+	static void TensorSmoothing(int vertices, int iterations);
+
+	// Mean curvature flow of a noisy torus over the same stretch of time: a few large implicit steps with the factorization
+	// and with conjugate gradients, against the explicit steps at the stable limit it would take, with the noise left over.
+	static void MeanCurvatureFlow(int vertices, int steps);
+
+	// Lines of curvature of a torus traced through the triangle directions, about one line per spacing x spacing mean edges
+	// and each running ten times that far both ways, on one thread and on all of them, with how far they stray from the
+	// exact lines of curvature, the circles around the tube and around the axis.
+	static void LinesOfCurvature(int faces, double spacing);
+
+	// Wall time of each stage of Polyhedron::Initialize() for one mesh, on one thread and on all of them.
+	static void InitializeStages(int faces);
+
+	// Repeated Loop subdivision of one mesh, the way SubdivideMesh() in main.cpp does it:
+	// each level is built and initialized, then moved over the level before it.
+	static void RepeatedSubdivision(int faces, int levels);
+
+	// The same levels of Loop subdivision on 1, 2, 4, ... threads, up to the number of hardware threads or 16,
+	// with the speedup over one thread, checking that every thread count gives the same mesh.
+	static void SubdivisionScaling(int faces, int levels);
+
+	// Levels of Loop subdivision of a torus compiled into stencils once, then applied to a few deformations of it, against
+	// subdividing each deformation level by level; and the limit positions against those of three more levels.
+	static void SubdivisionStencils(int faces, int levels);
+
+	// Levels of Loop subdivision of a torus, uniform and adaptive where the mean curvature of the base is in its top quarter,
+	// with the faces, memory and time of each, and how far the curvatures at the base vertices inside the refined region
+	// are from the uniform ones.
+	static void AdaptiveRefinement(int faces, int levels);
+
+	// Levels of Loop subdivision of a torus streamed to a binary .ply file with mean and Gaussian curvature statistics,
+	// with the time and peak memory; and, when the result is small enough, against subdividing in memory.
+	static void StreamingSubdivisionToDisk(int faces, int levels);
+
+	// Every curvature of a grid with each of its triangles wound the other way in turn, where walks around a vertex
+	// can close on one side of the flipped triangle and not the other; a regression check that none of them crashes.
+	static void FlippedTriangles(int size);
+
+private:
+
+	// One row of KernelDispatch(): the best of three passes over p for the curvatures Cs, both ways.
+	template <Curvature... Cs> static void TimeKernels(Polyhedron* p, const std::string& name);
+
+	// Reference for TensorSmoothing(): each entry of the global tensors in turn, through its own explicit steps.
+	static void SmoothTensorEntries(Polyhedron* p, std::vector<TangentSpace>& tangentSpaces, double dt, int iterations);
+
+	// Generate a closed torus with roughly the given number of faces.
+	// The vertices and triangles are filled in, but the polyhedron is not initialized.
+	static Polyhedron* CreateTorus(int faces);
+
+	// Reference edge construction: for every new edge, scan the triangles of one endpoint for the other.
+	// This is the construction Polyhedron::CreateEdges() used before it switched to the edge table.
+	static void CreateEdgesByStarScan(Polyhedron* p);
+	static void CreateEdgeByStarScan(Polyhedron* p, Vert* v0, Vert* v1);
+
+	// Reference loaders: read each line into a string and cut words off its front with substr/erase/stof.
+	// These are the loaders Polyhedron(file, a) and Polyhedron(file) used before the tokenizer.
+	static void ReadObjByLines(Polyhedron* p, const std::string& file);
+	static void ReadPlyByLines(Polyhedron* p, const std::string& file);
+
+	// Write the vertices and triangles of a mesh as an ascii .ply file. ObjFile::Write() writes the .obj files.
+	static void WriteAsciiPly(Polyhedron* p, const std::string& file);
+
+	// True if both initialized meshes have the same corner table, valences and angles.
+	static bool SameTopology(Polyhedron* p, Polyhedron* q);
+
+	// True if both meshes have the same triangles and, to float precision, the same vertices.
+	static bool SameMesh(Polyhedron* p, Polyhedron* q);
+
+	// Bytes held by the lists of a polyhedron and the triangle lists of its vertices and edges.
+	static size_t GetMemoryUsage(Polyhedron* p);
+
+	// Largest resident set size of the process so far, in MB.
+	static double GetPeakMemory();
+
+	// Face counts from 10k up to the given maximum, by factors of ten.
+	static std::vector<int> GetFaceCounts(int maxFaces);
+
+	Benchmark();
+	~Benchmark();
+
+};
@@ -0,0 +1,370 @@
+#include "compactmesh.hpp"
+
+#include <algorithm>
+#include "polyhedron.hpp"
+#include "dihedral.hpp"
+#include "meshanalysis.hpp"
+
+CompactMesh::CompactMesh()
+{
+	center = glm::dvec3(0.0, 0.0, 0.0);
+}
+CompactMesh::CompactMesh(const std::vector<glm::dvec3>& positions, const std::vector<int32_t>& triangles)
+	: positions(positions), cornerVertices(triangles)
+{
+	center = glm::dvec3(0.0, 0.0, 0.0);
+}
+CompactMesh::CompactMesh(Polyhedron& p)
+{
+	center = glm::dvec3(0.0, 0.0, 0.0);
+	positions.resize(p.vlist.size());
+	for (int i = 0; i < p.vlist.size(); ++i)
+	{
+		positions[i] = p.vlist[i].GetPosition();
+	}
+	cornerVertices.resize(3 * p.tlist.size());
+	for (int i = 0; i < p.tlist.size(); ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			cornerVertices[3 * i + j] = p.tlist[i].vertices[j]->index;
+		}
+	}
+}
+CompactMesh::~CompactMesh() {}
+
+void CompactMesh::Initialize()
+{
+	valenceDeficit = 0;
+	CreateCornerTable();
+	ComputeValences();
+	InitializeFromCornerTable();
+}
+
+void CompactMesh::InitializeFromCornerTable()
+{
+	surfaceArea = 0.0;
+	angleDeficit = 0.0;
+
+	CreateOneRings();
+	ComputeBoundingSphere();
+	ComputeNormalsAndArea();
+	InterpolateNormals();
+	ComputeAngles();
+	ComputeEdgeGeometry();
+	MeshAnalysis::ComputeCurvatureGeometry(*this);
+}
+
+double CompactMesh::GetOppositeEdgeLength(int32_t c) const
+{
+	return glm::length(positions[V(P(c))] - positions[V(N(c))]);
+}
+
+size_t CompactMesh::GetMemoryUsage() const
+{
+	return positions.capacity() * sizeof(glm::dvec3)
+		+ normals.capacity() * sizeof(glm::dvec3)
+		+ totalAngles.capacity() * sizeof(double)
+		+ valences.capacity() * sizeof(int32_t)
+		+ mixedAreas.capacity() * sizeof(double)
+		+ mixedPerimeters.capacity() * sizeof(double)
+		+ vertexCorners.capacity() * sizeof(int32_t)
+		+ faceNormals.capacity() * sizeof(glm::dvec3)
+		+ areas.capacity() * sizeof(double)
+		+ cornerVertices.capacity() * sizeof(int32_t)
+		+ cornerOpposites.capacity() * sizeof(int32_t)
+		+ cornerEdges.capacity() * sizeof(int32_t)
+		+ cornerAngles.capacity() * sizeof(double)
+		+ cornerCotangents.capacity() * sizeof(double)
+		+ fanOffsets.capacity() * sizeof(int32_t)
+		+ fanCorners.capacity() * sizeof(int32_t)
+		+ ringOffsets.capacity() * sizeof(int32_t)
+		+ ringVertices.capacity() * sizeof(int32_t)
+		+ edgeHalfEdges.capacity() * sizeof(int32_t)
+		+ edgeLengths.capacity() * sizeof(double)
+		+ edgeDihedrals.capacity() * sizeof(double);
+}
+
+void CompactMesh::CreateCornerTable()
+{
+	int numCorners = cornerVertices.size();
+	std::vector<int> indices(cornerVertices.begin(), cornerVertices.end());
+	std::vector<int> halfEdges;
+	int numEdges = EdgeTable::Build(indices, positions.size(), halfEdges);
+
+	// The first two half-edges to reach an edge are its sides; a third one (a non-manifold edge) is left unpaired.
+	edgeHalfEdges.assign(numEdges, -1);
+	std::vector<int32_t> secondHalfEdges(numEdges, -1);
+	cornerEdges.resize(numCorners);
+	for (int32_t h = 0; h < numCorners; ++h)
+	{
+		int32_t e = halfEdges[h];
+		if (edgeHalfEdges[e] < 0)
+			edgeHalfEdges[e] = h;
+		else if (secondHalfEdges[e] < 0)
+			secondHalfEdges[e] = h;
+
+		// Half-edge h is opposite corner P(h).
+		cornerEdges[P(h)] = e;
+	}
+
+	cornerOpposites.assign(numCorners, -1);
+	for (int32_t e = 0; e < numEdges; ++e)
+	{
+		int32_t h = edgeHalfEdges[e];
+		int32_t g = secondHalfEdges[e];
+		if (g >= 0)
+		{
+			cornerOpposites[P(h)] = P(g);
+			cornerOpposites[P(g)] = P(h);
+		}
+	}
+
+	// Later corners overwrite earlier ones, as in MeshAnalysis::GetCornerList().
+	vertexCorners.assign(positions.size(), -1);
+	for (int32_t c = 0; c < numCorners; ++c)
+	{
+		vertexCorners[V(c)] = c;
+	}
+}
+
+void CompactMesh::CreateOneRings()
+{
+	int numVertices = positions.size();
+	int numCorners = cornerVertices.size();
+
+	// Bucket the corners by vertex; the fans are then ordered within each bucket.
+	fanOffsets.assign(numVertices + 1, 0);
+	for (int32_t c = 0; c < numCorners; ++c)
+	{
+		++fanOffsets[V(c) + 1];
+	}
+	for (int i = 0; i < numVertices; ++i)
+	{
+		fanOffsets[i + 1] += fanOffsets[i];
+	}
+	std::vector<int32_t> buckets(numCorners);
+	std::vector<int32_t> fill(fanOffsets.begin(), fanOffsets.end() - 1);
+	for (int32_t c = 0; c < numCorners; ++c)
+	{
+		buckets[fill[V(c)]++] = c;
+	}
+
+	// Each corner is placed once, and each walk stops at a boundary, at a corner of another vertex
+	// (across an edge of the opposite orientation) or at a corner it has already placed.
+	fanCorners.resize(numCorners);
+	ringOffsets.assign(numVertices + 1, 0);
+	ringVertices.clear();
+	ringVertices.reserve(numCorners + numVertices);
+	std::vector<bool> placed(numCorners, false);
+	int32_t next = 0;
+	for (int32_t v = 0; v < numVertices; ++v)
+	{
+		int count = fanOffsets[v + 1] - fanOffsets[v];
+		for (int i = -1; i < count; ++i)
+		{
+			int32_t seed = (i < 0) ? vertexCorners[v] : buckets[fanOffsets[v] + i];
+			if (seed < 0 || placed[seed])
+				continue;
+
+			// Swing clockwise to the boundary. Coming back around to the seed instead means the fan is closed,
+			// and then the corner reached last is Swing(seed).
+			int32_t start = seed;
+			bool closed = false;
+			for (int j = 0; j < count; ++j)
+			{
+				int32_t back = SwingBack(start);
+				if (back < 0 || V(back) != v || placed[back])
+					break;
+				if (back == seed)
+				{
+					closed = true;
+					break;
+				}
+				start = back;
+			}
+
+			if (!closed)
+				ringVertices.push_back(V(P(start)));
+			int32_t c = start;
+			do
+			{
+				placed[c] = true;
+				fanCorners[next++] = c;
+				ringVertices.push_back(V(N(c)));
+				c = Swing(c);
+			} while (c >= 0 && V(c) == v && !placed[c]);
+		}
+		ringOffsets[v + 1] = ringVertices.size();
+	}
+}
+
+void CompactMesh::ComputeBoundingSphere()
+{
+	if (positions.empty())
+		return;
+
+	glm::dvec3 min = positions[0];
+	glm::dvec3 max = min;
+	for (const glm::dvec3& x : positions)
+	{
+		min = glm::min(min, x);
+		max = glm::max(max, x);
+	}
+	center = 0.5 * (min + max);
+	radius = glm::length(center - min);
+}
+
+void CompactMesh::ComputeNormalsAndArea()
+{
+	int numTriangles = GetNumberOfTriangles();
+	faceNormals.resize(numTriangles);
+	areas.resize(numTriangles);
+
+	double signedVolume = 0.0;
+	for (int32_t t = 0; t < numTriangles; ++t)
+	{
+		glm::dvec3 x0 = positions[V(3 * t)];
+		glm::dvec3 x1 = positions[V(3 * t + 1)];
+		glm::dvec3 x2 = positions[V(3 * t + 2)];
+
+		// Heron's formula, with the side lengths in the order of Triangle::edges.
+		double a = glm::length(x1 - x0);
+		double b = glm::length(x2 - x1);
+		double c = glm::length(x0 - x2);
+		double halfPerimeter = 0.5 * (a + b + c);
+		double area = sqrt(halfPerimeter * (halfPerimeter - a) * (halfPerimeter - b) * (halfPerimeter - c));
+
+		glm::dvec3 normal = glm::cross(x2 - x0, x1 - x0);
+		normal /= glm::length(normal);
+
+		faceNormals[t] = normal;
+		areas[t] = area;
+		surfaceArea += area;
+		signedVolume += glm::dot(center - x0, normal) * area;
+	}
+
+	// Now orient the normals in the triangles:
+	if (signedVolume > 0)
+	{
+		for (glm::dvec3& normal : faceNormals)
+		{
+			normal *= -1.0;
+		}
+	}
+}
+
+void CompactMesh::InterpolateNormals()
+{
+	// Visiting the triangles in order adds up the normals at each vertex in the order of Vert::triangles.
+	normals.assign(positions.size(), glm::dvec3(0.0, 0.0, 0.0));
+	for (int32_t c = 0; c < GetNumberOfCorners(); ++c)
+	{
+		normals[V(c)] += faceNormals[T(c)];
+	}
+	for (glm::dvec3& normal : normals)
+	{
+		normal = glm::normalize(normal);
+	}
+}
+
+void CompactMesh::ComputeValences()
+{
+	// Swing around each vertex from its first corner: backwards first, then forwards from the start if a boundary is hit.
+	valences.assign(positions.size(), 0);
+	for (int32_t c = 0; c < GetNumberOfCorners(); ++c)
+	{
+		if (valences[V(c)] != 0)
+			continue;
+
+		int32_t index = -1;
+		int valence = 0;
+		bool goPrevious = true;
+		int32_t previous = c;
+		while (index != c)
+		{
+			int32_t rotate = goPrevious ? P(previous) : N(previous);
+			if (O(rotate) >= 0)
+			{
+				int32_t adjacent = goPrevious ? P(O(rotate)) : N(O(rotate));
+				index = adjacent;
+				++valence;
+				previous = adjacent;
+			}
+			else
+			{
+				// A boundary edge still counts toward the valence.
+				++valence;
+				if (goPrevious)
+				{
+					previous = c;
+					goPrevious = false;
+				}
+				else
+					index = c;
+			}
+		}
+		valences[V(c)] = valence;
+		valenceDeficit += 6 - valence;
+	}
+}
+
+void CompactMesh::ComputeAngles()
+{
+	int numCorners = GetNumberOfCorners();
+	cornerAngles.resize(numCorners);
+	cornerCotangents.resize(numCorners);
+	totalAngles.assign(positions.size(), 0.0);
+	for (int32_t c = 0; c < numCorners; ++c)
+	{
+		// Same arithmetic as MeshAnalysis::ComputeAngle().
+		glm::dvec3 x = positions[V(c)];
+		glm::dvec3 cn = positions[V(N(c))] - x;
+		glm::dvec3 cp = positions[V(P(c))] - x;
+
+		double dot = glm::clamp(glm::dot(cn, cp), -1.0, 1.0);
+		double angle = acos(dot / (glm::length(cn) * glm::length(cp)));
+		cornerAngles[c] = angle;
+		cornerCotangents[c] = 1.0 / tan(angle);
+		totalAngles[V(c)] += angle;
+	}
+
+	angleDeficit = 0.0;
+	for (double totalAngle : totalAngles)
+	{
+		angleDeficit += 2 * M_PI - totalAngle;
+	}
+}
+
+void CompactMesh::ComputeEdgeGeometry()
+{
+	// Edge e runs from V(h) to V(N(h)) in triangle T(h), so that is its current triangle, as in MeshAnalysis::ComputeCurvatureGeometry().
+	// The normals and tangents are gathered a block at a time for Dihedral::ComputeSignedAngles().
+	const int BLOCK_SIZE = 4096;
+	int numEdges = GetNumberOfEdges();
+	edgeLengths.resize(numEdges);
+	edgeDihedrals.resize(numEdges);
+	Dihedral::Batch batch(BLOCK_SIZE);
+	for (int32_t begin = 0; begin < numEdges; begin += BLOCK_SIZE)
+	{
+		int32_t end = std::min(begin + BLOCK_SIZE, numEdges);
+		for (int32_t e = begin; e < end; ++e)
+		{
+			int32_t h = edgeHalfEdges[e];
+			int32_t o = O(P(h));
+			edgeLengths[e] = glm::length(positions[V(N(h))] - positions[V(h)]);
+			if (o < 0)
+				batch.Set(e - begin, glm::dvec3(0.0), glm::dvec3(0.0), glm::dvec3(0.0));
+			else
+				batch.Set(e - begin, faceNormals[T(h)], faceNormals[T(o)], positions[V(N(h))] - positions[V(h)]);
+		}
+		Dihedral::ComputeSignedAngles(batch.GetEdges(), end - begin, edgeDihedrals.data() + begin);
+
+		// A boundary edge does not bend.
+		for (int32_t e = begin; e < end; ++e)
+		{
+			if (O(P(edgeHalfEdges[e])) < 0)
+				edgeDihedrals[e] = 0.0;
+		}
+	}
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "geometry.hpp"
+#include "edgetable.hpp"
+
+// Forward declaration.
+class Polyhedron;
+
+/** Index-based mesh: the same corner table as Polyhedron, stored as flat arrays.
+ *
+ * Polyhedron keeps a Vert, Edge, Triangle and Corner object for every element and links them with pointers,
+ * and every Vert and Edge owns a heap-allocated list of triangles on top of that.
+ * Here every quantity is an array of its own, indexed by 32-bit integers, so a pass over one quantity
+ * (say, the face normals) reads only that quantity, and the whole mesh is a couple dozen allocations.
+ *
+ * Corner c = 3t + k is the kth corner of triangle t, as in Polyhedron::clist:
+ * - V(c) is its vertex, so triangle t is V(3t), V(3t+1), V(3t+2);
+ * - N(c) and P(c) are the next and previous corners of the triangle, which are arithmetic on c;
+ * - O(c) is the opposite corner across the edge opposite c, or -1 on a boundary;
+ * - E(c) is the edge opposite c.
+ * Half-edge 3t + j runs from V(3t+j) to V(N(3t+j)), like Triangle::edges[j], and its opposite corner is P(3t+j).
+ *
+ * The one-ring of every vertex is also kept in order, CSR style: the corners of vertex v, counterclockwise,
+ * are a slice of fanCorners starting at fanOffsets[v], and its neighbours are a slice of ringVertices.
+ * A walk around a vertex is then a pass over a few contiguous integers instead of a chain of lookups.
+ *
+ * Initialize() computes everything Polyhedron::Initialize() does, in the same order,
+ * so the curvatures computed on either representation of a mesh agree.
+ */
+class CompactMesh
+{
+
+public:
+
+	// A slice of one of the index arrays.
+	struct Range
+	{
+		const int32_t* first = NULL;
+		const int32_t* last = NULL;
+
+		const int32_t* begin() const { return first; }
+		const int32_t* end() const { return last; }
+		int32_t size() const { return last - first; }
+		bool empty() const { return first == last; }
+		int32_t operator[](int32_t i) const { return first[i]; }
+		int32_t back() const { return last[-1]; }
+	};
+
+	CompactMesh();
+
+	// Create a mesh from vertex positions and a flat list of three vertex indices per triangle.
+	CompactMesh(const std::vector<glm::dvec3>& positions, const std::vector<int32_t>& triangles);
+
+	// Copy the vertices and triangles of a polyhedron. The polyhedron does not need to be initialized.
+	CompactMesh(Polyhedron& p);
+
+	~CompactMesh();
+
+
+	// Do all of the operations to prepare this mesh.
+	void Initialize();
+
+	// The part of Initialize() that comes after the corner table and valences, for a mesh that was given those
+	// along with its positions, as by Subdivision::LoopSubdivision(). Everything else is computed from them.
+	void InitializeFromCornerTable();
+
+
+	/*** Corner table ***/
+
+	static int32_t T(int32_t c) { return c / 3; }
+	static int32_t N(int32_t c) { return (c % 3 == 2) ? c - 2 : c + 1; }
+	static int32_t P(int32_t c) { return (c % 3 == 0) ? c + 2 : c - 1; }
+	int32_t V(int32_t c) const { return cornerVertices[c]; }
+	int32_t O(int32_t c) const { return cornerOpposites[c]; }
+	int32_t E(int32_t c) const { return cornerEdges[c]; }
+
+	// The next corner counterclockwise around the vertex of c (c.p.o.p), or -1 if there is a boundary in the way.
+	int32_t Swing(int32_t c) const
+	{
+		int32_t o = cornerOpposites[P(c)];
+		return (o < 0) ? -1 : P(o);
+	}
+
+	// The next corner clockwise around the vertex of c (c.n.o.n), or -1: the inverse of Swing().
+	int32_t SwingBack(int32_t c) const
+	{
+		int32_t o = cornerOpposites[N(c)];
+		return (o < 0) ? -1 : N(o);
+	}
+
+	// The corners of a vertex, counterclockwise. A fan that is cut by a boundary starts at the boundary.
+	// A closed fan starts at Swing(vertexCorners[v]), so it ends at vertexCorners[v] like GetVertexStar(Vert*).
+	// The fans of a vertex where several of them meet follow each other, the one through vertexCorners[v] first.
+	Range GetFan(int32_t v) const { return GetSlice(fanCorners, fanOffsets, v); }
+
+	// The neighbours of a vertex, in the order of its fan: V(N(c)) for every corner c of the fan,
+	// after V(P(c)) of the first corner if the fan is cut by a boundary.
+	Range GetRing(int32_t v) const { return GetSlice(ringVertices, ringOffsets, v); }
+
+	// The fan of a vertex if it is a single closed fan, or an empty range on a boundary.
+	Range GetStar(int32_t v) const
+	{
+		Range fan = GetFan(v);
+		return (!fan.empty() && Swing(fan.back()) == fan[0]) ? fan : Range();
+	}
+
+	int32_t GetNumberOfVertices() const { return positions.size(); }
+	int32_t GetNumberOfEdges() const { return edgeHalfEdges.size(); }
+	int32_t GetNumberOfTriangles() const { return cornerVertices.size() / 3; }
+	int32_t GetNumberOfCorners() const { return cornerVertices.size(); }
+
+	// Length of the edge opposite a corner.
+	double GetOppositeEdgeLength(int32_t c) const;
+
+	// Bytes held by the arrays of the mesh.
+	size_t GetMemoryUsage() const;
+
+
+	/*** Fields ***/
+
+	// Surface area:
+	double surfaceArea = 0.0;
+
+	// Bounding sphere:
+	glm::dvec3 center;
+	double radius = 0.0;
+
+	// Valence and angle deficits:
+	int valenceDeficit = 0;
+	double angleDeficit = 0.0;
+
+	// Per vertex.
+	std::vector<glm::dvec3> positions;
+	std::vector<glm::dvec3> normals;
+	std::vector<double> totalAngles;
+	std::vector<int32_t> valences;
+
+	// Mixed area and perimeter of each vertex, as Vert::mixedArea and Vert::mixedPerimeter, but -1 on a boundary.
+	// Cached by MeshAnalysis::ComputeCurvatureGeometry().
+	std::vector<double> mixedAreas;
+	std::vector<double> mixedPerimeters;
+
+	// One corner of each vertex, or -1 for a vertex without triangles.
+	// This is the last corner of the vertex in corner order, the same one Vert::c points to.
+	std::vector<int32_t> vertexCorners;
+
+	// Per triangle.
+	std::vector<glm::dvec3> faceNormals;
+	std::vector<double> areas;
+
+	// Per corner.
+	std::vector<int32_t> cornerVertices;
+	std::vector<int32_t> cornerOpposites;
+	std::vector<int32_t> cornerEdges;
+	std::vector<double> cornerAngles;
+	std::vector<double> cornerCotangents;
+
+	// Per vertex, in CSR form: the slices of vertex v run from offsets[v] to offsets[v + 1]. See GetFan() and GetRing().
+	std::vector<int32_t> fanOffsets;
+	std::vector<int32_t> fanCorners;
+	std::vector<int32_t> ringOffsets;
+	std::vector<int32_t> ringVertices;
+
+	// Per edge: the first half-edge on it in corner order, which orients the edge the same way as Edge::vertices.
+	// Edge e runs from V(h) to V(N(h)) for h = edgeHalfEdges[e].
+	std::vector<int32_t> edgeHalfEdges;
+
+	// Per edge: the length, as Edge::length, and the signed angle between the normals of its two triangles,
+	// as Edge::dihedral, or 0 on a boundary.
+	std::vector<double> edgeLengths;
+	std::vector<double> edgeDihedrals;
+
+private:
+
+	// Match up the half-edges and fill in the opposite corners, the corner edges and the vertex corners.
+	void CreateCornerTable();
+
+	// Order the corners and neighbours of every vertex into fans, in one walk around each vertex.
+	void CreateOneRings();
+
+	static Range GetSlice(const std::vector<int32_t>& values, const std::vector<int32_t>& offsets, int32_t i)
+	{
+		Range range;
+		range.first = values.data() + offsets[i];
+		range.last = values.data() + offsets[i + 1];
+		return range;
+	}
+
+	// Compute the radius and center of a sphere that bounds the mesh.
+	void ComputeBoundingSphere();
+
+	// Compute the face normals and area, including orientation.
+	void ComputeNormalsAndArea();
+
+	// Interpolate normals to the vertices.
+	void InterpolateNormals();
+
+	// Count the edges at each vertex, the same way MeshAnalysis::GetValenceDeficit() does.
+	void ComputeValences();
+
+	// Compute the corner angles, their cotangents and the angle deficit.
+	void ComputeAngles();
+
+	// Compute the length and the signed angle at every edge.
+	void ComputeEdgeGeometry();
+
+};
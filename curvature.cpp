@@ -1,22 +1,15 @@
 #include "curvature.hpp"
-#include <Eigen/src/Eigenvalues/EigenSolver.h>
+#include "parallel.hpp"
 
 
 // See Figure 4 in the paper for the formulas used for mixedArea according to whether or not the triangles are obtuse.
-double Curvature::ComputeMixedArea(Corner& c)
+double CurvatureTensor::ComputeMixedArea(Corner& c)
 {
 	double mixedArea = 0;
-	Vert* v = c.v;
 
-	// Bounce around the vertex using the corner:
-	int k = -1;
-	Corner* previous = &c;
-	while (k != c.index)
+	// Around the vertex from the corner after c, or from one boundary edge to the other.
+	for (Corner* adjacent : CornerFan::After(c))
 	{
-		Corner* adjacent = previous->p->o->p;
-		k = adjacent->index;
-		//std::cout << k << " " << c.index << " " << c.angle << " " << c.v->valence << " " << adjacent->v->index << std::endl;
-
 		// If the triangle is obtuse, but the obtuse angle is NOT at this corner:
 		if (adjacent->p->angle > 0.5 * M_PI ||
 			adjacent->n->angle > 0.5 * M_PI)
@@ -53,42 +46,37 @@ double Curvature::ComputeMixedArea(Corner& c)
 			//mixedArea += 0.25 * MeanCurvatureWeight(theta, phi) * squareMagnitude;
 			//mixedArea += MeanCurvatureWeight(theta, phi) * squareMagnitude;
 		}
-		previous = adjacent;
 	}
 	return mixedArea;
 }
 
 // See Equation 8 in the paper.
-glm::dvec3 Curvature::ComputeMeanCurvature(Corner& c)
+glm::dvec3 CurvatureTensor::ComputeMeanCurvature(Corner& c)
 {
 	double mixedArea = ComputeMixedArea(c);
 	Vert* v = c.v;
 	glm::dvec3 total = glm::dvec3(0.0, 0.0, 0.0);
+	CornerFan fan = CornerFan::After(c);
+	if (!fan.IsClosed())
+		return total;
 
-	// Bounce around the vertex using the corner:
-	int k = -1;
-	Corner* previous = &c;
-	while (k != c.index)
+	for (Corner* adjacent : fan)
 	{
-		Corner* adjacent = previous->p->o->p;
-		k = adjacent->index;
-
-		// If the triangle is obtuse, but the obtuse angle is NOT at this corner:
+		// The two angles opposite the edge from v to w.
 		double theta = adjacent->n->angle;
 		double phi = adjacent->n->o->angle;
 
-		Vert* w = previous->n->v;
+		Vert* w = adjacent->p->v;
 		glm::dvec3 xi = glm::dvec3(v->x, v->y, v->z);
 		glm::dvec3 xj = glm::dvec3(w->x, w->y, w->z);
 		glm::dvec3 difference = xi - xj;
 
 		total += MeanCurvatureWeight(theta, phi) * difference;
-		previous = adjacent;
 	}
 	return ((double)1.0 / (2.0 * mixedArea)) * total;
 }
 
-double Curvature::ComputeGaussianCurvature(Corner& c)
+double CurvatureTensor::ComputeGaussianCurvature(Corner& c)
 {
 	double mixedArea = ComputeMixedArea(c);
 	return ((2.0 * M_PI) - c.v->totalAngle) / mixedArea;
@@ -96,7 +84,7 @@ double Curvature::ComputeGaussianCurvature(Corner& c)
 }
 
 
-double Curvature::ComputeNormalCurvature(Vert* v1, Vert* v2)
+double CurvatureTensor::ComputeNormalCurvature(Vert* v1, Vert* v2)
 {
 	glm::dvec3 xi = glm::dvec3(v1->x, v1->y, v1->z);
 	glm::dvec3 xj = glm::dvec3(v2->x, v2->y, v2->z);
@@ -106,237 +94,325 @@ double Curvature::ComputeNormalCurvature(Vert* v1, Vert* v2)
 	return 2.0 * glm::dot(difference, v1->normal) / squareMagnitude;
 }
 
-TangentSpace Curvature::GetCurvatureTensor(Corner& c)
+Vert* CurvatureTensor::GetFirstNeighbour(Vert* v)
 {
-	// Go through the connected vertices of v and project the edges onto the tangent plane of v.
-	// The tangent plane will just be determined by the normal vector at v.
-	// We will need to establish a coordinate system.
-	Vert* v = c.v;
-	std::vector<Vert*> connectedVertices = c.GetAdjacentVertices();
-
-	// We will establish an orthonormal coordinate system on the tangent space.
-	// We'll just pick out the first edge from the connected vertices and project that vector onto the space and call it e1.
-	glm::dvec3 firstEdge = connectedVertices[0]->getPosition() - v->getPosition();
-	TangentSpace tps(v, firstEdge);
-
-	/*
-	std::cout << "c.v.position: " << glm::to_string(v->getPosition()) << std::endl;
-	std::cout << "w.position: " << glm::to_string(connectedVertices[0]->getPosition()) << std::endl;
-	std::cout << "first edge: " << glm::to_string(firstEdge) << std::endl;
-	std::cout << "e1: " << glm::to_string(tps.e1) << std::endl;
-	std::cout << "e2: " << glm::to_string(tps.e2) << std::endl;
-	std::cout << "Normal: " << glm::to_string(v->normal) << std::endl;
-	*/
-
-	// Now for the hard part: we need to build the linear system given by the normal curvatures:
-	// Ax = b:
-	Eigen::VectorXd normalCurvatureVector(connectedVertices.size()); // the vector b.
-	Eigen::MatrixXd coordinateMatrix(connectedVertices.size(), 3);	 // the matrix A.
-
-	// Fill the linear system:
-	for (int i = 0; i < connectedVertices.size(); ++i)
-	{
-		Vert* w = connectedVertices[i];
-		normalCurvatureVector(i) = ComputeNormalCurvature(v, w);
-
-		// Convert the edge vector into local coordinates: (a, b) relative to {e1, e2}.
-		glm::dvec2 local = tps.LocalCoordinates(w->getPosition());
-		/*
-		std::cout << std::endl;
-		std::cout << "Converting the edge connecting v to " << glm::to_string(w->getPosition()) << std::endl;
-		std::cout << glm::to_string(local) << std::endl;
-		std::cout << std::endl;
-		*/
-
-		// Expression of curvature tensor in {e1, e2} coordinates:
-		coordinateMatrix(i, 0) = local[0] * local[0];
-		coordinateMatrix(i, 1) = 2.0 * local[0] * local[1];
-		coordinateMatrix(i, 2) = local[1] * local[1];
-	}
-
-	//std::cout << "Matrix: " << coordinateMatrix << std::endl;
-	//std::cout << "Vector: " << normalCurvatureVector << std::endl;
-	
-	// Solve using Eigen:
-	Eigen::Vector3d solution = coordinateMatrix.colPivHouseholderQr().solve(normalCurvatureVector);
-	//std::cout << "Solution: " << solution << std::endl;
-
-	// Build up curvature tensor matrix:
-	Eigen::Matrix2d curvatureTensor;
-	curvatureTensor(0, 0) = solution[0];
-	curvatureTensor(1, 0) = solution[1];
-	curvatureTensor(0, 1) = solution[1];
-	curvatureTensor(1, 1) = solution[2];
-	tps.curvatureTensor = curvatureTensor;
-
-	/*
-	// Get eigenvalues and eigenvectors:
-	Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> es(curvatureTensor);
-	Eigen::Vector2d eigenValues = es.eigenvalues();
-	Eigen::MatrixXd eigenVectors = es.eigenvectors();
-	//std::cout << "Eigenvalues: " << eigenValues << std::endl;
-	//std::cout << "Eigenvectors: " << eigenVectors << std::endl;
-	//std::cout << std::endl;
-
-	// Set them in the tangent space:
-	tps.k1 = eigenValues.x();
-	//std::cout << "Set k1" << std::endl;
-	tps.p1 = eigenVectors.col(0);
-	//std::cout << "Set p1" << std::endl;
-	tps.k2 = eigenValues.y();
-	//std::cout << "Set k2" << std::endl;
-	tps.p2 = eigenVectors.col(1);
-	//std::cout << "Set p2" << std::endl;
-	*/
-	
-
-	// Get the global curvature tensor.
-	tps.curvatureTensorGlobal = tps.GlobalCoordinates(curvatureTensor);	
-
-	return tps;
+	if (v->triangles.empty())
+		return NULL;
+	Triangle* t = v->triangles[0];
+	return t->vertices[(t->Contains(v) + 1) % 3];
 }
 
-void Curvature::SmoothCurvatureTensor(Polyhedron* p, std::vector<TangentSpace>& tangentSpaces, double dt, int iterations)
+glm::dmat2 CurvatureTensor::FitCurvatureTensor(Vert* v, Polyhedron* p, const TangentSpace& tps)
 {
-	// Assuming that the curvature tensors have been found in the tangent spaces, ordered by vertex index.
-	
-	// Loop through all 9 entries of the global curvature tensor.
-	for (int i = 0; i < 3; ++i)
+	// Each neighbour w, in the unit direction (a, b) of the frame, gives one equation of the linear system Ax = b:
+	// a^2 x0 + 2ab x1 + b^2 x2 = the normal curvature towards w.
+	// The least-squares solution solves the normal equations A^T A x = A^T b, which are only 3x3,
+	// so they are added up neighbour by neighbour instead of storing A.
+	double ata[3][3] = { { 0.0 } };
+	double atb[3] = { 0.0 };
+	auto addNeighbour = [&](Vert* w)
 	{
-		for (int j = 0; j < 3; ++j)
+		glm::dvec2 local = glm::normalize(tps.LocalCoordinates(w->GetPosition()));
+		double row[3] = { local[0] * local[0], 2.0 * local[0] * local[1], local[1] * local[1] };
+		double normalCurvature = ComputeNormalCurvature(v, w);
+		for (int i = 0; i < 3; ++i)
 		{
-			// Assign value0 to this value of the curvature tensor to each vertex:
-			for (Vert& v : p->vlist)
+			for (int j = 0; j < 3; ++j)
 			{
-				v.value0 = tangentSpaces[v.index].curvatureTensorGlobal(i, j);
+				ata[i][j] += row[i] * row[j];
 			}
+			atb[i] += row[i] * normalCurvature;
+		}
+	};
 
-			// Apply smoothing:
-			Smoothing::SmoothValueMeanCurvature(p, dt, iterations);
+	// Every neighbour follows v in one of its triangles, except the one before it on a boundary edge.
+	for (Triangle* t : v->triangles)
+	{
+		int k = t->Contains(v);
+		Corner& c = p->clist[3 * t->index + k];
+		addNeighbour(c.n->v);
+		if (c.n->o == NULL)
+			addNeighbour(c.p->v);
+	}
 
-			// Assign the smoothed value of the curvature tensor to the original matrix:
-			for (Vert& v : p->vlist)
+	// Cramer's rule.
+	double minors[3] = {
+		ata[1][1] * ata[2][2] - ata[1][2] * ata[2][1],
+		ata[1][0] * ata[2][2] - ata[1][2] * ata[2][0],
+		ata[1][0] * ata[2][1] - ata[1][1] * ata[2][0]
+	};
+	double determinant = ata[0][0] * minors[0] - ata[0][1] * minors[1] + ata[0][2] * minors[2];
+	glm::dmat2 tensor(0.0);
+	if (!(std::abs(determinant) > 0))
+		return tensor;
+
+	double solution[3];
+	for (int column = 0; column < 3; ++column)
+	{
+		double m[3][3];
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
 			{
-				tangentSpaces[v.index].curvatureTensorGlobal(i, j) = v.value0;
+				m[i][j] = (j == column) ? atb[i] : ata[i][j];
 			}
 		}
+		solution[column] = (m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+			- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+			+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) / determinant;
 	}
 
-	// Smoothing has been done, so now get the smoothed curvature tensor back into local coordinates... the brute force way.
-	for (TangentSpace& tps : tangentSpaces)
-	{
-		tps.curvatureTensor = tps.LocalCoordinates(tps.curvatureTensorGlobal);
-	}
+	tensor[0][0] = solution[0];
+	tensor[1][0] = solution[1];
+	tensor[0][1] = solution[1];
+	tensor[1][1] = solution[2];
+	return tensor;
 }
 
-void Curvature::GetEigenSpaces(std::vector<TangentSpace>& tangentSpaces)
+TangentSpace CurvatureTensor::GetCurvatureTensor(Vert* v, Polyhedron* p)
 {
-	for (TangentSpace& tps : tangentSpaces)
-	{
-		// Get eigenvalues and eigenvectors:
-		Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> es(tps.curvatureTensor);
-		Eigen::Vector2d eigenValues = es.eigenvalues();
-		Eigen::MatrixXd eigenVectors = es.eigenvectors();
-		//std::cout << "Eigenvalues: " << eigenValues << std::endl;
-		//std::cout << "Eigenvectors: " << eigenVectors << std::endl;
-		//std::cout << std::endl;
-
-		// Set them in the tangent space:
-		tps.k1 = eigenValues.x();
-		//std::cout << "Set k1" << std::endl;
-		tps.p1 = eigenVectors.col(0);
-		//std::cout << "Set p1" << std::endl;
-		tps.k2 = eigenValues.y();
-		//std::cout << "Set k2" << std::endl;
-		tps.p2 = eigenVectors.col(1);
-		//std::cout << "Set p2" << std::endl;
-	}
+	// The tangent plane is determined by the normal vector at v.
+	// The first edge, projected onto it, is e1 of the coordinate system.
+	Vert* first = GetFirstNeighbour(v);
+	if (first == NULL)
+		return TangentSpace();
+
+	TangentSpace tps(v, first->GetPosition() - v->GetPosition());
+	tps.curvatureTensor = FitCurvatureTensor(v, p, tps);
+
+	// Get the global curvature tensor.
+	tps.curvatureTensorGlobal = tps.GlobalCoordinates(tps.curvatureTensor);
+	return tps;
 }
 
-void Curvature::GetTriangleStreamlines(Polyhedron* p, std::vector<TangentSpace>& tangentSpaces, std::vector<Eigen::Vector3d>& minorStream, std::vector<Eigen::Vector3d>& majorStream)
+std::vector<TangentSpace> CurvatureTensor::GetCurvatureTensors(Polyhedron* p)
 {
-	// Go through the triangles and assign a streamvector by taking the weighted average of the principal directions of the vertices.
-	// The weights are determined by the Voronoi area, using the ``mixed area'' computation.
-	// We will have to convert all prinicpal directions to the global frame.
-	for (Triangle& t : p->tlist)
+	std::vector<TangentSpace> tangentSpaces(p->vlist.size());
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(p->vlist.size(), BLOCK_SIZE, [&](int begin, int end)
 	{
-		Eigen::Vector3d minorTriangle;
-		minorTriangle(0) = 0;
-		minorTriangle(1) = 0;
-		minorTriangle(2) = 0;
-		Eigen::Vector3d majorTriangle;
-		majorTriangle(0) = 0;
-		majorTriangle(1) = 0;
-		majorTriangle(2) = 0;
-
-		// Quick check if the triangle is obtuse:
-		int obtuseIndex = -1;
-		for (int i = 0; i < 3; ++i)
+		for (int i = begin; i < end; ++i)
 		{
-			if (t.angles[i] > 0.5 * M_PI)
-				obtuseIndex = i;
+			tangentSpaces[i] = GetCurvatureTensor(&p->vlist[i], p);
 		}
+	});
+	return tangentSpaces;
+}
 
-		for (int i = 0; i < 3; ++i)
+void CurvatureTensor::SmoothCurvatureTensor(Polyhedron* p, std::vector<TangentSpace>& tangentSpaces, double dt, int iterations, bool implicit)
+{
+	Laplacian laplacian;
+	laplacian.Build(p);
+	SmoothCurvatureTensor(laplacian, tangentSpaces, dt, iterations, implicit);
+}
+
+void CurvatureTensor::SmoothCurvatureTensor(Laplacian& laplacian, std::vector<TangentSpace>& tangentSpaces, double dt, int iterations, bool implicit)
+{
+	// Assuming that the curvature tensors have been found in the tangent spaces, ordered by vertex index.
+	// The global tensor is symmetric, so its six distinct entries are smoothed together, as six channels of one block.
+	const int CHANNELS = 6;
+	const int ROWS[CHANNELS] = { 0, 0, 0, 1, 1, 2 };
+	const int COLUMNS[CHANNELS] = { 0, 1, 2, 1, 2, 2 };
+	int n = tangentSpaces.size();
+	std::vector<double> values(CHANNELS * n);
+	std::vector<double> smoothed(CHANNELS * n);
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
 		{
-			Vert* v = t.vertices[i];
-			TangentSpace& tps = tangentSpaces[v->index];
-
-			// Principal directions:
-			Eigen::Vector2d minorLocal = tps.p1;
-			Eigen::Vector2d majorLocal = tps.p2;
-			Eigen::Vector3d minorGlobal = tps.GlobalCoordinates(minorLocal);
-			Eigen::Vector3d majorGlobal = tps.GlobalCoordinates(majorLocal);
-
-			// Voronoi area:
-			double mixedArea = 0;
-
-			// Check if the angle here is obtuse:
-			if (obtuseIndex == i)
-				mixedArea = 0.5 * t.area;
-			else if (obtuseIndex > -1)
-				mixedArea = 0.25 * t.area;
-			else
+			for (int k = 0; k < CHANNELS; ++k)
 			{
-				// Not obtuse. Proceed as normal:
-				double q = t.angles[(i + 1) % 3];
-				double r = t.angles[(i + 2) % 3];
-
-				double pr = t.edges[(i + 2) % 3]->length;
-				double pq = t.edges[i]->length;
-				pr *= pr;
-				pq *= pq;
-
-				mixedArea = (1.0 / 8.0) * (pr * (1.0 / tan(q)) + pq * (1.0 / tan(r)));
+				values[CHANNELS * i + k] = tangentSpaces[i].curvatureTensorGlobal[COLUMNS[k]][ROWS[k]];
 			}
-			
-			// Now add these to the triangle directions:
-			minorTriangle += (mixedArea / t.area) * minorGlobal;
-			majorTriangle += (mixedArea / t.area) * majorGlobal;
 		}
+	});
 
-		minorStream[t.index] = minorTriangle.normalized();
-		majorStream[t.index] = majorTriangle.normalized();
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		if (implicit)
+			laplacian.ImplicitStep(values, smoothed, CHANNELS, dt);
+		else
+			laplacian.ExplicitStep(values, smoothed, CHANNELS, dt);
+		values.swap(smoothed);
 	}
-}
-
-
-
 
+	// Smoothing has been done, so now get the smoothed curvature tensor back into local coordinates.
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			TangentSpace& tps = tangentSpaces[i];
+			for (int k = 0; k < CHANNELS; ++k)
+			{
+				tps.curvatureTensorGlobal[COLUMNS[k]][ROWS[k]] = values[CHANNELS * i + k];
+				tps.curvatureTensorGlobal[ROWS[k]][COLUMNS[k]] = values[CHANNELS * i + k];
+			}
+			tps.curvatureTensor = tps.LocalCoordinates(tps.curvatureTensorGlobal);
+		}
+	});
+}
 
+void CurvatureTensor::SolveEigenProblem(const glm::dmat2& m, double& k1, double& k2, glm::dvec2& e1, glm::dvec2& e2)
+{
+	// For [[a, b], [b, c]]: k = (a + c) / 2 -+ sqrt(((a - c) / 2)^2 + b^2).
+	double a = m[0][0];
+	double b = 0.5 * (m[0][1] + m[1][0]);
+	double c = m[1][1];
+	double half = 0.5 * (a - c);
+	double radius = std::hypot(half, b);
+	double mean = 0.5 * (a + c);
+	k1 = mean - radius;
+	k2 = mean + radius;
+
+	// (A - k2) x = 0 has the solutions (k2 - c, b) and (b, k2 - a). Use the one without cancellation:
+	// k2 - c = half + radius and k2 - a = radius - half.
+	glm::dvec2 major = (half >= 0) ? glm::dvec2(half + radius, b) : glm::dvec2(b, radius - half);
+	double length = glm::length(major);
+	e2 = (length > 0) ? (1.0 / length) * major : glm::dvec2(1.0, 0.0);
+	e1 = glm::dvec2(-e2.y, e2.x);
+}
 
+PrincipalCurvatures CurvatureTensor::GetEigenSpaces(const std::vector<TangentSpace>& tangentSpaces)
+{
+	int n = tangentSpaces.size();
+	PrincipalCurvatures principal;
+	principal.k1.resize(n);
+	principal.k2.resize(n);
+	principal.p1.resize(n);
+	principal.p2.resize(n);
+
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const TangentSpace& tps = tangentSpaces[i];
+			glm::dvec2 e1, e2;
+			SolveEigenProblem(tps.curvatureTensor, principal.k1[i], principal.k2[i], e1, e2);
+			principal.p1[i] = tps.GlobalCoordinates(e1);
+			principal.p2[i] = tps.GlobalCoordinates(e2);
+		}
+	});
+	return principal;
+}
 
+PrincipalCurvatures CurvatureTensor::GetPrincipalCurvatures(Polyhedron* p)
+{
+	int n = p->vlist.size();
+	PrincipalCurvatures principal;
+	principal.k1.resize(n);
+	principal.k2.resize(n);
+	principal.p1.resize(n);
+	principal.p2.resize(n);
+
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert* v = &p->vlist[i];
+			Vert* first = GetFirstNeighbour(v);
+			if (first == NULL)
+			{
+				principal.k1[i] = 0.0;
+				principal.k2[i] = 0.0;
+				principal.p1[i] = glm::dvec3(0.0);
+				principal.p2[i] = glm::dvec3(0.0);
+				continue;
+			}
 
+			TangentSpace tps(v, first->GetPosition() - v->GetPosition());
+			glm::dvec2 e1, e2;
+			SolveEigenProblem(FitCurvatureTensor(v, p, tps), principal.k1[i], principal.k2[i], e1, e2);
+			principal.p1[i] = tps.GlobalCoordinates(e1);
+			principal.p2[i] = tps.GlobalCoordinates(e2);
+		}
+	});
+	return principal;
+}
 
+void CurvatureTensor::GetTriangleStreamlines(Polyhedron* p, const PrincipalCurvatures& principal, std::vector<glm::dvec3>& minorStream, std::vector<glm::dvec3>& majorStream)
+{
+	// Go through the triangles and assign a streamvector by taking the weighted average of the principal directions of the vertices.
+	// The weights are determined by the Voronoi area, using the ``mixed area'' computation.
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(p->tlist.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int index = begin; index < end; ++index)
+		{
+			Triangle& t = p->tlist[index];
+			glm::dvec3 minorTriangle(0.0);
+			glm::dvec3 majorTriangle(0.0);
 
+			// The angles of the triangle are those of its corners.
+			double angles[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				angles[i] = p->clist[3 * t.index + i].angle;
+			}
 
+			// Quick check if the triangle is obtuse:
+			int obtuseIndex = -1;
+			for (int i = 0; i < 3; ++i)
+			{
+				if (angles[i] > 0.5 * M_PI)
+					obtuseIndex = i;
+			}
 
+			for (int i = 0; i < 3; ++i)
+			{
+				Vert* v = t.vertices[i];
+
+				// Voronoi area:
+				double mixedArea = 0;
+
+				// Check if the angle here is obtuse:
+				if (obtuseIndex == i)
+					mixedArea = 0.5 * t.area;
+				else if (obtuseIndex > -1)
+					mixedArea = 0.25 * t.area;
+				else
+				{
+					// Not obtuse. Proceed as normal:
+					double q = angles[(i + 1) % 3];
+					double r = angles[(i + 2) % 3];
+
+					double pr = t.edges[(i + 2) % 3]->length;
+					double pq = t.edges[i]->length;
+					pr *= pr;
+					pq *= pq;
+
+					mixedArea = (1.0 / 8.0) * (pr * (1.0 / tan(q)) + pq * (1.0 / tan(r)));
+				}
+				
+				// Now add these to the triangle directions. A principal direction has no sign,
+				// so each is turned to agree with that of the first vertex before it is added.
+				glm::dvec3 minor = principal.p1[v->index];
+				glm::dvec3 major = principal.p2[v->index];
+				if (glm::dot(minor, principal.p1[t.vertices[0]->index]) < 0)
+					minor = -minor;
+				if (glm::dot(major, principal.p2[t.vertices[0]->index]) < 0)
+					major = -major;
+				minorTriangle += (mixedArea / t.area) * minor;
+				majorTriangle += (mixedArea / t.area) * major;
+			}
 
+			// In the plane of the triangle, or 0 where the directions cancel out.
+			minorTriangle -= glm::dot(minorTriangle, t.normal) * t.normal;
+			majorTriangle -= glm::dot(majorTriangle, t.normal) * t.normal;
+			double minorLength = glm::length(minorTriangle);
+			double majorLength = glm::length(majorTriangle);
+			minorStream[t.index] = (minorLength > 0) ? minorTriangle / minorLength : glm::dvec3(0.0);
+			majorStream[t.index] = (majorLength > 0) ? majorTriangle / majorLength : glm::dvec3(0.0);
+		}
+	});
+}
 
-double Curvature::MeanCurvatureWeight(double theta, double phi)
+double CurvatureTensor::MeanCurvatureWeight(double theta, double phi)
 {
 	return 0.5 * ((1.0 / tan(theta)) + (1.0 / tan(phi)));
 }
 
-Curvature::Curvature(){}
-Curvature::~Curvature(){}
+CurvatureTensor::CurvatureTensor(){}
+CurvatureTensor::~CurvatureTensor(){}
@@ -1,15 +1,23 @@
 #pragma once
 
 #include <cmath>
-
-#include <Eigen/Dense>
-#include <Eigen/Eigenvalues>
+#include <vector>
 
 #include "glm/gtx/norm.hpp"
 #include "glm/gtx/string_cast.hpp"
 #include "polyhedron.hpp"
 #include "tangentspace.hpp"
-#include "smoothing.hpp"
+#include "laplacian.hpp"
+
+// The principal curvatures and directions of every vertex, one array per quantity, indexed by vertex.
+// k1 <= k2, and p1 and p2 are the unit directions in the world that go with them.
+struct PrincipalCurvatures
+{
+	std::vector<double> k1;
+	std::vector<double> k2;
+	std::vector<glm::dvec3> p1;
+	std::vector<glm::dvec3> p2;
+};
 
 /** Implementation of curvature operators from:
  * http://www.multires.caltech.edu/pubs/diffGeoOps.pdf
@@ -18,8 +26,12 @@
  * 1) Mean curvature H.
  * 2) Gaussian curvature K.
  * 3) Curvature tensor.
+ *
+ * The curvature tensor of a vertex is fit by least squares to the normal curvatures along its edges, in its tangent plane.
+ * The fit is a 3x3 system and the eigen decomposition of the tensor a 2x2 one, so both are solved in closed form,
+ * and the vertices are split over the threads. (Named CurvatureTensor so as not to collide with the Curvature enum.)
  */
-class Curvature
+class CurvatureTensor
 {
 
 public:
@@ -36,23 +48,44 @@ public:
 	// Compute the normal curvature in the direction of an edge.
 	static double ComputeNormalCurvature(Vert* v1, Vert* v2);
 
-	// Get the curvature tensor and principal curvatures by solving a linear system.
-	static TangentSpace GetCurvatureTensor(Corner& c);
+	// Get the curvature tensor of a vertex by solving a linear system.
+	// The tensor is 0 if the neighbours of the vertex do not determine it.
+	static TangentSpace GetCurvatureTensor(Vert* v, Polyhedron* p);
+
+	// The curvature tensors of every vertex, in parallel.
+	static std::vector<TangentSpace> GetCurvatureTensors(Polyhedron* p);
 
-	// Apply smoothing to the curvature tensors.
-	static void SmoothCurvatureTensor(Polyhedron* p, std::vector<TangentSpace>& tangentSpaces, double dt, int iterations);
+	// Apply smoothing to the curvature tensors: iterations steps of the heat equation with the cotangent Laplacian,
+	// explicit or backward Euler. Backward Euler is stable for any dt, so a few large steps do the work of many small ones.
+	static void SmoothCurvatureTensor(Polyhedron* p, std::vector<TangentSpace>& tangentSpaces, double dt, int iterations, bool implicit = false);
 
-	// Get eigen-stuff:
-	static void GetEigenSpaces(std::vector<TangentSpace>& tangentSpaces);
+	// The same with a Laplacian already built for the polyhedron, to smooth several sets of tensors over one mesh.
+	static void SmoothCurvatureTensor(Laplacian& laplacian, std::vector<TangentSpace>& tangentSpaces, double dt, int iterations, bool implicit = false);
 
-	// Set streamlines:
-	static void GetTriangleStreamlines(Polyhedron* p, std::vector<TangentSpace>& tangentSpaces, std::vector<Eigen::Vector3d>& minorStream, std::vector<Eigen::Vector3d>& majorStream);
+	// Eigenvalues and eigenvectors of every tensor, in parallel.
+	static PrincipalCurvatures GetEigenSpaces(const std::vector<TangentSpace>& tangentSpaces);
+
+	// Fit the tensor of every vertex and take it apart at once, without keeping the tensors.
+	static PrincipalCurvatures GetPrincipalCurvatures(Polyhedron* p);
+
+	// Eigenvalues k1 <= k2 of a symmetric 2x2 matrix, with unit eigenvectors e1 and e2.
+	static void SolveEigenProblem(const glm::dmat2& m, double& k1, double& k2, glm::dvec2& e1, glm::dvec2& e2);
+
+	// Set streamlines: one unit direction of each family per triangle, in its plane, indexed by triangle.
+	// The vectors must have room for every triangle.
+	static void GetTriangleStreamlines(Polyhedron* p, const PrincipalCurvatures& principal, std::vector<glm::dvec3>& minorStream, std::vector<glm::dvec3>& majorStream);
 
 private:
 
+	// Fit the tensor of v in the frame of tps.
+	static glm::dmat2 FitCurvatureTensor(Vert* v, Polyhedron* p, const TangentSpace& tps);
+
+	// A neighbour of v to start the frame at, or NULL if it has none.
+	static Vert* GetFirstNeighbour(Vert* v);
+
 	static double MeanCurvatureWeight(double theta, double phi);
 
-	Curvature();
-	~Curvature();
+	CurvatureTensor();
+	~CurvatureTensor();
 
 };
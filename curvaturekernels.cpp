@@ -0,0 +1,37 @@
+#include "curvaturekernels.hpp"
+
+const CurvatureKernels::Entry& CurvatureKernels::Get(Curvature curvature)
+{
+	// In the order of the enum.
+	static const Entry KERNELS[] =
+	{
+		MakeEntry<Curvature::HORIZON>(),
+		MakeEntry<Curvature::MEAN>(),
+		MakeEntry<Curvature::GAUSSIAN>(),
+		MakeEntry<Curvature::ORIGINAL>(),
+		MakeEntry<Curvature::DISTORTION>(),
+		MakeEntry<Curvature::CONE>(),
+		MakeEntry<Curvature::DISTORTION_SIGNED>(),
+		MakeEntry<Curvature::MEAN_SIGNED>(),
+		MakeEntry<Curvature::MAX_PRINCIPAL_DISTORTION>(),
+		MakeEntry<Curvature::MIN_PRINCIPAL_DISTORTION>(),
+		MakeEntry<Curvature::FALSE_GAUSSIAN>(),
+		MakeEntry<Curvature::FALSE_MEAN>(),
+		MakeEntry<Curvature::PRINCIPAL_DEVIATION>(),
+		MakeEntry<Curvature::DIFFERENCE>()
+	};
+	return KERNELS[(int)curvature];
+}
+
+int CurvatureKernels::Needs(const std::vector<Curvature>& curvatures)
+{
+	int needs = 0;
+	for (Curvature curvature : curvatures)
+	{
+		needs |= Get(curvature).needs;
+	}
+	return needs;
+}
+
+CurvatureKernels::CurvatureKernels() {}
+CurvatureKernels::~CurvatureKernels() {}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include "utilities.hpp"
+
+// Everything the distortion measures need from the dihedral angles around a vertex, gathered in one trip around its star.
+struct StarDistortion
+{
+	// Sum of the signed and of the unsigned angles between consecutive face normals.
+	double signedSum = 0.0;
+	double unsignedSum = 0.0;
+
+	// Smallest and largest signed angle, and the unit edge directions they were found at.
+	double min = std::numeric_limits<double>::max();
+	double max = -1.0 * std::numeric_limits<double>::max();
+	glm::dvec3 minDirection;
+	glm::dvec3 maxDirection;
+};
+
+// What the curvature measures at one vertex are made of. MeshAnalysis fills in the ones a set of measures needs.
+struct CurvatureTerms
+{
+	// The terms besides the total angle and the normal, which are always there.
+	enum Needs
+	{
+		STAR = 1,      // closed and star
+		MEAN = 2,      // mixedArea and meanVector
+		PERIMETER = 4, // mixedPerimeter
+		TURNING = 8    // turning; only gathered along with the perimeter
+	};
+
+	double totalAngle = 0.0;
+	glm::dvec3 normal;
+
+	// The dihedral angles around the star, if it is closed.
+	bool closed = false;
+	StarDistortion star;
+
+	// Mixed area, or -1 on a boundary, and the mean curvature normal if there is one.
+	double mixedArea = -1.0;
+	glm::dvec3 meanVector;
+
+	// Mixed perimeter, or -1 on a boundary.
+	double mixedPerimeter = -1.0;
+
+	// Sum of the unsigned angles between consecutive normals of a closed star, starting with the last and first.
+	double turning = 0.0;
+
+	// Half the length of the mean curvature normal, negative if sign is set and it points away from the normal.
+	// 0 on a boundary.
+	double GetMeanCurvature(bool sign) const
+	{
+		if (mixedArea == -1)
+			return 0;
+
+		double meanCurvature = 0.5 * glm::length(meanVector);
+		if (!sign || glm::dot(normal, meanVector) > 0)
+			return meanCurvature;
+		else
+			return -1.0 * meanCurvature;
+	}
+};
+
+/** One kernel per Curvature, chosen at compile time.
+ *
+ * CurvatureKernel<C>::NEEDS is the set of terms measure C reads, and Compute() turns them into its value
+ * in a few operations. The expensive part, walking around the vertex, is all in gathering the terms,
+ * and a set of measures gathers each term once: the seven measures built from the dihedral angles share one walk.
+ * The kernels only see the terms, so they serve a Polyhedron and a CompactMesh alike.
+ */
+template <Curvature C> struct CurvatureKernel;
+
+template <> struct CurvatureKernel<Curvature::GAUSSIAN>
+{
+	static const int NEEDS = 0;
+	static double Compute(const CurvatureTerms& terms) { return (2.0 * M_PI) - terms.totalAngle; }
+};
+
+template <> struct CurvatureKernel<Curvature::MEAN>
+{
+	static const int NEEDS = CurvatureTerms::MEAN;
+	static double Compute(const CurvatureTerms& terms) { return terms.GetMeanCurvature(false); }
+};
+
+template <> struct CurvatureKernel<Curvature::MEAN_SIGNED>
+{
+	static const int NEEDS = CurvatureTerms::MEAN;
+	static double Compute(const CurvatureTerms& terms) { return terms.GetMeanCurvature(true); }
+};
+
+// Length of the boundary of the Gauss map over the mixed perimeter.
+template <> struct CurvatureKernel<Curvature::HORIZON>
+{
+	static const int NEEDS = CurvatureTerms::PERIMETER | CurvatureTerms::TURNING;
+	static double Compute(const CurvatureTerms& terms)
+	{
+		if (terms.mixedPerimeter == -1)
+			return 0;
+		return 2.0 * terms.turning / terms.mixedPerimeter;
+	}
+};
+
+// The rest are built from the dihedral angles around the vertex, and are 0 unless its star is closed.
+template <> struct CurvatureKernel<Curvature::ORIGINAL>
+{
+	static const int NEEDS = CurvatureTerms::STAR | CurvatureTerms::PERIMETER;
+	static double Compute(const CurvatureTerms& terms) { return terms.closed ? terms.star.signedSum / terms.mixedPerimeter : 0; }
+};
+
+template <> struct CurvatureKernel<Curvature::DISTORTION>
+{
+	static const int NEEDS = CurvatureTerms::STAR;
+	static double Compute(const CurvatureTerms& terms) { return terms.closed ? terms.star.unsignedSum : 0; }
+};
+
+template <> struct CurvatureKernel<Curvature::DISTORTION_SIGNED>
+{
+	static const int NEEDS = CurvatureTerms::STAR;
+	static double Compute(const CurvatureTerms& terms) { return terms.closed ? terms.star.signedSum : 0; }
+};
+
+template <> struct CurvatureKernel<Curvature::MAX_PRINCIPAL_DISTORTION>
+{
+	static const int NEEDS = CurvatureTerms::STAR;
+	static double Compute(const CurvatureTerms& terms) { return terms.closed ? terms.star.max : 0; }
+};
+
+template <> struct CurvatureKernel<Curvature::MIN_PRINCIPAL_DISTORTION>
+{
+	static const int NEEDS = CurvatureTerms::STAR;
+	static double Compute(const CurvatureTerms& terms) { return terms.closed ? terms.star.min : 0; }
+};
+
+template <> struct CurvatureKernel<Curvature::FALSE_GAUSSIAN>
+{
+	static const int NEEDS = CurvatureTerms::STAR;
+	static double Compute(const CurvatureTerms& terms) { return terms.closed ? terms.star.min * terms.star.max : 0; }
+};
+
+template <> struct CurvatureKernel<Curvature::FALSE_MEAN>
+{
+	static const int NEEDS = CurvatureTerms::STAR;
+	static double Compute(const CurvatureTerms& terms) { return terms.closed ? 0.5 * (terms.star.min + terms.star.max) : 0; }
+};
+
+// The angle between the max/min principal distortions.
+template <> struct CurvatureKernel<Curvature::PRINCIPAL_DEVIATION>
+{
+	static const int NEEDS = CurvatureTerms::STAR;
+	static double Compute(const CurvatureTerms& terms)
+	{
+		if (!terms.closed)
+			return 0;
+		double principalAngle = glm::acos(glm::clamp(glm::dot(terms.star.maxDirection, terms.star.minDirection), -1.0, 1.0));
+		return 0.5 * M_PI - principalAngle;
+	}
+};
+
+// The Gaussian curvature of the dual cone.
+template <> struct CurvatureKernel<Curvature::CONE>
+{
+	static const int NEEDS = CurvatureTerms::STAR | CurvatureTerms::MEAN;
+	static double Compute(const CurvatureTerms& terms)
+	{
+		if (!terms.closed)
+			return 0;
+		double mean = terms.GetMeanCurvature(true);
+		double distortion = terms.star.signedSum;
+		return std::abs(std::abs(mean) - std::abs(distortion));
+	}
+};
+
+// The difference between the mean curvature and the distortion.
+template <> struct CurvatureKernel<Curvature::DIFFERENCE>
+{
+	static const int NEEDS = CurvatureTerms::STAR | CurvatureTerms::MEAN | CurvatureTerms::PERIMETER;
+	static double Compute(const CurvatureTerms& terms)
+	{
+		if (!terms.closed)
+			return 0;
+		double distortion = terms.star.signedSum / terms.mixedPerimeter;
+		double mean = terms.GetMeanCurvature(true);
+		return std::abs(mean - distortion);
+	}
+};
+
+/** The kernels as a set.
+ *
+ * With the curvatures known at compile time, Compute<Cs...>() runs all of their kernels inline.
+ * With a list known only at runtime, Get() looks up the kernel of each one in a table built from the same templates.
+ */
+class CurvatureKernels
+{
+
+public:
+
+	// A kernel, for a curvature chosen at runtime.
+	struct Entry
+	{
+		int needs;
+		double (*compute)(const CurvatureTerms&);
+	};
+
+	static const Entry& Get(Curvature curvature);
+
+	// The terms a set of curvatures needs between them.
+	template <Curvature... Cs> static constexpr int Needs() { return (0 | ... | CurvatureKernel<Cs>::NEEDS); }
+	static int Needs(const std::vector<Curvature>& curvatures);
+
+	// values[k] is the kth curvature of Cs.
+	template <Curvature... Cs> static void Compute(const CurvatureTerms& terms, double* values)
+	{
+		int k = 0;
+		((values[k++] = CurvatureKernel<Cs>::Compute(terms)), ...);
+	}
+
+private:
+
+	template <Curvature C> static constexpr Entry MakeEntry() { return Entry{ CurvatureKernel<C>::NEEDS, &CurvatureKernel<C>::Compute }; }
+
+	CurvatureKernels();
+	~CurvatureKernels();
+
+};
@@ -7,7 +7,7 @@ CurveComponent::CurveComponent()
 }
 CurveComponent::CurveComponent(std::vector<LineVertex> vertices)
 {
-	this->vertices = vertices;
+	this->vertices = std::move(vertices);
 	this->transform = glm::mat4(1);
 }
 
@@ -0,0 +1,201 @@
+#include "dihedral.hpp"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DIHEDRAL_X86
+#endif
+
+namespace
+{
+	// Taylor series of asin(y) / y in powers of y^2: (2n)! / (4^n (n!)^2 (2n + 1)).
+	// Acos() only needs it for y <= 0.5, where 25 terms are past the last bit.
+	const int ASIN_TERMS = 25;
+	struct AsinSeries
+	{
+		double c[ASIN_TERMS];
+		constexpr AsinSeries() : c()
+		{
+			double a = 1.0;
+			for (int n = 0; n < ASIN_TERMS; ++n)
+			{
+				c[n] = a / (2 * n + 1);
+				a *= (2.0 * n + 1.0) / (2.0 * n + 2.0);
+			}
+		}
+	};
+	constexpr AsinSeries ASIN;
+}
+
+bool Dihedral::forceScalar = false;
+
+double Dihedral::Acos(double x)
+{
+	// acos(a) = pi/2 - asin(a) for a <= 0.5, and 2 asin(sqrt((1 - a) / 2)) above, so the series always sees y <= 0.5.
+	double a = std::abs(x);
+	bool big = a > 0.5;
+	double y = big ? std::sqrt((1.0 - a) * 0.5) : a;
+	double z = y * y;
+	double s = ASIN.c[ASIN_TERMS - 1];
+	for (int k = ASIN_TERMS - 2; k >= 0; --k)
+	{
+		s = s * z + ASIN.c[k];
+	}
+	s = s * y;
+	double r = big ? 2.0 * s : M_PI_2 - s;
+	return (x < 0) ? M_PI - r : r;
+}
+
+void Dihedral::ComputeSignedAngles(const Edges& edges, int count, double* angles)
+{
+	int done = 0;
+	if (!forceScalar && HasAvx2())
+	{
+		done = count - count % 4;
+		ComputeAvx2(edges, 0, done, angles);
+	}
+	ComputeScalar(edges, done, count, angles);
+}
+
+void Dihedral::ComputeScalar(const Edges& edges, int begin, int end, double* angles)
+{
+	const double* const* c = edges.current;
+	const double* const* n = edges.next;
+	const double* const* t = edges.tangent;
+	for (int i = begin; i < end; ++i)
+	{
+		// Angle between normals. The clamp keeps a NaN, like glm::clamp.
+		double dot = c[0][i] * n[0][i] + c[1][i] * n[1][i] + c[2][i] * n[2][i];
+		dot = (dot < -1.0) ? -1.0 : dot;
+		dot = (1.0 < dot) ? 1.0 : dot;
+		double angle = Acos(dot);
+
+		// \ip{N_i \times N_{i+1} , t_e} > 0 => negative.
+		double x = c[1][i] * n[2][i] - n[1][i] * c[2][i];
+		double y = c[2][i] * n[0][i] - n[2][i] * c[0][i];
+		double z = c[0][i] * n[1][i] - n[0][i] * c[1][i];
+		double ip = x * t[0][i] + y * t[1][i] + z * t[2][i];
+		angles[i] = (ip > 0) ? -angle : angle;
+	}
+}
+
+#ifdef DIHEDRAL_X86
+
+// The same arithmetic as ComputeScalar() and Acos(), four edges at a time.
+// FMA is left out on purpose: fusing the multiplies and adds would round differently from the scalar loop.
+__attribute__((target("avx2")))
+void Dihedral::ComputeAvx2(const Edges& edges, int begin, int end, double* angles)
+{
+	const double* const* c = edges.current;
+	const double* const* n = edges.next;
+	const double* const* t = edges.tangent;
+	const __m256d ONE = _mm256_set1_pd(1.0);
+	const __m256d MINUS_ONE = _mm256_set1_pd(-1.0);
+	const __m256d HALF = _mm256_set1_pd(0.5);
+	const __m256d TWO = _mm256_set1_pd(2.0);
+	const __m256d ZERO = _mm256_setzero_pd();
+	const __m256d SIGN = _mm256_set1_pd(-0.0);
+	const __m256d HALF_PI = _mm256_set1_pd(M_PI_2);
+	const __m256d PI = _mm256_set1_pd(M_PI);
+
+	for (int i = begin; i < end; i += 4)
+	{
+		__m256d cx = _mm256_loadu_pd(c[0] + i);
+		__m256d cy = _mm256_loadu_pd(c[1] + i);
+		__m256d cz = _mm256_loadu_pd(c[2] + i);
+		__m256d nx = _mm256_loadu_pd(n[0] + i);
+		__m256d ny = _mm256_loadu_pd(n[1] + i);
+		__m256d nz = _mm256_loadu_pd(n[2] + i);
+
+		// max(lo, x) and min(hi, x) return x when it is NaN.
+		__m256d dot = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(cx, nx), _mm256_mul_pd(cy, ny)), _mm256_mul_pd(cz, nz));
+		dot = _mm256_max_pd(MINUS_ONE, dot);
+		dot = _mm256_min_pd(ONE, dot);
+
+		// Acos():
+		__m256d a = _mm256_andnot_pd(SIGN, dot);
+		__m256d big = _mm256_cmp_pd(a, HALF, _CMP_GT_OQ);
+		__m256d y = _mm256_blendv_pd(a, _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(ONE, a), HALF)), big);
+		__m256d z = _mm256_mul_pd(y, y);
+		__m256d s = _mm256_set1_pd(ASIN.c[ASIN_TERMS - 1]);
+		for (int k = ASIN_TERMS - 2; k >= 0; --k)
+		{
+			s = _mm256_add_pd(_mm256_mul_pd(s, z), _mm256_set1_pd(ASIN.c[k]));
+		}
+		s = _mm256_mul_pd(s, y);
+		__m256d r = _mm256_blendv_pd(_mm256_sub_pd(HALF_PI, s), _mm256_mul_pd(TWO, s), big);
+		__m256d angle = _mm256_blendv_pd(r, _mm256_sub_pd(PI, r), _mm256_cmp_pd(dot, ZERO, _CMP_LT_OQ));
+
+		// The sign:
+		__m256d x = _mm256_sub_pd(_mm256_mul_pd(cy, nz), _mm256_mul_pd(ny, cz));
+		__m256d w = _mm256_sub_pd(_mm256_mul_pd(cz, nx), _mm256_mul_pd(nz, cx));
+		__m256d v = _mm256_sub_pd(_mm256_mul_pd(cx, ny), _mm256_mul_pd(nx, cy));
+		__m256d ip = _mm256_add_pd(_mm256_add_pd(
+			_mm256_mul_pd(x, _mm256_loadu_pd(t[0] + i)),
+			_mm256_mul_pd(w, _mm256_loadu_pd(t[1] + i))),
+			_mm256_mul_pd(v, _mm256_loadu_pd(t[2] + i)));
+		__m256d negative = _mm256_and_pd(_mm256_cmp_pd(ip, ZERO, _CMP_GT_OQ), SIGN);
+		_mm256_storeu_pd(angles + i, _mm256_xor_pd(angle, negative));
+	}
+}
+
+bool Dihedral::HasAvx2()
+{
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+
+#else
+
+void Dihedral::ComputeAvx2(const Edges& edges, int begin, int end, double* angles)
+{
+	ComputeScalar(edges, begin, end, angles);
+}
+
+bool Dihedral::HasAvx2()
+{
+	return false;
+}
+
+#endif
+
+Dihedral::Batch::Batch(int capacity)
+	: capacity(capacity), values(9 * capacity)
+{
+}
+
+void Dihedral::Batch::Set(int i, const glm::dvec3& current, const glm::dvec3& next, const glm::dvec3& tangent)
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		values[k * capacity + i] = current[k];
+		values[(3 + k) * capacity + i] = next[k];
+		values[(6 + k) * capacity + i] = tangent[k];
+	}
+}
+
+Dihedral::Edges Dihedral::Batch::GetEdges() const
+{
+	Edges edges;
+	for (int k = 0; k < 3; ++k)
+	{
+		edges.current[k] = values.data() + k * capacity;
+		edges.next[k] = values.data() + (3 + k) * capacity;
+		edges.tangent[k] = values.data() + (6 + k) * capacity;
+	}
+	return edges;
+}
+
+const char* Dihedral::GetInstructionSet()
+{
+	return (!forceScalar && HasAvx2()) ? "avx2" : "scalar";
+}
+
+void Dihedral::SetScalar(bool scalar)
+{
+	forceScalar = scalar;
+}
+
+Dihedral::Dihedral() {}
+Dihedral::~Dihedral() {}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/** Signed dihedral angles of many edges in one sweep.
+ *
+ * Every distortion measure is built from the angle between the normals of the two triangles at each edge of a star,
+ * signed by which way the surface bends along the edge. That is an acos, a cross product and a dot product per edge,
+ * and it is the same for every measure and both ends of the edge, so MeshAnalysis and CompactMesh compute it once per edge
+ * with ComputeSignedAngles() and the measures add up the results.
+ *
+ * The input is in SoA form, one array per coordinate, so that four edges at a time fill an AVX2 register.
+ * AVX2 is used when the processor has it and the scalar loop otherwise. acos() is not an instruction, so both paths
+ * evaluate the same series with the same operations in the same order, and give the same bits.
+ */
+class Dihedral
+{
+
+public:
+
+	// The arrays of count edges: the unit normal of the current and the next triangle of each edge,
+	// and the tangent t along it, from the vertex the current triangle leaves it at.
+	struct Edges
+	{
+		const double* current[3];
+		const double* next[3];
+		const double* tangent[3];
+	};
+
+	// Storage for the arrays of up to capacity edges, filled in one edge at a time.
+	class Batch
+	{
+
+	public:
+
+		Batch(int capacity);
+
+		void Set(int i, const glm::dvec3& current, const glm::dvec3& next, const glm::dvec3& tangent);
+		Edges GetEdges() const;
+
+	private:
+
+		int capacity;
+		std::vector<double> values;
+
+	};
+
+	// angles[i] is the angle between the two normals of edge i, negative if (current x next) . tangent > 0.
+	static void ComputeSignedAngles(const Edges& edges, int count, double* angles);
+
+	// acos() as ComputeSignedAngles() computes it, within a couple of ulps of std::acos on [-1, 1].
+	static double Acos(double x);
+
+	// "avx2" or "scalar": what ComputeSignedAngles() runs on this machine.
+	static const char* GetInstructionSet();
+
+	// Use the scalar loop even where AVX2 is available, to compare the two.
+	static void SetScalar(bool scalar);
+
+private:
+
+	static void ComputeScalar(const Edges& edges, int begin, int end, double* angles);
+	static void ComputeAvx2(const Edges& edges, int begin, int end, double* angles);
+
+	static bool HasAvx2();
+	static bool forceScalar;
+
+	Dihedral();
+	~Dihedral();
+
+};
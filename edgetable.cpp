@@ -0,0 +1,63 @@
+#include "edgetable.hpp"
+
+#include <cstddef>
+
+int EdgeTable::Build(const std::vector<int>& triangles, int numVertices, std::vector<int>& halfEdgeToEdge)
+{
+	int numHalfEdges = triangles.size();
+	halfEdgeToEdge.assign(numHalfEdges, -1);
+
+	// Two stable counting sorts, by the larger vertex and then by the smaller one, order the half-edges
+	// by (smaller vertex, larger vertex, half-edge), so the half-edges of an edge follow each other, first one first.
+	std::vector<int> lows(numHalfEdges);
+	std::vector<int> highs(numHalfEdges);
+	for (int h = 0; h < numHalfEdges; ++h)
+	{
+		int a = triangles[h];
+		int b = triangles[(h % 3 == 2) ? h - 2 : h + 1];
+		lows[h] = (a < b ? a : b);
+		highs[h] = (a < b ? b : a);
+	}
+	std::vector<int> byHigh(numHalfEdges);
+	std::vector<int> sorted(numHalfEdges);
+	std::vector<int> offsets(numVertices + 1);
+	auto countingSort = [&](const std::vector<int>& keys, const int* input, std::vector<int>& output)
+	{
+		offsets.assign(numVertices + 1, 0);
+		for (int h = 0; h < numHalfEdges; ++h)
+		{
+			++offsets[keys[h] + 1];
+		}
+		for (int v = 0; v < numVertices; ++v)
+		{
+			offsets[v + 1] += offsets[v];
+		}
+		for (int i = 0; i < numHalfEdges; ++i)
+		{
+			int h = (input == NULL) ? i : input[i];
+			output[offsets[keys[h]]++] = h;
+		}
+	};
+	countingSort(highs, NULL, byHigh);
+	countingSort(lows, byHigh.data(), sorted);
+
+	// Merge: every half-edge points to the first half-edge of its run, which owns the edge.
+	std::vector<int>& owners = byHigh;
+	for (int i = 0; i < numHalfEdges; ++i)
+	{
+		int h = sorted[i];
+		bool same = i > 0 && lows[sorted[i - 1]] == lows[h] && highs[sorted[i - 1]] == highs[h];
+		owners[h] = same ? owners[sorted[i - 1]] : h;
+	}
+
+	// Number the edges in order of first appearance: an owner comes before the other half-edges of its edge.
+	int numEdges = 0;
+	for (int h = 0; h < numHalfEdges; ++h)
+	{
+		halfEdgeToEdge[h] = (owners[h] == h) ? numEdges++ : halfEdgeToEdge[owners[h]];
+	}
+	return numEdges;
+}
+
+EdgeTable::EdgeTable() {}
+EdgeTable::~EdgeTable() {}
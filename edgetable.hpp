@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+/** Edge matching over a flat triangle index list.
+ * Triangle i owns the three half-edges 3i, 3i+1, 3i+2, where half-edge 3i+j runs from triangles[3i+j] to triangles[3i+(j+1)%3].
+ * Two half-edges lie on the same edge exactly when their unordered vertex pairs agree.
+ *
+ * Matching is a sort-and-merge: two stable counting sorts, by the larger vertex and then by the smaller one, put the
+ * half-edges of each edge next to each other, and one pass over the runs matches them up.
+ * Everything is O(T + V) over flat arrays, however high the valences, and it follows the vertex order of the mesh.
+ */
+class EdgeTable
+{
+
+public:
+
+	// Assign an edge to every half-edge and return the number of edges.
+	// Edges are numbered in order of first appearance, scanning the half-edges in order.
+	static int Build(const std::vector<int>& triangles, int numVertices, std::vector<int>& halfEdgeToEdge);
+
+private:
+
+	EdgeTable();
+	~EdgeTable();
+
+};
@@ -13,43 +13,6 @@ Vert::Vert(double x, double y, double z)
 	this->normal = glm::dvec3(0.0, 0.0, 0.0);
 }
 Vert::~Vert() {}
-Vert::Vert(const Vert& v)
-{
-	this->index = v.index;
-	this->x = v.x;
-	this->y = v.y;
-	this->z = v.z;
-	this->normal = v.normal;
-	this->triangles = v.triangles;
-	this->valence = v.valence;
-	this->totalAngle = v.totalAngle;
-	this->c = v.c;
-}
-Vert::Vert(Vert&& v)
-{
-	this->index = v.index;
-	this->x = v.x;
-	this->y = v.y;
-	this->z = v.z;
-	this->normal = v.normal;
-	this->triangles = v.triangles;
-	this->valence = v.valence;
-	this->totalAngle = v.totalAngle;
-	this->c = v.c;
-}
-Vert& Vert::operator=(Vert&& v)
-{
-	this->index = v.index;
-	this->x = v.x;
-	this->y = v.y;
-	this->z = v.z;
-	this->normal = v.normal;
-	this->triangles = v.triangles;
-	this->valence = v.valence;
-	this->totalAngle = v.totalAngle;
-	this->c = v.c;
-	return *this;
-}
 
 void Vert::Print()
 {
@@ -79,28 +42,9 @@ glm::dvec3 Vert::GetPosition()
 
 Edge::Edge()
 {
-	this->vertices = std::vector<Vert*>(2);
+	this->vertices.fill(NULL);
 }
 Edge::~Edge() {}
-Edge::Edge(const Edge& e)
-{
-	this->index = e.index;
-	this->vertices = e.vertices;
-	this->triangles = e.triangles;
-}
-Edge::Edge(Edge&& e)
-{
-	this->index = e.index;
-	this->vertices = e.vertices;
-	this->triangles = e.triangles;
-}
-Edge& Edge::operator=(Edge&& e)
-{
-	this->index = e.index;
-	this->vertices = e.vertices;
-	this->triangles = e.triangles;
-	return *this;
-}
 
 void Edge::Print()
 {
@@ -177,36 +121,11 @@ int Edge::Contains(Vert* v)
 
 Triangle::Triangle()
 {
-	this->vertices = std::vector<Vert*>(3);
-	this->edges = std::vector<Edge*>(3);
+	this->vertices.fill(NULL);
+	this->edges.fill(NULL);
 	this->normal = glm::dvec3(0.0, 0.0, 0.0);
 }
 Triangle::~Triangle() {}
-Triangle::Triangle(const Triangle& t)
-{
-	this->index = t.index;
-	this->normal = t.normal;
-	this->area = t.area;
-	this->vertices = t.vertices;
-	this->edges = t.edges;
-}
-Triangle::Triangle(Triangle&& t)
-{
-	this->index = t.index;
-	this->normal = t.normal;
-	this->area = t.area;
-	this->vertices = t.vertices;
-	this->edges = t.edges;
-}
-Triangle& Triangle::operator=(Triangle&& t)
-{
-	this->index = t.index;
-	this->normal = t.normal;
-	this->area = t.area;
-	this->vertices = t.vertices;
-	this->edges = t.edges;
-	return *this;
-}
 
 void Triangle::Print()
 {
@@ -267,16 +186,14 @@ Corner::~Corner() {}
 std::vector<Vert*> Corner::GetAdjacentVertices()
 {
 	std::vector<Vert*> connected;
-	// Bounce around until we get back to where we started.
-	int k = -1;
-	Corner* previous = this;
-	while (k != this->index)
-	{
-		Corner* adjacent = previous->p->o->p;
-		k = adjacent->index;
 
+	// Each corner of the fan adds the vertex after it. A fan cut by a boundary also has the one before its first corner.
+	CornerFan fan = CornerFan::After(*this);
+	if (!fan.IsClosed())
+		connected.push_back((*fan.begin())->p->v);
+	for (Corner* adjacent : fan)
+	{
 		connected.push_back(adjacent->n->v);
-		previous = adjacent;
 	}
 	return connected;
 }
@@ -303,38 +220,3 @@ void Corner::Print()
 	std::cout << std::endl;
 }
 
-Corner::Corner(const Corner& c)
-{
-	this->index = c.index;
-	this->v = c.v;
-	this->e = c.e;
-	this->t = c.t;
-	this->n = c.n;
-	this->p = c.p;
-	this->o = c.o;
-	this->angle = c.angle;
-}
-Corner::Corner(Corner&& c)
-{
-	this->index = c.index;
-	this->v = c.v;
-	this->e = c.e;
-	this->t = c.t;
-	this->n = c.n;
-	this->p = c.p;
-	this->o = c.o;
-	this->angle = c.angle;
-}
-Corner& Corner::operator=(Corner&& c)
-{
-	this->index = c.index;
-	this->v = c.v;
-	this->e = c.e;
-	this->t = c.t;
-	this->n = c.n;
-	this->p = c.p;
-	this->o = c.o;
-	this->angle = c.angle;
-	return *this;
-}
-
@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <vector>
+#include <array>
+#include <memory_resource>
 #include <cmath>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
@@ -35,9 +37,10 @@ public:
 	Vert();
 	Vert(double x, double y, double z);
 	~Vert();
-	Vert(const Vert& v);
-	Vert(Vert&& v);
-	Vert& operator=(Vert&& v);
+	Vert(const Vert& v) = default;
+	Vert(Vert&& v) = default;
+	Vert& operator=(const Vert& v) = default;
+	Vert& operator=(Vert&& v) = default;
 
 
 	/*** Methods ***/
@@ -59,12 +62,23 @@ public:
 	glm::dvec3 normal;
 	double totalAngle = 0.0;
 
+	// Area and perimeter of the part of the Voronoi region of the vertex inside its triangles, or -1 for a vertex without any.
+	// On a boundary the region is cut off by the boundary edges. Cached by MeshAnalysis::ComputeCurvatureGeometry().
+	double mixedArea = -1.0;
+	double mixedPerimeter = -1.0;
+
 	// Number of edges attached to the vertex.
 	int valence = 0;
 
 	// One of the corners of the vertex: the others can be found by corner traversal.
-	Corner* c;
-	std::vector<Triangle*> triangles;
+	Corner* c = NULL;
+
+	// If the fan of c is cut by a boundary, the corner at its clockwise end, where a counterclockwise walk starts.
+	// NULL if the fan is closed. Set by MeshAnalysis::GetBoundaryCorners().
+	Corner* boundary = NULL;
+
+	// Allocated from the arena of the polyhedron once it is initialized; see Polyhedron::CreateArena().
+	std::pmr::vector<Triangle*> triangles;
 };
 
 
@@ -77,9 +91,10 @@ public:
 	/*** Constructors ***/
 	Edge();
 	~Edge();
-	Edge(const Edge& e);
-	Edge(Edge&& e);
-	Edge& operator=(Edge&& e);
+	Edge(const Edge& e) = default;
+	Edge(Edge&& e) = default;
+	Edge& operator=(const Edge& e) = default;
+	Edge& operator=(Edge&& e) = default;
 
 
 	/*** Methods ***/
@@ -102,8 +117,15 @@ public:
 	/*** Fields ***/
 
 	int index = -1;
-	std::vector<Vert*> vertices;
-	std::vector<Triangle*> triangles;
+	std::array<Vert*, 2> vertices;
+
+	// Cached by MeshAnalysis::ComputeCurvatureGeometry(): GetLength(), and the signed angle between the normals
+	// of the two triangles (0 on a boundary), which is the same seen from either end of the edge.
+	double length = 0.0;
+	double dihedral = 0.0;
+
+	// Allocated from the arena of the polyhedron, like Vert::triangles.
+	std::pmr::vector<Triangle*> triangles;
 };
 
 
@@ -116,9 +138,10 @@ public:
 	/*** Constructors ***/
 	Triangle();
 	~Triangle();
-	Triangle(const Triangle& t);
-	Triangle(Triangle&& t);
-	Triangle& operator=(Triangle&& t);
+	Triangle(const Triangle& t) = default;
+	Triangle(Triangle&& t) = default;
+	Triangle& operator=(const Triangle& t) = default;
+	Triangle& operator=(Triangle&& t) = default;
 
 
 	/*** Methods ***/
@@ -135,8 +158,9 @@ public:
 	// Area: keep in memory since it does involve a square root, I guess.
 	double area = -1.0;
 
-	std::vector<Vert*> vertices;
-	std::vector<Edge*> edges;
+	// Fixed size, so a triangle carries its connectivity inline instead of in two heap blocks.
+	std::array<Vert*, 3> vertices;
+	std::array<Edge*, 3> edges;
 };
 
 
@@ -151,9 +175,10 @@ public:
 
 	Corner();
 	~Corner();
-	Corner(const Corner& v);
-	Corner(Corner&& v);
-	Corner& operator=(Corner&& v);
+	Corner(const Corner& c) = default;
+	Corner(Corner&& c) = default;
+	Corner& operator=(const Corner& c) = default;
+	Corner& operator=(Corner&& c) = default;
 
 	// Get all adjacent vertices to c.v.
 	std::vector<Vert*> GetAdjacentVertices();
@@ -174,4 +199,69 @@ public:
 
 	double angle = 0.0;
 
+	// 1 / tan(angle), cached by MeshAnalysis::ComputeCurvatureGeometry().
+	double cotangent = 0.0;
+
+};
+
+
+/** The corners of one vertex, one per triangle of its fan, counterclockwise (c.p.o.p):
+ *
+ *     for (Corner* c : CornerFan(v))
+ *
+ * A closed fan goes once around, from the corner it is given. A fan cut by a boundary always runs from Vert::boundary
+ * to the other boundary edge, wherever it is asked to start, so a walk is O(valence) either way and never dereferences
+ * a missing opposite corner. A walk also stops where the next triangle meets the vertex with the other orientation.
+ * Nothing is allocated.
+ */
+class CornerFan
+{
+
+public:
+
+	class Iterator
+	{
+
+	public:
+
+		Iterator(Corner* c, Corner* first) : c(c), first(first) {}
+
+		Corner* operator*() const { return c; }
+		bool operator!=(const Iterator& i) const { return c != i.c; }
+
+		Iterator& operator++()
+		{
+			Corner* o = c->p->o;
+			Corner* next = (o == NULL) ? NULL : o->p;
+			c = (next == NULL || next->v != c->v || next == first) ? NULL : next;
+			return *this;
+		}
+
+	private:
+
+		Corner* c;
+		Corner* first;
+	};
+
+	// The fan of the vertex of c, starting with c if it is closed. Swing(v.c) first and v.c last is the order
+	// of MeshAnalysis::GetVertexStar(), so a closed fan from CornerFan(v) or After(c) ends where it was started from.
+	explicit CornerFan(Corner& c) : first(c.v->boundary != NULL ? c.v->boundary : &c) {}
+	explicit CornerFan(Vert& v) : first(v.c == NULL ? NULL : (v.boundary != NULL ? v.boundary : Swing(v.c))) {}
+	static CornerFan After(Corner& c) { return CornerFan(c.v->boundary != NULL ? c.v->boundary : Swing(&c)); }
+
+	Iterator begin() const { return Iterator(first, first); }
+	Iterator end() const { return Iterator(NULL, first); }
+
+	// False if the fan is cut by a boundary.
+	bool IsClosed() const { return first == NULL || first->v->boundary == NULL; }
+
+	// The next corner counterclockwise around the vertex of c, which must not be on a boundary.
+	static Corner* Swing(Corner* c) { return c->p->o->p; }
+
+private:
+
+	explicit CornerFan(Corner* first) : first(first) {}
+
+	Corner* first;
+
 };
@@ -0,0 +1,412 @@
+#include "laplacian.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+struct Laplacian::Factorization
+{
+	double dt = 0.0;
+	Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver;
+};
+
+Laplacian::Laplacian() {}
+Laplacian::~Laplacian() {}
+
+void Laplacian::Build(Polyhedron* p)
+{
+	int n = p->vlist.size();
+	factorization.reset();
+	areas.resize(n);
+	rowOffsets.assign(n + 1, 0);
+
+	// Row i: the neighbours of vertex i with their weights, sorted and merged, and the diagonal.
+	// Each triangle of the star gives half the cotangent of its other two corners to the edges across from them.
+	auto buildRow = [&](int i, std::vector<std::pair<int, double>>& row)
+	{
+		row.clear();
+		Vert& v = p->vlist[i];
+		for (Triangle* t : v.triangles)
+		{
+			Corner& c = p->clist[3 * t->index + t->Contains(&v)];
+			row.push_back(std::make_pair(c.n->v->index, 0.5 * c.p->cotangent));
+			row.push_back(std::make_pair(c.p->v->index, 0.5 * c.n->cotangent));
+		}
+		row.push_back(std::make_pair(i, 0.0));
+		std::sort(row.begin(), row.end(), [](const std::pair<int, double>& a, const std::pair<int, double>& b) { return a.first < b.first; });
+
+		int size = 0;
+		double diagonal = 0.0;
+		for (int k = 0; k < row.size(); ++k)
+		{
+			if (size > 0 && row[size - 1].first == row[k].first)
+				row[size - 1].second += row[k].second;
+			else
+				row[size++] = row[k];
+			diagonal -= row[k].second;
+		}
+		row.resize(size);
+		for (std::pair<int, double>& entry : row)
+		{
+			if (entry.first == i)
+				entry.second = diagonal;
+		}
+	};
+
+	// Count the entries of each row, then fill them in at their offsets.
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<std::pair<int, double>> row;
+		for (int i = begin; i < end; ++i)
+		{
+			buildRow(i, row);
+			rowOffsets[i + 1] = row.size();
+			areas[i] = (p->vlist[i].boundary != NULL) ? -1 : p->vlist[i].mixedArea;
+		}
+	});
+	for (int i = 0; i < n; ++i)
+	{
+		rowOffsets[i + 1] += rowOffsets[i];
+	}
+
+	columns.resize(rowOffsets[n]);
+	weights.resize(rowOffsets[n]);
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<std::pair<int, double>> row;
+		for (int i = begin; i < end; ++i)
+		{
+			buildRow(i, row);
+			for (int k = 0; k < row.size(); ++k)
+			{
+				columns[rowOffsets[i] + k] = row[k].first;
+				weights[rowOffsets[i] + k] = row[k].second;
+			}
+		}
+	});
+}
+
+int Laplacian::GetSize() const
+{
+	return areas.size();
+}
+
+void Laplacian::ExplicitStep(const std::vector<double>& in, std::vector<double>& out, int channels, double dt) const
+{
+	int n = GetSize();
+	out.resize(in.size());
+	const int BLOCK_SIZE = 1024;
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<double> sum(channels);
+		for (int i = begin; i < end; ++i)
+		{
+			const double* row = &in[i * channels];
+			double* result = &out[i * channels];
+			if (areas[i] <= 0)
+			{
+				std::copy(row, row + channels, result);
+				continue;
+			}
+
+			std::fill(sum.begin(), sum.end(), 0.0);
+			for (int k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+			{
+				const double* neighbour = &in[columns[k] * channels];
+				double w = weights[k];
+				for (int c = 0; c < channels; ++c)
+				{
+					sum[c] += w * neighbour[c];
+				}
+			}
+
+			double scale = dt / areas[i];
+			for (int c = 0; c < channels; ++c)
+			{
+				result[c] = row[c] + scale * sum[c];
+			}
+		}
+	});
+}
+
+void Laplacian::MultiplyImplicit(const std::vector<double>& x, std::vector<double>& y, int channels, double dt) const
+{
+	int n = GetSize();
+	const int BLOCK_SIZE = 1024;
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const double* row = &x[i * channels];
+			double* result = &y[i * channels];
+			if (areas[i] <= 0)
+			{
+				std::copy(row, row + channels, result);
+				continue;
+			}
+
+			std::fill(result, result + channels, 0.0);
+			for (int k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+			{
+				int j = columns[k];
+				double w = (j == i) ? areas[i] - dt * weights[k] : -dt * weights[k];
+				if (j != i && areas[j] <= 0)
+					continue;
+				const double* neighbour = &x[j * channels];
+				for (int c = 0; c < channels; ++c)
+				{
+					result[c] += w * neighbour[c];
+				}
+			}
+		}
+	});
+}
+
+void Laplacian::Dot(const std::vector<double>& a, const std::vector<double>& b, int channels, std::vector<double>& result) const
+{
+	// Fixed blocks, each summed on its own, then the blocks in order, so the sums do not depend on the threads.
+	int n = GetSize();
+	const int BLOCK_SIZE = 4096;
+	int blocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<double> partial(blocks * channels, 0.0);
+	Parallel::For(blocks, [&](int block)
+	{
+		double* sum = &partial[block * channels];
+		for (int i = block * BLOCK_SIZE; i < std::min(n, (block + 1) * BLOCK_SIZE); ++i)
+		{
+			for (int c = 0; c < channels; ++c)
+			{
+				sum[c] += a[i * channels + c] * b[i * channels + c];
+			}
+		}
+	});
+
+	result.assign(channels, 0.0);
+	for (int block = 0; block < blocks; ++block)
+	{
+		for (int c = 0; c < channels; ++c)
+		{
+			result[c] += partial[block * channels + c];
+		}
+	}
+}
+
+double Laplacian::GetExplicitLimit() const
+{
+	// By Gershgorin, the eigenvalues of M^-1 W lie in [-2 max |W_ii| / A_i, 0], and forward Euler is stable below 2 / |lambda|.
+	double limit = std::numeric_limits<double>::max();
+	for (int i = 0; i < GetSize(); ++i)
+	{
+		if (areas[i] <= 0)
+			continue;
+		for (int k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+		{
+			if (columns[k] == i && weights[k] < 0)
+				limit = std::min(limit, areas[i] / -weights[k]);
+		}
+	}
+	return limit;
+}
+
+bool Laplacian::Factor(double dt)
+{
+	// The same matrix MultiplyImplicit() applies.
+	int n = GetSize();
+	std::vector<Eigen::Triplet<double>> triplets;
+	triplets.reserve(columns.size());
+	for (int i = 0; i < n; ++i)
+	{
+		if (areas[i] <= 0)
+		{
+			triplets.push_back(Eigen::Triplet<double>(i, i, 1.0));
+			continue;
+		}
+		for (int k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+		{
+			int j = columns[k];
+			if (j == i)
+				triplets.push_back(Eigen::Triplet<double>(i, i, areas[i] - dt * weights[k]));
+			else if (areas[j] > 0)
+				triplets.push_back(Eigen::Triplet<double>(i, j, -dt * weights[k]));
+		}
+	}
+
+	Eigen::SparseMatrix<double> matrix(n, n);
+	matrix.setFromTriplets(triplets.begin(), triplets.end());
+
+	factorization.reset(new Factorization());
+	factorization->dt = dt;
+	factorization->solver.compute(matrix);
+	if (factorization->solver.info() != Eigen::Success)
+	{
+		factorization.reset();
+		return false;
+	}
+	return true;
+}
+
+void Laplacian::GetRightHandSide(const std::vector<double>& in, std::vector<double>& rhs, int channels, double dt) const
+{
+	// The boundary values are known, so their rows become x_i = f_i, and their columns move to the right-hand side,
+	// which keeps the matrix symmetric.
+	int n = GetSize();
+	rhs.resize(n * channels);
+	const int BLOCK_SIZE = 1024;
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const double* row = &in[i * channels];
+			double* b = &rhs[i * channels];
+			if (areas[i] <= 0)
+			{
+				std::copy(row, row + channels, b);
+				continue;
+			}
+
+			for (int c = 0; c < channels; ++c)
+			{
+				b[c] = areas[i] * row[c];
+			}
+			for (int k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+			{
+				int j = columns[k];
+				if (j == i || areas[j] > 0)
+					continue;
+				for (int c = 0; c < channels; ++c)
+				{
+					b[c] += dt * weights[k] * in[j * channels + c];
+				}
+			}
+		}
+	});
+}
+
+bool Laplacian::ImplicitStep(const std::vector<double>& in, std::vector<double>& out, int channels, double dt,
+	double tolerance, int maxIterations)
+{
+	int n = GetSize();
+	int size = n * channels;
+	const int BLOCK_SIZE = 1024;
+	std::vector<double> rhs;
+	GetRightHandSide(in, rhs, channels, dt);
+
+	if (factorization != NULL && factorization->dt == dt)
+	{
+		iterations = 0;
+		out.resize(size);
+		Parallel::For(channels, [&](int c)
+		{
+			Eigen::VectorXd b(n);
+			for (int i = 0; i < n; ++i)
+			{
+				b[i] = rhs[i * channels + c];
+			}
+			Eigen::VectorXd x = factorization->solver.solve(b);
+			for (int i = 0; i < n; ++i)
+			{
+				out[i * channels + c] = x[i];
+			}
+		});
+		return true;
+	}
+
+	std::vector<double> inverseDiagonal(n, 1.0);
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (areas[i] <= 0)
+				continue;
+			for (int k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+			{
+				if (columns[k] == i)
+					inverseDiagonal[i] = 1.0 / (areas[i] - dt * weights[k]);
+			}
+		}
+	});
+
+	// Conjugate gradients from x = f, one set of scalars per channel.
+	std::vector<double> r(size), z(size), d(size), q(size);
+	out = in;
+	MultiplyImplicit(out, q, channels, dt);
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int k = begin * channels; k < end * channels; ++k)
+		{
+			r[k] = rhs[k] - q[k];
+			z[k] = inverseDiagonal[k / channels] * r[k];
+			d[k] = z[k];
+		}
+	});
+
+	std::vector<double> threshold, rz, dq, rr, alpha(channels), beta(channels);
+	Dot(rhs, rhs, channels, threshold);
+	for (int c = 0; c < channels; ++c)
+	{
+		threshold[c] *= tolerance * tolerance;
+	}
+	Dot(r, z, channels, rz);
+
+	for (iterations = 0; iterations < maxIterations; ++iterations)
+	{
+		Dot(r, r, channels, rr);
+		bool converged = true;
+		for (int c = 0; c < channels; ++c)
+		{
+			converged = converged && rr[c] <= threshold[c];
+		}
+		if (converged)
+			return true;
+
+		MultiplyImplicit(d, q, channels, dt);
+		Dot(d, q, channels, dq);
+		for (int c = 0; c < channels; ++c)
+		{
+			alpha[c] = (dq[c] > 0) ? rz[c] / dq[c] : 0.0;
+		}
+		Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				for (int c = 0; c < channels; ++c)
+				{
+					int k = i * channels + c;
+					out[k] += alpha[c] * d[k];
+					r[k] -= alpha[c] * q[k];
+					z[k] = inverseDiagonal[i] * r[k];
+				}
+			}
+		});
+
+		std::vector<double> previous = rz;
+		Dot(r, z, channels, rz);
+		for (int c = 0; c < channels; ++c)
+		{
+			beta[c] = (previous[c] > 0) ? rz[c] / previous[c] : 0.0;
+		}
+		Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				for (int c = 0; c < channels; ++c)
+				{
+					int k = i * channels + c;
+					d[k] = z[k] + beta[c] * d[k];
+				}
+			}
+		});
+	}
+
+	Dot(r, r, channels, rr);
+	for (int c = 0; c < channels; ++c)
+	{
+		if (rr[c] > threshold[c])
+			return false;
+	}
+	return true;
+}
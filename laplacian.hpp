@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "polyhedron.hpp"
+
+/** The cotangent Laplacian of a polyhedron, assembled once as a sparse matrix and applied to many values per vertex at a time.
+ *
+ * At vertex i, (L f)_i = 1/A_i * sum over the neighbours j of w_ij (f_j - f_i), with w_ij = (cot alpha_ij + cot beta_ij) / 2
+ * and A_i the mixed area. L = M^-1 W, where M is the diagonal of mixed areas and W, which holds the weights,
+ * is symmetric. W is kept in CSR form, with the diagonal -sum_j w_ij in each row.
+ *
+ * The values are a row-major block of n rows, one per vertex, and any number of channels, so one trip over the matrix
+ * smooths all of them. Boundary vertices, where the mixed area is not defined, keep their values.
+ *
+ * A backward Euler step solves (M - dt W) f' = M f, which is symmetric and positive definite, by conjugate gradients
+ * preconditioned with its diagonal. All channels are solved at once, each with its own step sizes, starting from f,
+ * so every iteration is one trip over the matrix for all of them.
+ *
+ * When many steps are taken with the same dt, Factor() computes a sparse Cholesky (LDL^T) factorization of the matrix once,
+ * and the steps after it are two triangular solves per channel instead.
+ */
+class Laplacian
+{
+
+public:
+
+	Laplacian();
+	~Laplacian();
+
+	// Assemble the matrix from the cached cotangents and mixed areas of an initialized polyhedron, in parallel.
+	void Build(Polyhedron* p);
+
+	// Number of vertices.
+	int GetSize() const;
+
+	// out = in + dt L in, for a block of channels values per vertex. The rows are split over the threads.
+	void ExplicitStep(const std::vector<double>& in, std::vector<double>& out, int channels, double dt) const;
+
+	// Largest dt for which ExplicitStep() is stable: the smallest A_i / |W_ii| over the vertices that move.
+	double GetExplicitLimit() const;
+
+	// Factor M - dt W for the ImplicitStep() calls with this dt, until the next Build() or Factor().
+	// Returns false, and leaves the steps to conjugate gradients, if the matrix could not be factored.
+	bool Factor(double dt);
+
+	// Solve (M - dt W) out = M in for a block of channels values per vertex. With the factorization for dt,
+	// the channels are solved directly and split over the threads. Otherwise conjugate gradients solve all of them
+	// to a residual of tolerance times the right-hand side, and it returns false if some channel did not get there in maxIterations.
+	bool ImplicitStep(const std::vector<double>& in, std::vector<double>& out, int channels, double dt,
+		double tolerance = 1e-10, int maxIterations = 1000);
+
+	// CSR form of W: the columns and weights of row i are [rowOffsets[i], rowOffsets[i+1]), in increasing column order.
+	std::vector<int> rowOffsets;
+	std::vector<int> columns;
+	std::vector<double> weights;
+
+	// Mixed area of each vertex, or -1 on a boundary, where the values are held fixed.
+	std::vector<double> areas;
+
+	// Conjugate gradient iterations of the last ImplicitStep().
+	int iterations = 0;
+
+private:
+
+	// The factorization of M - dt W, with the boundary rows and columns replaced by those of the identity.
+	struct Factorization;
+	std::unique_ptr<Factorization> factorization;
+
+	// M f, with the boundary values themselves in their rows and what they contribute to the rows next to them moved over.
+	void GetRightHandSide(const std::vector<double>& in, std::vector<double>& rhs, int channels, double dt) const;
+
+	// y = (M - dt W) x, with the boundary rows and columns replaced by those of the identity.
+	void MultiplyImplicit(const std::vector<double>& x, std::vector<double>& y, int channels, double dt) const;
+
+	// result[c] = sum over the vertices of a[i][c] * b[i][c], added up in the same order on any number of threads.
+	void Dot(const std::vector<double>& a, const std::vector<double>& b, int channels, std::vector<double>& result) const;
+
+};
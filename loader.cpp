@@ -88,6 +88,24 @@ void Loader::UpdateHighlight(uint vbo, uint v0, uint v1, uint v2, glm::vec4 colo
 	glBufferSubData(GL_ARRAY_BUFFER, v2 * vertexSize + bytesToHighlightColor, highlightColorSize, &data[0]);
 }
 
+void Loader::UpdateVertices(MeshComponent& mesh, const std::vector<int>& indices)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.getVBO());
+	std::vector<Vertex>& vertices = mesh.getVertices();
+	uint vertexSize = sizeof(Vertex);
+	int i = 0;
+	while (i < indices.size())
+	{
+		int j = i + 1;
+		while (j < indices.size() && indices[j] == indices[j - 1] + 1)
+		{
+			++j;
+		}
+		glBufferSubData(GL_ARRAY_BUFFER, indices[i] * vertexSize, (j - i) * vertexSize, &vertices[indices[i]]);
+		i = j;
+	}
+}
+
 uint Loader::AttributeList_StoreData(std::vector<LineVertex>& vertices) 
 {
 	uint vboID;
@@ -31,6 +31,10 @@ public:
 	/** Update the highlight color of a single vertex. */
 	static void UpdateHighlight(uint vao, uint v0, glm::vec4 color);
 
+	/** Copy the given vertices of a prepared mesh to its VBO in place, after MeshComponent::UpdateVertices().
+	 * The indices are in increasing order; each run of consecutive vertices is one upload. */
+	static void UpdateVertices(MeshComponent& mesh, const std::vector<int>& indices);
+
 private:
 
 	// pass data to GPU:
@@ -7,6 +7,7 @@
 #include <cmath>
 #include <iostream>
 #include <algorithm>
+#include <filesystem>
 
 #include "glew.h"
 #include <GL/gl.h>
@@ -36,6 +37,12 @@
 #include "toonshader.hpp"
 #include "silhouette.hpp"
 #include "view.hpp"
+#include "benchmark.hpp"
+#include "plyfile.hpp"
+#include "objfile.hpp"
+#include "meshcache.hpp"
+#include "smoothing.hpp"
+#include "streamlines.hpp"
 
 
 
@@ -112,7 +119,9 @@ short ReadShort( FILE * );
 /**********************************************************************************/
 /**********************************************************************************/
 
+Polyhedron* ReadPolyhedron(std::string fileName);
 Polyhedron* SubdivideMesh(Polyhedron* p, int n);
+Polyhedron* LoadPolyhedron(std::string fileName, int subdivisions);
 void LoadMeshFromFile(std::string fileName, int subdivisions);
 void LoadMeshFromFile(std::string fileName, int subdivisions, int meshIndex, Curvature curvature);
 void LoadMeshFromFile(std::string fileName, int subdivisions, std::vector<Curvature> curvature);
@@ -137,8 +146,8 @@ std::vector<MeshComponent> meshes;
 // Curve objects to draw:
 CurveComponent curve;
 CurveComponent dualCurve;
-CurveComponent maxPrincipalDirections;
-CurveComponent minPrincipalDirections;
+CurveComponent linesOfCurvature;
+uint maxLinesOfCurvatureCount = 0;
 uint renderMaxMinPrincipalDirection = 0;
 //CurveComponent silhouette;
 
@@ -225,6 +234,18 @@ bool lockCamera = true;
 // main program:
 int main(int argc, char* argv[])
 {
+	// Headless benchmarks skip the window entirely.
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		return Benchmark::Run(argc, argv);
+	}
+
+	// So does batch smoothing of a mesh file.
+	if (argc > 1 && std::string(argv[1]) == "--smooth")
+	{
+		return Smoothing::Run(argc, argv);
+	}
+
 	// Initialize GLUT:
 	glutInit(&argc, argv);
 	//glutSetKeyRepeat(GLUT_KEY_REPEAT_OFF);
@@ -403,29 +424,75 @@ void SetFloatTBO(std::vector<float>& data)
 	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, curvatureBuffer);
 }
 
+// Read and initialize a mesh file with Polyhedron::Read().
+// A file that cannot be loaded is reported and NULL is returned, rather than exiting.
+Polyhedron* ReadPolyhedron(std::string fileName)
+{
+	Polyhedron* p = new Polyhedron(0, 0, 0);
+	IOResult result = Polyhedron::Read(fileName, *p);
+	if (!result.success)
+	{
+		std::cout << result.message << std::endl;
+		delete(p);
+		return NULL;
+	}
+	p->Initialize();
+
+	// One line for the mesh and one per stage of Initialize().
+	std::cout << fileName << ": " << p->vlist.size() << " vertices, " << p->elist.size() << " edges, " << p->tlist.size() << " triangles." << std::endl;
+	p->initializeTimes.Print(std::cout);
+	return p;
+}
+
+// Subdivide a mesh n times in place. Each level comes out initialized and is moved into p, which releases the level before it.
 Polyhedron* SubdivideMesh(Polyhedron* p, int n)
 {
-	std::vector<Polyhedron*> loops;
-	Polyhedron* lp;
-	lp = p;
-	loops.push_back(lp);
 	for (int i = 0; i < n; ++i)
 	{
-		Polyhedron* q;
-		q = Subdivision::LoopSubdivisionHeap(loops[i]);
-		q->Initialize();
-		loops.push_back(q);
-		delete(loops[i]);
+		*p = Subdivision::LoopSubdivision(p);
 	}
-	return loops.back();
+	return p;
 }
 
-void LoadMeshFromFile(std::string fileName, int subdivisions, int meshIndex, glm::vec3 color)
+// Read a mesh file and subdivide it, going through the mesh cache kept next to the file.
+// A cache that is missing or out of date is rebuilt from the source file.
+Polyhedron* LoadPolyhedron(std::string fileName, int subdivisions)
 {
-	Polyhedron* p = new Polyhedron(fileName);
-	p->Initialize();
+	uint64_t hash;
+	IOResult result = MeshCache::HashFile(fileName, hash);
+	if (!result.success)
+	{
+		std::cout << result.message << std::endl;
+		return NULL;
+	}
+
+	std::string cacheName = MeshCache::GetCachePath(fileName, subdivisions);
+	if (std::filesystem::exists(cacheName))
+	{
+		Polyhedron* p = new Polyhedron(0, 0, 0);
+		result = MeshCache::Load(cacheName, *p, hash, subdivisions);
+		if (result.success)
+			return p;
+		std::cout << result.message << " REBUILDING." << std::endl;
+		delete(p);
+	}
+
+	Polyhedron* p = ReadPolyhedron(fileName);
+	if (p == NULL)
+		return NULL;
 
 	Polyhedron* lp = SubdivideMesh(p, subdivisions);
+	result = MeshCache::Save(cacheName, *lp, hash, subdivisions);
+	if (!result.success)
+		std::cout << result.message << std::endl;
+	return lp;
+}
+
+void LoadMeshFromFile(std::string fileName, int subdivisions, int meshIndex, glm::vec3 color)
+{
+	Polyhedron* lp = LoadPolyhedron(fileName, subdivisions);
+	if (lp == NULL)
+		return;
 
 	mesh = MeshComponent(lp, color);
 
@@ -437,18 +504,21 @@ void LoadMeshFromFile(std::string fileName, int subdivisions, int meshIndex, glm
 }
 void LoadMeshFromFile(std::string fileName, int subdivisions, std::vector<Curvature> curvatures)
 {
-	Polyhedron* p = new Polyhedron(fileName);
-	p->Initialize();
-
-	Polyhedron* lp = SubdivideMesh(p, subdivisions);
+	Polyhedron* lp = LoadPolyhedron(fileName, subdivisions);
+	if (lp == NULL)
+		return;
 
 	// Currently hard-coded as up to four curvatures that can be displayed.
+	// They are computed together, in one pass over the vertices.
+	if (curvatures.size() > 4)
+		curvatures.resize(4);
+	std::vector<std::vector<double>> allCurvatureData = MeshAnalysis::GetVertexCurvatures(lp, curvatures);
 	for (int i = 0; i < 4; ++i)
 	{
 		double total = 0.0;
 		if (i < curvatures.size())
 		{
-			std::vector<double> curvatureData = MeshAnalysis::GetVertexCurvatures(lp, curvatures[i]);
+			std::vector<double>& curvatureData = allCurvatureData[i];
 			meshList[i].push_back(MeshComponent(lp, curvatureData, curvatures[i]));
 			Loader::PrepareMesh(meshList[i][0]);
 
@@ -469,48 +539,30 @@ void LoadMeshFromFile(std::string fileName, int subdivisions, std::vector<Curvat
 }
 void LoadMeshFromFile(std::string fileName, int subdivisions)
 {
-	Polyhedron* p = new Polyhedron(fileName);
-	p->Initialize();
-
-	Polyhedron* lp = SubdivideMesh(p, subdivisions);
+	Polyhedron* lp = LoadPolyhedron(fileName, subdivisions);
+	if (lp == NULL)
+		return;
 
 	std::cout << "**** Computing curvatures. ****" << std::endl;
 
-	std::vector<double> gaussianCurvatures  = MeshAnalysis::GetVertexCurvatures(lp, Curvature::GAUSSIAN);
-	std::cout << "Gaussian curvature. " << std::endl;
-
-	std::vector<double> meanCurvatures	    = MeshAnalysis::GetVertexCurvatures(lp, Curvature::MEAN);
-	std::cout << "Mean curvature. " << std::endl;
-
-	std::vector<double> horizonMeasures     = MeshAnalysis::GetVertexCurvatures(lp, Curvature::HORIZON);
-	std::cout << "Horizon measure. " << std::endl;
-
-	std::vector<double> horizonMeasuresTest = MeshAnalysis::GetVertexCurvatures(lp, Curvature::ORIGINAL);
-	std::cout << "Original horizon measure. " << std::endl;
-
-	std::vector<double> distortion          = MeshAnalysis::GetVertexCurvatures(lp, Curvature::DISTORTION);
-	std::cout << "Distortion. " << std::endl;
-
-	std::vector<double> distortionSigned    = MeshAnalysis::GetVertexCurvatures(lp, Curvature::DISTORTION_SIGNED);
-	std::cout << "Signed distortion. " << std::endl;
-
-	std::vector<double> gaussianCone        = MeshAnalysis::GetVertexCurvatures(lp, Curvature::CONE);
-	std::cout << "Gaussian cone. " << std::endl;
-	
-	std::vector<double> meanSigned			= MeshAnalysis::GetVertexCurvatures(lp, Curvature::MEAN_SIGNED);
-	std::cout << "Signed mean curvature. " << std::endl;
-
-	std::vector<double> minPrincipal		= MeshAnalysis::GetVertexCurvatures(lp, Curvature::MIN_PRINCIPAL_DISTORTION);
-	std::cout << "Min principal curvature from distortion. " << std::endl;
-
-	std::vector<double> maxPrincipal		= MeshAnalysis::GetVertexCurvatures(lp, Curvature::MAX_PRINCIPAL_DISTORTION);
-	std::cout << "Max principal curvature from distortion. " << std::endl;
-
-	std::vector<double> falseGaussian		= MeshAnalysis::GetVertexCurvatures(lp, Curvature::FALSE_GAUSSIAN);
-	std::cout << "Gaussian curvature from distortion. " << std::endl;
-
-	std::vector<double> falseMean			= MeshAnalysis::GetVertexCurvatures(lp, Curvature::FALSE_MEAN);
-	std::cout << "Mean curvature from distortion. " << std::endl;
+	// All of them in one pass over the vertices, with the kernels fixed at compile time.
+	std::vector<std::vector<double>> curvatureData = MeshAnalysis::GetVertexCurvatures<
+		Curvature::GAUSSIAN, Curvature::MEAN, Curvature::HORIZON, Curvature::ORIGINAL,
+		Curvature::DISTORTION, Curvature::DISTORTION_SIGNED, Curvature::CONE, Curvature::MEAN_SIGNED,
+		Curvature::MIN_PRINCIPAL_DISTORTION, Curvature::MAX_PRINCIPAL_DISTORTION, Curvature::FALSE_GAUSSIAN, Curvature::FALSE_MEAN>(lp);
+
+	std::vector<double>& gaussianCurvatures  = curvatureData[0];
+	std::vector<double>& meanCurvatures      = curvatureData[1];
+	std::vector<double>& horizonMeasures     = curvatureData[2];
+	std::vector<double>& horizonMeasuresTest = curvatureData[3];
+	std::vector<double>& distortion          = curvatureData[4];
+	std::vector<double>& distortionSigned    = curvatureData[5];
+	std::vector<double>& gaussianCone        = curvatureData[6];
+	std::vector<double>& meanSigned          = curvatureData[7];
+	std::vector<double>& minPrincipal        = curvatureData[8];
+	std::vector<double>& maxPrincipal        = curvatureData[9];
+	std::vector<double>& falseGaussian       = curvatureData[10];
+	std::vector<double>& falseMean           = curvatureData[11];
 
 
 	meshList[0].push_back(MeshComponent(lp, meanSigned, Curvature::MEAN_SIGNED));
@@ -529,10 +581,9 @@ void LoadMeshFromFile(std::string fileName, int subdivisions)
 }
 void LoadMeshFromFile(std::string fileName, int subdivisions, int meshIndex, Curvature curvature)
 {
-	Polyhedron* p = new Polyhedron(fileName);
-	p->Initialize();
-
-	Polyhedron* lp = SubdivideMesh(p, subdivisions);
+	Polyhedron* lp = LoadPolyhedron(fileName, subdivisions);
+	if (lp == NULL)
+		return;
 
 	std::vector<double> triangleCurvatureData = MeshAnalysis::GetVertexCurvatures(lp, curvature);
 	mesh = MeshComponent(lp, triangleCurvatureData, curvature);
@@ -586,37 +637,27 @@ void InitLists()
 	curvatures.push_back(Curvature::DIFFERENCE);
 	LoadMeshFromFile("./tempmodels/bunny.ply", 0, curvatures);
 	curvatureList = curvatures;
+	if (poly == NULL)
+	{
+		std::cout << "NO MESH LOADED." << std::endl;
+		exit(-1);
+	}
 
 	//LoadMeshFromFile("./tempmodels/dragon.ply", 1, 0, glm::vec3(0.0f, 1.0f, 1.0f));
 
 
 	std::cout << "Computed curvatures. " << std::endl;
 
-	// Lines of curvature.
-	std::vector<Edge*> principals = MeshAnalysis::GetPrincipalDirections(poly);
-	std::vector<LineVertex> maxPrincipals;
-	std::vector<LineVertex> minPrincipals;
-	maxPrincipals.reserve(poly->vlist.size() * 2);
-	minPrincipals.reserve(poly->vlist.size() * 2);
-	for (int i = 0; i < principals.size(); i += 2)
-	{
-		// [i] is the max principal direction, [i+1] is the min principal direction.
-		Edge* max = principals[i];
-		Edge* min = principals[i + 1];
-
-		glm::vec3 max0 = (glm::vec3)(max->vertices[0]->GetPosition());
-		glm::vec3 max1 = (glm::vec3)(max->vertices[1]->GetPosition());
-		glm::vec3 min0 = (glm::vec3)(min->vertices[0]->GetPosition());
-		glm::vec3 min1 = (glm::vec3)(min->vertices[1]->GetPosition());
-		maxPrincipals.push_back(LineVertex(max0, glm::vec3(1.0f, 0.6f, 0.0f)));
-		maxPrincipals.push_back(LineVertex(max1, glm::vec3(1.0f, 0.6f, 0.0f)));
-		minPrincipals.push_back(LineVertex(min0, glm::vec3(0.0f, 1.0f, 1.0f)));
-		minPrincipals.push_back(LineVertex(min1, glm::vec3(0.0f, 1.0f, 1.0f)));
-	}
-	maxPrincipalDirections = CurveComponent(maxPrincipals);
-	minPrincipalDirections = CurveComponent(minPrincipals);
-	Loader::PrepareCurve(maxPrincipalDirections);
-	Loader::PrepareCurve(minPrincipalDirections);
+	// Lines of curvature, traced across the triangles into one buffer: the max lines first, then the min lines.
+	// About one line per 4 x 4 edges, each running up to 40 edges from its seed both ways.
+	double meanEdgeLength = 0.0;
+	for (Edge& e : poly->elist)
+		meanEdgeLength += e.length;
+	meanEdgeLength /= poly->elist.size();
+	std::vector<LineVertex> lines;
+	maxLinesOfCurvatureCount = Streamlines::TraceLinesOfCurvature(poly, 4.0 * meanEdgeLength, 40.0 * meanEdgeLength, lines);
+	linesOfCurvature = CurveComponent(std::move(lines));
+	Loader::PrepareCurve(linesOfCurvature);
 
 	// Silhouette.
 	/*
@@ -837,48 +878,23 @@ void Display()
 	{
 		glLineWidth((GLfloat)2.0);
 
-		// If value is 1, then render just max.
 		lineShader.Start();
+		glBindVertexArray(linesOfCurvature.getVAO());
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		lineShader.LoadProjectionMatrix(perspectiveMatrix);
+		lineShader.LoadViewMatrix(viewMatrix);
+		lineShader.LoadTransformMatrix(linesOfCurvature.transform);
+
+		// If value is 1, then render just max.
 		if (renderMaxMinPrincipalDirection == 1)
-		{
-			glBindVertexArray(maxPrincipalDirections.getVAO());
-			glEnableVertexAttribArray(0);
-			glEnableVertexAttribArray(1);
-			lineShader.LoadProjectionMatrix(perspectiveMatrix);
-			lineShader.LoadViewMatrix(viewMatrix);
-			lineShader.LoadTransformMatrix(maxPrincipalDirections.transform);
-			glDrawArrays(GL_LINES, 0, maxPrincipalDirections.getCount());
-		}
+			glDrawArrays(GL_LINES, 0, maxLinesOfCurvatureCount);
 		// If value is 2, then render just min.
 		else if (renderMaxMinPrincipalDirection == 2)
-		{
-			glBindVertexArray(minPrincipalDirections.getVAO());
-			glEnableVertexAttribArray(0);
-			glEnableVertexAttribArray(1);
-			lineShader.LoadProjectionMatrix(perspectiveMatrix);
-			lineShader.LoadViewMatrix(viewMatrix);
-			lineShader.LoadTransformMatrix(minPrincipalDirections.transform);
-			glDrawArrays(GL_LINES, 0, minPrincipalDirections.getCount());
-		}
+			glDrawArrays(GL_LINES, maxLinesOfCurvatureCount, linesOfCurvature.getCount() - maxLinesOfCurvatureCount);
 		// Render both.
 		else
-		{
-			glBindVertexArray(maxPrincipalDirections.getVAO());
-			glEnableVertexAttribArray(0);
-			glEnableVertexAttribArray(1);
-			lineShader.LoadProjectionMatrix(perspectiveMatrix);
-			lineShader.LoadViewMatrix(viewMatrix);
-			lineShader.LoadTransformMatrix(maxPrincipalDirections.transform);
-			glDrawArrays(GL_LINES, 0, maxPrincipalDirections.getCount());
-
-			glBindVertexArray(minPrincipalDirections.getVAO());
-			glEnableVertexAttribArray(0);
-			glEnableVertexAttribArray(1);
-			lineShader.LoadProjectionMatrix(perspectiveMatrix);
-			lineShader.LoadViewMatrix(viewMatrix);
-			lineShader.LoadTransformMatrix(minPrincipalDirections.transform);
-			glDrawArrays(GL_LINES, 0, minPrincipalDirections.getCount());
-		}
+			glDrawArrays(GL_LINES, 0, linesOfCurvature.getCount());
 		lineShader.Stop();
 	}
 
@@ -0,0 +1,76 @@
+#include "mappedfile.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile() {}
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& file)
+{
+	Close();
+
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		error = "FILE COULD NOT BE OPENED: " + file + " (" + strerror(errno) + ")";
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0)
+	{
+		error = "FILE COULD NOT BE READ: " + file + " (" + strerror(errno) + ")";
+		close(fd);
+		return false;
+	}
+
+	// An empty file is valid to open, but mmap() refuses zero-length mappings.
+	size = status.st_size;
+	if (size == 0)
+	{
+		close(fd);
+		return true;
+	}
+
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		error = "FILE COULD NOT BE MAPPED: " + file + " (" + strerror(errno) + ")";
+		size = 0;
+		return false;
+	}
+
+	// The loaders read front to back.
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	data = (const char*)mapping;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != NULL)
+	{
+		munmap((void*)data, size);
+	}
+	data = NULL;
+	size = 0;
+}
+
+const char* MappedFile::Data() const
+{
+	return data;
+}
+
+size_t MappedFile::Size() const
+{
+	return size;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/** Read-only memory map of a whole file.
+ * The loaders parse straight out of the mapping, so no part of the file is copied into an intermediate buffer.
+ * The mapping is released when the object is closed or destroyed; it cannot be copied.
+ */
+class MappedFile
+{
+
+public:
+
+	MappedFile();
+	~MappedFile();
+
+	// Map the file. Returns false (and sets the error message) if the file cannot be opened or mapped.
+	bool Open(const std::string& file);
+	void Close();
+
+	const char* Data() const;
+	size_t Size() const;
+
+	// Why the last Open() failed.
+	std::string error;
+
+private:
+
+	MappedFile(const MappedFile& m) = delete;
+	MappedFile& operator=(const MappedFile& m) = delete;
+
+	const char* data = NULL;
+	size_t size = 0;
+
+};
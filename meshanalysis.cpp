@@ -1,467 +1,88 @@
 #include "meshanalysis.hpp"
+#include "compactmesh.hpp"
+#include "parallel.hpp"
+#include "dihedral.hpp"
 #include <limits>
 
 
 MeshAnalysis::MeshAnalysis() {}
 MeshAnalysis::~MeshAnalysis() {}
 
-std::vector<Edge*> MeshAnalysis::GetPrincipalDirections(Polyhedron* p)
+bool MeshAnalysis::ComputeStarDistortion(Corner& c, StarDistortion& distortion)
 {
-	// Two directions for each vertex.
-	std::vector<Edge*> principals;
-	principals.reserve(p->vlist.size() * 2);
-
-	Edge* maxDirection;
-	Edge* minDirection;
+	// Walk the star of the vertex from Swing(v->c), the same order as GetVertexStar(Vert*).
+	// Triangles i and i+1 of the star share the edge opposite the previous corner of corner i,
+	// and the signed angle between their normals is cached on that edge.
+	Vert* v = c.v;
+	CornerFan fan(*v);
+	if (v->c == NULL || !fan.IsClosed())
+		return false;
 
-	// Go through the corner list and compute the principal directions of the corresponding vertex.
-	// Skip vertices we have already seen.
-	for (Vert& v : p->vlist)
+	glm::dvec3 vPosition = v->GetPosition();
+	for (Corner* current : fan)
 	{
-		// Min/max principal curvatures using the distortion.
-		double max = -1.0 * std::numeric_limits<double>::max();
-		double min = std::numeric_limits<double>::max();
+		Edge* e = current->p->e;
+		double angle = e->dihedral;
 
-		int index = v.index;
+		// Unsigned distortion, written as the supplement of the dihedral angle.
+		double dihedral = M_PI - std::abs(angle);
+		distortion.unsignedSum += M_PI - dihedral;
 
-		glm::dvec3 vPosition = v.GetPosition();
-		std::vector<Triangle*> star = GetVertexStar(&v);
-		star.push_back(star[0]);
-
-		// Remember: star[size - 1] = star[0].
-		for (int i = 0; i < star.size() - 1; ++i)
+		// The edge direction is the tangent vector t_e that gave the angle its sign.
+		glm::dvec3 te = current->n->v->GetPosition() - vPosition;
+		distortion.signedSum += angle;
+		if (angle > distortion.max)
 		{
-			// Normals:
-			glm::dvec3 current = star[i]->normal;
-			glm::dvec3 next = star[i+1]->normal;
-
-			// Angle between normals:
-			double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-			double angle = acos(dot);
-
-			// Figure out if the angle should be signed:
-			// \ip{N_i \times N_{i+1} , t_e} > 0 => negative, where t_e is the tangent vector along the edge.
-
-			// Get the tangent vector to the edge.
-			Edge* e = MeshAnalysis::GetEdge(star[i], star[i+1]);
-			if (e == NULL)
-				std::cout << "OOPS" << std::endl;
-			Vert* q = e->GetOtherVertex(&v);
-			glm::dvec3 te = q->GetPosition() - vPosition;
-			if (q->index == v.index)
-				std::cout << "OOPS" << std::endl;
-
-			// DEBUG: check that the edge is correct.
-			Triangle* t1 = e->GetOtherTriangle(star[i]);
-			Triangle* t0 = e->GetOtherTriangle(star[i+1]);
-			if (t1->index != star[i+1]->index || t0->index != star[i]->index)
-				std::cout << "EDGE BROKE" << std::endl;
-
-			// Check the inner product.
-			double ip = glm::dot(glm::cross(current, next), te);
-			if (ip > 0)
-				angle *= -1.0;
-
-			// Check for min or max.
-			if (angle > max)
-			{
-				max = angle;
-				maxDirection = e;
-			}
-			if (angle < min)
-			{
-				min = angle;
-				minDirection = e;
-			}
+			distortion.max = angle;
+			distortion.maxDirection = te / e->length;
+		}
+		if (angle < distortion.min)
+		{
+			distortion.min = angle;
+			distortion.minDirection = te / e->length;
 		}
-		principals.push_back(maxDirection);
-		principals.push_back(minDirection);
 	}
-	return principals;
+	return true;
 }
 
 double MeshAnalysis::ComputePrincipalDeviation(Corner& c)
 {
-	// Get the vertex and its star.
-	// Set the last element to be equal to the first so all the calculations can be done in a single for-loop.
-	Vert* v = c.v;
-	glm::dvec3 vPosition = v->GetPosition();
-	std::vector<Triangle*> star = GetVertexStar(v);
-	star.push_back(star[0]);
-
-	//std::cout << "Current vertex is " << v->index << std::endl;
-	if (c.o == NULL)
-		std::cout << "BOUNDARY" << std::endl;
-
-	// Min/max principal curvatures using the distortion.
-	double min = std::numeric_limits<double>::max();
-	double max = -1.0 * std::numeric_limits<double>::max();
-	glm::dvec3 minDirection;
-	glm::dvec3 maxDirection;
-
-	// Remember: star[size - 1] = star[0].
-	for (int i = 0; i < star.size() - 1; ++i)
-	{
-		// Normals:
-		glm::dvec3 current = star[i]->normal;
-		glm::dvec3 next = star[i+1]->normal;
-
-		// Angle between normals:
-		double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-		double angle = acos(dot);
-
-		// Figure out if the angle should be signed:
-		// \ip{N_i \times N_{i+1} , t_e} > 0 => negative, where t_e is the tangent vector along the edge.
-
-		// Get the tangent vector to the edge.
-		Edge* e = MeshAnalysis::GetEdge(star[i], star[i+1]);
-		if (e == NULL)
-			std::cout << "OOPS" << std::endl;
-		Vert* q = e->GetOtherVertex(v);
-		glm::dvec3 te = q->GetPosition() - vPosition;
-		if (q->index == v->index)
-			std::cout << "OOPS" << std::endl;
-
-		// DEBUG: check that the edge is correct.
-		Triangle* t1 = e->GetOtherTriangle(star[i]);
-		Triangle* t0 = e->GetOtherTriangle(star[i+1]);
-		if (t1->index != star[i+1]->index || t0->index != star[i]->index)
-			std::cout << "EDGE BROKE" << std::endl;
-
-		// Check the inner product.
-		double ip = glm::dot(glm::cross(current, next), te);
-		if (ip > 0)
-			angle *= -1.0;
-
-		// Check for min or max.
-		if (angle > max)
-		{
-			max = angle;
-			maxDirection = te / glm::length(te);
-		}
-		if (angle < min)
-		{
-			min = angle;
-			minDirection = te / glm::length(te);
-		}
-	}
-	
-	double principalAngle = glm::acos(glm::clamp(glm::dot(maxDirection, minDirection), -1.0, 1.0));
-	return 0.5 * M_PI - principalAngle;
+	return ComputeCurvature<Curvature::PRINCIPAL_DEVIATION>(c);
 }
 
 double MeshAnalysis::ComputeMeanFromDistortion(Corner& c)
 {
-	// Get the vertex and its star.
-	// Set the last element to be equal to the first so all the calculations can be done in a single for-loop.
-	Vert* v = c.v;
-	glm::dvec3 vPosition = v->GetPosition();
-	std::vector<Triangle*> star = GetVertexStar(v);
-	star.push_back(star[0]);
-
-	//std::cout << "Current vertex is " << v->index << std::endl;
-	if (c.o == NULL)
-		std::cout << "BOUNDARY" << std::endl;
-
-	// Min/max principal curvatures using the distortion.
-	double min = std::numeric_limits<double>::max();
-	double max = -1.0 * std::numeric_limits<double>::max();
-
-	// Remember: star[size - 1] = star[0].
-	for (int i = 0; i < star.size() - 1; ++i)
-	{
-		// Normals:
-		glm::dvec3 current = star[i]->normal;
-		glm::dvec3 next = star[i+1]->normal;
-
-		// Angle between normals:
-		double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-		double angle = acos(dot);
-
-		// Figure out if the angle should be signed:
-		// \ip{N_i \times N_{i+1} , t_e} > 0 => negative, where t_e is the tangent vector along the edge.
-
-		// Get the tangent vector to the edge.
-		Edge* e = MeshAnalysis::GetEdge(star[i], star[i+1]);
-		if (e == NULL)
-			std::cout << "OOPS" << std::endl;
-		Vert* q = e->GetOtherVertex(v);
-		glm::dvec3 te = q->GetPosition() - vPosition;
-		if (q->index == v->index)
-			std::cout << "OOPS" << std::endl;
-
-		// DEBUG: check that the edge is correct.
-		Triangle* t1 = e->GetOtherTriangle(star[i]);
-		Triangle* t0 = e->GetOtherTriangle(star[i+1]);
-		if (t1->index != star[i+1]->index || t0->index != star[i]->index)
-			std::cout << "EDGE BROKE" << std::endl;
-
-		// Check the inner product.
-		double ip = glm::dot(glm::cross(current, next), te);
-		if (ip > 0)
-			angle *= -1.0;
-
-		// Check for min or max.
-		if (angle > max)
-			max = angle;
-		if (angle < min)
-			min = angle;
-	}
-	return 0.5 * (min + max);
+	return ComputeCurvature<Curvature::FALSE_MEAN>(c);
 }
 
 double MeshAnalysis::ComputeGaussianFromDistortion(Corner& c)
 {
-	// Get the vertex and its star.
-	// Set the last element to be equal to the first so all the calculations can be done in a single for-loop.
-	Vert* v = c.v;
-	glm::dvec3 vPosition = v->GetPosition();
-	std::vector<Triangle*> star = GetVertexStar(v);
-	star.push_back(star[0]);
-
-	//std::cout << "Current vertex is " << v->index << std::endl;
-	if (c.o == NULL)
-		std::cout << "BOUNDARY" << std::endl;
-
-	// Min/max principal curvatures using the distortion.
-	double min = std::numeric_limits<double>::max();
-	double max = -1.0 * std::numeric_limits<double>::max();
-
-	// Remember: star[size - 1] = star[0].
-	for (int i = 0; i < star.size() - 1; ++i)
-	{
-		// Normals:
-		glm::dvec3 current = star[i]->normal;
-		glm::dvec3 next = star[i+1]->normal;
-
-		// Angle between normals:
-		double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-		double angle = acos(dot);
-
-		// Figure out if the angle should be signed:
-		// \ip{N_i \times N_{i+1} , t_e} > 0 => negative, where t_e is the tangent vector along the edge.
-
-		// Get the tangent vector to the edge.
-		Edge* e = MeshAnalysis::GetEdge(star[i], star[i+1]);
-		if (e == NULL)
-			std::cout << "OOPS" << std::endl;
-		Vert* q = e->GetOtherVertex(v);
-		glm::dvec3 te = q->GetPosition() - vPosition;
-		if (q->index == v->index)
-			std::cout << "OOPS" << std::endl;
-
-		// DEBUG: check that the edge is correct.
-		Triangle* t1 = e->GetOtherTriangle(star[i]);
-		Triangle* t0 = e->GetOtherTriangle(star[i+1]);
-		if (t1->index != star[i+1]->index || t0->index != star[i]->index)
-			std::cout << "EDGE BROKE" << std::endl;
-
-		// Check the inner product.
-		double ip = glm::dot(glm::cross(current, next), te);
-		if (ip > 0)
-			angle *= -1.0;
-
-		// Check for min or max.
-		if (angle > max)
-			max = angle;
-		if (angle < min)
-			min = angle;
-	}
-	return min * max;
+	return ComputeCurvature<Curvature::FALSE_GAUSSIAN>(c);
 }
+
 double MeshAnalysis::ComputeMinPrincipalDistortion(Corner& c)
 {
-	// Get the vertex and its star.
-	// Set the last element to be equal to the first so all the calculations can be done in a single for-loop.
-	Vert* v = c.v;
-	glm::dvec3 vPosition = v->GetPosition();
-	std::vector<Triangle*> star = GetVertexStar(v);
-	star.push_back(star[0]);
-
-	//std::cout << "Current vertex is " << v->index << std::endl;
-	if (c.o == NULL)
-		std::cout << "BOUNDARY" << std::endl;
-
-	// Min/max principal curvatures using the distortion.
-	double min = std::numeric_limits<double>::max();
-
-	// Remember: star[size - 1] = star[0].
-	for (int i = 0; i < star.size() - 1; ++i)
-	{
-		// Normals:
-		glm::dvec3 current = star[i]->normal;
-		glm::dvec3 next = star[i+1]->normal;
-
-		// Angle between normals:
-		double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-		double angle = acos(dot);
-
-		// Figure out if the angle should be signed:
-		// \ip{N_i \times N_{i+1} , t_e} > 0 => negative, where t_e is the tangent vector along the edge.
-
-		// Get the tangent vector to the edge.
-		Edge* e = MeshAnalysis::GetEdge(star[i], star[i+1]);
-		if (e == NULL)
-			std::cout << "OOPS" << std::endl;
-		Vert* q = e->GetOtherVertex(v);
-		glm::dvec3 te = q->GetPosition() - vPosition;
-		if (q->index == v->index)
-			std::cout << "OOPS" << std::endl;
-
-		// DEBUG: check that the edge is correct.
-		Triangle* t1 = e->GetOtherTriangle(star[i]);
-		Triangle* t0 = e->GetOtherTriangle(star[i+1]);
-		if (t1->index != star[i+1]->index || t0->index != star[i]->index)
-			std::cout << "EDGE BROKE" << std::endl;
-
-		// Check the inner product.
-		double ip = glm::dot(glm::cross(current, next), te);
-		if (ip > 0)
-			angle *= -1.0;
-
-		// Check for min or max.
-		//if (angle > max)
-		//	max = angle;
-		if (angle < min)
-			min = angle;
-	}
-	return min;
+	return ComputeCurvature<Curvature::MIN_PRINCIPAL_DISTORTION>(c);
 }
 
 double MeshAnalysis::ComputeMaxPrincipalDistortion(Corner& c)
 {
-	// Get the vertex and its star.
-	// Set the last element to be equal to the first so all the calculations can be done in a single for-loop.
-	Vert* v = c.v;
-	glm::dvec3 vPosition = v->GetPosition();
-	std::vector<Triangle*> star = GetVertexStar(v);
-	star.push_back(star[0]);
-
-	//std::cout << "Current vertex is " << v->index << std::endl;
-	if (c.o == NULL)
-		std::cout << "BOUNDARY" << std::endl;
-
-	// Min/max principal curvatures using the distortion.
-	//double min = std::numeric_limits<double>::max();
-	double max = -1.0 * std::numeric_limits<double>::max();
-
-	// Remember: star[size - 1] = star[0].
-	for (int i = 0; i < star.size() - 1; ++i)
-	{
-		// Normals:
-		glm::dvec3 current = star[i]->normal;
-		glm::dvec3 next = star[i+1]->normal;
-
-		// Angle between normals:
-		double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-		double angle = acos(dot);
-
-		// Figure out if the angle should be signed:
-		// \ip{N_i \times N_{i+1} , t_e} > 0 => negative, where t_e is the tangent vector along the edge.
-
-		// Get the tangent vector to the edge.
-		Edge* e = MeshAnalysis::GetEdge(star[i], star[i+1]);
-		if (e == NULL)
-			std::cout << "OOPS" << std::endl;
-		Vert* q = e->GetOtherVertex(v);
-		glm::dvec3 te = q->GetPosition() - vPosition;
-		if (q->index == v->index)
-			std::cout << "OOPS" << std::endl;
-
-		// DEBUG: check that the edge is correct.
-		Triangle* t1 = e->GetOtherTriangle(star[i]);
-		Triangle* t0 = e->GetOtherTriangle(star[i+1]);
-		if (t1->index != star[i+1]->index || t0->index != star[i]->index)
-			std::cout << "EDGE BROKE" << std::endl;
-
-		// Check the inner product.
-		double ip = glm::dot(glm::cross(current, next), te);
-		if (ip > 0)
-			angle *= -1.0;
-
-		// Check for min or max.
-		if (angle > max)
-			max = angle;
-		//if (angle < min)
-		//	min = angle;
-	}
-	return max;
+	return ComputeCurvature<Curvature::MAX_PRINCIPAL_DISTORTION>(c);
 }
 
+// Distortion is the signed perimeter of the Gauss map.
 double MeshAnalysis::ComputeSignedDistortion(Corner& c)
 {
-	// Get the vertex and its star.
-	// Set the last element to be equal to the first so all the calculations can be done in a single for-loop.
-	Vert* v = c.v;
-	glm::dvec3 vPosition = v->GetPosition();
-	std::vector<Triangle*> star = GetVertexStar(v);
-	star.push_back(star[0]);
-
-	//std::cout << "Current vertex is " << v->index << std::endl;
-	if (c.o == NULL)
-		std::cout << "BOUNDARY" << std::endl;
-
-	/*
-	for (Triangle* t : star)
-		t->Print();
-
-	std::cout << std::endl;
-	*/
-
-	// Distortion is the signed perimeter of the Gauss map.
-	double distortion = 0;
-
-	// Remember: star[size - 1] = star[0].
-	for (int i = 0; i < star.size() - 1; ++i)
-	{
-		// Normals:
-		glm::dvec3 current = star[i]->normal;
-		glm::dvec3 next = star[i+1]->normal;
-
-		// Angle between normals:
-		double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-		double angle = acos(dot);
-
-		// Figure out if the angle should be signed:
-		// \ip{N_i \times N_{i+1} , t_e} > 0 => negative, where t_e is the tangent vector along the edge.
-
-		// Get the tangent vector to the edge.
-		Edge* e = MeshAnalysis::GetEdge(star[i], star[i+1]);
-		if (e == NULL)
-			std::cout << "OOPS" << std::endl;
-		Vert* q = e->GetOtherVertex(v);
-		glm::dvec3 te = q->GetPosition() - vPosition;
-		if (q->index == v->index)
-			std::cout << "OOPS" << std::endl;
-
-		// DEBUG: check that the edge is correct.
-		Triangle* t1 = e->GetOtherTriangle(star[i]);
-		Triangle* t0 = e->GetOtherTriangle(star[i+1]);
-		if (t1->index != star[i+1]->index || t0->index != star[i]->index)
-			std::cout << "EDGE BROKE" << std::endl;
-
-		// Check the inner product.
-		double ip = glm::dot(glm::cross(current, next), te);
-		if (ip > 0)
-			angle *= -1.0;
-
-
-		// Distortion.
-		distortion += angle;
-	}
-
-	return distortion;
+	return ComputeCurvature<Curvature::DISTORTION_SIGNED>(c);
 }
 // Return the edge attached to both triangles.
 Edge* MeshAnalysis::GetEdge(Triangle* t0, Triangle* t1)
 {
 	//t0->Print();
 	//t1->Print();
-	std::vector<Edge*> edges0 = t0->edges;
-	std::vector<Edge*> edges1 = t1->edges;
-	for (Edge* e0 : edges0)
+	for (Edge* e0 : t0->edges)
 	{
-		for (Edge* e1 : edges1)
+		for (Edge* e1 : t1->edges)
 		{
 			//std::cout << e0->index << " " << e1->index << std::endl;
 			if (e0->index == e1->index)
@@ -471,16 +92,12 @@ Edge* MeshAnalysis::GetEdge(Triangle* t0, Triangle* t1)
 			}
 		}
 	}
-	std::cout << "FAILURE" << std::endl;
 	return NULL;
 }
 
 double MeshAnalysis::ComputeGaussianCone(Corner& c)
 {
-	double mean = ComputeSignedMeanCurvature(c);
-	double distortion = ComputeSignedDistortion(c);
-
-	return abs(abs(mean) - abs(distortion));
+	return ComputeCurvature<Curvature::CONE>(c);
 }
 
 /*
@@ -525,67 +142,19 @@ double MeshAnalysis::ComputeGaussianCone(Corner& c)
 }
 */
 
+// Sum of the unsigned angles between consecutive normals of the star: the perimeter of the Gauss map.
 double MeshAnalysis::ComputeDistortion(Corner& c)
 {
-	// Get the vertex and its star.
-	Vert* v = c.v;
-	std::vector<Triangle*> star = GetVertexStar(v);
-
-	// Get supplement of the angle between each pair of normal vectors.
-	// This is the dihedral angle at the edge between normal vectors.
-	double distortion = 0;
-
-	for (int i = 0; i < star.size() - 1; ++i)
-	{
-		// Normals:
-		glm::dvec3 current = star[i]->normal;
-		glm::dvec3 next = star[i+1]->normal;
-
-		// Angle between normals:
-		double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-		double angle = acos(dot);
-
-		// Distortion.
-		double dihedral = M_PI - angle;
-		distortion += M_PI - dihedral;
-	}
-	// Last angle:
-	// Normals:
-	glm::dvec3 current = star[star.size() - 1]->normal;
-	glm::dvec3 next = star[0]->normal;
-
-	// Angle between normals:
-	double dot = glm::clamp(glm::dot(current, next), -1.0, 1.0);
-	double angle = acos(dot);
-
-	// Distortion.
-	double dihedral = M_PI - angle;
-	distortion += M_PI - dihedral;
-
-	if (distortion < 0)
-		std::cout << "Negative distortion." << std::endl;
-
-	return distortion;
+	return ComputeCurvature<Curvature::DISTORTION>(c);
 }
 
-
 std::vector<Triangle*> MeshAnalysis::GetVertexStar(Vert* v)
 {
 	std::vector<Triangle*> star;
-
-	// Bounce around CCW starting at any corner of the vertex.
-	Corner* c = v->c;
-
-	int k = -1;
-	Corner* previous = c;
-	while (k != c->index)
+	star.reserve(v->triangles.size());
+	for (Corner* c : CornerFan(*v))
 	{
-		Corner* current = previous->p->o->p;
-		k = current->index;
-		star.push_back(current->t);
-		previous = current;
-
-		//std::cout << current->t->index << " " << 180 * current->angle / M_PI << std::endl;
+		star.push_back(c->t);
 	}
 	return star;
 }
@@ -594,46 +163,27 @@ std::vector<Triangle*> MeshAnalysis::GetVertexStar(Vert* v)
 
 double MeshAnalysis::ComputeDifference(Corner& c)
 {
-	double distortion = ComputeSignedDistortion(c) / ComputeMixedPerimeter(c);
-	//double distortion = ComputeDistortion(c) / ComputeMixedPerimeter(c);
-	double mean = ComputeSignedMeanCurvature(c);
+	return ComputeCurvature<Curvature::DIFFERENCE>(c);
+}
 
-	return std::abs((double)mean - (double)distortion);
-	//return (double)(distortion - mean) / M_PI;
+double MeshAnalysis::ComputeNormalTurning(Corner& c)
+{
+	// The star starts at Swing(v->c) and ends at v->c, the same order as v->triangles, whose last pair comes first.
+	double total = 0.0;
+	for (Corner* current : CornerFan(*c.v->c))
+	{
+		total += std::abs(current->p->e->dihedral);
+	}
+	return total;
 }
 
 double MeshAnalysis::ComputeHorizonMeasureTest(Corner& c)
 {
-	return ComputeSignedDistortion(c) / ComputeMixedPerimeter(c);
+	return ComputeCurvature<Curvature::ORIGINAL>(c);
 }
 double MeshAnalysis::ComputeHorizonMeasure(Corner& c)
 {
-	// Start with the mixed perimeter.
-	double mixedPerimeter = ComputeMixedPerimeter(c);
-	if (mixedPerimeter == -1)
-		return 0;
-	
-	// Get the vertex associated with this corner.
-	Vert* v = c.v;
-
-	// Get list of triangle normal vectors in the list of triangles containing the vertex.
-	std::vector<glm::dvec3> normals;
-	for (Triangle* t : v->triangles)
-	{
-		normals.push_back(t->normal);
-	}
-
-	// Compute angles between each pair of normal vectors.
-	double last = glm::clamp(glm::dot(normals[normals.size()-1], normals[0]), -1.0, 1.0);
-	double total = acos(last);
-	for (int i = 0; i < normals.size() - 1; ++i)
-	{
-		double dot = glm::clamp(glm::dot(normals[i], normals[i+1]), -1.0, 1.0);
-		total += acos(dot);
-	}
-
-	// Testing: if the Gaussian curvature is negative, try adding 4pi.
-	return 2.0 * total / mixedPerimeter;
+	return ComputeCurvature<Curvature::HORIZON>(c);
 }
 
 // Based on the paper, compute the ``mixed perimeter'' of the Voronoi area corresponding to the triangle for this corner.
@@ -641,51 +191,41 @@ double MeshAnalysis::ComputeHorizonMeasure(Corner& c)
 double MeshAnalysis::ComputeMixedPerimeter(Corner& c)
 {
 	double mixedPerimeter = 0;
-	Vert* v = c.v;
 
-	// Bounce around the vertex using the corner:
-	int k = -1;
-	Corner* previous = &c;
-	while (k != c.index)
+	// Around the vertex from the corner after c. On a boundary, the parts of the perimeter along the boundary edges are left out.
+	for (Corner* current : CornerFan::After(c))
 	{
-		// Check if this is a boundary vertex.
-		// If so, set the mixed perimeter to be -1.
-		if (previous->p->o == NULL)
-			return -1;
-
-		Corner* current = previous->p->o->p;
-		k = current->index;
-
 		// If the triangle is obtuse, but the obtuse angle is NOT at this corner:
 		if (current->p->angle > 0.5 * M_PI ||
 			current->n->angle > 0.5 * M_PI)
 		{
 			// The perimeter is then half of the length of the edge opposite the corner.
-			mixedPerimeter += 0.5 * current->e->GetLength();
+			mixedPerimeter += 0.5 * current->e->length;
 		}
 		// If the triangle is obtuse and the angle IS at this corner:
 		else if (current->angle > 0.5 * M_PI)
 		{
 			// The perimeter is then half the sum of the edges containing the vertex.
 			// These edges are opposite the two adjacent corners of the current.
-			mixedPerimeter += 0.5 * (current->p->e->GetLength() + current->n->e->GetLength());
+			mixedPerimeter += 0.5 * (current->p->e->length + current->n->e->length);
 		}
 		// The triangle is not obtuse:
 		else
 		{
 			// Actual Voronoi cell based upon the circumcenter.
 			// First compute circumradius.
-			double pEdgeLength = current->p->e->GetLength();
-			double nEdgeLength = current->n->e->GetLength();
-			double cEdgeLength = current->e->GetLength();
+			double pEdgeLength = current->p->e->length;
+			double nEdgeLength = current->n->e->length;
+			double cEdgeLength = current->e->length;
 			double circumRadius = 0.25 * cEdgeLength * pEdgeLength * nEdgeLength / current->t->area;
 
 			// Now compute the two arcs of the Voronoi cell.
-			double pArcLength = std::sqrt(circumRadius * circumRadius - (0.25 * pEdgeLength * pEdgeLength));
-			double nArcLength = std::sqrt(circumRadius * circumRadius - (0.25 * nEdgeLength * nEdgeLength));
+			// A right angle at another corner can come out just under 90 degrees, and then the arc along the long edge
+			// is 0 up to rounding, which may be on either side of it.
+			double pArcLength = std::sqrt(std::max(0.0, circumRadius * circumRadius - (0.25 * pEdgeLength * pEdgeLength)));
+			double nArcLength = std::sqrt(std::max(0.0, circumRadius * circumRadius - (0.25 * nEdgeLength * nEdgeLength)));
 			mixedPerimeter += pArcLength + nArcLength;
 		}
-		previous = current;
 	}
 	return mixedPerimeter;
 }
@@ -693,113 +233,132 @@ double MeshAnalysis::ComputeMixedPerimeter(Corner& c)
 
 double MeshAnalysis::GetVertexCurvature(Vert* v, Curvature curv)
 {
-	// Choose the correct curvature function.
-	double (*CurvatureFunction)(Corner&);	
-	if (curv == Curvature::GAUSSIAN)
-		CurvatureFunction = ComputeGaussianCurvature;
-	else if (curv == Curvature::MEAN)
-		CurvatureFunction = ComputeMeanCurvature;
-	else if (curv == Curvature::HORIZON)
-		CurvatureFunction = ComputeHorizonMeasure;
-	else if (curv == Curvature::ORIGINAL)
-		CurvatureFunction = ComputeHorizonMeasureTest;
-	else if (curv == Curvature::DISTORTION)
-		CurvatureFunction = ComputeDistortion;
-	else if (curv == Curvature::CONE)
-		CurvatureFunction = ComputeGaussianCone;
-	else if (curv == Curvature::DISTORTION_SIGNED)
-		CurvatureFunction = ComputeSignedDistortion;
-	else if (curv == Curvature::MEAN_SIGNED)
-		CurvatureFunction = ComputeSignedMeanCurvature;
-	else if (curv == Curvature::MAX_PRINCIPAL_DISTORTION)
-		CurvatureFunction = ComputeMaxPrincipalDistortion;
-	else if (curv == Curvature::MIN_PRINCIPAL_DISTORTION)
-		CurvatureFunction = ComputeMinPrincipalDistortion;
-	else if (curv == Curvature::FALSE_GAUSSIAN)
-		CurvatureFunction = ComputeGaussianFromDistortion;
-	else if (curv == Curvature::FALSE_MEAN)
-		CurvatureFunction = ComputeMeanFromDistortion;
-	else if (curv == Curvature::PRINCIPAL_DEVIATION)
-		CurvatureFunction = ComputePrincipalDeviation;
-	else 
-		CurvatureFunction = ComputeDifference;
-
-	Corner c = *(v->c);
-	return CurvatureFunction(c);
+	const CurvatureKernels::Entry& kernel = CurvatureKernels::Get(curv);
+	CurvatureTerms terms;
+	GatherTerms(kernel.needs, *v->c, terms);
+	return kernel.compute(terms);
 }
 std::vector<double> MeshAnalysis::GetVertexCurvatures(Polyhedron* p, Curvature curv)
 {
-	// Assume that curvatures[i] is the curvature of vertices[i].
-	std::vector<double> curvatures(p->vlist.size(), std::numeric_limits<double>::max());
-
-	// Choose the correct curvature function.
-	double (*CurvatureFunction)(Corner&);	
-	if (curv == Curvature::GAUSSIAN)
-		CurvatureFunction = ComputeGaussianCurvature;
-	else if (curv == Curvature::MEAN)
-		CurvatureFunction = ComputeMeanCurvature;
-	else if (curv == Curvature::HORIZON)
-		CurvatureFunction = ComputeHorizonMeasure;
-	else if (curv == Curvature::ORIGINAL)
-		CurvatureFunction = ComputeHorizonMeasureTest;
-	else if (curv == Curvature::DISTORTION)
-		CurvatureFunction = ComputeDistortion;
-	else if (curv == Curvature::CONE)
-		CurvatureFunction = ComputeGaussianCone;
-	else if (curv == Curvature::DISTORTION_SIGNED)
-		CurvatureFunction = ComputeSignedDistortion;
-	else if (curv == Curvature::MEAN_SIGNED)
-		CurvatureFunction = ComputeSignedMeanCurvature;
-	else if (curv == Curvature::MAX_PRINCIPAL_DISTORTION)
-		CurvatureFunction = ComputeMaxPrincipalDistortion;
-	else if (curv == Curvature::MIN_PRINCIPAL_DISTORTION)
-		CurvatureFunction = ComputeMinPrincipalDistortion;
-	else if (curv == Curvature::FALSE_GAUSSIAN)
-		CurvatureFunction = ComputeGaussianFromDistortion;
-	else if (curv == Curvature::FALSE_MEAN)
-		CurvatureFunction = ComputeMeanFromDistortion;
-	else if (curv == Curvature::PRINCIPAL_DEVIATION)
-		CurvatureFunction = ComputePrincipalDeviation;
-	else //if (curv == Curvature::PRINCIPAL_DEVIATION)
-		CurvatureFunction = ComputeDifference;
-
-	// Go through the corner list and compute the Gaussian curvature of the corresponding vertex.
-	// Skip vertices we have already seen.
-	for (Corner& c : p->clist)
+	return GetVertexCurvatures(p, std::vector<Curvature>{ curv })[0];
+}
+
+std::vector<std::vector<double>> MeshAnalysis::GetVertexCurvatures(Polyhedron* p, const std::vector<Curvature>& curvs)
+{
+	// The kernels come from a table here, and the terms are whatever the list needs between them.
+	int needs = CurvatureKernels::Needs(curvs);
+	std::vector<const CurvatureKernels::Entry*> kernels;
+	for (Curvature curv : curvs)
 	{
-		int index = c.v->index;
+		kernels.push_back(&CurvatureKernels::Get(curv));
+	}
 
-		// Skip this vertex if we have already given it a value.
-		if (curvatures[index] != std::numeric_limits<double>::max())
-			continue;
-		double curvature = CurvatureFunction(c);
-		/*
-		if (curv == Curvature::GAUSSIAN)
-			curvature = abs(curvature);
-		*/
-		curvatures[index] = curvature;
+	std::vector<Corner*> corners = GetFirstCorners(p);
+	return RunKernels(corners.size(), kernels.size(),
+		[&](int i, CurvatureTerms& terms)
+		{
+			if (corners[i] == NULL)
+				return false;
+			GatherTerms(needs, *corners[i], terms);
+			return true;
+		},
+		[&](const CurvatureTerms& terms, double* values)
+		{
+			for (int k = 0; k < kernels.size(); ++k)
+			{
+				values[k] = kernels[k]->compute(terms);
+			}
+		});
+}
+
+void MeshAnalysis::UpdateVertexCurvatures(Polyhedron* p, const std::vector<int>& vertices, const std::vector<Curvature>& curvs,
+	std::vector<std::vector<double>>& values)
+{
+	int needs = CurvatureKernels::Needs(curvs);
+	std::vector<const CurvatureKernels::Entry*> kernels;
+	for (Curvature curv : curvs)
+	{
+		kernels.push_back(&CurvatureKernels::Get(curv));
 	}
-	return curvatures;
+
+	RunKernels(vertices,
+		[&](int i, CurvatureTerms& terms)
+		{
+			Corner* c = GetFirstCorner(p, i);
+			if (c == NULL)
+				return false;
+			GatherTerms(needs, *c, terms);
+			return true;
+		},
+		[&](const CurvatureTerms& terms, double* values)
+		{
+			for (int k = 0; k < kernels.size(); ++k)
+			{
+				values[k] = kernels[k]->compute(terms);
+			}
+		},
+		values);
 }
 
-// See Figure 4 in the paper for the formulas used for mixedArea according to whether or not the triangles are obtuse.
-double MeshAnalysis::ComputeMixedArea(Corner& c)
+void MeshAnalysis::GatherTerms(int needs, Corner& c, CurvatureTerms& terms)
 {
-	double mixedArea = 0;
 	Vert* v = c.v;
+	terms.totalAngle = v->totalAngle;
+	terms.normal = v->normal;
+	if (needs & CurvatureTerms::STAR)
+		terms.closed = ComputeStarDistortion(c, terms.star);
+
+	// The curvatures are not defined on a boundary, where they get -1 for the area and perimeter, as on a CompactMesh.
+	bool closed = (v->boundary == NULL);
+	if (needs & CurvatureTerms::MEAN)
+	{
+		terms.mixedArea = closed ? v->mixedArea : -1;
+		if (terms.mixedArea != -1)
+			terms.meanVector = ComputeMeanCurvatureVector(c);
+	}
+	if (needs & CurvatureTerms::PERIMETER)
+	{
+		terms.mixedPerimeter = closed ? v->mixedPerimeter : -1;
+		if ((needs & CurvatureTerms::TURNING) && terms.mixedPerimeter != -1)
+			terms.turning = ComputeNormalTurning(c);
+	}
+}
 
-	// Bounce around the vertex using the corner:
-	int k = -1;
-	Corner* current = &c;
-	while (k != c.index)
+std::vector<Corner*> MeshAnalysis::GetFirstCorners(Polyhedron* p)
+{
+	// Walk the corners backwards, so the first corner of each vertex is the last one written.
+	std::vector<Corner*> corners(p->vlist.size(), NULL);
+	for (int i = (int)p->clist.size() - 1; i >= 0; --i)
 	{
-		// Check if this is a boundary vertex.
-		// If so, set the mixed area to be -1.
-		if (current->p->o == NULL)
-			return -1;
+		Corner& c = p->clist[i];
+		corners[c.v->index] = &c;
+	}
+	return corners;
+}
+
+Corner* MeshAnalysis::GetFirstCorner(Polyhedron* p, int i)
+{
+	// The corner of vertex v in triangle t is 3t + k, so the lowest triangle has the lowest corner.
+	Vert& v = p->vlist[i];
+	Triangle* first = NULL;
+	for (Triangle* t : v.triangles)
+	{
+		if (first == NULL || t->index < first->index)
+			first = t;
+	}
+	if (first == NULL)
+		return NULL;
+	return &p->clist[3 * first->index + first->Contains(&v)];
+}
 
-		//std::cout << k << " " << c.index << " " << c.angle << " " << c.v->valence << " " << adjacent->v->index << std::endl;
+// See Figure 4 in the paper for the formulas used for mixedArea according to whether or not the triangles are obtuse.
+double MeshAnalysis::ComputeMixedArea(Corner& c)
+{
+	double mixedArea = 0;
 
+	// Around the vertex from c, or from one boundary edge to the other.
+	for (Corner* current : CornerFan(c))
+	{
 		// If the triangle is obtuse, but the obtuse angle is NOT at this corner:
 		if (current->p->angle > 0.5 * M_PI ||
 			current->n->angle > 0.5 * M_PI)
@@ -816,129 +375,59 @@ double MeshAnalysis::ComputeMixedArea(Corner& c)
 		// The triangle is not obtuse:
 		else
 		{
-			double theta = current->n->angle;
-			double phi   = current->p->angle;
-
-			double pq = current->n->e->GetLength();
-			double pr = current->p->e->GetLength();
+			double pq = current->n->e->length;
+			double pr = current->p->e->length;
 			pq *= pq;
 			pr *= pr;
 
-			double test = pq * (1.0 / tan(theta)) + pr * (1.0 / tan(phi));
+			double test = pq * current->n->cotangent + pr * current->p->cotangent;
 			if (test <= 0)
 			{
 				std::cout << "ERROR: non-positive mixed area. " << std::endl;
 				return -1;
 			}
-			mixedArea += (1.0 / 8.0) * (pq * (1.0 / tan(theta)) + pr * (1.0 / tan(phi)));
+			mixedArea += (1.0 / 8.0) * test;
 		}
-		Corner* adjacent = current->p->o->p;
-		k = adjacent->index;
-		current = adjacent;
 	}
 	return mixedArea;
 }
 
 double MeshAnalysis::ComputeGaussianCurvature(Corner& c)
 {
-	/*
-	double mixedArea = ComputeMixedArea(c);
-	if (mixedArea == -1)
-		return 0;
-	return ((2.0 * M_PI) - c.v->totalAngle) / mixedArea;
-	*/
-	return ((2.0 * M_PI) - c.v->totalAngle);
+	return ComputeCurvature<Curvature::GAUSSIAN>(c);
 }
 
 // See Equation 8 in the paper.
-double MeshAnalysis::ComputeSignedMeanCurvature(Corner& c)
+glm::dvec3 MeshAnalysis::ComputeMeanCurvatureVector(Corner& c)
 {
-	double mixedArea = ComputeMixedArea(c);
-	
-	// If this is a boundary vertex, just set the mean curvature to be zero:
-	if (mixedArea == -1)
-		return 0;
-
 	Vert* v = c.v;
 	glm::dvec3 total = glm::dvec3(0.0, 0.0, 0.0);
+	CornerFan fan = CornerFan::After(c);
+	if (!fan.IsClosed())
+		return total;
 
-	// Bounce around the vertex using the corner:
-	int k = -1;
-	Corner* previous = &c;
-	while (k != c.index)
+	for (Corner* adjacent : fan)
 	{
-		Corner* adjacent = previous->p->o->p;
-		k = adjacent->index;
-
-		// If the triangle is obtuse, but the obtuse angle is NOT at this corner:
-		double theta = adjacent->n->angle;
-		double phi = adjacent->n->o->angle;
+		// Cotangents of the two angles opposite the edge from v to w, which it shares with the corner before.
+		double weight = adjacent->n->cotangent + adjacent->n->o->cotangent;
 
-		Vert* w = previous->n->v;
+		Vert* w = adjacent->p->v;
 		glm::dvec3 xi = glm::dvec3(v->x, v->y, v->z);
 		glm::dvec3 xj = glm::dvec3(w->x, w->y, w->z);
 		glm::dvec3 difference = xi - xj;
 
-		total += MeanCurvatureWeight(theta, phi) * difference;
-		previous = adjacent;
+		total += weight * difference;
 	}
-	//return 0.5 * ((double)1.0 / (2.0 * mixedArea)) * total;
-	glm::dvec3 mcVector = ((double)1.0 / (2.0 * mixedArea)) * total;
-
-	double meanCurvature = 0.5 * glm::length(mcVector);
-	if (glm::dot(v->normal, mcVector) > 0)
-		return meanCurvature;
-	else
-		return -1.0 * meanCurvature;
+	return ((double)1.0 / (2.0 * v->mixedArea)) * total;
 }
-double MeshAnalysis::ComputeMeanCurvature(Corner& c)
-{
-	double mixedArea = ComputeMixedArea(c);
-	
-	// If this is a boundary vertex, just set the mean curvature to be zero:
-	if (mixedArea == -1)
-		return 0;
-
-	Vert* v = c.v;
-	glm::dvec3 total = glm::dvec3(0.0, 0.0, 0.0);
-
-	// Bounce around the vertex using the corner:
-	int k = -1;
-	Corner* previous = &c;
-	while (k != c.index)
-	{
-		Corner* adjacent = previous->p->o->p;
-		k = adjacent->index;
-
-		// If the triangle is obtuse, but the obtuse angle is NOT at this corner:
-		double theta = adjacent->n->angle;
-		double phi = adjacent->n->o->angle;
-
-		Vert* w = previous->n->v;
-		glm::dvec3 xi = glm::dvec3(v->x, v->y, v->z);
-		glm::dvec3 xj = glm::dvec3(w->x, w->y, w->z);
-		glm::dvec3 difference = xi - xj;
-
-		total += MeanCurvatureWeight(theta, phi) * difference;
-		previous = adjacent;
-	}
-	//return 0.5 * ((double)1.0 / (2.0 * mixedArea)) * total;
-	glm::dvec3 mcVector = ((double)1.0 / (2.0 * mixedArea)) * total;
 
-	/*
-	double meanCurvature = glm::length(mcVector);
-	if (glm::dot(v->normal, mcVector) > 0)
-		return meanCurvature;
-	else
-		return -1 * meanCurvature;
-		*/
-
-	return 0.5 * glm::length(mcVector);
+double MeshAnalysis::ComputeSignedMeanCurvature(Corner& c)
+{
+	return ComputeCurvature<Curvature::MEAN_SIGNED>(c);
 }
-
-double MeshAnalysis::MeanCurvatureWeight(double theta, double phi)
+double MeshAnalysis::ComputeMeanCurvature(Corner& c)
 {
-	return (1.0 / tan(theta)) + (1.0 / tan(phi));
+	return ComputeCurvature<Curvature::MEAN>(c);
 }
 
 
@@ -950,206 +439,181 @@ void MeshAnalysis::GetCornerList(Polyhedron* p)
 	int numTriangles = tlist.size();
 	std::vector<Corner>& corners = p->clist;
 
-	// Analyze one triangle at a time.
-	int cornerIndex = 0;
-	for (int i = 0; i < numTriangles; ++i)
+	// Analyze the triangles in parallel: each one only writes its own three corners.
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(numTriangles, BLOCK_SIZE, [&](int begin, int end)
 	{
-		// Get the triangle and its vertices.
-		Triangle& t = tlist[i];
-		Vert* v1 = t.vertices[0];
-		Vert* v2 = t.vertices[1];
-		Vert* v3 = t.vertices[2];
-
-		// Corners.
-		Corner& c1 = corners[cornerIndex];
-		c1.index = cornerIndex;
-		Corner& c2 = corners[cornerIndex + 1];
-		c2.index = cornerIndex + 1;
-		Corner& c3 = corners[cornerIndex + 2];
-		c3.index = cornerIndex + 2;
-		 
-		// Triangle: c.t.
-		c1.t = &t;
-		c2.t = &t;
-		c3.t = &t;
-
-		// Vertex: c.v.
-		c1.v = v1;
-		c2.v = v2;
-		c3.v = v3;
-		v1->c = &c1;
-		v2->c = &c2;
-		v3->c = &c3;
-
-		// Next: c.n.
-		c1.n = &c2;
-		c2.n = &c3;
-		c3.n = &c1;
-
-		// Previous: c.p.
-		c1.p = &c3;
-		c2.p = &c1;
-		c3.p = &c2;
-
-		// Edge: c.e.
-		for (int j = 0; j < 3; ++j)
+		for (int i = begin; i < end; ++i)
 		{
-			// For each vertex, check to see if that vertex is NOT contained in an edge.
-			// The edge that does not contain the vertex is the edge that we want for c.e.
-			Edge* e = t.edges[j];
-			if (e->Contains(v1) == -1)
-			{
-				c1.e = e;
-			}
-			if (e->Contains(v2) == -1)
-			{
-				c2.e = e;
-			}
-			if (e->Contains(v3) == -1)
+			int cornerIndex = 3 * i;
+
+			// Get the triangle and its vertices.
+			Triangle& t = tlist[i];
+			Vert* v1 = t.vertices[0];
+			Vert* v2 = t.vertices[1];
+			Vert* v3 = t.vertices[2];
+
+			// Corners.
+			Corner& c1 = corners[cornerIndex];
+			c1.index = cornerIndex;
+			Corner& c2 = corners[cornerIndex + 1];
+			c2.index = cornerIndex + 1;
+			Corner& c3 = corners[cornerIndex + 2];
+			c3.index = cornerIndex + 2;
+		 
+			// Triangle: c.t.
+			c1.t = &t;
+			c2.t = &t;
+			c3.t = &t;
+
+			// Vertex: c.v.
+			c1.v = v1;
+			c2.v = v2;
+			c3.v = v3;
+
+			// Next: c.n.
+			c1.n = &c2;
+			c2.n = &c3;
+			c3.n = &c1;
+
+			// Previous: c.p.
+			c1.p = &c3;
+			c2.p = &c1;
+			c3.p = &c2;
+
+			// Edge: c.e.
+			for (int j = 0; j < 3; ++j)
 			{
-				c3.e = e;
+				// For each vertex, check to see if that vertex is NOT contained in an edge.
+				// The edge that does not contain the vertex is the edge that we want for c.e.
+				Edge* e = t.edges[j];
+				if (e->Contains(v1) == -1)
+				{
+					c1.e = e;
+				}
+				if (e->Contains(v2) == -1)
+				{
+					c2.e = e;
+				}
+				if (e->Contains(v3) == -1)
+				{
+					c3.e = e;
+				}
 			}
-		}
-
-		// And now the hard part...
-		// Opposite: c.o.
-		for (int j = 0; j < 3; ++j)
-		{
-			Corner& c = corners[cornerIndex + j];
-
-			// Get the edge of the corner and find the triangle that is not equal to c.t.
-			Edge* e = c.e;
 
-			// If this edge is attached to only one triangle then there is no opposite corner.
-			if (!(e->isBoundary()))
+			// And now the hard part...
+			// Opposite: c.o.
+			for (int j = 0; j < 3; ++j)
 			{
-				// Pick the correct triangle that is NOT equal to the current triangle c.t.	
-				Triangle* s = e->GetOtherTriangle(&t);
+				Corner& c = corners[cornerIndex + j];
 
-				// Look through the vertices of the triangle and find the one that is not in the shared edge.
-				for (int k = 0; k < 3; ++k)
+				// Get the edge of the corner and find the triangle that is not equal to c.t.
+				Edge* e = c.e;
+
+				// If this edge is attached to only one triangle then there is no opposite corner.
+				if (!(e->isBoundary()))
 				{
-					int triangleVertexIndex = k;
-					Vert* w = s->vertices[triangleVertexIndex];
-					if (e->Contains(w) == -1)
+					// Pick the correct triangle that is NOT equal to the current triangle c.t.	
+					Triangle* s = e->GetOtherTriangle(&t);
+
+					// Look through the vertices of the triangle and find the one that is not in the shared edge.
+					for (int k = 0; k < 3; ++k)
 					{
-						// The annoying part.
-						// We need to figure out what the index of the desired corner c.o will be, before it is even initialized.
-						// Since we are creating these corners by iterating through the triangles, we can determine the future index of c.o.
-						// First, each triangle generates three corners.
-						// So if we are looking at the ith triangle, then the desired corner will have index 3i, 3i+1, or 3i+2.
-						int index = 3 * s->index + triangleVertexIndex;
-						c.o = &corners[index];
-						//c.Print();
-						break;
+						int triangleVertexIndex = k;
+						Vert* w = s->vertices[triangleVertexIndex];
+						if (e->Contains(w) == -1)
+						{
+							// The annoying part.
+							// We need to figure out what the index of the desired corner c.o will be, before it is even initialized.
+							// Since we are creating these corners by iterating through the triangles, we can determine the future index of c.o.
+							// First, each triangle generates three corners.
+							// So if we are looking at the ith triangle, then the desired corner will have index 3i, 3i+1, or 3i+2.
+							int index = 3 * s->index + triangleVertexIndex;
+							c.o = &corners[index];
+							//c.Print();
+							break;
+						}
 					}
 				}
-			}
-			else
-			{
-				c.o = NULL;
+				else
+				{
+					c.o = NULL;
+				}
 			}
 		}
+	});
 
-		cornerIndex += 3;
+	// Vertex: v.c. The corners are visited in order, so each vertex gets its last corner.
+	for (Corner& c : corners)
+	{
+		c.v->c = &c;
 	}
+	GetBoundaryCorners(p);
 }
 
-void MeshAnalysis::GetValenceDeficit(Polyhedron* p)
+void MeshAnalysis::GetBoundaryCorners(Polyhedron* p)
 {
-	// We can cycle around a vertex using corners.
-	// Given a corner, check c.p.o.p to get a new corner at the same vertex.
-	// Hop around in this fashion until we get back to where we started.
-
-	// WARNING: KNOWN BUG:
-	// Will crash if the mesh has boundary.
-	// Something goes wrong when bouncing around using the corners if there is boundary.
-	// GO FIX!
-
-	// This method requires that the polyhedron has a corner table.
-	if (p->clist.size() < 1)
-	{
-		GetCornerList(p);
-	}
-	std::vector<Corner>& corners = p->clist;
-
-	for (Corner c : corners)
+	// Swing clockwise (c.n.o.n) from the corner of each vertex. Coming back around to it means the fan is closed;
+	// otherwise the last corner reached is the one next to the boundary.
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(p->vlist.size(), BLOCK_SIZE, [&](int begin, int end)
 	{
-		// Valence:
-		// Don't bother computing if the valence of this vertex has already been set.
-		if (c.v->valence == 0)
+		for (int i = begin; i < end; ++i)
 		{
-			// Bounce around until we get back to where we started OR until we reach a boundary.
-			int index = -1;
-			int valence = 0;
-			bool goPrevious = true;
-			Corner* previous = &c;
-			
-			// Valence computation:
-			while (index != c.index)
+			Vert& v = p->vlist[i];
+			v.boundary = NULL;
+			if (v.c == NULL)
+				continue;
+			Corner* c = v.c;
+			while (true)
 			{
-				// Go the correct direction.
-				Corner* rotate = goPrevious ? previous->p : previous->n;
-
-				// The c.o.p corner will be NULL if the starting triangle was a boundary.
-				// So check this first:
-				if (rotate->o != NULL)
+				Corner* o = c->n->o;
+				if (o == NULL || o->n->v != &v)
 				{
-					// Still make sure to go the correct direction.
-					Corner* adjacent = goPrevious ? rotate->o->p : rotate->o->n;
-					index = adjacent->index;
-
-					++valence;
-					previous = adjacent;
-				}
-				// NULL (boundary) case:
-				else
-				{
-					// Still increase the valence.
-					++valence;
-
-					// Change the direction. 
-					// But if we already did try going the other direction, we are done.
-					if (goPrevious)
-					{
-						previous = &c;
-						goPrevious = false;
-					}
-					else
-						index = c.index;
+					v.boundary = c;
+					break;
 				}
+				c = o->n;
+				if (c == v.c)
+					break;
 			}
-			c.v->valence = valence;
-			int deficit = 6 - valence;
-			p->valenceDeficit += deficit;
 		}
+	});
+}
+
+void MeshAnalysis::GetValenceDeficit(Polyhedron* p)
+{
+	// This method requires that the polyhedron has a corner table.
+	if (p->clist.size() < 1)
+	{
+		GetCornerList(p);
 	}
-	/*
-	for (Corner c : corners)
+
+	// One walk around each vertex. A fan cut by a boundary has one more edge than triangles.
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(p->vlist.size(), BLOCK_SIZE, [&](int begin, int end)
 	{
-		// Valence:
-		// Don't bother computing if the valence of this vertex has already been set.
-		if (c.v->valence == 0)
+		for (int i = begin; i < end; ++i)
 		{
-			// Bounce around until we get back to where we started.
-			int index = -1;
-			int valence = 0;
-			Corner* previous = &c;
-			while (index != c.index)
+			Vert& v = p->vlist[i];
+			CornerFan fan(v);
+			int valence = fan.IsClosed() ? 0 : 1;
+			for (CornerFan::Iterator c = fan.begin(); c != fan.end(); ++c)
 			{
-				// Valence computation:
-				Corner* adjacent = previous->p->o->p;
-				index = adjacent->index;
-
-				valence++;
-				previous = adjacent;
+				++valence;
 			}
-			c.v->valence = valence;
-			int deficit = 6 - valence;
-			p->valenceDeficit += deficit;
+			v.valence = (v.c == NULL) ? 0 : valence;
 		}
+	});
+
+	// Vertices without triangles do not count.
+	int deficit = 0;
+	for (Vert& v : p->vlist)
+	{
+		if (v.c != NULL)
+			deficit += 6 - v.valence;
 	}
-	*/
+	p->valenceDeficit = deficit;
 }
 
 void MeshAnalysis::ComputeAngle(Corner& c)
@@ -1170,13 +634,28 @@ void MeshAnalysis::ComputeAngle(Corner& c)
 
 void MeshAnalysis::ComputeAngles(std::vector<Corner>& corners)
 {
-	for (Corner& c : corners)
+	// Compute the missing angles in parallel.
+	std::vector<char> computed(corners.size(), 0);
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(corners.size(), BLOCK_SIZE, [&](int begin, int end)
 	{
-		// Check to see if the angle has already been computed. If not, continue:
-		if (c.angle == 0)
+		for (int i = begin; i < end; ++i)
 		{
-			ComputeAngle(c);
+			// Check to see if the angle has already been computed. If not, continue:
+			if (corners[i].angle == 0)
+			{
+				ComputeAngle(corners[i]);
+				computed[i] = 1;
+			}
+		}
+	});
 
+	// Several corners share a vertex, so add up the totals in corner order.
+	for (int i = 0; i < corners.size(); ++i)
+	{
+		Corner& c = corners[i];
+		if (computed[i])
+		{
 			// Add this angle to the vertex total angle.
 			c.v->totalAngle += c.angle;
 
@@ -1201,7 +680,414 @@ void MeshAnalysis::GetAngleDeficit(Polyhedron* p)
 	p->angleDeficit = totalAngleDeficit;
 }
 
+void MeshAnalysis::ComputeCurvatureGeometry(Polyhedron* p)
+{
+	const int BLOCK_SIZE = 4096;
+
+	// Edges: the length, and the signed angle between the normals of the two triangles.
+	Parallel::ForBlocks(p->elist.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<Edge*> edges(end - begin);
+		for (int i = begin; i < end; ++i)
+		{
+			edges[i - begin] = &p->elist[i];
+		}
+		ComputeEdgeGeometry(edges.data(), end - begin);
+	});
+
+	// Corners:
+	Parallel::ForBlocks(p->clist.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			p->clist[i].cotangent = 1.0 / tan(p->clist[i].angle);
+		}
+	});
+
+	// Vertices, which read the two above. The walks start at the first corner, like GetVertexCurvatures().
+	std::vector<Corner*> corners = GetFirstCorners(p);
+	Parallel::ForBlocks(p->vlist.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = p->vlist[i];
+			v.mixedArea = (corners[i] == NULL) ? -1 : ComputeMixedArea(*corners[i]);
+			v.mixedPerimeter = (corners[i] == NULL) ? -1 : ComputeMixedPerimeter(*corners[i]);
+		}
+	});
+}
+
+void MeshAnalysis::ComputeCurvatureGeometry(Polyhedron* p, const std::vector<Triangle*>& triangles, const std::vector<int>& vertices)
+{
+	const int BLOCK_SIZE = 4096;
+
+	// The edges of the triangles, each once: sorted out of a few triangles, or marked when they are much of the mesh.
+	std::vector<Edge*> edges;
+	if (triangles.size() < p->tlist.size() / 16)
+	{
+		for (Triangle* t : triangles)
+		{
+			edges.insert(edges.end(), t->edges.begin(), t->edges.end());
+		}
+		std::sort(edges.begin(), edges.end(), [](Edge* e0, Edge* e1) { return e0->index < e1->index; });
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	}
+	else
+	{
+		std::vector<char> marks(p->elist.size(), 0);
+		for (Triangle* t : triangles)
+		{
+			for (Edge* e : t->edges)
+			{
+				marks[e->index] = 1;
+			}
+		}
+		for (int i = 0; i < p->elist.size(); ++i)
+		{
+			if (marks[i])
+				edges.push_back(&p->elist[i]);
+		}
+	}
+	Parallel::ForBlocks(edges.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		ComputeEdgeGeometry(edges.data() + begin, end - begin);
+	});
+
+	// Corners:
+	Parallel::ForBlocks(triangles.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				Corner& c = p->clist[3 * triangles[i]->index + k];
+				c.cotangent = 1.0 / tan(c.angle);
+			}
+		}
+	});
+
+	// Vertices:
+	Parallel::ForBlocks(vertices.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = p->vlist[vertices[i]];
+			Corner* c = GetFirstCorner(p, vertices[i]);
+			v.mixedArea = (c == NULL) ? -1 : ComputeMixedArea(*c);
+			v.mixedPerimeter = (c == NULL) ? -1 : ComputeMixedPerimeter(*c);
+		}
+	});
+}
+
+void MeshAnalysis::ComputeCurvatureGeometry(CompactMesh& m)
+{
+	// The walks start at the first corner, like GetVertexCurvatures(), and read the cotangents and lengths.
+	std::vector<int32_t> corners = GetFirstCorners(m);
+	m.mixedAreas.resize(corners.size());
+	m.mixedPerimeters.resize(corners.size());
+	Parallel::ForBlocks(corners.size(), 4096, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			m.mixedAreas[i] = (corners[i] < 0) ? -1 : ComputeMixedArea(m, corners[i]);
+			m.mixedPerimeters[i] = (corners[i] < 0) ? -1 : ComputeMixedPerimeter(m, corners[i]);
+		}
+	});
+}
+
+void MeshAnalysis::ComputeEdgeGeometry(Edge* const* edges, int count)
+{
+	// The normals and tangents are gathered for Dihedral::ComputeSignedAngles(), which does all of them at once.
+	Dihedral::Batch batch(count);
+	for (int i = 0; i < count; ++i)
+	{
+		Edge& e = *edges[i];
+		e.length = e.GetLength();
+		if (e.triangles.size() < 2)
+		{
+			batch.Set(i, glm::dvec3(0.0), glm::dvec3(0.0), glm::dvec3(0.0));
+			continue;
+		}
+
+		// The current triangle is the one that runs along the edge from vertices[0] to vertices[1],
+		// which is how the star of vertices[0] meets the two triangles. The star of vertices[1] meets them
+		// the other way around, but then the normals and the tangent both change sign, and so the angle does not.
+		Triangle* current = e.triangles[0];
+		Triangle* next = e.triangles[1];
+		int k = current->Contains(e.vertices[0]);
+		if (current->vertices[(k + 1) % 3] != e.vertices[1])
+			std::swap(current, next);
+		batch.Set(i, current->normal, next->normal, e.vertices[1]->GetPosition() - e.vertices[0]->GetPosition());
+	}
+
+	std::vector<double> angles(count);
+	Dihedral::ComputeSignedAngles(batch.GetEdges(), count, angles.data());
+	for (int i = 0; i < count; ++i)
+	{
+		Edge& e = *edges[i];
+		e.dihedral = (e.triangles.size() < 2) ? 0.0 : angles[i];
+	}
+}
+
 float MeshAnalysis::InverseLerp(float start, float end, float v)
 {
 	return (v - start) / (end  - start);
 }
+
+
+
+/********* COMPACT MESH *********/
+
+std::vector<double> MeshAnalysis::GetVertexCurvatures(const CompactMesh& m, Curvature curv)
+{
+	return GetVertexCurvatures(m, std::vector<Curvature>{ curv })[0];
+}
+
+std::vector<std::vector<double>> MeshAnalysis::GetVertexCurvatures(const CompactMesh& m, const std::vector<Curvature>& curvs)
+{
+	// As for a Polyhedron: every curvature of a vertex at once, at the first of its corners.
+	int needs = CurvatureKernels::Needs(curvs);
+	std::vector<const CurvatureKernels::Entry*> kernels;
+	for (Curvature curv : curvs)
+	{
+		kernels.push_back(&CurvatureKernels::Get(curv));
+	}
+
+	std::vector<int32_t> corners = GetFirstCorners(m);
+	return RunKernels(corners.size(), kernels.size(),
+		[&](int i, CurvatureTerms& terms)
+		{
+			if (corners[i] < 0)
+				return false;
+			GatherTerms(needs, m, corners[i], terms);
+			return true;
+		},
+		[&](const CurvatureTerms& terms, double* values)
+		{
+			for (int k = 0; k < kernels.size(); ++k)
+			{
+				values[k] = kernels[k]->compute(terms);
+			}
+		});
+}
+
+double MeshAnalysis::GetVertexCurvature(const CompactMesh& m, int32_t v, Curvature curv)
+{
+	const CurvatureKernels::Entry& kernel = CurvatureKernels::Get(curv);
+	CurvatureTerms terms;
+	GatherTerms(kernel.needs, m, m.vertexCorners[v], terms);
+	return kernel.compute(terms);
+}
+
+std::vector<int32_t> MeshAnalysis::GetFirstCorners(const CompactMesh& m)
+{
+	std::vector<int32_t> corners(m.GetNumberOfVertices(), -1);
+	for (int32_t v = 0; v < m.GetNumberOfVertices(); ++v)
+	{
+		CompactMesh::Range fan = m.GetFan(v);
+		if (!fan.empty())
+			corners[v] = *std::min_element(fan.begin(), fan.end());
+	}
+	return corners;
+}
+
+void MeshAnalysis::GatherTerms(int needs, const CompactMesh& m, int32_t c, CurvatureTerms& terms)
+{
+	int32_t v = m.V(c);
+	terms.totalAngle = m.totalAngles[v];
+	terms.normal = m.normals[v];
+	if (needs & CurvatureTerms::STAR)
+		terms.closed = ComputeStarDistortion(m, v, terms.star);
+	if (needs & CurvatureTerms::MEAN)
+	{
+		terms.mixedArea = m.mixedAreas[v];
+		if (terms.mixedArea != -1)
+			terms.meanVector = ComputeMeanCurvatureVector(m, c, terms.mixedArea);
+	}
+	if (needs & CurvatureTerms::PERIMETER)
+	{
+		terms.mixedPerimeter = m.mixedPerimeters[v];
+		if ((needs & CurvatureTerms::TURNING) && terms.mixedPerimeter != -1)
+			terms.turning = ComputeNormalTurning(m, c);
+	}
+}
+
+std::vector<int32_t> MeshAnalysis::GetVertexStar(const CompactMesh& m, int32_t v)
+{
+	std::vector<int32_t> star;
+	for (int32_t c : m.GetStar(v))
+	{
+		star.push_back(CompactMesh::T(c));
+	}
+	return star;
+}
+
+bool MeshAnalysis::ComputeStarDistortion(const CompactMesh& m, int32_t v, StarDistortion& distortion)
+{
+	// Walk the pairs of consecutive triangles of the star, including the last and first.
+	// Triangles i and i+1 of the star share the edge from v to the next vertex of corner i, which is opposite its previous corner.
+	CompactMesh::Range star = m.GetStar(v);
+	if (star.empty())
+		return false;
+
+	glm::dvec3 vPosition = m.positions[v];
+	for (int32_t current : star)
+	{
+		int32_t e = m.E(CompactMesh::P(current));
+		double angle = m.edgeDihedrals[e];
+
+		// Unsigned distortion, written as the supplement of the dihedral angle.
+		double dihedral = M_PI - std::abs(angle);
+		distortion.unsignedSum += M_PI - dihedral;
+
+		// The edge direction is the tangent vector t_e that gave the angle its sign.
+		glm::dvec3 te = m.positions[m.V(CompactMesh::N(current))] - vPosition;
+		double length = m.edgeLengths[e];
+		distortion.signedSum += angle;
+		if (angle > distortion.max)
+		{
+			distortion.max = angle;
+			distortion.maxDirection = te / length;
+		}
+		if (angle < distortion.min)
+		{
+			distortion.min = angle;
+			distortion.minDirection = te / length;
+		}
+	}
+	return true;
+}
+
+double MeshAnalysis::ComputeMixedArea(const CompactMesh& m, int32_t c)
+{
+	double mixedArea = 0;
+
+	// Bounce around the vertex using the corner:
+	int32_t current = c;
+	do
+	{
+		// Check if this is a boundary vertex.
+		// If so, set the mixed area to be -1.
+		if (m.O(CompactMesh::P(current)) < 0)
+			return -1;
+
+		int32_t n = CompactMesh::N(current);
+		int32_t p = CompactMesh::P(current);
+
+		// If the triangle is obtuse, but the obtuse angle is NOT at this corner:
+		if (m.cornerAngles[p] > 0.5 * M_PI || m.cornerAngles[n] > 0.5 * M_PI)
+		{
+			mixedArea += 0.25 * m.areas[CompactMesh::T(current)];
+		}
+		// If the triangle is obtuse and the angle IS at this corner:
+		else if (m.cornerAngles[current] > 0.5 * M_PI)
+		{
+			mixedArea += 0.5 * m.areas[CompactMesh::T(current)];
+		}
+		// The triangle is not obtuse:
+		else
+		{
+			double pq = m.edgeLengths[m.E(n)];
+			double pr = m.edgeLengths[m.E(p)];
+			pq *= pq;
+			pr *= pr;
+
+			double test = pq * m.cornerCotangents[n] + pr * m.cornerCotangents[p];
+			if (test <= 0)
+			{
+				std::cout << "ERROR: non-positive mixed area. " << std::endl;
+				return -1;
+			}
+			mixedArea += (1.0 / 8.0) * test;
+		}
+		current = m.Swing(current);
+	} while (current != c);
+	return mixedArea;
+}
+
+double MeshAnalysis::ComputeMixedPerimeter(const CompactMesh& m, int32_t c)
+{
+	double mixedPerimeter = 0;
+
+	// Bounce around the vertex using the corner:
+	int32_t current = c;
+	do
+	{
+		// Check if this is a boundary vertex.
+		// If so, set the mixed perimeter to be -1.
+		current = m.Swing(current);
+		if (current < 0)
+			return -1;
+
+		int32_t n = CompactMesh::N(current);
+		int32_t p = CompactMesh::P(current);
+
+		// If the triangle is obtuse, but the obtuse angle is NOT at this corner:
+		if (m.cornerAngles[p] > 0.5 * M_PI || m.cornerAngles[n] > 0.5 * M_PI)
+		{
+			// The perimeter is then half of the length of the edge opposite the corner.
+			mixedPerimeter += 0.5 * m.edgeLengths[m.E(current)];
+		}
+		// If the triangle is obtuse and the angle IS at this corner:
+		else if (m.cornerAngles[current] > 0.5 * M_PI)
+		{
+			// The perimeter is then half the sum of the edges containing the vertex.
+			mixedPerimeter += 0.5 * (m.edgeLengths[m.E(p)] + m.edgeLengths[m.E(n)]);
+		}
+		// The triangle is not obtuse:
+		else
+		{
+			// Actual Voronoi cell based upon the circumcenter.
+			double pEdgeLength = m.edgeLengths[m.E(p)];
+			double nEdgeLength = m.edgeLengths[m.E(n)];
+			double cEdgeLength = m.edgeLengths[m.E(current)];
+			double circumRadius = 0.25 * cEdgeLength * pEdgeLength * nEdgeLength / m.areas[CompactMesh::T(current)];
+
+			// Now compute the two arcs of the Voronoi cell.
+			double pArcLength = std::sqrt(std::max(0.0, circumRadius * circumRadius - (0.25 * pEdgeLength * pEdgeLength)));
+			double nArcLength = std::sqrt(std::max(0.0, circumRadius * circumRadius - (0.25 * nEdgeLength * nEdgeLength)));
+			mixedPerimeter += pArcLength + nArcLength;
+		}
+	} while (current != c);
+	return mixedPerimeter;
+}
+
+// See Equation 8 in the paper.
+glm::dvec3 MeshAnalysis::ComputeMeanCurvatureVector(const CompactMesh& m, int32_t c, double mixedArea)
+{
+	int32_t v = m.V(c);
+	glm::dvec3 total = glm::dvec3(0.0, 0.0, 0.0);
+
+	// Bounce around the vertex using the corner:
+	int32_t previous = c;
+	int32_t adjacent;
+	do
+	{
+		adjacent = m.Swing(previous);
+		// Cotangents of the two angles opposite the edge from v to the next vertex of previous.
+		int32_t n = CompactMesh::N(adjacent);
+		double weight = m.cornerCotangents[n] + m.cornerCotangents[m.O(n)];
+
+		glm::dvec3 difference = m.positions[v] - m.positions[m.V(CompactMesh::N(previous))];
+		total += weight * difference;
+		previous = adjacent;
+	} while (adjacent != c);
+	return ((double)1.0 / (2.0 * mixedArea)) * total;
+}
+
+double MeshAnalysis::ComputeNormalTurning(const CompactMesh& m, int32_t c)
+{
+	// The star is in the order of Vert::triangles, and triangles i and i+1 share the edge opposite the previous corner of corner i.
+	// The Swing() walk of the perimeter can close where the star does not, on a mesh wound inconsistently around the vertex.
+	CompactMesh::Range star = m.GetStar(m.V(c));
+	if (star.empty())
+		return 0.0;
+
+	int last = star.size() - 1;
+	double total = std::abs(m.edgeDihedrals[m.E(CompactMesh::P(star[last]))]);
+	for (int i = 0; i < last; ++i)
+	{
+		total += std::abs(m.edgeDihedrals[m.E(CompactMesh::P(star[i]))]);
+	}
+	return total;
+}
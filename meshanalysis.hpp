@@ -2,8 +2,11 @@
 
 #include <cmath>
 #include <limits>
+#include <cstdint>
 #include <algorithm>
 #include "utilities.hpp"
+#include "parallel.hpp"
+#include "curvaturekernels.hpp"
 #include "meshcomponent.hpp"
 #define GLM_ENABLE_EXPERIMENTAL
 #include "glm/gtx/norm.hpp"
@@ -11,6 +14,7 @@
 // Forward declaration.
 class Polyhedron;
 class MeshComponent;
+class CompactMesh;
 
 // Static class to analyze a Polyhedron object.
 class MeshAnalysis
@@ -21,7 +25,11 @@ public:
 	// Compute the corners of a polyhedron.
 	void static GetCornerList(Polyhedron* p);	
 
-	// Compute the valence deficit of a polyhedron.
+	// Find the corner where the fan of each vertex starts if it is cut by a boundary: Vert::boundary, read by CornerFan.
+	// Run by GetCornerList().
+	void static GetBoundaryCorners(Polyhedron* p);
+
+	// Compute the valence of each vertex and the valence deficit of a polyhedron, with or without boundary.
 	void static GetValenceDeficit(Polyhedron* p);
 
 	// Compute the angle at a single vertex.
@@ -33,15 +41,23 @@ public:
 	// Compute angle deficit of a polyhedron.
 	void static GetAngleDeficit(Polyhedron* p);
 
+	// Cache what the curvature measures share: edge lengths, dihedral angles and corner cotangents,
+	// then the mixed area and perimeter of each vertex at its first corner.
+	// Needs the corners and angles; run it again whenever the vertices move.
+	void static ComputeCurvatureGeometry(Polyhedron* p);
+
+	// The same for the edges and corners of some triangles whose shape changed, and the given vertices,
+	// which must include every vertex of those triangles. Used by Polyhedron::Update().
+	void static ComputeCurvatureGeometry(Polyhedron* p, const std::vector<Triangle*>& triangles, const std::vector<int>& vertices);
+
+	// The mixed area and perimeter of each vertex of a CompactMesh, at its first corner.
+	// Needs the corner cotangents and edge lengths; CompactMesh::InitializeFromCornerTable() calls it.
+	void static ComputeCurvatureGeometry(CompactMesh& m);
+
 	// Get the star of a vertex, using the corner list to ensure orientation.
+	// On a boundary, the triangles from one boundary edge to the other.
 	std::vector<Triangle*> static GetVertexStar(Vert* v);
 
-	
-	/********* LINES OF CURVATURE *********/
-	// Get principal directions:
-	// Data is structured such that two elements in a row are the max and min principal directions at the same vertex.
-	static std::vector<Edge*> GetPrincipalDirections(Polyhedron *p);
-
 
 
 	/********* VERTEX CURVATURES *********/
@@ -49,13 +65,40 @@ public:
 	static std::vector<double> GetVertexCurvatures(Polyhedron* p, Curvature curvature);
 	static double GetVertexCurvature(Vert* v, Curvature curvature);
 
+	// Any number of curvatures in one pass: result[k][i] is curvatures[k] at vertex i.
+	// Each vertex is visited once, at the first of its corners, and the vertices are split over the threads.
+	// What the curvatures share is computed once per vertex, and the values are the same as computing one curvature at a time.
+	static std::vector<std::vector<double>> GetVertexCurvatures(Polyhedron* p, const std::vector<Curvature>& curvatures);
+
+	// The same, with the curvatures fixed at compile time, so that their kernels are inlined into the loop:
+	// GetVertexCurvatures<Curvature::MEAN, Curvature::GAUSSIAN>(p)[1] is the Gaussian curvature.
+	template <Curvature... Cs> static std::vector<std::vector<double>> GetVertexCurvatures(Polyhedron* p);
+
+	// One curvature at the vertex of a corner, with its kernel fixed at compile time.
+	template <Curvature C> static double ComputeCurvature(Corner& c);
+
+	// Recompute the curvatures at the given vertices only, after Polyhedron::Update() returned them.
+	// values is what GetVertexCurvatures() returned for the same curvatures, and is changed in place.
+	static void UpdateVertexCurvatures(Polyhedron* p, const std::vector<int>& vertices, const std::vector<Curvature>& curvatures,
+		std::vector<std::vector<double>>& values);
+	template <Curvature... Cs>
+	static void UpdateVertexCurvatures(Polyhedron* p, const std::vector<int>& vertices, std::vector<std::vector<double>>& values);
+
+	// The first corner of each vertex in corner order, or NULL for a vertex without corners.
+	static std::vector<Corner*> GetFirstCorners(Polyhedron* p);
+
+	// The same for vertex i: the corner of its lowest triangle.
+	static Corner* GetFirstCorner(Polyhedron* p, int i);
+
 
 	/********* CURVATURE *********/
 
 	// Given a corner, compute the area of the Voronoi region containing the vertex corresponding to the corner.
+	// On a boundary, the part of it inside the triangles of the vertex.
 	static double ComputeMixedArea(Corner& c);
 
 	// Given a corner, compute the perimeter of the Voronoi region containing the vertex corresponding to the corner.
+	// On a boundary, without the parts along the boundary edges.
 	static double ComputeMixedPerimeter(Corner& c);
 
 	// Compute the angle between the max/min principal distortions.
@@ -96,12 +139,165 @@ public:
 
 	static Edge* GetEdge(Triangle* t0, Triangle* t1);
 
+
+	/********* COMPACT MESH *********/
+	// The same measures on a CompactMesh, for every Curvature.
+	// They visit the corners in the same order as the Polyhedron versions, so both give the same values on the same mesh.
+	// Vertices on a boundary get 0 for the measures that need a closed star.
+
+	static std::vector<double> GetVertexCurvatures(const CompactMesh& m, Curvature curvature);
+	static std::vector<std::vector<double>> GetVertexCurvatures(const CompactMesh& m, const std::vector<Curvature>& curvatures);
+	template <Curvature... Cs> static std::vector<std::vector<double>> GetVertexCurvatures(const CompactMesh& m);
+	static double GetVertexCurvature(const CompactMesh& m, int32_t v, Curvature curvature);
+
+	// The first corner of each vertex in corner order, the lowest one in its fan, or -1 for a vertex without corners.
+	static std::vector<int32_t> GetFirstCorners(const CompactMesh& m);
+
+	// Get the triangles of the star of a vertex, in the order of GetVertexStar(Vert*). Empty on a boundary.
+	static std::vector<int32_t> GetVertexStar(const CompactMesh& m, int32_t v);
+
+	static double ComputeMixedArea(const CompactMesh& m, int32_t c);
+	static double ComputeMixedPerimeter(const CompactMesh& m, int32_t c);
+
 private:
 
+	// Fill in the terms in needs (a set of CurvatureTerms::Needs) at the vertex of corner c.
+	static void GatherTerms(int needs, Corner& c, CurvatureTerms& terms);
+	static void GatherTerms(int needs, const CompactMesh& m, int32_t c, CurvatureTerms& terms);
+
+	// Run evaluate(terms, values) at every vertex for which gather(i, terms) is true, split over the threads,
+	// and return values[k] of vertex i in result[k][i]. The other vertices get the max.
+	template <typename Gather, typename Evaluate>
+	static std::vector<std::vector<double>> RunKernels(int numVertices, int numCurvatures, Gather gather, Evaluate evaluate);
+
+	// The same for the vertices in the list only, writing into the existing curvatures[k][i].
+	template <typename Gather, typename Evaluate>
+	static void RunKernels(const std::vector<int>& vertices, Gather gather, Evaluate evaluate, std::vector<std::vector<double>>& curvatures);
+
+	// Length and dihedral angle of each of the edges, with their angles computed in one Dihedral batch.
+	static void ComputeEdgeGeometry(Edge* const* edges, int count);
+
+	// Walk the star of the vertex of c once, reading the cached dihedral angles. Returns false if the vertex is on a boundary.
+	static bool ComputeStarDistortion(Corner& c, StarDistortion& distortion);
+
+	// Mean curvature normal at the vertex of c, from the cached cotangents and mixed area. 0 on a boundary.
+	static glm::dvec3 ComputeMeanCurvatureVector(Corner& c);
+
+	// Sum of the unsigned angles between consecutive normals around the closed star of the vertex of c,
+	// starting with the pair of the last and first triangles, from the cached dihedral angles.
+	static double ComputeNormalTurning(Corner& c);
+
+	// Returns false if the vertex is on a boundary.
+	static bool ComputeStarDistortion(const CompactMesh& m, int32_t v, StarDistortion& distortion);
+
+	static glm::dvec3 ComputeMeanCurvatureVector(const CompactMesh& m, int32_t c, double mixedArea);
+	static double ComputeNormalTurning(const CompactMesh& m, int32_t c);
+
 	MeshAnalysis();
 	~MeshAnalysis();
 
 	float static InverseLerp(float start, float end, float v);
-	static double MeanCurvatureWeight(double theta, double phi);
 
 };
+
+template <Curvature... Cs>
+std::vector<std::vector<double>> MeshAnalysis::GetVertexCurvatures(Polyhedron* p)
+{
+	const int needs = CurvatureKernels::Needs<Cs...>();
+	std::vector<Corner*> corners = GetFirstCorners(p);
+	return RunKernels(corners.size(), sizeof...(Cs),
+		[&](int i, CurvatureTerms& terms)
+		{
+			if (corners[i] == NULL)
+				return false;
+			GatherTerms(needs, *corners[i], terms);
+			return true;
+		},
+		[](const CurvatureTerms& terms, double* values) { CurvatureKernels::Compute<Cs...>(terms, values); });
+}
+
+template <Curvature... Cs>
+std::vector<std::vector<double>> MeshAnalysis::GetVertexCurvatures(const CompactMesh& m)
+{
+	const int needs = CurvatureKernels::Needs<Cs...>();
+	std::vector<int32_t> corners = GetFirstCorners(m);
+	return RunKernels(corners.size(), sizeof...(Cs),
+		[&](int i, CurvatureTerms& terms)
+		{
+			if (corners[i] < 0)
+				return false;
+			GatherTerms(needs, m, corners[i], terms);
+			return true;
+		},
+		[](const CurvatureTerms& terms, double* values) { CurvatureKernels::Compute<Cs...>(terms, values); });
+}
+
+template <Curvature... Cs>
+void MeshAnalysis::UpdateVertexCurvatures(Polyhedron* p, const std::vector<int>& vertices, std::vector<std::vector<double>>& values)
+{
+	const int needs = CurvatureKernels::Needs<Cs...>();
+	RunKernels(vertices,
+		[&](int i, CurvatureTerms& terms)
+		{
+			Corner* c = GetFirstCorner(p, i);
+			if (c == NULL)
+				return false;
+			GatherTerms(needs, *c, terms);
+			return true;
+		},
+		[](const CurvatureTerms& terms, double* values) { CurvatureKernels::Compute<Cs...>(terms, values); },
+		values);
+}
+
+template <Curvature C>
+double MeshAnalysis::ComputeCurvature(Corner& c)
+{
+	CurvatureTerms terms;
+	GatherTerms(CurvatureKernel<C>::NEEDS, c, terms);
+	return CurvatureKernel<C>::Compute(terms);
+}
+
+template <typename Gather, typename Evaluate>
+std::vector<std::vector<double>> MeshAnalysis::RunKernels(int numVertices, int numCurvatures, Gather gather, Evaluate evaluate)
+{
+	std::vector<std::vector<double>> curvatures(numCurvatures, std::vector<double>(numVertices, std::numeric_limits<double>::max()));
+	const int BLOCK_SIZE = 1024;
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<double> values(numCurvatures);
+		for (int i = begin; i < end; ++i)
+		{
+			CurvatureTerms terms;
+			if (!gather(i, terms))
+				continue;
+			evaluate(terms, values.data());
+			for (int k = 0; k < numCurvatures; ++k)
+			{
+				curvatures[k][i] = values[k];
+			}
+		}
+	});
+	return curvatures;
+}
+
+template <typename Gather, typename Evaluate>
+void MeshAnalysis::RunKernels(const std::vector<int>& vertices, Gather gather, Evaluate evaluate, std::vector<std::vector<double>>& curvatures)
+{
+	const int BLOCK_SIZE = 1024;
+	Parallel::ForBlocks(vertices.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<double> values(curvatures.size());
+		for (int j = begin; j < end; ++j)
+		{
+			int i = vertices[j];
+			CurvatureTerms terms;
+			if (!gather(i, terms))
+				continue;
+			evaluate(terms, values.data());
+			for (int k = 0; k < curvatures.size(); ++k)
+			{
+				curvatures[k][i] = values[k];
+			}
+		}
+	});
+}
@@ -0,0 +1,472 @@
+#include "meshcache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+const char MeshCache::MAGIC[8] = { 'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H' };
+
+std::string MeshCache::GetCachePath(const std::string& source, int subdivisions)
+{
+	if (subdivisions > 0)
+		return source + ".loop" + std::to_string(subdivisions) + ".cache";
+	return source + ".cache";
+}
+
+IOResult MeshCache::HashFile(const std::string& file, uint64_t& hash)
+{
+	MappedFile mapping;
+	if (!mapping.Open(file))
+	{
+		return IOResult::Error(mapping.error);
+	}
+
+	// Hash fixed-size blocks in parallel, eight bytes at a time, then hash the block hashes together.
+	// The blocks do not depend on the number of threads, so neither does the hash.
+	const size_t BLOCK_SIZE = 16 << 20;
+	const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+	const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+	auto mix = [&](uint64_t h, uint64_t word) -> uint64_t
+	{
+		h += word * PRIME2;
+		h = (h << 31) | (h >> 33);
+		return h * PRIME1;
+	};
+
+	const char* data = mapping.Data();
+	size_t size = mapping.Size();
+	int numBlocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<uint64_t> blockHashes(numBlocks);
+	Parallel::For(numBlocks, [&](int i)
+	{
+		const char* block = data + i * BLOCK_SIZE;
+		size_t length = std::min(BLOCK_SIZE, size - i * BLOCK_SIZE);
+
+		// Four independent lanes keep the multiplier busy.
+		uint64_t lanes[4] = { PRIME1, PRIME2, 0, (uint64_t)i };
+		size_t j = 0;
+		for (; j + 32 <= length; j += 32)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				uint64_t word;
+				memcpy(&word, block + j + 8 * k, 8);
+				lanes[k] = mix(lanes[k], word);
+			}
+		}
+		for (; j < length; ++j)
+		{
+			lanes[0] = mix(lanes[0], (unsigned char)block[j]);
+		}
+		blockHashes[i] = mix(mix(mix(lanes[0], lanes[1]), lanes[2]), lanes[3]);
+	});
+
+	hash = mix(PRIME1, size);
+	for (uint64_t blockHash : blockHashes)
+	{
+		hash = mix(hash, blockHash);
+	}
+	return IOResult::Ok();
+}
+
+IOResult MeshCache::Save(const std::string& file, Polyhedron& p, uint64_t sourceHash, int subdivisions)
+{
+	int numVertices = p.vlist.size();
+	int numEdges = p.elist.size();
+	int numTriangles = p.tlist.size();
+	if (p.clist.size() != 3 * numTriangles || (numTriangles > 0 && p.clist[0].t == NULL))
+	{
+		return IOResult::Error("CANNOT CACHE A POLYHEDRON THAT IS NOT INITIALIZED.");
+	}
+	const Corner* corners = p.clist.data();
+
+	// Flatten the pointers into indices.
+	std::vector<double> positions(3 * numVertices);
+	std::vector<double> vertexNormals(3 * numVertices);
+	std::vector<double> vertexAngles(numVertices);
+	std::vector<int32_t> vertexValences(numVertices);
+	std::vector<int32_t> vertexCorners(numVertices);
+	std::vector<int32_t> vertexTriangleOffsets(numVertices + 1, 0);
+	std::vector<int32_t> vertexTriangles;
+	for (int i = 0; i < numVertices; ++i)
+	{
+		Vert& v = p.vlist[i];
+		positions[3 * i] = v.x;
+		positions[3 * i + 1] = v.y;
+		positions[3 * i + 2] = v.z;
+		for (int k = 0; k < 3; ++k)
+		{
+			vertexNormals[3 * i + k] = v.normal[k];
+		}
+		vertexAngles[i] = v.totalAngle;
+		vertexValences[i] = v.valence;
+
+		// Vert::c is only set for vertices that are in a triangle.
+		vertexCorners[i] = v.triangles.empty() ? -1 : v.c - corners;
+		for (Triangle* t : v.triangles)
+		{
+			vertexTriangles.push_back(t->index);
+		}
+		vertexTriangleOffsets[i + 1] = vertexTriangles.size();
+	}
+
+	std::vector<int32_t> triangleVertices(3 * numTriangles);
+	std::vector<int32_t> triangleEdges(3 * numTriangles);
+	std::vector<double> triangleNormals(3 * numTriangles);
+	std::vector<double> triangleAreas(numTriangles);
+	for (int i = 0; i < numTriangles; ++i)
+	{
+		Triangle& t = p.tlist[i];
+		for (int k = 0; k < 3; ++k)
+		{
+			triangleVertices[3 * i + k] = t.vertices[k]->index;
+			triangleEdges[3 * i + k] = t.edges[k]->index;
+			triangleNormals[3 * i + k] = t.normal[k];
+		}
+		triangleAreas[i] = t.area;
+	}
+
+	std::vector<int32_t> edgeVertices(2 * numEdges);
+	std::vector<int32_t> edgeTriangleOffsets(numEdges + 1, 0);
+	std::vector<int32_t> edgeTriangles;
+	for (int i = 0; i < numEdges; ++i)
+	{
+		Edge& e = p.elist[i];
+		edgeVertices[2 * i] = e.vertices[0]->index;
+		edgeVertices[2 * i + 1] = e.vertices[1]->index;
+		for (Triangle* t : e.triangles)
+		{
+			edgeTriangles.push_back(t->index);
+		}
+		edgeTriangleOffsets[i + 1] = edgeTriangles.size();
+	}
+
+	std::vector<int32_t> cornerEdges(3 * numTriangles);
+	std::vector<int32_t> cornerOpposites(3 * numTriangles);
+	std::vector<double> cornerAngles(3 * numTriangles);
+	for (int i = 0; i < 3 * numTriangles; ++i)
+	{
+		const Corner& c = corners[i];
+		cornerEdges[i] = c.e->index;
+		cornerOpposites[i] = (c.o != NULL) ? c.o - corners : -1;
+		cornerAngles[i] = c.angle;
+	}
+
+	// Header.
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.subdivisions = subdivisions;
+	header.sourceHash = sourceHash;
+	header.numVertices = numVertices;
+	header.numEdges = numEdges;
+	header.numTriangles = numTriangles;
+	header.valenceDeficit = p.valenceDeficit;
+	header.surfaceArea = p.surfaceArea;
+	header.angleDeficit = p.angleDeficit;
+	header.radius = p.radius;
+	for (int k = 0; k < 3; ++k)
+	{
+		header.center[k] = p.center[k];
+	}
+	header.orientation = p.orientation;
+
+	// Lay the sections out after the header, each on an 8-byte boundary.
+	const void* sections[NUMBER_OF_SECTIONS] = {
+		positions.data(), vertexNormals.data(), vertexAngles.data(), vertexValences.data(), vertexCorners.data(),
+		vertexTriangleOffsets.data(), vertexTriangles.data(),
+		triangleVertices.data(), triangleEdges.data(), triangleNormals.data(), triangleAreas.data(),
+		edgeVertices.data(), edgeTriangleOffsets.data(), edgeTriangles.data(),
+		cornerEdges.data(), cornerOpposites.data(), cornerAngles.data()
+	};
+	header.sizes[POSITIONS] = positions.size() * sizeof(double);
+	header.sizes[VERTEX_NORMALS] = vertexNormals.size() * sizeof(double);
+	header.sizes[VERTEX_ANGLES] = vertexAngles.size() * sizeof(double);
+	header.sizes[VERTEX_VALENCES] = vertexValences.size() * sizeof(int32_t);
+	header.sizes[VERTEX_CORNERS] = vertexCorners.size() * sizeof(int32_t);
+	header.sizes[VERTEX_TRIANGLE_OFFSETS] = vertexTriangleOffsets.size() * sizeof(int32_t);
+	header.sizes[VERTEX_TRIANGLES] = vertexTriangles.size() * sizeof(int32_t);
+	header.sizes[TRIANGLE_VERTICES] = triangleVertices.size() * sizeof(int32_t);
+	header.sizes[TRIANGLE_EDGES] = triangleEdges.size() * sizeof(int32_t);
+	header.sizes[TRIANGLE_NORMALS] = triangleNormals.size() * sizeof(double);
+	header.sizes[TRIANGLE_AREAS] = triangleAreas.size() * sizeof(double);
+	header.sizes[EDGE_VERTICES] = edgeVertices.size() * sizeof(int32_t);
+	header.sizes[EDGE_TRIANGLE_OFFSETS] = edgeTriangleOffsets.size() * sizeof(int32_t);
+	header.sizes[EDGE_TRIANGLES] = edgeTriangles.size() * sizeof(int32_t);
+	header.sizes[CORNER_EDGES] = cornerEdges.size() * sizeof(int32_t);
+	header.sizes[CORNER_OPPOSITES] = cornerOpposites.size() * sizeof(int32_t);
+	header.sizes[CORNER_ANGLES] = cornerAngles.size() * sizeof(double);
+
+	uint64_t offset = (sizeof(Header) + 7) & ~7ULL;
+	for (int s = 0; s < NUMBER_OF_SECTIONS; ++s)
+	{
+		header.offsets[s] = offset;
+		offset = (offset + header.sizes[s] + 7) & ~7ULL;
+	}
+
+	// Write under a temporary name, then move it into place.
+	std::string temporary = file + ".tmp";
+	std::ofstream f(temporary, std::ios::binary | std::ios::trunc);
+	const char padding[8] = { 0 };
+	f.write((const char*)&header, sizeof(header));
+	uint64_t written = sizeof(header);
+	for (int s = 0; s < NUMBER_OF_SECTIONS; ++s)
+	{
+		f.write(padding, header.offsets[s] - written);
+		f.write((const char*)sections[s], header.sizes[s]);
+		written = header.offsets[s] + header.sizes[s];
+	}
+	f.close();
+	if (!f || std::rename(temporary.c_str(), file.c_str()) != 0)
+	{
+		std::remove(temporary.c_str());
+		return IOResult::Error("CACHE COULD NOT BE WRITTEN: " + file);
+	}
+	return IOResult::Ok();
+}
+
+IOResult MeshCache::Load(const std::string& file, Polyhedron& p, uint64_t sourceHash, int subdivisions)
+{
+	MappedFile mapping;
+	if (!mapping.Open(file))
+	{
+		return IOResult::Error(mapping.error);
+	}
+	if (mapping.Size() < sizeof(Header))
+	{
+		return IOResult::Error(file + ": NOT A MESH CACHE.");
+	}
+
+	Header header;
+	memcpy(&header, mapping.Data(), sizeof(header));
+	IOResult result = CheckHeader(header, mapping.Size(), sourceHash, subdivisions);
+	if (result.success)
+	{
+		result = Build(header, mapping.Data(), p);
+	}
+	if (!result.success)
+	{
+		return IOResult::Error(file + ": " + result.message);
+	}
+	return IOResult::Ok();
+}
+
+IOResult MeshCache::CheckHeader(const Header& header, size_t fileSize, uint64_t sourceHash, int subdivisions)
+{
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+		return IOResult::Error("NOT A MESH CACHE.");
+	if (header.version != VERSION)
+		return IOResult::Error("CACHE VERSION " + std::to_string(header.version) + " IS NOT THE CURRENT VERSION " + std::to_string(VERSION) + ".");
+	if (header.sourceHash != sourceHash)
+		return IOResult::Error("CACHE IS OUT OF DATE: THE SOURCE FILE HAS CHANGED.");
+	if (header.subdivisions != subdivisions)
+		return IOResult::Error("CACHE IS FOR " + std::to_string(header.subdivisions) + " SUBDIVISIONS, NOT " + std::to_string(subdivisions) + ".");
+	if (header.numVertices < 0 || header.numEdges < 0 || header.numTriangles < 0)
+		return IOResult::Error("CACHE IS DAMAGED.");
+	if (header.orientation != 1.0 && header.orientation != -1.0)
+		return IOResult::Error("CACHE IS DAMAGED.");
+
+	// Every section has to be inside the file, and the fixed-length ones have to have the right length.
+	uint64_t V = header.numVertices;
+	uint64_t E = header.numEdges;
+	uint64_t T = header.numTriangles;
+	uint64_t expected[NUMBER_OF_SECTIONS] = {
+		3 * V * sizeof(double), 3 * V * sizeof(double), V * sizeof(double), V * sizeof(int32_t), V * sizeof(int32_t),
+		(V + 1) * sizeof(int32_t), 0,
+		3 * T * sizeof(int32_t), 3 * T * sizeof(int32_t), 3 * T * sizeof(double), T * sizeof(double),
+		2 * E * sizeof(int32_t), (E + 1) * sizeof(int32_t), 0,
+		3 * T * sizeof(int32_t), 3 * T * sizeof(int32_t), 3 * T * sizeof(double)
+	};
+	for (int s = 0; s < NUMBER_OF_SECTIONS; ++s)
+	{
+		bool inside = header.offsets[s] % 8 == 0 && header.offsets[s] <= fileSize && header.sizes[s] <= fileSize - header.offsets[s];
+		bool length = (expected[s] > 0) ? header.sizes[s] == expected[s] : header.sizes[s] % sizeof(int32_t) == 0;
+		if (!inside || !length)
+			return IOResult::Error("CACHE IS DAMAGED.");
+	}
+	return IOResult::Ok();
+}
+
+IOResult MeshCache::Build(const Header& header, const char* data, Polyhedron& p)
+{
+	int numVertices = header.numVertices;
+	int numEdges = header.numEdges;
+	int numTriangles = header.numTriangles;
+	int numCorners = 3 * numTriangles;
+
+	const double* positions = (const double*)GetSection(header, data, POSITIONS);
+	const double* vertexNormals = (const double*)GetSection(header, data, VERTEX_NORMALS);
+	const double* vertexAngles = (const double*)GetSection(header, data, VERTEX_ANGLES);
+	const int32_t* vertexValences = (const int32_t*)GetSection(header, data, VERTEX_VALENCES);
+	const int32_t* vertexCorners = (const int32_t*)GetSection(header, data, VERTEX_CORNERS);
+	const int32_t* vertexTriangleOffsets = (const int32_t*)GetSection(header, data, VERTEX_TRIANGLE_OFFSETS);
+	const int32_t* vertexTriangles = (const int32_t*)GetSection(header, data, VERTEX_TRIANGLES);
+	const int32_t* triangleVertices = (const int32_t*)GetSection(header, data, TRIANGLE_VERTICES);
+	const int32_t* triangleEdges = (const int32_t*)GetSection(header, data, TRIANGLE_EDGES);
+	const double* triangleNormals = (const double*)GetSection(header, data, TRIANGLE_NORMALS);
+	const double* triangleAreas = (const double*)GetSection(header, data, TRIANGLE_AREAS);
+	const int32_t* edgeVertices = (const int32_t*)GetSection(header, data, EDGE_VERTICES);
+	const int32_t* edgeTriangleOffsets = (const int32_t*)GetSection(header, data, EDGE_TRIANGLE_OFFSETS);
+	const int32_t* edgeTriangles = (const int32_t*)GetSection(header, data, EDGE_TRIANGLES);
+	const int32_t* cornerEdges = (const int32_t*)GetSection(header, data, CORNER_EDGES);
+	const int32_t* cornerOpposites = (const int32_t*)GetSection(header, data, CORNER_OPPOSITES);
+	const double* cornerAngles = (const double*)GetSection(header, data, CORNER_ANGLES);
+
+	// A damaged cache must not turn into wild pointers: check every index before using it.
+	size_t numVertexTriangles = header.sizes[VERTEX_TRIANGLES] / sizeof(int32_t);
+	size_t numEdgeTriangles = header.sizes[EDGE_TRIANGLES] / sizeof(int32_t);
+	bool valid = InRange(vertexCorners, numVertices, -1, numCorners)
+		&& InRange(vertexTriangleOffsets, numVertices + 1, 0, numVertexTriangles + 1)
+		&& vertexTriangleOffsets[numVertices] == numVertexTriangles
+		&& InRange(vertexTriangles, numVertexTriangles, 0, numTriangles)
+		&& InRange(triangleVertices, numCorners, 0, numVertices)
+		&& InRange(triangleEdges, numCorners, 0, numEdges)
+		&& InRange(edgeVertices, 2 * numEdges, 0, numVertices)
+		&& InRange(edgeTriangleOffsets, numEdges + 1, 0, numEdgeTriangles + 1)
+		&& edgeTriangleOffsets[numEdges] == numEdgeTriangles
+		&& InRange(edgeTriangles, numEdgeTriangles, 0, numTriangles)
+		&& InRange(cornerEdges, numCorners, 0, numEdges)
+		&& InRange(cornerOpposites, numCorners, -1, numCorners);
+	for (int i = 0; valid && i < numVertices; ++i)
+	{
+		valid = vertexTriangleOffsets[i] <= vertexTriangleOffsets[i + 1];
+	}
+	for (int i = 0; valid && i < numEdges; ++i)
+	{
+		valid = edgeTriangleOffsets[i] <= edgeTriangleOffsets[i + 1];
+	}
+	if (!valid)
+	{
+		return IOResult::Error("CACHE IS DAMAGED.");
+	}
+
+	// Size every list once, so the pointers set below stay valid; then fill the lists in parallel.
+	p.vlist.clear();
+	p.elist.clear();
+	p.tlist.clear();
+	p.clist.clear();
+	p.vertexProperties.clear();
+	p.texCoords.clear();
+	p.normals.clear();
+	p.cornerTexCoords.clear();
+	p.cornerNormals.clear();
+	p.vlist.resize(numVertices);
+	p.elist.resize(numEdges);
+	p.tlist.resize(numTriangles);
+	p.clist.resize(numCorners);
+
+	// The arena hands out the triangle lists one after the other, so size them all before the parallel fill.
+	p.CreateArena(numVertexTriangles + numEdgeTriangles);
+	for (int i = 0; i < numVertices; ++i)
+	{
+		p.AttachToArena(p.vlist[i].triangles, vertexTriangleOffsets[i + 1] - vertexTriangleOffsets[i]);
+		p.vlist[i].triangles.resize(vertexTriangleOffsets[i + 1] - vertexTriangleOffsets[i]);
+	}
+	for (int i = 0; i < numEdges; ++i)
+	{
+		p.AttachToArena(p.elist[i].triangles, edgeTriangleOffsets[i + 1] - edgeTriangleOffsets[i]);
+		p.elist[i].triangles.resize(edgeTriangleOffsets[i + 1] - edgeTriangleOffsets[i]);
+	}
+
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = p.vlist[i];
+			v.index = i;
+			v.x = positions[3 * i];
+			v.y = positions[3 * i + 1];
+			v.z = positions[3 * i + 2];
+			v.normal = glm::dvec3(vertexNormals[3 * i], vertexNormals[3 * i + 1], vertexNormals[3 * i + 2]);
+			v.totalAngle = vertexAngles[i];
+			v.valence = vertexValences[i];
+			v.c = (vertexCorners[i] >= 0) ? &p.clist[vertexCorners[i]] : NULL;
+			for (int j = 0; j < v.triangles.size(); ++j)
+			{
+				v.triangles[j] = &p.tlist[vertexTriangles[vertexTriangleOffsets[i] + j]];
+			}
+		}
+	});
+
+	Parallel::ForBlocks(numTriangles, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = p.tlist[i];
+			t.index = i;
+			for (int k = 0; k < 3; ++k)
+			{
+				t.vertices[k] = &p.vlist[triangleVertices[3 * i + k]];
+				t.edges[k] = &p.elist[triangleEdges[3 * i + k]];
+			}
+			t.normal = glm::dvec3(triangleNormals[3 * i], triangleNormals[3 * i + 1], triangleNormals[3 * i + 2]);
+			t.area = triangleAreas[i];
+		}
+	});
+
+	Parallel::ForBlocks(numEdges, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Edge& e = p.elist[i];
+			e.index = i;
+			e.vertices[0] = &p.vlist[edgeVertices[2 * i]];
+			e.vertices[1] = &p.vlist[edgeVertices[2 * i + 1]];
+			for (int j = 0; j < e.triangles.size(); ++j)
+			{
+				e.triangles[j] = &p.tlist[edgeTriangles[edgeTriangleOffsets[i] + j]];
+			}
+		}
+	});
+
+	// The corner of vertex k in triangle t is 3t + k, as MeshAnalysis::GetCornerList() numbers them.
+	Parallel::ForBlocks(numCorners, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Corner& c = p.clist[i];
+			int t = i / 3;
+			int k = i % 3;
+			c.index = i;
+			c.t = &p.tlist[t];
+			c.v = c.t->vertices[k];
+			c.e = &p.elist[cornerEdges[i]];
+			c.n = &p.clist[3 * t + (k + 1) % 3];
+			c.p = &p.clist[3 * t + (k + 2) % 3];
+			c.o = (cornerOpposites[i] >= 0) ? &p.clist[cornerOpposites[i]] : NULL;
+			c.angle = cornerAngles[i];
+		}
+	});
+
+	p.valenceDeficit = header.valenceDeficit;
+	p.surfaceArea = header.surfaceArea;
+	p.angleDeficit = header.angleDeficit;
+	p.radius = header.radius;
+	p.center = glm::dvec3(header.center[0], header.center[1], header.center[2]);
+	p.orientation = header.orientation;
+
+	// Cheaper to recompute from what was loaded than to store.
+	MeshAnalysis::GetBoundaryCorners(&p);
+	MeshAnalysis::ComputeCurvatureGeometry(&p);
+	return IOResult::Ok();
+}
+
+const void* MeshCache::GetSection(const Header& header, const char* data, Section section)
+{
+	return data + header.offsets[section];
+}
+
+bool MeshCache::InRange(const int32_t* values, size_t count, int min, int max)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (values[i] < min || values[i] >= max)
+			return false;
+	}
+	return true;
+}
+
+MeshCache::MeshCache() {}
+MeshCache::~MeshCache() {}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "utilities.hpp"
+#include "mappedfile.hpp"
+#include "parallel.hpp"
+#include "polyhedron.hpp"
+
+/** Binary cache of an initialized polyhedron.
+ *
+ * Loading a mesh means parsing the file and then running Polyhedron::Initialize(), which rebuilds edges, corners,
+ * valences and angles, and SubdivideMesh() builds the same again at every level. A cache file stores the result instead:
+ * positions, normals, areas and angles, and every pointer of the adjacency structure as an integer index.
+ * Loading a cache only has to turn those indices back into pointers.
+ *
+ * The file is a fixed header followed by flat arrays, each starting on an 8-byte boundary, in the byte order of the
+ * machine that wrote it. The header records the format version, the hash of the source mesh file and the number of
+ * subdivisions applied to it, so a cache goes stale as soon as the source file changes.
+ * The vertex properties and .obj attributes of the source file are not cached.
+ */
+class MeshCache
+{
+
+public:
+
+	// Bump whenever the layout below changes; older caches are then rebuilt.
+	// 2: Vert::triangles is in fan order, not triangle order.
+	// 3: the header holds Polyhedron::orientation.
+	static const uint32_t VERSION = 3;
+
+	// Where the cache of a source file, subdivided the given number of times, is kept: next to the source.
+	static std::string GetCachePath(const std::string& source, int subdivisions);
+
+	// Hash the contents of a file.
+	static IOResult HashFile(const std::string& file, uint64_t& hash);
+
+	// Write an initialized polyhedron to a cache file.
+	// The file is written under a temporary name and then renamed, so a reader never sees half a cache.
+	static IOResult Save(const std::string& file, Polyhedron& p, uint64_t sourceHash, int subdivisions);
+
+	// Read a cache file into an empty polyhedron, which is then ready to use without Initialize().
+	// Fails if the file is not a cache of this version, or was made from a different source or number of subdivisions.
+	static IOResult Load(const std::string& file, Polyhedron& p, uint64_t sourceHash, int subdivisions);
+
+private:
+
+	// The arrays of the file, in order.
+	enum Section
+	{
+		POSITIONS,               // double, 3 per vertex
+		VERTEX_NORMALS,          // double, 3 per vertex
+		VERTEX_ANGLES,           // double, total angle per vertex
+		VERTEX_VALENCES,         // int
+		VERTEX_CORNERS,          // int, Vert::c or -1
+		VERTEX_TRIANGLE_OFFSETS, // int, one more than the vertices: Vert::triangles of vertex i is [offsets[i], offsets[i+1])
+		VERTEX_TRIANGLES,        // int
+		TRIANGLE_VERTICES,       // int, 3 per triangle
+		TRIANGLE_EDGES,          // int, 3 per triangle
+		TRIANGLE_NORMALS,        // double, 3 per triangle
+		TRIANGLE_AREAS,          // double
+		EDGE_VERTICES,           // int, 2 per edge
+		EDGE_TRIANGLE_OFFSETS,   // int, one more than the edges
+		EDGE_TRIANGLES,          // int
+		CORNER_EDGES,            // int, Corner::e
+		CORNER_OPPOSITES,        // int, Corner::o or -1
+		CORNER_ANGLES,           // double
+		NUMBER_OF_SECTIONS
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		int32_t subdivisions;
+		uint64_t sourceHash;
+
+		int32_t numVertices;
+		int32_t numEdges;
+		int32_t numTriangles;
+		int32_t valenceDeficit;
+		double surfaceArea;
+		double angleDeficit;
+		double radius;
+		double center[3];
+		double orientation;
+
+		// Byte offset and length of each section.
+		uint64_t offsets[NUMBER_OF_SECTIONS];
+		uint64_t sizes[NUMBER_OF_SECTIONS];
+	};
+
+	static const char MAGIC[8];
+
+	// Check the header against the file and what the caller asked for.
+	static IOResult CheckHeader(const Header& header, size_t fileSize, uint64_t sourceHash, int subdivisions);
+
+	// Create the vertices, edges, triangles and corners from the arrays of a mapped cache.
+	static IOResult Build(const Header& header, const char* data, Polyhedron& p);
+
+	// Start of a section in the mapped file.
+	static const void* GetSection(const Header& header, const char* data, Section section);
+
+	// True if every value is in [min, max).
+	static bool InRange(const int32_t* values, size_t count, int min, int max);
+
+	MeshCache();
+	~MeshCache();
+
+};
@@ -215,6 +215,37 @@ MeshComponent::MeshComponent(Polyhedron* p, std::vector<double>& values, Curvatu
 	this->vertices = vertices;
 	this->triangles = triangles;
 	this->transform = glm::mat4(1);
+	this->colored = true;
+	this->signedColors = (countNegative > 0);
+	this->minNegative = minNegative;
+	this->maxPositive = maxPositive;
+	this->meanNegative = meanNegative;
+	this->meanPositive = meanPositive;
+}
+
+void MeshComponent::UpdateVertices(Polyhedron* p, const std::vector<int>& indices)
+{
+	for (int i : indices)
+	{
+		Vert& current = p->vlist[i];
+		vertices[i].setPosition((float)current.x, (float)current.y, (float)current.z);
+		vertices[i].setNormal((float)current.normal.x, (float)current.normal.y, (float)current.normal.z);
+	}
+}
+
+void MeshComponent::UpdateVertices(Polyhedron* p, const std::vector<int>& indices, std::vector<double>& values)
+{
+	UpdateVertices(p, indices);
+	if (!colored)
+		return;
+
+	for (int i : indices)
+	{
+		if (signedColors)
+			vertices[i].setColor(InterpolateSignedColor(minNegative, maxPositive, meanNegative, meanPositive, values[i]));
+		else
+			vertices[i].setColor(InterpolateColor(0, maxPositive, meanPositive, values[i]));
+	}
 }
 
 // Blind copy.
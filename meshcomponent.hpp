@@ -33,6 +33,12 @@ public:
 	glm::vec4 InterpolateSignedColor(double minNegative, double maxPositive, double meanNegative, double meanPositive, double value);
 	glm::vec4 InterpolateColor(double min, double max, double mean, double value);
 
+	// Copy the positions and normals of the given vertices from p again, after Polyhedron::Update() moved them,
+	// and with values, recolor them. The colors keep the scale of the values the component was built from,
+	// so the rest of the mesh keeps its colors. Loader::UpdateVertices() then patches the GPU buffer.
+	void UpdateVertices(Polyhedron* p, const std::vector<int>& indices);
+	void UpdateVertices(Polyhedron* p, const std::vector<int>& indices, std::vector<double>& values);
+
 	// getters/setters:
 	uint getVAO();
 	uint getVBO();
@@ -55,6 +61,14 @@ private:
 	std::vector<Vertex> vertices;
 	std::vector<uint> triangles;
 
+	// Scale of the values the vertices were colored with, for UpdateVertices().
+	bool colored = false;
+	bool signedColors = false;
+	double minNegative = 0;
+	double maxPositive = 0;
+	double meanNegative = 0;
+	double meanPositive = 0;
+
 	// OpenGL rendering data:
 	uint vaoID;
 	uint vboID; // Vertex data VBO.
@@ -0,0 +1,296 @@
+#include "objfile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+IOResult ObjFile::Read(const std::string& file, Polyhedron& p)
+{
+	MappedFile mapping;
+	if (!mapping.Open(file))
+	{
+		return IOResult::Error(mapping.error);
+	}
+
+	// Several chunks per thread, so that a thread that draws a quick chunk can pick up another.
+	const char* data = mapping.Data();
+	std::vector<size_t> offsets = Tokenizer::SplitLines(data, mapping.Size(), 4 * Parallel::GetNumberOfThreads(), MINIMUM_CHUNK_SIZE);
+	int numChunks = offsets.size() - 1;
+
+	std::vector<Contents> chunks(numChunks);
+	std::vector<IOResult> results(numChunks);
+	std::vector<int> lines(numChunks, 0);
+	Parallel::For(numChunks, [&](int i)
+	{
+		results[i] = Parse(data + offsets[i], offsets[i + 1] - offsets[i], chunks[i], lines[i]);
+	});
+
+	// Report the first error in the file, with its line counted from the start of the file.
+	for (int i = 0; i < numChunks; ++i)
+	{
+		if (!results[i].success)
+		{
+			int line = std::count(data, data + offsets[i], '\n') + lines[i];
+			return IOResult::Error(file + ": LINE " + std::to_string(line) + ": " + results[i].message);
+		}
+	}
+
+	IOResult result = Build(chunks, p);
+	if (!result.success)
+	{
+		return IOResult::Error(file + ": " + result.message);
+	}
+	return IOResult::Ok();
+}
+
+IOResult ObjFile::Write(const std::string& file, const Polyhedron& p)
+{
+	FILE* f = fopen(file.c_str(), "w");
+	if (f == NULL)
+	{
+		return IOResult::Error("FILE COULD NOT BE OPENED: " + file + " (" + strerror(errno) + ")");
+	}
+
+	for (const Vert& v : p.vlist)
+	{
+		fprintf(f, "v %.17g %.17g %.17g\n", v.x, v.y, v.z);
+	}
+	for (const Triangle& t : p.tlist)
+	{
+		fprintf(f, "f %d %d %d\n", t.vertices[0]->index + 1, t.vertices[1]->index + 1, t.vertices[2]->index + 1);
+	}
+
+	bool failed = ferror(f) != 0;
+	if (fclose(f) != 0 || failed)
+	{
+		return IOResult::Error("FILE COULD NOT BE WRITTEN: " + file + " (" + strerror(errno) + ")");
+	}
+	return IOResult::Ok();
+}
+
+IOResult ObjFile::Parse(const char* data, size_t size, Contents& contents, int& line)
+{
+	Tokenizer tokens(data, size);
+	std::vector<FaceVertex> polygon;
+
+	for (line = 1; !tokens.AtEnd(); tokens.NextLine(), ++line)
+	{
+		std::string_view word = tokens.Word();
+		if (word == "v")
+		{
+			// Anything after x, y, z (a w coordinate, or a vertex color) is ignored.
+			double x, y, z;
+			if (!tokens.Number(x) || !tokens.Number(y) || !tokens.Number(z))
+				return IOResult::Error("ERROR READING VERTEX.");
+			contents.positions.push_back(x);
+			contents.positions.push_back(y);
+			contents.positions.push_back(z);
+		}
+		else if (word == "vt")
+		{
+			// v is optional, and w is ignored.
+			double u, v = 0.0;
+			if (!tokens.Number(u))
+				return IOResult::Error("ERROR READING TEXTURE COORDINATE.");
+			tokens.Number(v);
+			contents.texCoords.push_back(glm::vec2(u, v));
+		}
+		else if (word == "vn")
+		{
+			double x, y, z;
+			if (!tokens.Number(x) || !tokens.Number(y) || !tokens.Number(z))
+				return IOResult::Error("ERROR READING NORMAL.");
+			contents.normals.push_back(glm::vec3(x, y, z));
+		}
+		else if (word == "f")
+		{
+			IOResult result = ParseFace(tokens, contents, polygon);
+			if (!result.success)
+				return result;
+		}
+		// Comments, blank lines and all other statements are skipped.
+	}
+	return IOResult::Ok();
+}
+
+IOResult ObjFile::ParseFace(Tokenizer& tokens, Contents& contents, std::vector<FaceVertex>& polygon)
+{
+	int numVertices = contents.positions.size() / 3;
+	int numTexCoords = contents.texCoords.size();
+	int numNormals = contents.normals.size();
+
+	polygon.clear();
+	while (!tokens.AtLineEnd() && tokens.Peek() != '#')
+	{
+		// Index 0 never appears in a .obj file, so it marks a missing vt or vn.
+		int v;
+		int vt = 0;
+		int vn = 0;
+		if (!tokens.Number(v))
+			return IOResult::Error("ERROR READING FACE.");
+		if (tokens.Accept('/'))
+		{
+			if (tokens.Peek() != '/' && !tokens.Number(vt))
+				return IOResult::Error("ERROR READING FACE.");
+			if (tokens.Accept('/') && !tokens.Number(vn))
+				return IOResult::Error("ERROR READING FACE.");
+		}
+
+		FaceVertex corner = { -1, -1, -1, false, false, false };
+		if (!ResolveIndex(v, numVertices, corner.vertex, corner.relativeVertex))
+			return IOResult::Error("FACE INDEX OUT OF RANGE.");
+		if (vt != 0)
+			ResolveIndex(vt, numTexCoords, corner.texCoord, corner.relativeTexCoord);
+		if (vn != 0)
+			ResolveIndex(vn, numNormals, corner.normal, corner.relativeNormal);
+		polygon.push_back(corner);
+	}
+
+	if (polygon.size() < 3)
+		return IOResult::Error("FACE HAS FEWER THAN THREE VERTICES.");
+
+	// Fan triangulation around the first vertex; a triangle is a fan of one.
+	for (int j = 1; j + 1 < polygon.size(); ++j)
+	{
+		for (int k : { 0, j, j + 1 })
+		{
+			const FaceVertex& corner = polygon[k];
+			int index = contents.cornerVertices.size();
+			if (corner.relativeVertex)
+				contents.relativeVertices.push_back(index);
+			if (corner.relativeTexCoord)
+				contents.relativeTexCoords.push_back(index);
+			if (corner.relativeNormal)
+				contents.relativeNormals.push_back(index);
+
+			contents.cornerVertices.push_back(corner.vertex);
+			contents.cornerTexCoords.push_back(corner.texCoord);
+			contents.cornerNormals.push_back(corner.normal);
+		}
+	}
+	return IOResult::Ok();
+}
+
+bool ObjFile::ResolveIndex(int index, int count, int& resolved, bool& relative)
+{
+	relative = (index < 0);
+	resolved = relative ? count + index : index - 1;
+	return index != 0;
+}
+
+IOResult ObjFile::Build(std::vector<Contents>& chunks, Polyhedron& p)
+{
+	int numChunks = chunks.size();
+
+	// Lay the chunks out one after the other.
+	int numVertices = 0;
+	int numTexCoords = 0;
+	int numNormals = 0;
+	int numCorners = 0;
+	for (Contents& chunk : chunks)
+	{
+		chunk.firstVertex = numVertices;
+		chunk.firstTexCoord = numTexCoords;
+		chunk.firstNormal = numNormals;
+		chunk.firstCorner = numCorners;
+		numVertices += chunk.positions.size() / 3;
+		numTexCoords += chunk.texCoords.size();
+		numNormals += chunk.normals.size();
+		numCorners += chunk.cornerVertices.size();
+	}
+
+	// Fix up the negative indices, then check that every index refers to something in the file.
+	// Each chunk records the first triangle with a bad index, or -1.
+	std::vector<int> invalid(numChunks, -1);
+	Parallel::For(numChunks, [&](int i)
+	{
+		// A relative index that still comes out negative points before the start of the file:
+		// make it out of range at the other end, since -1 means "not given".
+		Contents& chunk = chunks[i];
+		for (int corner : chunk.relativeVertices)
+			chunk.cornerVertices[corner] += chunk.firstVertex;
+		for (int corner : chunk.relativeTexCoords)
+		{
+			chunk.cornerTexCoords[corner] += chunk.firstTexCoord;
+			if (chunk.cornerTexCoords[corner] < 0)
+				chunk.cornerTexCoords[corner] = numTexCoords;
+		}
+		for (int corner : chunk.relativeNormals)
+		{
+			chunk.cornerNormals[corner] += chunk.firstNormal;
+			if (chunk.cornerNormals[corner] < 0)
+				chunk.cornerNormals[corner] = numNormals;
+		}
+
+		for (int j = 0; j < chunk.cornerVertices.size() && invalid[i] < 0; ++j)
+		{
+			int vertex = chunk.cornerVertices[j];
+			int texCoord = chunk.cornerTexCoords[j];
+			int normal = chunk.cornerNormals[j];
+			if (vertex < 0 || vertex >= numVertices
+				|| texCoord < -1 || texCoord >= numTexCoords
+				|| normal < -1 || normal >= numNormals)
+			{
+				invalid[i] = (chunk.firstCorner + j) / 3;
+			}
+		}
+	});
+	for (int triangle : invalid)
+	{
+		if (triangle >= 0)
+			return IOResult::Error("FACE INDEX OUT OF RANGE IN TRIANGLE " + std::to_string(triangle) + ".");
+	}
+
+	// Size everything first; the triangles then point into a vlist that no longer moves.
+	// Only keep the per-corner indices if the file had something for them to refer to.
+	p.vlist.clear();
+	p.tlist.clear();
+	p.elist.clear();
+	p.vertexProperties.clear();
+	p.vlist.resize(numVertices);
+	p.tlist.resize(numCorners / 3);
+	p.texCoords.resize(numTexCoords);
+	p.normals.resize(numNormals);
+	p.cornerTexCoords.resize((numTexCoords > 0) ? numCorners : 0);
+	p.cornerNormals.resize((numNormals > 0) ? numCorners : 0);
+
+	Parallel::For(numChunks, [&](int i)
+	{
+		Contents& chunk = chunks[i];
+		for (int j = 0; j < chunk.positions.size() / 3; ++j)
+		{
+			Vert& v = p.vlist[chunk.firstVertex + j];
+			v.x = chunk.positions[3 * j];
+			v.y = chunk.positions[3 * j + 1];
+			v.z = chunk.positions[3 * j + 2];
+			v.index = chunk.firstVertex + j;
+		}
+
+		int firstTriangle = chunk.firstCorner / 3;
+		for (int j = 0; j < chunk.cornerVertices.size() / 3; ++j)
+		{
+			Triangle& t = p.tlist[firstTriangle + j];
+			for (int k = 0; k < 3; ++k)
+			{
+				t.vertices[k] = &p.vlist[chunk.cornerVertices[3 * j + k]];
+			}
+			t.index = firstTriangle + j;
+		}
+
+		std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), p.texCoords.begin() + chunk.firstTexCoord);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), p.normals.begin() + chunk.firstNormal);
+		if (!p.cornerTexCoords.empty())
+			std::copy(chunk.cornerTexCoords.begin(), chunk.cornerTexCoords.end(), p.cornerTexCoords.begin() + chunk.firstCorner);
+		if (!p.cornerNormals.empty())
+			std::copy(chunk.cornerNormals.begin(), chunk.cornerNormals.end(), p.cornerNormals.begin() + chunk.firstCorner);
+	});
+
+	Corner c;
+	p.clist = std::vector<Corner>(3 * p.tlist.size(), c);
+	p.center = glm::dvec3(0.0, 0.0, 0.0);
+	return IOResult::Ok();
+}
+
+ObjFile::ObjFile() {}
+ObjFile::~ObjFile() {}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "utilities.hpp"
+#include "mappedfile.hpp"
+#include "tokenizer.hpp"
+#include "parallel.hpp"
+#include "polyhedron.hpp"
+
+/** Reader for .obj files.
+ *
+ * The file is memory mapped and tokenized in place. Besides "v" and "f" lines, the reader understands:
+ * - "vt" and "vn" lines, which are kept in Polyhedron::texCoords and Polyhedron::normals;
+ * - face vertices written as v, v/vt, v//vn or v/vt/vn;
+ * - negative indices, which count back from the most recent vertex (-1 is the last one read);
+ * - faces with more than three vertices, which are fan triangulated.
+ * Other statements (groups, materials, smoothing, lines, ...) are skipped.
+ *
+ * Large files are cut into chunks at line ends and the chunks are parsed in parallel, each into its own Contents.
+ * The chunks are then stitched together in file order. Positive indices are absolute and need nothing,
+ * but a negative index can only be resolved within its chunk, so those corners are fixed up during the stitch
+ * by adding the number of vertices (texture coordinates, normals) in the chunks before.
+ *
+ * Nothing here terminates the process: problems with the file come back as an IOResult.
+ */
+class ObjFile
+{
+
+public:
+
+	// Read a .obj file into an empty polyhedron.
+	static IOResult Read(const std::string& file, Polyhedron& p);
+
+	// Write the vertices and triangles of a polyhedron as a .obj file, with every digit of the positions.
+	static IOResult Write(const std::string& file, const Polyhedron& p);
+
+private:
+
+	// Everything read from one chunk of the file, before it is turned into a polyhedron.
+	struct Contents
+	{
+		// x, y, z of each vertex.
+		std::vector<double> positions;
+		std::vector<glm::vec2> texCoords;
+		std::vector<glm::vec3> normals;
+
+		// Per triangle corner, zero based: the vertex, and the texture coordinate and normal (-1 if not given).
+		std::vector<int> cornerVertices;
+		std::vector<int> cornerTexCoords;
+		std::vector<int> cornerNormals;
+
+		// Corners that came from negative indices. These are relative to the start of the chunk
+		// until the counts of the chunks before are added.
+		std::vector<int> relativeVertices;
+		std::vector<int> relativeTexCoords;
+		std::vector<int> relativeNormals;
+
+		// Where the chunk's lists start once all chunks are stitched together.
+		int firstVertex = 0;
+		int firstTexCoord = 0;
+		int firstNormal = 0;
+		int firstCorner = 0;
+	};
+
+	// One vertex of a face, with flags for the indices that are relative to the chunk.
+	struct FaceVertex
+	{
+		int vertex;
+		int texCoord;
+		int normal;
+		bool relativeVertex;
+		bool relativeTexCoord;
+		bool relativeNormal;
+	};
+
+	// Chunks are at least this large, so that small files are not worth a thread each.
+	static const size_t MINIMUM_CHUNK_SIZE = 1 << 20;
+
+	// Parse one chunk of the file.
+	// On failure, line is set to the line of the error, counted from 1 at the start of the chunk.
+	static IOResult Parse(const char* data, size_t size, Contents& contents, int& line);
+
+	// Parse the vertices of an "f" line and append its triangles.
+	// The polygon list is scratch space, reused from face to face.
+	static IOResult ParseFace(Tokenizer& tokens, Contents& contents, std::vector<FaceVertex>& polygon);
+
+	// Turn a one-based or negative index into a zero-based one, with count items read so far in this chunk.
+	// Negative indices resolve within the chunk and are flagged as relative. Returns false for index 0.
+	static bool ResolveIndex(int index, int count, int& resolved, bool& relative);
+
+	// Stitch the chunks together and create the vertices and triangles of the polyhedron.
+	static IOResult Build(std::vector<Contents>& chunks, Polyhedron& p);
+
+	ObjFile();
+	~ObjFile();
+
+};
@@ -0,0 +1,66 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+int Parallel::numberOfThreads = 0;
+
+int Parallel::GetNumberOfThreads()
+{
+	if (numberOfThreads > 0)
+		return numberOfThreads;
+	return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+void Parallel::SetNumberOfThreads(int threads)
+{
+	numberOfThreads = std::max(0, threads);
+}
+
+void Parallel::For(int n, const std::function<void(int)>& task)
+{
+	int threads = std::min(n, GetNumberOfThreads());
+	if (threads <= 1)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	std::atomic<int> next(0);
+	auto work = [&]()
+	{
+		for (int i = next++; i < n; i = next++)
+		{
+			task(i);
+		}
+	};
+
+	std::vector<std::thread> team;
+	team.reserve(threads - 1);
+	for (int i = 0; i < threads - 1; ++i)
+	{
+		team.emplace_back(work);
+	}
+	work();
+	for (std::thread& thread : team)
+	{
+		thread.join();
+	}
+}
+
+void Parallel::ForBlocks(int n, int blockSize, const std::function<void(int, int)>& task)
+{
+	int numBlocks = (n + blockSize - 1) / blockSize;
+	For(numBlocks, [&](int i)
+	{
+		task(i * blockSize, std::min(n, (i + 1) * blockSize));
+	});
+}
+
+Parallel::Parallel() {}
+Parallel::~Parallel() {}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+
+/** Minimal fork-join helper on std::thread.
+ * For() hands the items out to a team of threads one at a time and returns once all of them are done.
+ * The calling thread works as one of the team, so a team of one runs everything inline.
+ */
+class Parallel
+{
+
+public:
+
+	// Number of threads For() uses. Defaults to the number of hardware threads.
+	static int GetNumberOfThreads();
+
+	// Use this many threads from now on; 0 goes back to the default.
+	static void SetNumberOfThreads(int threads);
+
+	// Run task(i) for every i in [0, n), spread over the threads.
+	// Items are taken in increasing order, so give the slow items low numbers.
+	static void For(int n, const std::function<void(int)>& task);
+
+	// Run task(begin, end) over consecutive blocks of [0, n) of the given size, spread over the threads.
+	// For loops whose items are too small to hand out one at a time.
+	static void ForBlocks(int n, int blockSize, const std::function<void(int, int)>& task);
+
+private:
+
+	static int numberOfThreads;
+
+	Parallel();
+	~Parallel();
+
+};
@@ -0,0 +1,704 @@
+#include "plyfile.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+IOResult PlyFile::Read(const std::string& file, Polyhedron& p)
+{
+	MappedFile mapping;
+	if (!mapping.Open(file))
+	{
+		return IOResult::Error(mapping.error);
+	}
+
+	Header header;
+	IOResult result = ReadHeader(mapping.Data(), mapping.Size(), header);
+	if (!result.success)
+	{
+		return result;
+	}
+
+	// A header can claim any number of records, so check that the body has room for them before reserving any.
+	const char* body = mapping.Data() + header.bodyOffset;
+	size_t bodySize = mapping.Size() - header.bodyOffset;
+	size_t room = bodySize + ((header.format == Format::ASCII) ? 1 : 0);
+	for (const Element& e : header.elements)
+	{
+		size_t recordSize = GetMinimumRecordSize(e, header.format);
+		if (recordSize > 0 && (size_t)e.count > room / recordSize)
+		{
+			return IOResult::Error(file + ": FILE IS TOO SHORT FOR " + std::to_string(e.count) + " " + e.name + " ELEMENTS.");
+		}
+		room -= recordSize * e.count;
+	}
+
+	// Size the lists from the header so that nothing is reallocated while loading.
+	p.vlist.clear();
+	p.tlist.clear();
+	p.elist.clear();
+	p.vertexProperties.clear();
+	p.texCoords.clear();
+	p.normals.clear();
+	p.cornerTexCoords.clear();
+	p.cornerNormals.clear();
+	for (const Element& e : header.elements)
+	{
+		if (e.name == "vertex")
+			p.vlist.reserve(e.count);
+		else if (e.name == "face")
+			p.tlist.reserve(e.count);
+	}
+
+	if (header.format == Format::ASCII)
+	{
+		// The parallel reader gives up on any problem; the streaming reader then says what it is.
+		if (!ReadAsciiByLines(body, bodySize, header, p))
+			result = ReadAscii(body, bodySize, header, p);
+	}
+	else
+		result = ReadBinary(body, bodySize, header, p);
+	if (!result.success)
+	{
+		return IOResult::Error(file + ": " + result.message);
+	}
+
+	Corner c;
+	p.clist = std::vector<Corner>(3 * p.tlist.size(), c);
+	p.center = glm::dvec3(0.0, 0.0, 0.0);
+	return IOResult::Ok();
+}
+
+IOResult PlyFile::ReadHeader(const char* data, size_t size, Header& header)
+{
+	if (size < 4 || strncmp(data, "ply", 3) != 0)
+	{
+		return IOResult::Error("NOT A .PLY FILE.");
+	}
+
+	bool hasFormat = false;
+	size_t position = 0;
+	while (position < size)
+	{
+		// Get the next line, without its line ending.
+		size_t end = position;
+		while (end < size && data[end] != '\n')
+		{
+			++end;
+		}
+		std::string line(data + position, end - position);
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		position = end + 1;
+
+		std::istringstream words(line);
+		std::string word;
+		words >> word;
+
+		if (word == "end_header")
+		{
+			if (!hasFormat)
+			{
+				return IOResult::Error("PLY HEADER HAS NO FORMAT LINE.");
+			}
+			header.bodyOffset = (position < size) ? position : size;
+			return IOResult::Ok();
+		}
+		else if (word == "format")
+		{
+			std::string format;
+			words >> format;
+			if (format == "ascii")
+				header.format = Format::ASCII;
+			else if (format == "binary_little_endian")
+				header.format = Format::BINARY_LITTLE_ENDIAN;
+			else if (format == "binary_big_endian")
+				header.format = Format::BINARY_BIG_ENDIAN;
+			else
+				return IOResult::Error("UNKNOWN PLY FORMAT: " + format);
+			hasFormat = true;
+		}
+		else if (word == "element")
+		{
+			Element element;
+			if (!(words >> element.name >> element.count) || element.count < 0)
+			{
+				return IOResult::Error("ERROR READING ELEMENT: " + line);
+			}
+			header.elements.push_back(element);
+		}
+		else if (word == "property")
+		{
+			if (header.elements.empty())
+			{
+				return IOResult::Error("PROPERTY BEFORE ANY ELEMENT: " + line);
+			}
+
+			Property property;
+			std::string type;
+			words >> type;
+			if (type == "list")
+			{
+				std::string countType;
+				words >> countType >> type;
+				property.isList = true;
+				if (!ParseType(countType, property.countType))
+				{
+					return IOResult::Error("UNKNOWN PROPERTY TYPE: " + line);
+				}
+			}
+			if (!ParseType(type, property.type) || !(words >> property.name))
+			{
+				return IOResult::Error("UNKNOWN PROPERTY TYPE: " + line);
+			}
+			header.elements.back().properties.push_back(property);
+		}
+		// Anything else ("comment", "obj_info") carries no structure.
+	}
+	return IOResult::Error("PLY HEADER HAS NO end_header.");
+}
+
+size_t PlyFile::GetMinimumRecordSize(const Element& element, Format format)
+{
+	size_t size = 0;
+	for (const Property& property : element.properties)
+	{
+		if (format == Format::ASCII)
+			size += 2;
+		else
+			size += TypeSize(property.isList ? property.countType : property.type);
+	}
+	return size;
+}
+
+IOResult PlyFile::GetVertexRoles(const Element& element, std::vector<Role>& roles, std::vector<std::vector<float>*>& extras, Polyhedron& p)
+{
+	int found = 0;
+	roles.assign(element.properties.size(), Role::SKIP);
+	extras.assign(element.properties.size(), NULL);
+	for (int k = 0; k < element.properties.size(); ++k)
+	{
+		const Property& property = element.properties[k];
+		if (property.isList)
+			continue;
+
+		if (property.name == "x")
+			roles[k] = Role::X;
+		else if (property.name == "y")
+			roles[k] = Role::Y;
+		else if (property.name == "z")
+			roles[k] = Role::Z;
+		else
+		{
+			roles[k] = Role::EXTRA;
+			std::vector<float>& values = p.vertexProperties[property.name];
+			values.reserve(element.count);
+			extras[k] = &values;
+			continue;
+		}
+		++found;
+	}
+	if (found != 3)
+	{
+		return IOResult::Error("VERTEX ELEMENT NEEDS x, y AND z PROPERTIES.");
+	}
+	return IOResult::Ok();
+}
+
+IOResult PlyFile::GetFaceRoles(const Element& element, std::vector<Role>& roles)
+{
+	bool found = false;
+	roles.assign(element.properties.size(), Role::SKIP);
+	for (int k = 0; k < element.properties.size(); ++k)
+	{
+		const Property& property = element.properties[k];
+		if (property.isList && !found && (property.name == "vertex_indices" || property.name == "vertex_index"))
+		{
+			roles[k] = Role::VERTEX_INDICES;
+			found = true;
+		}
+	}
+	if (!found)
+	{
+		return IOResult::Error("FACE ELEMENT HAS NO vertex_indices LIST.");
+	}
+	return IOResult::Ok();
+}
+
+IOResult PlyFile::ReadBinary(const char* data, size_t size, const Header& header, Polyhedron& p)
+{
+	const uint16_t one = 1;
+	bool littleHost = (*(const uint8_t*)&one == 1);
+	bool swap = (header.format == Format::BINARY_LITTLE_ENDIAN) != littleHost;
+
+	const char* cursor = data;
+	const char* end = data + size;
+	std::vector<Role> roles;
+	std::vector<std::vector<float>*> extras;
+	std::vector<int> polygon;
+
+	for (const Element& element : header.elements)
+	{
+		bool isVertex = (element.name == "vertex");
+		bool isFace = (element.name == "face");
+		if (isVertex)
+		{
+			IOResult result = GetVertexRoles(element, roles, extras, p);
+			if (!result.success)
+				return result;
+		}
+		else if (isFace)
+		{
+			IOResult result = GetFaceRoles(element, roles);
+			if (!result.success)
+				return result;
+		}
+		else
+		{
+			roles.assign(element.properties.size(), Role::SKIP);
+		}
+
+		for (long i = 0; i < element.count; ++i)
+		{
+			double position[3] = { 0.0, 0.0, 0.0 };
+			for (int k = 0; k < element.properties.size(); ++k)
+			{
+				const Property& property = element.properties[k];
+				int itemSize = TypeSize(property.type);
+
+				if (!property.isList)
+				{
+					if (cursor + itemSize > end)
+						return IOResult::Error("UNEXPECTED END OF FILE IN ELEMENT " + element.name + ".");
+
+					Role role = roles[k];
+					if (role == Role::X || role == Role::Y || role == Role::Z)
+						position[(int)role - (int)Role::X] = LoadScalar(cursor, property.type, swap);
+					else if (role == Role::EXTRA)
+						extras[k]->push_back((float)LoadScalar(cursor, property.type, swap));
+					cursor += itemSize;
+					continue;
+				}
+
+				// List: a count followed by that many items.
+				int countSize = TypeSize(property.countType);
+				if (cursor + countSize > end)
+					return IOResult::Error("UNEXPECTED END OF FILE IN ELEMENT " + element.name + ".");
+				long count = (long)LoadScalar(cursor, property.countType, swap);
+				cursor += countSize;
+				if (count < 0 || cursor + count * itemSize > end)
+					return IOResult::Error("UNEXPECTED END OF FILE IN ELEMENT " + element.name + ".");
+
+				if (roles[k] == Role::VERTEX_INDICES)
+				{
+					polygon.resize(count);
+					for (long j = 0; j < count; ++j)
+					{
+						polygon[j] = (int)LoadScalar(cursor + j * itemSize, property.type, swap);
+					}
+				}
+				cursor += count * itemSize;
+			}
+
+			if (isVertex)
+			{
+				// Construct in place: copying a Vert into the list would copy its containers too.
+				Vert& v = p.vlist.emplace_back(position[0], position[1], position[2]);
+				v.index = p.vlist.size() - 1;
+			}
+			else if (isFace)
+			{
+				if (!AddPolygon(p, polygon))
+					return IOResult::Error("FACE " + std::to_string(i) + " HAS A VERTEX INDEX OUT OF RANGE.");
+			}
+		}
+	}
+	return IOResult::Ok();
+}
+
+IOResult PlyFile::ReadAscii(const char* data, size_t size, const Header& header, Polyhedron& p)
+{
+	Tokenizer tokens(data, size);
+	std::vector<Role> roles;
+	std::vector<std::vector<float>*> extras;
+	std::vector<int> polygon;
+
+	for (const Element& element : header.elements)
+	{
+		bool isVertex = (element.name == "vertex");
+		bool isFace = (element.name == "face");
+		if (isVertex)
+		{
+			IOResult result = GetVertexRoles(element, roles, extras, p);
+			if (!result.success)
+				return result;
+		}
+		else if (isFace)
+		{
+			IOResult result = GetFaceRoles(element, roles);
+			if (!result.success)
+				return result;
+		}
+		else
+		{
+			roles.assign(element.properties.size(), Role::SKIP);
+		}
+
+		for (long i = 0; i < element.count; ++i)
+		{
+			double position[3] = { 0.0, 0.0, 0.0 };
+			for (int k = 0; k < element.properties.size(); ++k)
+			{
+				const Property& property = element.properties[k];
+				double value;
+				if (!tokens.NextNumber(value))
+					return IOResult::Error("ERROR READING ELEMENT " + element.name + " " + std::to_string(i) + ".");
+
+				if (!property.isList)
+				{
+					Role role = roles[k];
+					if (role == Role::X || role == Role::Y || role == Role::Z)
+						position[(int)role - (int)Role::X] = value;
+					else if (role == Role::EXTRA)
+						extras[k]->push_back((float)value);
+					continue;
+				}
+
+				// The list grows as its items are read, so a count larger than what is left runs out of numbers first.
+				long count = (long)value;
+				if (count < 0)
+					return IOResult::Error("NEGATIVE LIST COUNT IN ELEMENT " + element.name + " " + std::to_string(i) + ".");
+				if (roles[k] == Role::VERTEX_INDICES)
+					polygon.clear();
+				for (long j = 0; j < count; ++j)
+				{
+					if (!tokens.NextNumber(value))
+						return IOResult::Error("ERROR READING ELEMENT " + element.name + " " + std::to_string(i) + ".");
+					if (roles[k] == Role::VERTEX_INDICES)
+						polygon.push_back((int)value);
+				}
+			}
+
+			if (isVertex)
+			{
+				// Construct in place: copying a Vert into the list would copy its containers too.
+				Vert& v = p.vlist.emplace_back(position[0], position[1], position[2]);
+				v.index = p.vlist.size() - 1;
+			}
+			else if (isFace)
+			{
+				if (!AddPolygon(p, polygon))
+					return IOResult::Error("FACE " + std::to_string(i) + " HAS A VERTEX INDEX OUT OF RANGE.");
+			}
+		}
+	}
+	return IOResult::Ok();
+}
+
+bool PlyFile::ReadAsciiByLines(const char* data, size_t size, const Header& header, Polyhedron& p)
+{
+	std::vector<size_t> offsets = Tokenizer::SplitLines(data, size, 4 * Parallel::GetNumberOfThreads(), MINIMUM_CHUNK_SIZE);
+	int numChunks = offsets.size() - 1;
+	if (numChunks < 2)
+		return false;
+
+	// Number the lines: the first line of each chunk.
+	std::vector<long> firstLines(numChunks + 1, 0);
+	Parallel::For(numChunks, [&](int i)
+	{
+		firstLines[i + 1] = std::count(data + offsets[i], data + offsets[i + 1], '\n');
+	});
+	for (int i = 0; i < numChunks; ++i)
+	{
+		firstLines[i + 1] += firstLines[i];
+	}
+
+	// Line (record) numbers at which each element starts.
+	int numElements = header.elements.size();
+	std::vector<long> firstRecords(numElements + 1, 0);
+	for (int e = 0; e < numElements; ++e)
+	{
+		firstRecords[e + 1] = firstRecords[e] + header.elements[e].count;
+	}
+	if (firstLines[numChunks] < firstRecords[numElements])
+		return false;
+
+	// What to do with the properties of each element.
+	std::vector<std::vector<Role>> roles(numElements);
+	std::vector<std::vector<std::vector<float>*>> extras(numElements);
+	long numVertices = 0;
+	for (int e = 0; e < numElements; ++e)
+	{
+		const Element& element = header.elements[e];
+		if (element.name == "vertex")
+		{
+			if (!GetVertexRoles(element, roles[e], extras[e], p).success)
+			{
+				p.vertexProperties.clear();
+				return false;
+			}
+			for (std::vector<float>* values : extras[e])
+			{
+				if (values != NULL)
+					values->resize(element.count);
+			}
+			numVertices = element.count;
+		}
+		else if (element.name == "face")
+		{
+			if (!GetFaceRoles(element, roles[e]).success)
+				return false;
+		}
+		else
+		{
+			roles[e].assign(element.properties.size(), Role::SKIP);
+		}
+	}
+
+	// Vertices go straight to their place; triangles are collected per chunk and stitched in order.
+	std::vector<double> positions(3 * numVertices);
+	std::vector<std::vector<int>> triangles(numChunks);
+	std::vector<int> failed(numChunks, 0);
+	Parallel::For(numChunks, [&](int i)
+	{
+		Tokenizer tokens(data + offsets[i], offsets[i + 1] - offsets[i]);
+		std::vector<int> polygon;
+		int e = 0;
+		for (long line = firstLines[i]; !tokens.AtEnd() && line < firstRecords[numElements]; ++line, tokens.NextLine())
+		{
+			while (line >= firstRecords[e + 1])
+			{
+				++e;
+			}
+			const Element& element = header.elements[e];
+			long record = line - firstRecords[e];
+
+			double position[3] = { 0.0, 0.0, 0.0 };
+			polygon.clear();
+			for (int k = 0; k < element.properties.size(); ++k)
+			{
+				const Property& property = element.properties[k];
+				Role role = roles[e][k];
+				double value;
+				if (!tokens.Number(value))
+				{
+					failed[i] = 1;
+					return;
+				}
+
+				if (!property.isList)
+				{
+					if (role == Role::X || role == Role::Y || role == Role::Z)
+						position[(int)role - (int)Role::X] = value;
+					else if (role == Role::EXTRA)
+						(*extras[e][k])[record] = (float)value;
+					continue;
+				}
+
+				long count = (long)value;
+				if (count < 0)
+				{
+					failed[i] = 1;
+					return;
+				}
+				for (long j = 0; j < count; ++j)
+				{
+					if (!tokens.Number(value))
+					{
+						failed[i] = 1;
+						return;
+					}
+					if (role == Role::VERTEX_INDICES)
+						polygon.push_back((int)value);
+				}
+			}
+
+			// Exactly one record per line.
+			if (!tokens.AtLineEnd())
+			{
+				failed[i] = 1;
+				return;
+			}
+
+			if (element.name == "vertex")
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					positions[3 * record + j] = position[j];
+				}
+			}
+			else if (element.name == "face")
+			{
+				for (int index : polygon)
+				{
+					if (index < 0 || index >= numVertices)
+					{
+						failed[i] = 1;
+						return;
+					}
+				}
+				for (int j = 1; j + 1 < polygon.size(); ++j)
+				{
+					triangles[i].push_back(polygon[0]);
+					triangles[i].push_back(polygon[j]);
+					triangles[i].push_back(polygon[j + 1]);
+				}
+			}
+		}
+	});
+	if (std::count(failed.begin(), failed.end(), 1) > 0)
+	{
+		p.vertexProperties.clear();
+		return false;
+	}
+
+	// Stitch: size the lists, then fill them in parallel.
+	std::vector<int> firstTriangles(numChunks + 1, 0);
+	for (int i = 0; i < numChunks; ++i)
+	{
+		firstTriangles[i + 1] = firstTriangles[i] + triangles[i].size() / 3;
+	}
+	p.vlist.resize(numVertices);
+	p.tlist.resize(firstTriangles[numChunks]);
+	Parallel::For(numChunks, [&](int i)
+	{
+		// Each chunk fills the vertices in its share of the list, not the ones it read.
+		long begin = numVertices * i / numChunks;
+		long end = numVertices * (i + 1) / numChunks;
+		for (long j = begin; j < end; ++j)
+		{
+			Vert& v = p.vlist[j];
+			v.x = positions[3 * j];
+			v.y = positions[3 * j + 1];
+			v.z = positions[3 * j + 2];
+			v.index = j;
+		}
+
+		for (int j = 0; j < triangles[i].size() / 3; ++j)
+		{
+			Triangle& t = p.tlist[firstTriangles[i] + j];
+			for (int k = 0; k < 3; ++k)
+			{
+				t.vertices[k] = &p.vlist[triangles[i][3 * j + k]];
+			}
+			t.index = firstTriangles[i] + j;
+		}
+	});
+	return true;
+}
+
+bool PlyFile::AddPolygon(Polyhedron& p, const std::vector<int>& polygon)
+{
+	int numVertices = p.vlist.size();
+	for (int index : polygon)
+	{
+		if (index < 0 || index >= numVertices)
+			return false;
+	}
+
+	// Fan triangulation around the first vertex; a triangle is a fan of one.
+	for (int j = 1; j + 1 < polygon.size(); ++j)
+	{
+		Triangle& t = p.tlist.emplace_back();
+		t.vertices[0] = &p.vlist[polygon[0]];
+		t.vertices[1] = &p.vlist[polygon[j]];
+		t.vertices[2] = &p.vlist[polygon[j + 1]];
+		t.index = p.tlist.size() - 1;
+	}
+	return true;
+}
+
+bool PlyFile::ParseType(const std::string& name, Type& type)
+{
+	if (name == "char" || name == "int8")
+		type = Type::INT8;
+	else if (name == "uchar" || name == "uint8")
+		type = Type::UINT8;
+	else if (name == "short" || name == "int16")
+		type = Type::INT16;
+	else if (name == "ushort" || name == "uint16")
+		type = Type::UINT16;
+	else if (name == "int" || name == "int32")
+		type = Type::INT32;
+	else if (name == "uint" || name == "uint32")
+		type = Type::UINT32;
+	else if (name == "float" || name == "float32")
+		type = Type::FLOAT32;
+	else if (name == "double" || name == "float64")
+		type = Type::FLOAT64;
+	else
+		return false;
+	return true;
+}
+
+int PlyFile::TypeSize(Type type)
+{
+	switch (type)
+	{
+		case Type::INT8:
+		case Type::UINT8:
+			return 1;
+		case Type::INT16:
+		case Type::UINT16:
+			return 2;
+		case Type::INT32:
+		case Type::UINT32:
+		case Type::FLOAT32:
+			return 4;
+		case Type::FLOAT64:
+			return 8;
+	}
+	return 0;
+}
+
+double PlyFile::LoadScalar(const char* data, Type type, bool swap)
+{
+	switch (type)
+	{
+		case Type::INT8:
+			return (double)*(const int8_t*)data;
+		case Type::UINT8:
+			return (double)*(const uint8_t*)data;
+		case Type::INT16:
+		case Type::UINT16:
+		{
+			uint16_t bits;
+			memcpy(&bits, data, 2);
+			if (swap)
+				bits = __builtin_bswap16(bits);
+			return (type == Type::INT16) ? (double)(int16_t)bits : (double)bits;
+		}
+		case Type::INT32:
+		case Type::UINT32:
+		case Type::FLOAT32:
+		{
+			uint32_t bits;
+			memcpy(&bits, data, 4);
+			if (swap)
+				bits = __builtin_bswap32(bits);
+			if (type == Type::FLOAT32)
+			{
+				float value;
+				memcpy(&value, &bits, 4);
+				return value;
+			}
+			return (type == Type::INT32) ? (double)(int32_t)bits : (double)bits;
+		}
+		case Type::FLOAT64:
+		{
+			uint64_t bits;
+			memcpy(&bits, data, 8);
+			if (swap)
+				bits = __builtin_bswap64(bits);
+			double value;
+			memcpy(&value, &bits, 8);
+			return value;
+		}
+	}
+	return 0.0;
+}
+
+PlyFile::PlyFile() {}
+PlyFile::~PlyFile() {}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "utilities.hpp"
+#include "mappedfile.hpp"
+#include "tokenizer.hpp"
+#include "parallel.hpp"
+#include "polyhedron.hpp"
+
+/** Reader for .ply files in any of the three encodings: ascii, binary_little_endian and binary_big_endian.
+ *
+ * The file is memory mapped and parsed in place: vertex and face records are decoded directly from the mapping into vlist/tlist.
+ * Large ascii files are parsed in parallel, chunk by chunk.
+ * The header is read in full, so elements other than "vertex" and "face" (edges, materials, ...) are skipped correctly,
+ * and every scalar vertex property besides x, y, z (normals, colors, quality, ...) is kept in Polyhedron::vertexProperties.
+ *
+ * Nothing here terminates the process: problems with the file come back as an IOResult.
+ */
+class PlyFile
+{
+
+public:
+
+	// Read a .ply file into an empty polyhedron.
+	// Faces with more than three vertices are fan triangulated.
+	static IOResult Read(const std::string& file, Polyhedron& p);
+
+private:
+
+	enum class Format { ASCII, BINARY_LITTLE_ENDIAN, BINARY_BIG_ENDIAN };
+	enum class Type { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+	// What the reader does with a property of the vertex or face element.
+	enum class Role { SKIP, X, Y, Z, EXTRA, VERTEX_INDICES };
+
+	struct Property
+	{
+		std::string name;
+		Type type;
+		bool isList = false;
+		Type countType;
+	};
+
+	struct Element
+	{
+		std::string name;
+		long count = 0;
+		std::vector<Property> properties;
+	};
+
+	// The parallel ascii reader cuts the body into chunks of at least this size.
+	static const size_t MINIMUM_CHUNK_SIZE = 1 << 20;
+
+	struct Header
+	{
+		Format format;
+		std::vector<Element> elements;
+		size_t bodyOffset = 0;
+	};
+
+	// Parse everything up to and including "end_header".
+	static IOResult ReadHeader(const char* data, size_t size, Header& header);
+
+	// The fewest bytes a record of the element can take in the body: its scalars and list counts in binary,
+	// or a number and a separator per property in ascii. Bounds the counts in the header by the size of the file.
+	static size_t GetMinimumRecordSize(const Element& element, Format format);
+
+	// Work out what to do with each property of the vertex or face element.
+	// Extra vertex properties get a list in p.vertexProperties; extras[k] points to it for property k.
+	static IOResult GetVertexRoles(const Element& element, std::vector<Role>& roles, std::vector<std::vector<float>*>& extras, Polyhedron& p);
+	static IOResult GetFaceRoles(const Element& element, std::vector<Role>& roles);
+
+	// Decode the body of the file, element by element.
+	static IOResult ReadBinary(const char* data, size_t size, const Header& header, Polyhedron& p);
+	static IOResult ReadAscii(const char* data, size_t size, const Header& header, Polyhedron& p);
+
+	// Parallel ascii reader for the usual layout of one element per line, so that line i of the body is record i.
+	// The body is cut into chunks at line ends and the chunks are parsed concurrently: vertices are written
+	// straight to their place, and each chunk collects its own triangles, which are stitched together in order.
+	// Returns false, having changed nothing in p, if the body is small or not laid out that way, or has any error.
+	static bool ReadAsciiByLines(const char* data, size_t size, const Header& header, Polyhedron& p);
+
+	// Append a polygon to the triangle list, fan triangulating if needed.
+	// Returns false if a vertex index is out of range.
+	static bool AddPolygon(Polyhedron& p, const std::vector<int>& polygon);
+
+	static bool ParseType(const std::string& name, Type& type);
+	static int TypeSize(Type type);
+
+	// Decode one binary scalar, swapping bytes if the file and host byte orders differ.
+	static double LoadScalar(const char* data, Type type, bool swap);
+
+	PlyFile();
+	~PlyFile();
+
+};
@@ -1,14 +1,13 @@
 #include "polyhedron.hpp"
+#include "plyfile.hpp"
+#include "objfile.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
 
 
 Polyhedron::Polyhedron()
 {
-	vlist.reserve(40000);
-	elist.reserve(100000);
-	tlist.reserve(40000);
-	
-	Corner c;
-	clist = std::vector<Corner>(3 * tlist.size(), c);
 	center = glm::dvec3(0.0, 0.0, 0.0);
 }
 Polyhedron::Polyhedron(int vertices, int edges, int triangles)
@@ -23,488 +22,500 @@ Polyhedron::Polyhedron(int vertices, int edges, int triangles)
 }
 
 // Load from a .obj file.
+// Use ObjFile::Read() directly to get errors back instead of exiting.
 Polyhedron::Polyhedron(std::string file, int a)
 {
-	vlist.reserve(40000);
-	elist.reserve(100000);
-	tlist.reserve(40000);
-
-	std::ifstream f(file);
-
-	// Check to see if the file can be opened.
-	if (!f)
+	IOResult result = ObjFile::Read(file, *this);
+	if (!result.success)
 	{
-		std::cout << "FILE COULD NOT BE OPENED." << std::endl;
+		std::cout << result.message << std::endl;
 		exit(-1);
 	}
-
-	// Store each line of the file in a string.
-	std::string line;
-
-	// Check to see if some line is "# OBJ File".
-	/*
-	while (f && line != "# OBJ File")
-	{
-		std::getline(f, line);
-	}
-	if (!f)
-	{
-		std::cout << "NOT A .OBJ FILE." << std::endl;
-		exit(-1);
-	}
-	*/
-
-	// Get data from the file.
-	std::getline(f, line);
-	while (f)
-	{
-		// Vertex:
-		if (line[0] == 'v' && line[1] != 't')
-		{
-			// Remove the 'v' at the start of the line.
-			line.erase(0, line.find(" ") + 1);
-
-			Vert v;
-			glm::vec3 position;
-			for (int i = 0; i < 3; ++i)
-			{
-				std::string word = line.substr(0, line.find(" "));
-				position[i] = std::stof(word);
-				line.erase(0, line.find(" ") + 1);
-			}
-			v.x = position.x;
-			v.y = position.y;
-			v.z = position.z;
-			v.index = vlist.size();
-			vlist.push_back(v);
-		}
-
-		// Triangle:
-		if (line[0] == 'f')
-		{
-			// Remove the 't' at the start of the line.
-			line.erase(0, line.find(" ") + 1);
-			Triangle t;
-
-			// May be formatted as xxx/xxx xxx/xxx xxx/xxx. 
-			// Take only the first element of each /.
-			for (int i = 0; i < 3; ++i)
-			{
-				std::string word = line.substr(0, line.find("/"));
-				//std::cout << std::stoi(word) << std::endl;
-				t.vertices[i] = &vlist[std::stoi(word) - 1];
-				line.erase(0, line.find(" ") + 1);
-			}
-			t.index = tlist.size();
-			tlist.push_back(t);
-		}
-
-		std::getline(f, line);
-	}
-
-	std::cout << vlist.size() << std::endl;
-	std::cout << tlist.size() << std::endl;
-
-	Corner c;
-	clist = std::vector<Corner>(3 * tlist.size(), c);
-	center = glm::dvec3(0.0, 0.0, 0.0);
 }
+// Load from a .ply file in any encoding.
+// Use PlyFile::Read() directly to get errors back instead of exiting.
 Polyhedron::Polyhedron(std::string file)
 {
-	vlist.reserve(40000);
-	elist.reserve(100000);
-	tlist.reserve(40000);
-
-	std::ifstream f(file);
-
-	// Check to see if the file can be opened.
-	if (!f)
+	IOResult result = PlyFile::Read(file, *this);
+	if (!result.success)
 	{
-		std::cout << "FILE COULD NOT BE OPENED." << std::endl;
+		std::cout << result.message << std::endl;
 		exit(-1);
 	}
+}
 
-	// Store each line of the file in a string.
-	std::string line;
-
-	// Check to see if the first line of the file is "ply".
-	std::getline(f, line);
-	if (line.substr(0, 3) != "ply")
-	{
-		std::cout << "NOT A .PLY FILE. " << std::endl;
-		exit(-1);
-	}
-
-	// Go through the header to figure out how many vertices and triangles there are.
-	int numberOfVertices;
-	int numberOfTriangles;
-	while (f && line.substr(0, 10) != "end_header")
-	{
-		std::getline(f, line);
-		
-		// Look for the word "element":
-		std::string word = line.substr(0, line.find(" "));
-		if (word == "element")
-		{
-			line.erase(0, line.find(" ") + 1);
-			
-			// Now decide whether or not this is vertex or triangle info.
-			word = line.substr(0, line.find(" "));
-			if (word == "vertex")
-			{
-				line.erase(0, line.find(" ") + 1);
-				numberOfVertices = std::stoi(line);
-			}
-			else if (word == "face")
-			{
-				line.erase(0, line.find(" ") + 1);
-				numberOfTriangles = std::stoi(line);
-			}
-			else
-			{
-				std::cout << "ERROR READING VERTEX/FACE INFO." << std::endl;
-				exit(-1);
-			}
-		}
-	}
-
-	// Now that we know how many vertices/faces there are, we can build up the lists.
-	// The file is currently sitting at the line "end_header". 
-	int count = 0;
-	std::getline(f, line);
-	while (f && line != "")
-	{
-		// Vertex:
-		if (count < numberOfVertices)
-		{
-			Vert v;
-			glm::vec3 position;
-			for (int i = 0; i < 3; ++i)
-			{
-				std::string word = line.substr(0, line.find(" "));
-				position[i] = std::stof(word);
-				line.erase(0, line.find(" ") + 1);
-			}
-			v.x = position.x;
-			v.y = position.y;
-			v.z = position.z;
-			v.index = vlist.size();
-			vlist.push_back(v);
-		}
-		// Triangle:
-		else
-		{
-			// Check that the first word is 3:
-			std::string word = line.substr(0, line.find(" "));
-			if (std::stoi(word) != 3)
-			{
-				std::cout << "ERROR: NOT A TRIANGLE MESH." << std::endl;
-			}
-			line.erase(0, line.find(" ") + 1);
-		
-			// Continue parsing:
-			Triangle t;	
-			for (int i = 0; i < 3; ++i)
-			{
-				std::string word = line.substr(0, line.find(" "));
-				t.vertices[i] = &vlist[std::stoi(word)];
-				line.erase(0, line.find(" ") + 1);
-			}
-			t.index = tlist.size();
-			tlist.push_back(t);
-		}
-		++count;
-		std::getline(f, line);
-	}
-
-	Corner c;
-	clist = std::vector<Corner>(3 * tlist.size(), c);
-	center = glm::dvec3(0.0, 0.0, 0.0);
+IOResult Polyhedron::Read(const std::string& file, Polyhedron& p)
+{
+	bool isObj = file.size() >= 4 && file.compare(file.size() - 4, 4, ".obj") == 0;
+	return isObj ? ObjFile::Read(file, p) : PlyFile::Read(file, p);
 }
 
 Polyhedron::~Polyhedron() {}
-/*
 Polyhedron::Polyhedron(const Polyhedron& p)
 {
-	this->index = p.index;
-	this->surfaceArea = p.surfaceArea;
-	this->center = p.center;
-	this->radius = p.radius;
-	this->valenceDeficit = p.valenceDeficit;
-	this->angleDeficit = p.angleDeficit;
-	this->vlist = p.vlist;
-	this->elist = p.elist;
-	this->tlist = p.tlist;
-	this->clist = p.clist;
+	*this = p;
 }
-Polyhedron::Polyhedron(Polyhedron&& p)
+// The lists keep their buffers, so the pointers between them are still good.
+Polyhedron::Polyhedron(Polyhedron&& p) = default;
+Polyhedron& Polyhedron::operator=(Polyhedron&& p)
 {
+	if (this == &p)
+		return *this;
+
+	// Let go of the old lists before the arena they were allocated from.
 	this->index = p.index;
 	this->surfaceArea = p.surfaceArea;
 	this->center = p.center;
 	this->radius = p.radius;
 	this->valenceDeficit = p.valenceDeficit;
 	this->angleDeficit = p.angleDeficit;
-	this->vlist = p.vlist;
-	this->elist = p.elist;
-	this->tlist = p.tlist;
-	this->clist = p.clist;
+	this->orientation = p.orientation;
+	this->initializeTimes = p.initializeTimes;
+	this->vlist = std::move(p.vlist);
+	this->elist = std::move(p.elist);
+	this->tlist = std::move(p.tlist);
+	this->clist = std::move(p.clist);
+	this->arena = std::move(p.arena);
+	this->movedVertices = std::move(p.movedVertices);
+	this->vertexProperties = std::move(p.vertexProperties);
+	this->texCoords = std::move(p.texCoords);
+	this->normals = std::move(p.normals);
+	this->cornerTexCoords = std::move(p.cornerTexCoords);
+	this->cornerNormals = std::move(p.cornerNormals);
+	return *this;
 }
-Polyhedron& Polyhedron::operator=(Polyhedron&& p)
+Polyhedron& Polyhedron::operator=(const Polyhedron& p)
 {
+	if (this == &p)
+		return *this;
+
 	this->index = p.index;
 	this->surfaceArea = p.surfaceArea;
 	this->center = p.center;
 	this->radius = p.radius;
 	this->valenceDeficit = p.valenceDeficit;
 	this->angleDeficit = p.angleDeficit;
+	this->orientation = p.orientation;
+	this->initializeTimes = p.initializeTimes;
+
+	// Drop the old lists and their arena, so the copied lists are all allocated on the heap.
+	this->vlist.clear();
+	this->elist.clear();
+	this->arena.reset();
 	this->vlist = p.vlist;
 	this->elist = p.elist;
 	this->tlist = p.tlist;
 	this->clist = p.clist;
+	this->movedVertices = p.movedVertices;
+	this->vertexProperties = p.vertexProperties;
+	this->texCoords = p.texCoords;
+	this->normals = p.normals;
+	this->cornerTexCoords = p.cornerTexCoords;
+	this->cornerNormals = p.cornerNormals;
+	Relink(p);
 	return *this;
 }
-*/
 
+void Polyhedron::CreateArena(size_t numPointers)
+{
+	std::unique_ptr<std::pmr::monotonic_buffer_resource> old = std::move(arena);
 
-void Polyhedron::Initialize()
+	// A little extra room for the alignment of each list.
+	arena = std::make_unique<std::pmr::monotonic_buffer_resource>(numPointers * sizeof(Triangle*) + 4096);
+	for (Vert& v : vlist)
+	{
+		AttachToArena(v.triangles, 0);
+	}
+	for (Edge& e : elist)
+	{
+		AttachToArena(e.triangles, 0);
+	}
+}
+
+void Polyhedron::AttachToArena(std::pmr::vector<Triangle*>& list, int size)
 {
-	std::cout << std::endl;
-	std::cout << "***** Initializing Polyhedron *****" << std::endl;
-	std::cout << "***** Connecting vertices to triangles ***** " << std::endl;
-	ConnectVerticesToTriangles();
+	// A pmr vector keeps the memory resource it was made with, even through assignment,
+	// so the only way to move a list into the arena is to make it over.
+	std::destroy_at(&list);
+	new (&list) std::pmr::vector<Triangle*>(arena.get());
+	list.reserve(size);
+}
 
-	std::cout << "***** Creating edges ***** " << std::endl;
-	CreateEdges();
-	std::cout << "Polyhedron has " << vlist.size() << " vertices, " << elist.size() << " edges, and " << tlist.size() << " triangles. " << std::endl;
+void Polyhedron::Relink(const Polyhedron& p)
+{
+	// An element is found at the same position in both lists.
+	auto vert = [&](Vert* v) -> Vert* { return (v == NULL) ? NULL : &vlist[v - p.vlist.data()]; };
+	auto edge = [&](Edge* e) -> Edge* { return (e == NULL) ? NULL : &elist[e - p.elist.data()]; };
+	auto triangle = [&](Triangle* t) -> Triangle* { return (t == NULL) ? NULL : &tlist[t - p.tlist.data()]; };
+	auto corner = [&](Corner* c) -> Corner* { return (c == NULL) ? NULL : &clist[c - p.clist.data()]; };
 
-	std::cout << "***** Ordering pointers ***** " << std::endl;
-	for (int i = 0; i < vlist.size(); ++i)
+	for (Vert& v : vlist)
+	{
+		v.c = corner(v.c);
+		v.boundary = corner(v.boundary);
+		for (Triangle*& t : v.triangles)
+			t = triangle(t);
+	}
+	for (Edge& e : elist)
 	{
-		OrderVertexToTrianglePointers(vlist[i]);
+		for (Vert*& v : e.vertices)
+			v = vert(v);
+		for (Triangle*& t : e.triangles)
+			t = triangle(t);
 	}
+	for (Triangle& t : tlist)
+	{
+		for (Vert*& v : t.vertices)
+			v = vert(v);
+		for (Edge*& e : t.edges)
+			e = edge(e);
+	}
+	for (Corner& c : clist)
+	{
+		c.v = vert(c.v);
+		c.e = edge(c.e);
+		c.t = triangle(c.t);
+		c.n = corner(c.n);
+		c.p = corner(c.p);
+		c.o = corner(c.o);
+	}
+}
+
+
+void Polyhedron::Initialize()
+{
+	// The stages that work on one element at a time run in parallel. Sums over the elements are still taken in order,
+	// so the results do not depend on the number of threads. Each stage is timed in initializeTimes.
+	initializeTimes.Clear();
+	initializeTimes.Begin("connect vertices to triangles");
+	ConnectVerticesToTriangles();
 
-	std::cout << "***** Computing bounding sphere ***** " << std::endl;
+	initializeTimes.Begin("create edges");
+	CreateEdges();
+
+	initializeTimes.Begin("bounding sphere");
 	ComputeBoundingSphere();
 
-	std::cout << "***** Computing normals and areas ***** " << std::endl;
+	initializeTimes.Begin("normals and areas");
 	ComputeNormalsAndArea();
 
-	std::cout << "***** Interpolating normals ***** " << std::endl;
+	initializeTimes.Begin("interpolate normals");
 	InterpolateNormals();
 
-	std::cout << "***** Constructing corner list *****" << std::endl;
+	initializeTimes.Begin("corner list");
 	MeshAnalysis::GetCornerList(this);
 
-	std::cout << "***** Computing valence deficit *****" << std::endl;
+	// The fans are walked with the corners, so this comes after them.
+	initializeTimes.Begin("order fans");
+	OrderVertexToTrianglePointers();
+
+	initializeTimes.Begin("valence deficit");
 	MeshAnalysis::GetValenceDeficit(this);
-	std::cout << "Valence deficit is " << valenceDeficit << std::endl;
 
-	std::cout << "***** Computing angle deficit *****" << std::endl;
+	initializeTimes.Begin("angle deficit");
 	MeshAnalysis::GetAngleDeficit(this);
-	std::cout << "Angle deficit is " << angleDeficit << std::endl;
 
-	std::cout << std::endl;
+	// The curvature measures read these instead of recomputing them around every vertex.
+	initializeTimes.Begin("curvature geometry");
+	MeshAnalysis::ComputeCurvatureGeometry(this);
+	initializeTimes.End();
 }
 
+void Polyhedron::MoveVertex(int vertex, const glm::dvec3& position)
+{
+	Vert& v = vlist[vertex];
+	v.x = position.x;
+	v.y = position.y;
+	v.z = position.z;
+	movedVertices.push_back(vertex);
+}
 
-
-
-void Polyhedron::ConnectVerticesToTriangles()
+std::vector<int> Polyhedron::Update()
 {
-	// Go through the triangles:
-	for (int i = 0; i < tlist.size(); ++i)
+	if (movedVertices.empty())
+		return std::vector<int>();
+
+	// Every triangle of a moved vertex changed shape. Nothing a vertex or its curvatures are made of
+	// reaches past its own triangles, so the vertices of these triangles are all that change besides them.
+	// A few moved vertices are gathered and sorted; when much of the mesh moved, as in a smoothing step,
+	// marking the triangles and vertices and reading the marks back in order is cheaper than the sort.
+	auto byIndex = [](Triangle* t0, Triangle* t1) { return t0->index < t1->index; };
+	std::vector<Triangle*> triangles;
+	std::vector<int> vertices;
+	if (movedVertices.size() < vlist.size() / 16)
 	{
-		Triangle* t = &tlist[i];	
-
-		// Add a pointer to the current triangle to each of its vertices.
-		for (int j = 0; j < 3; ++j)
+		vertices = movedVertices;
+		for (int i : movedVertices)
 		{
-			Vert* v = t->vertices[j];
-			v->triangles.push_back(t);
+			for (Triangle* t : vlist[i].triangles)
+			{
+				triangles.push_back(t);
+				for (Vert* v : t->vertices)
+				{
+					vertices.push_back(v->index);
+				}
+			}
 		}
-	}
-}
 
-void Polyhedron::CreateEdge(Vert* v0, Vert* v1)
-{
-	//std::cout << "***** Attempting to create edge between vertices " << v0->index << " and " << v1->index << " *****" << std::endl;
-	// First create an edge.
-	// Establish all properties of this edge before we push it to the 
-	// edge list.
-	Edge edge;
-	edge.index = elist.size();
-	edge.vertices[0] = v0;
-	edge.vertices[1] = v1;
-	elist.push_back(edge);
-	//std::cout << "Pushing new edge #" << edge.index << " to elist." << std::endl;
-	Edge* e = &elist[edge.index];
-
-	// Go through the triangles of the first vertex v0.
-	// If any of these triangles contains the second vertex v1:
-	// add this triangle to the edge's list of triangles.
-	for (int i = 0; i < v0->GetNumberOfTriangles(); ++i)
-	{
-		Triangle* t = v0->triangles[i];
-
-		int k = t->Contains(v1);
-		if (k != -1)
+		std::sort(triangles.begin(), triangles.end(), byIndex);
+		triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+	}
+	else
+	{
+		std::vector<char> triangleMarks(tlist.size(), 0);
+		std::vector<char> vertexMarks(vlist.size(), 0);
+		for (int i : movedVertices)
 		{
-			// The triangle contains both v0 and v1.
-			// Establish this edge as an edge for the triangle list.
-			// For consistency's sake, the edge will be always be added as the (j+1)%3 index'ed edge of the triangle, where j is the index of the vertex of the triangle.
-			e->triangles.push_back(t);
-
-			int index0 = t->Contains(v0);
-			if ((k + 1) % 3 == index0)
+			vertexMarks[i] = 1;
+			for (Triangle* t : vlist[i].triangles)
 			{
-				t->edges[k] = &elist[edge.index];
-				//std::cout << "Successfully registered edge #" << e->index << " to triangle #" << t->index << " at location " << k << std::endl;
+				triangleMarks[t->index] = 1;
 			}
-			else if ((k + 2) % 3 == index0)
+		}
+		for (int i = 0; i < tlist.size(); ++i)
+		{
+			if (!triangleMarks[i])
+				continue;
+			triangles.push_back(&tlist[i]);
+			for (Vert* v : tlist[i].vertices)
 			{
-				t->edges[(k+2)%3] = &elist[edge.index];
-				//std::cout << "Successfully registered edge #" << e->index << " to triangle #" << t->index << " at location " << (k+2)%3 << std::endl;
+				vertexMarks[v->index] = 1;
 			}
-			else
+		}
+		for (int i = 0; i < vlist.size(); ++i)
+		{
+			if (vertexMarks[i])
+				vertices.push_back(i);
+		}
+	}
+	movedVertices.clear();
+
+	// Triangles and their corners, as ComputeNormalsAndArea() and GetAngleDeficit() compute them.
+	std::vector<double> oldAreas(triangles.size());
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(triangles.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = *triangles[i];
+			oldAreas[i] = t.area;
+			t.ComputeNormalAndArea();
+			t.normal *= orientation;
+			for (int k = 0; k < 3; ++k)
 			{
-				std::cout << "TRIANGULATION ERROR AT TRIANGLE " << t->index << std::endl;
+				MeshAnalysis::ComputeAngle(clist[3 * t.index + k]);
 			}
 		}
+	});
+
+	// Vertices. Initialize() adds up the normals in triangle order and the angles in corner order,
+	// which are the same order here, so a sorted copy of the star gives the same sums.
+	std::vector<double> oldAngles(vertices.size());
+	Parallel::ForBlocks(vertices.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<Triangle*> star;
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = vlist[vertices[i]];
+			oldAngles[i] = v.totalAngle;
+			if (v.triangles.empty())
+				continue;
+
+			star.assign(v.triangles.begin(), v.triangles.end());
+			std::sort(star.begin(), star.end(), byIndex);
+			glm::dvec3 normal(0.0);
+			double totalAngle = 0.0;
+			for (Triangle* t : star)
+			{
+				normal += t->normal;
+				totalAngle += clist[3 * t->index + t->Contains(&v)].angle;
+			}
+			v.normal = glm::normalize(normal);
+			v.totalAngle = totalAngle;
+		}
+	});
+
+	for (int i = 0; i < triangles.size(); ++i)
+	{
+		surfaceArea += triangles[i]->area - oldAreas[i];
 	}
+	for (int i = 0; i < vertices.size(); ++i)
+	{
+		angleDeficit += oldAngles[i] - vlist[vertices[i]].totalAngle;
+	}
+
+	MeshAnalysis::ComputeCurvatureGeometry(this, triangles, vertices);
+	return vertices;
 }
 
 
-void Polyhedron::CreateEdges()
+
+
+void Polyhedron::ConnectVerticesToTriangles()
 {
-	// Loop through the triangles of the polyhedron.
-	// Create edges between vertices using the CreateEdge() method.
-	// Skip over triangle edges that have already been created.
-	// To ensure that this works, first set all edge pointers to NULL.
-	for (int i = 0; i < tlist.size(); ++i)
+	// Count the triangles of each vertex first, so every list is allocated once, at its final size.
+	// The vertex lists take 3T pointers, and the edge lists made next in CreateEdges() about as many again.
+	std::vector<int> counts(vlist.size(), 0);
+	for (Triangle& t : tlist)
 	{
 		for (int j = 0; j < 3; ++j)
 		{
-			tlist[i].edges[j] = NULL;
+			++counts[t.vertices[j]->index];
 		}
 	}
+	CreateArena(6 * tlist.size());
+	for (int i = 0; i < vlist.size(); ++i)
+	{
+		AttachToArena(vlist[i].triangles, counts[i]);
+	}
 
-	// Now get to creating edges.
+	// Go through the triangles:
 	for (int i = 0; i < tlist.size(); ++i)
 	{
-		//std::cout << "BEGIN ANALYSIS OF TRIANGLE " << i << std::endl;
-		Triangle t = tlist[i];
+		Triangle* t = &tlist[i];	
+
+		// Add a pointer to the current triangle to each of its vertices.
 		for (int j = 0; j < 3; ++j)
 		{
-			// If this edge exists, skip.
-			if (!t.edges[j])
-			{
-				Vert* v0 = t.vertices[j];
-				Vert* v1 = t.vertices[(j+1)%3];
-				CreateEdge(v0, v1);
-			}
+			Vert* v = t->vertices[j];
+			v->triangles.push_back(t);
 		}
 	}
 }
 
-
-void Polyhedron::OrderVertexToTrianglePointers(Vert v)
+void Polyhedron::CreateEdges()
 {
-	// Start at the 0th triangle.
-	Triangle* t = v.triangles[0];
-	Triangle* next;
-
-	// Go backwards (clockwise) around triangles around a vertex to find the boundary.
-	int k = -1;
-	for (int i = 1; i <= v.GetNumberOfTriangles(); ++i)
+	// Every triangle contributes three half-edges: edges[j] runs from vertices[j] to vertices[(j+1)%3].
+	// Gather the vertex indices into a flat list and let the edge table match the half-edges up in O(T + V).
+	// Edges are numbered in order of first appearance, which is the order the star-scanning version produced.
+	int numTriangles = tlist.size();
+	std::vector<int> indices(3 * numTriangles);
+	for (int i = 0; i < numTriangles; ++i)
 	{
-		// First, get the index of v in t.
-		k = t->Contains(&v);
-		if (k == -1)
+		for (int j = 0; j < 3; ++j)
 		{
-			break;
+			indices[3 * i + j] = tlist[i].vertices[j]->index;
 		}
-
-		// The corresponding face is the previous one around v.
-		Edge* e = t->edges[k];	
-
-		next = e->GetOtherTriangle(t);
-
-		// If this is a boundary:
-		if (next == NULL)
+	}
+	std::vector<int> halfEdges;
+	int numEdges = EdgeTable::Build(indices, vlist.size(), halfEdges);
+
+	// Now that the number of edges is known, size the edge list once.
+	// No push_back happens after this point, so the pointers handed out below stay valid.
+	elist.clear();
+	elist.resize(numEdges);
+	for (int i = 0; i < numTriangles; ++i)
+	{
+		Triangle* t = &tlist[i];
+		for (int j = 0; j < 3; ++j)
 		{
-			// Find a reference to t in v.
-			for (int j = 0; j < v.GetNumberOfTriangles(); ++j)
+			Edge* e = &elist[halfEdges[3 * i + j]];
+
+			// The first half-edge to reach an edge decides its orientation.
+			// Interior edges have two triangles, so make room for both at once.
+			if (e->index == -1)
 			{
-				if (v.triangles[j] == t)
-				{
-					v.triangles[j] = v.triangles[0];
-					v.triangles[0] = t;
-					break;
-				}
+				e->index = halfEdges[3 * i + j];
+				e->vertices[0] = t->vertices[j];
+				e->vertices[1] = t->vertices[(j+1)%3];
+				AttachToArena(e->triangles, 2);
 			}
+
+			// Triangles are visited in index order, so each edge lists its triangles in index order.
+			e->triangles.push_back(t);
+			t->edges[j] = e;
 		}
-		else
+	}
+}
+
+
+void Polyhedron::OrderVertexToTrianglePointers()
+{
+	// Each vertex only rearranges its own list, so the order does not depend on the blocks.
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(vlist.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<Triangle*> fan;
+		for (int i = begin; i < end; ++i)
 		{
-			t = next;
+			OrderVertexToTrianglePointers(vlist[i], fan);
 		}
+	});
+}
+
+void Polyhedron::OrderVertexToTrianglePointers(Vert& v, std::vector<Triangle*>& fan)
+{
+	// Nothing to order around a vertex without triangles.
+	if (v.c == NULL)
+		return;
+	int count = v.GetNumberOfTriangles();
+
+	// Swing clockwise (c.n.o.n) from the corner of the vertex to the boundary.
+	// Coming back around to v.c instead means the star is closed, and then the corner reached last is the one after v.c,
+	// so the triangles come out in the order of MeshAnalysis::GetVertexStar().
+	Corner* start = v.c;
+	for (int i = 0; i < count; ++i)
+	{
+		Corner* o = start->n->o;
+		if (o == NULL || o->n->v != &v || o->n == v.c)
+			break;
+		start = o->n;
 	}
 
-	// Now walk around in the forward direction and place them in order.
-	t = v.triangles[0];
-	int count = 0;
-	
-	for (int i = 0; i < v.GetNumberOfTriangles(); ++i)
+	// Now swing counterclockwise (c.p.o.p) and take the triangles in order.
+	fan.clear();
+	Corner* c = start;
+	do
 	{
-		// Find reference to v in t.
-		k = t->Contains(&v);
-		if (k == -1)
+		fan.push_back(c->t);
+		Corner* o = c->p->o;
+		c = (o == NULL || o->p->v != &v) ? NULL : o->p;
+	} while (c != NULL && c != start && fan.size() < count);
+
+	// Where several fans meet at the vertex, the triangles of the others keep their old order after this one.
+	if (fan.size() < count)
+	{
+		for (Triangle* t : v.triangles)
 		{
-			break;
+			if (std::find(fan.begin(), fan.end(), t) == fan.end())
+				fan.push_back(t);
 		}
-		 // The corresponding face is the next one around v.
-		 Edge* e = t->edges[k];
-		 next = e->GetOtherTriangle(t);
-
-		 // Break if we reached a boundary;
-		 if (next == NULL)
-		 {
-			 break;
-		 }
-
-		 // Swap the next face into its proper place in the face list.
-		 for (int j = 0; j < v.GetNumberOfTriangles(); ++j)
-		 {
-			if (v.triangles[j] == next)
-			{
-				v.triangles[j] = v.triangles[i];
-				v.triangles[i] = next;
-				break;
-			}
-		 }
-		 t = next;
 	}
-	
+	std::copy(fan.begin(), fan.begin() + count, v.triangles.begin());
 }
 
 void Polyhedron::ComputeBoundingSphere()
 {
-	glm::dvec3 min = glm::dvec3(vlist[0].x, vlist[0].y, vlist[0].z);
-	glm::dvec3 max = min;
-	for (int i = 0; i < vlist.size(); ++i)
+	if (vlist.empty())
+		return;
+
+	// Each block finds its own box; min and max come out the same whichever way the blocks are combined.
+	const int BLOCK_SIZE = 16384;
+	int numBlocks = (vlist.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<glm::dvec3> mins(numBlocks);
+	std::vector<glm::dvec3> maxs(numBlocks);
+	Parallel::For(numBlocks, [&](int i)
 	{
-		if (vlist[i].x < min.x)
-			min.x = vlist[i].x;
-		if (vlist[i].x > max.x)
-			max.x = vlist[i].x;
-		if (vlist[i].y < min.y)
-			min.y = vlist[i].y;
-		if (vlist[i].y > max.y)
-			max.y = vlist[i].y;
-		if (vlist[i].z < min.z)
-			min.z = vlist[i].z;
-		if (vlist[i].z > max.z)
-			max.z = vlist[i].z;
+		int end = std::min((int)vlist.size(), (i + 1) * BLOCK_SIZE);
+		glm::dvec3 min = vlist[i * BLOCK_SIZE].GetPosition();
+		glm::dvec3 max = min;
+		for (int j = i * BLOCK_SIZE; j < end; ++j)
+		{
+			min = glm::min(min, vlist[j].GetPosition());
+			max = glm::max(max, vlist[j].GetPosition());
+		}
+		mins[i] = min;
+		maxs[i] = max;
+	});
+
+	glm::dvec3 min = mins[0];
+	glm::dvec3 max = maxs[0];
+	for (int i = 1; i < numBlocks; ++i)
+	{
+		min = glm::min(min, mins[i]);
+		max = glm::max(max, maxs[i]);
 	}
 	center = 0.5 * (min + max);
 	radius = glm::length(center - min);
@@ -512,44 +523,58 @@ void Polyhedron::ComputeBoundingSphere()
 
 void Polyhedron::ComputeNormalsAndArea()
 {
-	double signedVolume = 0.0;
-
-	// Go through the triangle list and call the method on each triangle.
-	for (int i = 0; i < tlist.size(); ++i)
+	// Compute the normal and area of each triangle, and its share of the signed volume, in parallel.
+	std::vector<double> volumes(tlist.size());
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(tlist.size(), BLOCK_SIZE, [&](int begin, int end)
 	{
-		Triangle& t = tlist[i];
-
-		// Compute the normal and area of this triangle.
-		t.ComputeNormalAndArea();
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = tlist[i];
+			t.ComputeNormalAndArea();
 
-		// Add to the total surface area.
-		surfaceArea += t.area;
+			glm::dvec3 first(t.vertices[0]->x, t.vertices[0]->y, t.vertices[0]->z);
+			volumes[i] = glm::dot(center - first, t.normal) * t.area;
+		}
+	});
 
-		glm::dvec3 first(t.vertices[0]->x, t.vertices[0]->y, t.vertices[0]->z);
-		signedVolume += glm::dot(center - first, t.normal) * t.area;
+	// Add up the surface area and volume in triangle order.
+	double signedVolume = 0.0;
+	for (int i = 0; i < tlist.size(); ++i)
+	{
+		surfaceArea += tlist[i].area;
+		signedVolume += volumes[i];
 	}
 
 	// Now orient the normals in the triangles:
+	orientation = (signedVolume > 0) ? -1.0 : 1.0;
 	if (signedVolume > 0)
 	{
-		for (int i = 0; i < tlist.size(); ++i)
+		Parallel::ForBlocks(tlist.size(), BLOCK_SIZE, [&](int begin, int end)
 		{
-			tlist[i].normal *= -1.0;
-		}
+			for (int i = begin; i < end; ++i)
+			{
+				tlist[i].normal *= -1.0;
+			}
+		});
 	}
 }
 
 void Polyhedron::InterpolateNormals()
 {
-	for (int i = 0; i < vlist.size(); ++i)
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(vlist.size(), BLOCK_SIZE, [&](int begin, int end)
 	{
-		Vert& v = vlist[i];
-		for (int j = 0; j < v.GetNumberOfTriangles(); ++j)
+		for (int i = begin; i < end; ++i)
 		{
-			v.normal += v.triangles[j]->normal;
+			Vert& v = vlist[i];
+			for (int j = 0; j < v.GetNumberOfTriangles(); ++j)
+			{
+				v.normal += v.triangles[j]->normal;
+			}
+			v.normal = glm::normalize(v.normal);
 		}
-		v.normal = glm::normalize(v.normal);
-	}
+	});
 }
 
 void Polyhedron::PrintVertices()
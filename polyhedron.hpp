@@ -2,33 +2,77 @@
 
 #include <fstream>
 #include <string>
+#include <map>
+#include <memory>
+#include <memory_resource>
 #include "geometry.hpp"
+#include "edgetable.hpp"
 #include "meshanalysis.hpp"
-
-// Mesh class with adjacency information through vertices, edges, and triangles.
+#include "timing.hpp"
+
+/** Mesh class with adjacency information through vertices, edges, and triangles.
+ *
+ * The vertices, edges, triangles and corners point at each other, and all of them live in the four lists below.
+ * A std::vector moves its elements when it grows, so each list is sized once, from the input
+ * (a file header, the counts of the mesh being subdivided, the number of edges found), before any pointer into it
+ * is taken, and does not grow after that. Nothing is reserved up front beyond what the input asks for.
+ *
+ * Moving a polyhedron hands over the buffers of the lists, so it is O(1) and every pointer stays valid.
+ * Copying one copies the lists and then aims every pointer of the copy at the copy's own elements.
+ *
+ * The triangle lists of the vertices and edges, one small allocation each, come out of a single arena
+ * that Initialize() sizes from the number of triangles. Freeing the mesh releases the arena in one piece
+ * instead of returning a million small blocks to the heap one at a time.
+ * A copy's lists are allocated on the heap, so a copy never depends on the arena of the original.
+ */
 class Polyhedron
 {
 
 public:
 
 	Polyhedron();
+
+	// Reserve room for the given number of vertices, edges and triangles.
 	Polyhedron(int vertices, int edges, int triangles);
 
-	// Create a polyhedron from reading in a .ply file.
+	// Create a polyhedron from reading in a .ply file (ascii or binary).
 	Polyhedron(std::string file);
+
+	// Create a polyhedron from reading in a .obj file.
 	Polyhedron(std::string file, int a);
+
+	// Read a mesh file into an empty polyhedron: .obj files by extension, anything else as .ply.
+	static IOResult Read(const std::string& file, Polyhedron& p);
 	//Polyhedron(std::vector<MeshComponent>& meshes);
 	~Polyhedron();
-	/*
 	Polyhedron(const Polyhedron& p);
 	Polyhedron(Polyhedron&& p);
+	Polyhedron& operator=(const Polyhedron& p);
 	Polyhedron& operator=(Polyhedron&& p);
-	*/
 
 
 	// Do all of the operations to prepare this mesh.
 	void Initialize();
 
+	// Move a vertex of an initialized mesh. What was computed around it is out of date until the next Update().
+	void MoveVertex(int vertex, const glm::dvec3& position);
+
+	// Bring everything around the vertices moved since the last Update() up to date, as Initialize() would compute it:
+	// the normals and areas of their triangles, the angles and cotangents of those corners, the lengths and dihedral angles
+	// of those edges, and the normals, total angles, mixed areas and perimeters of every vertex of those triangles.
+	// The surface area and angle deficit are adjusted by the change. The bounding sphere is left alone.
+	// Returns the vertices of those triangles, in increasing order: the only ones whose curvatures can have changed,
+	// for MeshAnalysis::UpdateVertexCurvatures().
+	std::vector<int> Update();
+
+	// Give every vertex and edge a new, empty triangle list and start a new arena with room for the given number
+	// of triangle pointers. The old arena is released after nothing refers to it anymore.
+	void CreateArena(size_t numPointers);
+
+	// Replace one of the triangle lists of this polyhedron by an empty one in the arena, with room for size triangles.
+	// The arena is not thread safe: attach the lists first, then fill them in parallel.
+	void AttachToArena(std::pmr::vector<Triangle*>& list, int size);
+
 	// Info dump:
 	void PrintVertices();
 	void PrintEdges();
@@ -51,25 +95,59 @@ public:
 	int valenceDeficit = 0;
 	double angleDeficit = 0.0;
 
+	// -1 if Initialize() turned the triangle normals around to point out of the mesh, 1 if not.
+	double orientation = 1.0;
+
+	// Wall time of each stage of the last Initialize().
+	StageTimer initializeTimes;
+
+	// Backs the triangle lists of vlist and elist.
+	// It is declared before them so that it outlives them when the polyhedron is destroyed.
+	std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+
 	// Geometry lists:
 	std::vector<Vert> vlist;
 	std::vector<Edge> elist;
 	std::vector<Triangle> tlist;
 	std::vector<Corner> clist;
 
+	// Per-vertex properties read from the mesh file besides the position, keyed by name (e.g. "nx", "red", "quality").
+	// Each list is indexed by vertex index.
+	std::map<std::string, std::vector<float>> vertexProperties;
+
+	// Texture coordinates and normals from the "vt" and "vn" lines of a .obj file, in file order.
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+
+	// For each corner (3 * triangle + k), the index into texCoords or normals given by the face, or -1.
+	// Empty when the file has no texture coordinates or normals.
+	std::vector<int> cornerTexCoords;
+	std::vector<int> cornerNormals;
+
 private:
 
+	// The benchmarks drive the construction stages one at a time.
+	friend class Benchmark;
+	friend class Subdivision;
+
+	// Vertices passed to MoveVertex() since the last Update(), possibly more than once.
+	std::vector<int> movedVertices;
+
+	// Point everything in this polyhedron, whose lists were just copied from p, at its own elements instead of p's.
+	void Relink(const Polyhedron& p);
+
 	// Create pointers from vertices to their triangles.
 	void ConnectVerticesToTriangles();
 
-	// Create an edge between two vertices and add it to elist.
-	void CreateEdge(Vert* v0, Vert* v1);
-
-	// Create all edges, triangle by triangle.
+	// Create all edges at once by matching up the half-edges of the triangles.
 	void CreateEdges();
 
-	// Order the triangles around a vertex counterclockwise.
-	void OrderVertexToTrianglePointers(Vert v);
+	// Order the triangles around every vertex, a block of vertices at a time in parallel.
+	void OrderVertexToTrianglePointers();
+
+	// Order the triangles around a vertex counterclockwise, starting at a boundary if there is one,
+	// in one walk around the vertex with the corners. The fan is scratch space, reused from vertex to vertex.
+	void OrderVertexToTrianglePointers(Vert& v, std::vector<Triangle*>& fan);
 
 	// Compute the radius and center of a sphere that bounds the mesh.
 	void ComputeBoundingSphere();
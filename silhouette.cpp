@@ -62,6 +62,11 @@ glm::dvec3 Silhouette::LinearInterpolateZeroSet(Vert* v0, Vert* v1, double y0, d
 {
 	glm::dvec3 x0 = glm::dvec3(v0->x, v0->y, v0->z);
 	glm::dvec3 x1 = glm::dvec3(v1->x, v1->y, v1->z);
+	return LinearInterpolateZeroSet(x0, x1, y0, y1);
+}
+
+glm::dvec3 Silhouette::LinearInterpolateZeroSet(glm::dvec3 x0, glm::dvec3 x1, double y0, double y1)
+{
 	double z0 = -y1 / (y0 - y1);
 	double z1 = -y0 / (y1 - y0);
 	return z0 * x0 + z1 * x1;
@@ -110,5 +115,59 @@ std::vector<glm::dvec3> Silhouette::GetSilhouetteEdgesFromVertices(View& view)
 	return silhouetteEdges;
 }
 
+std::vector<int32_t> Silhouette::GetSilhouetteEdgesFromFaces(const CompactMesh& m, glm::dvec3 viewDirection)
+{
+	// Front-facing triangles, as in GetFrontFacingTriangles().
+	std::vector<bool> frontTriangles(m.GetNumberOfTriangles());
+	for (int32_t t = 0; t < m.GetNumberOfTriangles(); ++t)
+	{
+		float dot = glm::dot(viewDirection, m.faceNormals[t]);
+		frontTriangles[t] = (dot < 0);
+	}
+
+	// Pick out the edges that connect a front-facing triangle to a back-facing one.
+	std::vector<int32_t> silhouetteEdges;
+	for (int32_t e = 0; e < m.GetNumberOfEdges(); ++e)
+	{
+		int32_t h = m.edgeHalfEdges[e];
+		int32_t o = m.O(CompactMesh::P(h));
+		if (o >= 0 && frontTriangles[CompactMesh::T(h)] != frontTriangles[CompactMesh::T(o)])
+		{
+			silhouetteEdges.push_back(m.V(h));
+			silhouetteEdges.push_back(m.V(CompactMesh::N(h)));
+		}
+	}
+	return silhouetteEdges;
+}
+
+std::vector<glm::dvec3> Silhouette::GetSilhouetteEdgesFromVertices(const CompactMesh& m, glm::dvec3 viewDirection)
+{
+	// Front-facing vertices, as in GetFrontFacingVertices().
+	std::vector<bool> frontVertices(m.GetNumberOfVertices());
+	for (int32_t v = 0; v < m.GetNumberOfVertices(); ++v)
+	{
+		float dot = glm::dot(viewDirection, m.normals[v]);
+		frontVertices[v] = (dot < 0);
+	}
+
+	// Every edge of every triangle whose endpoints differ contributes its zero crossing.
+	// The edges are oriented as in the Polyhedron, so the points come out the same.
+	std::vector<glm::dvec3> silhouetteEdges;
+	for (int32_t c = 0; c < m.GetNumberOfCorners(); ++c)
+	{
+		// Half-edge c is opposite corner P(c).
+		int32_t h = m.edgeHalfEdges[m.E(CompactMesh::P(c))];
+		int32_t v0 = m.V(h);
+		int32_t v1 = m.V(CompactMesh::N(h));
+		if (frontVertices[v0] != frontVertices[v1])
+		{
+			double y0 = glm::dot(viewDirection, m.normals[v0]);
+			double y1 = glm::dot(viewDirection, m.normals[v1]);
+			silhouetteEdges.push_back(LinearInterpolateZeroSet(m.positions[v0], m.positions[v1], y0, y1));
+		}
+	}
+	return silhouetteEdges;
+}
+
 Silhouette::Silhouette() {}
 Silhouette::~Silhouette() {}
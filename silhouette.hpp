@@ -2,6 +2,7 @@
 
 #include<map>
 #include "polyhedron.hpp"
+#include "compactmesh.hpp"
 #include "view.hpp"
 
 
@@ -31,10 +32,16 @@ public:
 
 	// Linearly interpolate between two given values to get a point for which the dot product is exactly zero.
 	static glm::dvec3 LinearInterpolateZeroSet(Vert* v0, Vert* v1, double y0, double y1);
+	static glm::dvec3 LinearInterpolateZeroSet(glm::dvec3 x0, glm::dvec3 x1, double y0, double y1);
 
 	// Using the front-facing vertices, extract the silhouette edges.
 	static std::vector<glm::dvec3> GetSilhouetteEdgesFromVertices(View& view);
 
+	// The same two methods on a compact mesh, looking along the given direction.
+	// Edges from faces come back as pairs of vertex indices. Boundary edges are never part of a face silhouette.
+	static std::vector<int32_t> GetSilhouetteEdgesFromFaces(const CompactMesh& m, glm::dvec3 viewDirection);
+	static std::vector<glm::dvec3> GetSilhouetteEdgesFromVertices(const CompactMesh& m, glm::dvec3 viewDirection);
+
 
 private:
 
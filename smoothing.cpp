@@ -0,0 +1,189 @@
+#include "smoothing.hpp"
+#include "parallel.hpp"
+
+Smoothing::Smoothing(Polyhedron* p, Method method, double dt)
+	: p(p), method(method), dt(dt)
+{
+	rebuildInterval = (method == Method::EXPLICIT) ? 1 : 0;
+	Rebuild();
+}
+
+void Smoothing::Rebuild()
+{
+	laplacian.Build(p);
+	factored = (method == Method::IMPLICIT) && laplacian.Factor(dt);
+}
+
+bool Smoothing::Step(std::vector<int>& vertices)
+{
+	if (steps > 0 && rebuildInterval > 0 && steps % rebuildInterval == 0)
+		Rebuild();
+
+	int n = p->vlist.size();
+	positions.resize(3 * n);
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(n, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = p->vlist[i];
+			positions[3 * i] = v.x;
+			positions[3 * i + 1] = v.y;
+			positions[3 * i + 2] = v.z;
+		}
+	});
+
+	vertices.clear();
+	if (method == Method::EXPLICIT)
+		laplacian.ExplicitStep(positions, next, 3, dt);
+	else if (!laplacian.ImplicitStep(positions, next, 3, dt))
+		return false;
+
+	for (int i = 0; i < n; ++i)
+	{
+		if (next[3 * i] != positions[3 * i] || next[3 * i + 1] != positions[3 * i + 1] || next[3 * i + 2] != positions[3 * i + 2])
+			p->MoveVertex(i, glm::dvec3(next[3 * i], next[3 * i + 1], next[3 * i + 2]));
+	}
+	++steps;
+	vertices = p->Update();
+	return true;
+}
+
+int Smoothing::Run(int argc, char* argv[])
+{
+	if (argc < 4)
+	{
+		std::cout << "Usage: " << argv[0] << " --smooth <input> <output.obj> [steps] [dt] [implicit | iterative | explicit]" << std::endl;
+		std::cout << "  steps: number of time steps (10)" << std::endl;
+		std::cout << "  dt: time step as a fraction of the squared bounding radius (0.001),"
+			<< " or the stable limit for explicit steps if not given" << std::endl;
+		return -1;
+	}
+
+	std::string input = argv[2];
+	std::string output = argv[3];
+	int numSteps = 10;
+	if (argc > 4 && (!ParseArgument(argv[4], numSteps) || numSteps < 0))
+	{
+		std::cout << "INVALID NUMBER OF STEPS: " << argv[4] << std::endl;
+		return -1;
+	}
+	double dtScale = 0.0;
+	if (argc > 5 && (!ParseArgument(argv[5], dtScale) || !(dtScale > 0.0) || std::isinf(dtScale)))
+	{
+		std::cout << "INVALID TIME STEP: " << argv[5] << std::endl;
+		return -1;
+	}
+	std::string methodName = (argc > 6) ? argv[6] : "implicit";
+	Method method = Method::IMPLICIT;
+	if (methodName == "explicit")
+		method = Method::EXPLICIT;
+	else if (methodName == "iterative")
+		method = Method::IMPLICIT_ITERATIVE;
+	else if (methodName != "implicit")
+	{
+		std::cout << "UNKNOWN METHOD: " << methodName << std::endl;
+		return -1;
+	}
+
+	Timer timer;
+	Polyhedron p(0, 0, 0);
+	IOResult result = Polyhedron::Read(input, p);
+	if (!result.success)
+	{
+		std::cout << result.message << std::endl;
+		return 1;
+	}
+	p.Initialize();
+	std::cout << input << ": " << p.vlist.size() << " vertices, " << p.tlist.size() << " triangles, read and initialized in "
+		<< std::fixed << std::setprecision(1) << timer.Milliseconds() << " ms." << std::endl;
+
+	// Mean curvature flow runs on a clock of squared length, so the step is scaled by the size of the mesh.
+	double dt;
+	if (argc > 5)
+	{
+		dt = dtScale * p.radius * p.radius;
+	}
+	else if (method != Method::EXPLICIT)
+	{
+		dt = 0.001 * p.radius * p.radius;
+	}
+	else
+	{
+		Laplacian laplacian;
+		laplacian.Build(&p);
+		dt = laplacian.GetExplicitLimit();
+	}
+
+	timer.Start();
+	Smoothing smoothing(&p, method, dt);
+	std::cout << (method == Method::EXPLICIT ? "Explicit" : "Implicit") << " mean curvature flow, dt = " << std::scientific << dt
+		<< std::fixed << ", " << Parallel::GetNumberOfThreads() << " threads. Laplacian built"
+		<< (smoothing.factored ? " and factored" : "") << " in " << timer.Milliseconds() << " ms." << std::endl;
+	if (method == Method::EXPLICIT && dt > smoothing.laplacian.GetExplicitLimit())
+		std::cout << "WARNING: TIME STEP IS ABOVE THE EXPLICIT LIMIT OF " << std::scientific << smoothing.laplacian.GetExplicitLimit()
+			<< std::fixed << ". THE FLOW MAY BLOW UP." << std::endl;
+
+	// The mean curvature is brought up to date with the mesh after every step, around the vertices that moved.
+	std::vector<std::vector<double>> curvature = MeshAnalysis::GetVertexCurvatures<Curvature::MEAN>(&p);
+	std::cout << std::setw(8) << "step" << std::setw(12) << "time (ms)" << std::setw(16) << "surface area" << std::setw(16) << "max |H|" << std::endl;
+	Timer total;
+	for (int step = 1; step <= numSteps; ++step)
+	{
+		timer.Start();
+		std::vector<int> vertices;
+		if (!smoothing.Step(vertices))
+		{
+			std::cout << "CONJUGATE GRADIENTS DID NOT CONVERGE IN STEP " << step << ". " << output << " WAS NOT WRITTEN." << std::endl;
+			return 1;
+		}
+		MeshAnalysis::UpdateVertexCurvatures<Curvature::MEAN>(&p, vertices, curvature);
+		double stepTime = timer.Milliseconds();
+
+		double largest = 0.0;
+		for (double h : curvature[0])
+		{
+			largest = std::max(largest, std::abs(h));
+		}
+		std::cout << std::setw(8) << step << std::setw(12) << std::setprecision(1) << stepTime
+			<< std::setw(16) << std::setprecision(6) << p.surfaceArea << std::setw(16) << largest << std::endl;
+	}
+	std::cout << numSteps << " steps in " << std::setprecision(1) << total.Milliseconds() << " ms." << std::endl;
+
+	result = ObjFile::Write(output, p);
+	if (!result.success)
+	{
+		std::cout << result.message << std::endl;
+		return 1;
+	}
+	std::cout << "Wrote " << output << "." << std::endl;
+	return 0;
+}
+
+bool Smoothing::ParseArgument(const char* text, int& value)
+{
+	try
+	{
+		size_t end;
+		value = std::stoi(text, &end);
+		return text[end] == '\0';
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
+
+bool Smoothing::ParseArgument(const char* text, double& value)
+{
+	try
+	{
+		size_t end;
+		value = std::stod(text, &end);
+		return text[end] == '\0';
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include "polyhedron.hpp"
+#include "laplacian.hpp"
+#include "objfile.hpp"
+#include "timing.hpp"
+
+/** Mean curvature flow: every vertex moves along its mean curvature normal, dx/dt = L x = -2 H n,
+ * which takes the noise off a surface before its shape. From:
+ * Desbrun, Meyer, Schroder and Barr, Implicit fairing of irregular meshes using diffusion and curvature flow (1999).
+ *
+ * An explicit step x' = x + dt L x is one trip over the Laplacian, but is only stable for dt up to
+ * Laplacian::GetExplicitLimit(), which shrinks with the smallest triangles.
+ * An implicit step solves (M - dt W) x' = M x and is stable for any dt. As in the paper, the Laplacian is taken from
+ * the mesh as it is when the flow starts and kept for the steps after, so the matrix does not change and its Cholesky
+ * factorization is computed once; each step is then a pair of triangular solves for each of x, y and z.
+ * On meshes large enough that factoring costs more than it saves, IMPLICIT_ITERATIVE solves each step by conjugate
+ * gradients instead. rebuildInterval takes the Laplacian from the moved mesh every so many steps.
+ *
+ * Each step moves the vertices with Polyhedron::MoveVertex() and brings the normals, areas and cached geometry
+ * up to date with Polyhedron::Update(). The vertices it gives back are the ones to pass to
+ * MeshAnalysis::UpdateVertexCurvatures() and MeshComponent::UpdateVertices(). Boundary vertices do not move.
+ *
+ * Run() smooths a mesh file from the command line without opening a window:
+ *
+ *     ./build --smooth <input> <output.obj> [steps] [dt] [implicit | iterative | explicit]
+ */
+class Smoothing
+{
+
+public:
+
+	enum class Method { EXPLICIT, IMPLICIT, IMPLICIT_ITERATIVE };
+
+	// Start the flow on an initialized polyhedron, with a fixed time step.
+	// The Laplacian is built, and for implicit steps factored, here.
+	Smoothing(Polyhedron* p, Method method, double dt);
+
+	// Take one step and bring the mesh up to date, with the vertices whose geometry changed in increasing order.
+	// Returns false, and leaves the mesh as it was, if conjugate gradients did not converge.
+	bool Step(std::vector<int>& vertices);
+
+	// Take the Laplacian from the mesh as it is now, and factor it again for implicit steps.
+	void Rebuild();
+
+	// Dispatch the command line of a headless run. Returns the exit code for main().
+	static int Run(int argc, char* argv[]);
+
+	// Rebuild() before every this many steps, or never if 0.
+	// Explicit steps rebuild every step by default, since a rebuild costs about as much as the step;
+	// implicit steps keep their factorization.
+	int rebuildInterval;
+
+	// Steps taken so far.
+	int steps = 0;
+
+	// False if the factorization failed and implicit steps fall back to conjugate gradients.
+	bool factored = false;
+
+	Laplacian laplacian;
+
+private:
+
+	// Parse a whole command line argument as a number. Returns false if it is not one.
+	static bool ParseArgument(const char* text, int& value);
+	static bool ParseArgument(const char* text, double& value);
+
+	Polyhedron* p;
+	Method method;
+	double dt;
+
+	// Positions before and after a step, n rows of x, y, z.
+	std::vector<double> positions;
+	std::vector<double> next;
+
+};
@@ -1,4 +1,5 @@
 #include "spherical.hpp"
+#include "meshanalysis.hpp"
 
 std::vector<glm::vec3> Spherical::GetPolarPolygon(std::vector<glm::vec3>& polygon)
 {
@@ -122,5 +123,20 @@ std::vector<glm::vec3> Spherical::GetGaussMap(std::vector<Triangle*>& star, uint
 
 
 
+std::vector<glm::vec3> Spherical::GetGaussMap(const CompactMesh& m, int32_t vertex, uint count, float sphereRadius)
+{
+	CompactMesh::Range star = m.GetStar(vertex);
+	if (star.empty())
+		return std::vector<glm::vec3>();
+
+	std::vector<glm::vec3> normals;
+	normals.reserve(star.size());
+	for (int32_t c : star)
+	{
+		normals.push_back((glm::vec3)m.faceNormals[CompactMesh::T(c)]);
+	}
+	return GetGaussMap(normals, count, sphereRadius);
+}
+
 Spherical::Spherical(){}
 Spherical::~Spherical(){}
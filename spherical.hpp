@@ -4,6 +4,7 @@
 #include <vector>
 #include "glm/glm.hpp"
 #include "geometry.hpp"
+#include "compactmesh.hpp"
 #include "vertex.hpp"
 
 // Render spherical areas such as the Gauss map of the star of a vertex.
@@ -17,6 +18,9 @@ public:
 	std::vector<glm::vec3> static GetGaussMap(std::vector<Triangle*>& star, uint count, float sphereRadius);
 	std::vector<glm::vec3> static GetGaussMap(std::vector<glm::vec3>& star, uint count, float sphereRadius);
 
+	// The Gauss map of the star of a vertex of a compact mesh. Empty if the vertex is on a boundary.
+	std::vector<glm::vec3> static GetGaussMap(const CompactMesh& m, int32_t vertex, uint count, float sphereRadius);
+
 	// Given the vertices of a spherical polygon, compute the polar polygon.
 	// The ith output vector is the dual to the ith input vector.
 	std::vector<glm::vec3> static GetPolarPolygon(std::vector<glm::vec3>& polygon);
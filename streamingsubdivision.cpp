@@ -0,0 +1,569 @@
+#include "streamingsubdivision.hpp"
+#include "subdivision.hpp"
+#include "meshanalysis.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+IOResult StreamingSubdivision::Subdivide(const CompactMesh& m, int levels, const std::string& file, int batchFaces)
+{
+	std::vector<Statistics> statistics;
+	return Subdivide(m, levels, file, std::vector<Curvature>(), statistics, batchFaces);
+}
+
+IOResult StreamingSubdivision::Subdivide(const CompactMesh& m, int levels, const std::string& file,
+	const std::vector<Curvature>& curvatures, std::vector<Statistics>& statistics, int batchFaces)
+{
+	statistics.assign(curvatures.size(), Statistics());
+	if (levels < 0 || levels > 15)
+	{
+		return IOResult::Error("NUMBER OF SUBDIVISIONS OUT OF RANGE: " + std::to_string(levels));
+	}
+	uint64_t numVertices, numFaces;
+	GetCounts(m, levels, numVertices, numFaces);
+	if (numVertices > std::numeric_limits<uint32_t>::max())
+	{
+		return IOResult::Error("TOO MANY VERTICES FOR 32-BIT INDICES: " + file);
+	}
+
+	if (batchFaces <= 0)
+		batchFaces = GetDefaultBatchFaces(levels);
+	std::vector<std::vector<int32_t>> batches = GetBatches(m, batchFaces);
+	Layout layout;
+	GetLayout(m, batches, levels, layout);
+	int64_t childrenPerFace = (int64_t)1 << (2 * levels);
+
+	// The header, and then every vertex and face at a fixed size, so each batch knows where its part goes.
+	const uint16_t one = 1;
+	bool littleHost = (*(const uint8_t*)&one == 1);
+	std::ostringstream header;
+	header << "ply\n"
+		<< "format " << (littleHost ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+		<< "element vertex " << numVertices << "\n"
+		<< "property double x\n"
+		<< "property double y\n"
+		<< "property double z\n"
+		<< "element face " << numFaces << "\n"
+		<< "property list uchar uint vertex_indices\n"
+		<< "end_header\n";
+	std::string text = header.str();
+	const int64_t VERTEX_SIZE = 3 * sizeof(double);
+	const int64_t FACE_SIZE = 1 + 3 * sizeof(uint32_t);
+	int64_t vertexOffset = text.size();
+	int64_t faceOffset = vertexOffset + VERTEX_SIZE * (int64_t)numVertices;
+
+	// Write under a temporary name, then move it into place.
+	std::string temporary = file + ".tmp";
+	FILE* f = fopen(temporary.c_str(), "wb");
+	if (f == NULL)
+	{
+		return IOResult::Error("FILE COULD NOT BE OPENED: " + file + " (" + strerror(errno) + ")");
+	}
+	bool failed = fwrite(text.data(), 1, text.size(), f) != text.size();
+	auto write = [&](int64_t offset, const void* data, size_t size)
+	{
+		failed = failed || fseeko(f, offset, SEEK_SET) != 0 || fwrite(data, 1, size, f) != size;
+	};
+
+	double orientation = GetOrientation(m, std::vector<char>(m.GetNumberOfTriangles(), 1));
+	std::vector<double> sums(curvatures.size(), 0.0);
+	std::vector<double> minima(curvatures.size(), std::numeric_limits<double>::max());
+	std::vector<double> maxima(curvatures.size(), std::numeric_limits<double>::lowest());
+	int64_t counted = 0;
+
+	std::vector<char> faceMarks(m.GetNumberOfTriangles(), 0);
+	std::vector<char> vertexMarks(m.GetNumberOfVertices(), 0);
+	std::vector<int32_t> vertexIndices(m.GetNumberOfVertices(), -1);
+	std::vector<double> vertexBuffer;
+	std::vector<char> written;
+	std::vector<char> faceBuffer;
+	for (int b = 0; b < batches.size() && !failed; ++b)
+	{
+		const std::vector<int32_t>& batch = batches[b];
+		Patch patch;
+		GetPatch(m, batch, faceMarks, vertexMarks, vertexIndices, patch);
+		for (int level = 0; level < levels; ++level)
+		{
+			SubdividePatch(patch, level == levels - 1);
+		}
+		const CompactMesh& child = patch.mesh;
+
+		std::vector<std::vector<double>> values;
+		if (!curvatures.empty())
+		{
+			// The patch turned its faces by its own signed volume, which says nothing for a piece of a surface.
+			if (GetOrientation(child, patch.inBatch) != orientation)
+			{
+				CompactMesh& turned = patch.mesh;
+				for (glm::dvec3& normal : turned.faceNormals)
+				{
+					normal = -normal;
+				}
+				for (glm::dvec3& normal : turned.normals)
+				{
+					normal = -normal;
+				}
+			}
+			values = MeshAnalysis::GetVertexCurvatures(child, curvatures);
+		}
+
+		// Every corner of a face of the batch finds the index of its vertex on the lattice; the vertices the batch
+		// writes are all at such corners, and are put in the run of the batch the first time they come up.
+		int64_t first = layout.vertexStarts[b];
+		int64_t count = layout.batchEnds[b] - first;
+		vertexBuffer.assign(3 * count, 0.0);
+		written.assign(count, 0);
+		faceBuffer.resize(FACE_SIZE * childrenPerFace * batch.size());
+		char* record = faceBuffer.data();
+		for (int32_t t = 0; t < child.GetNumberOfTriangles(); ++t)
+		{
+			if (!patch.inBatch[t])
+				continue;
+
+			*record++ = 3;
+			for (int k = 0; k < 3; ++k)
+			{
+				int64_t index = GetVertexIndex(m, layout, patch.ancestors[t], patch.lattice[6 * t + 2 * k], patch.lattice[6 * t + 2 * k + 1]);
+				uint32_t vertex = index;
+				memcpy(record, &vertex, sizeof(vertex));
+				record += sizeof(vertex);
+
+				int64_t i = index - first;
+				if (i < 0 || i >= count || written[i])
+					continue;
+				written[i] = 1;
+				int32_t v = child.V(3 * t + k);
+				memcpy(&vertexBuffer[3 * i], &child.positions[v], VERTEX_SIZE);
+				for (int j = 0; j < curvatures.size(); ++j)
+				{
+					double value = values[j][v];
+					sums[j] += value;
+					minima[j] = std::min(minima[j], value);
+					maxima[j] = std::max(maxima[j], value);
+				}
+				++counted;
+			}
+		}
+		write(vertexOffset + VERTEX_SIZE * first, vertexBuffer.data(), VERTEX_SIZE * count);
+
+		// The children of consecutive faces of the mesh are consecutive in the file.
+		for (int i = 0, j; i < batch.size(); i = j)
+		{
+			for (j = i + 1; j < batch.size() && batch[j] == batch[j - 1] + 1; ++j) {}
+			size_t size = FACE_SIZE * childrenPerFace * (j - i);
+			write(faceOffset + FACE_SIZE * childrenPerFace * batch[i], faceBuffer.data() + FACE_SIZE * childrenPerFace * i, size);
+		}
+	}
+
+	// A vertex without faces only shrinks towards the origin, by the even rule with no neighbours.
+	int64_t numIsolated = layout.numVertices - layout.isolatedStart;
+	if (numIsolated > 0)
+	{
+		vertexBuffer.assign(3 * numIsolated, 0.0);
+		for (int32_t v = 0; v < m.GetNumberOfVertices(); ++v)
+		{
+			if (m.vertexCorners[v] >= 0)
+				continue;
+			glm::dvec3 position = m.positions[v];
+			for (int level = 0; level < levels; ++level)
+			{
+				position = ((double)3.0 / 4.0) * position;
+			}
+			memcpy(&vertexBuffer[3 * layout.vertexRanks[v]], &position, VERTEX_SIZE);
+		}
+		write(vertexOffset + VERTEX_SIZE * layout.isolatedStart, vertexBuffer.data(), VERTEX_SIZE * numIsolated);
+	}
+
+	failed = ferror(f) != 0 || failed;
+	if (fclose(f) != 0 || failed || std::rename(temporary.c_str(), file.c_str()) != 0)
+	{
+		std::remove(temporary.c_str());
+		return IOResult::Error("FILE COULD NOT BE WRITTEN: " + file + " (" + strerror(errno) + ")");
+	}
+
+	for (int j = 0; j < curvatures.size() && counted > 0; ++j)
+	{
+		statistics[j] = Statistics(minima[j], maxima[j], sums[j] / counted);
+	}
+	return IOResult::Ok();
+}
+
+void StreamingSubdivision::GetCounts(const CompactMesh& m, int levels, uint64_t& numVertices, uint64_t& numFaces)
+{
+	uint64_t n = (uint64_t)1 << levels;
+	numVertices = m.GetNumberOfVertices() + m.GetNumberOfEdges() * (n - 1) + m.GetNumberOfTriangles() * ((n - 1) * (n - 2) / 2);
+	numFaces = m.GetNumberOfTriangles() * n * n;
+}
+
+int StreamingSubdivision::GetDefaultBatchFaces(int levels)
+{
+	const int CHILD_FACES = 1 << 18;
+	return (2 * levels >= 18) ? 1 : (CHILD_FACES >> (2 * levels));
+}
+
+std::vector<std::vector<int32_t>> StreamingSubdivision::GetBatches(const CompactMesh& m, int batchFaces)
+{
+	int32_t numFaces = m.GetNumberOfTriangles();
+	glm::dvec3 low(std::numeric_limits<double>::max());
+	glm::dvec3 high(std::numeric_limits<double>::lowest());
+	for (int32_t v = 0; v < m.GetNumberOfVertices(); ++v)
+	{
+		low = glm::min(low, m.positions[v]);
+		high = glm::max(high, m.positions[v]);
+	}
+
+	// Spread the 21 bits of an integer out to every third bit.
+	auto spread = [](uint64_t x)
+	{
+		x = (x | (x << 32)) & 0x1F00000000FFFFull;
+		x = (x | (x << 16)) & 0x1F0000FF0000FFull;
+		x = (x | (x << 8)) & 0x100F00F00F00F00Full;
+		x = (x | (x << 4)) & 0x10C30C30C30C30C3ull;
+		x = (x | (x << 2)) & 0x1249249249249249ull;
+		return x;
+	};
+
+	// Morton codes of the centers, on a grid of 2^21 cells a side over the bounding box.
+	const double CELLS = (1 << 21) - 1;
+	std::vector<std::pair<uint64_t, int32_t>> codes(numFaces);
+	Parallel::ForBlocks(numFaces, 4096, [&](int begin, int end)
+	{
+		for (int32_t t = begin; t < end; ++t)
+		{
+			glm::dvec3 center = (m.positions[m.V(3 * t)] + m.positions[m.V(3 * t + 1)] + m.positions[m.V(3 * t + 2)]) / 3.0;
+			uint64_t code = 0;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				double extent = high[axis] - low[axis];
+				double x = (extent > 0.0) ? (center[axis] - low[axis]) / extent : 0.0;
+				code |= spread((uint64_t)(std::min(std::max(x, 0.0), 1.0) * CELLS)) << axis;
+			}
+			codes[t] = std::make_pair(code, t);
+		}
+	});
+	std::sort(codes.begin(), codes.end());
+
+	std::vector<std::vector<int32_t>> batches;
+	for (int32_t i = 0; i < numFaces; i += batchFaces)
+	{
+		int32_t end = std::min(numFaces, i + batchFaces);
+		std::vector<int32_t> batch;
+		batch.reserve(end - i);
+		for (int32_t j = i; j < end; ++j)
+		{
+			batch.push_back(codes[j].second);
+		}
+		std::sort(batch.begin(), batch.end());
+		batches.push_back(batch);
+	}
+	return batches;
+}
+
+void StreamingSubdivision::GetLayout(const CompactMesh& m, const std::vector<std::vector<int32_t>>& batches, int levels, Layout& layout)
+{
+	int numBatches = batches.size();
+	int64_t n = (int64_t)1 << levels;
+	layout.n = n;
+
+	layout.faceBatches.assign(m.GetNumberOfTriangles(), 0);
+	for (int b = 0; b < numBatches; ++b)
+	{
+		for (int32_t t : batches[b])
+		{
+			layout.faceBatches[t] = b;
+		}
+	}
+
+	// Rank every vertex, edge and face among those its batch writes, in index order.
+	std::vector<int32_t> ownedVertices(numBatches, 0);
+	std::vector<int32_t> ownedEdges(numBatches, 0);
+	std::vector<int32_t> ownedFaces(numBatches, 0);
+	int32_t numIsolated = 0;
+	layout.vertexRanks.resize(m.GetNumberOfVertices());
+	for (int32_t v = 0; v < m.GetNumberOfVertices(); ++v)
+	{
+		int32_t c = m.vertexCorners[v];
+		layout.vertexRanks[v] = (c < 0) ? numIsolated++ : ownedVertices[layout.faceBatches[CompactMesh::T(c)]]++;
+	}
+	layout.edgeRanks.resize(m.GetNumberOfEdges());
+	for (int32_t e = 0; e < m.GetNumberOfEdges(); ++e)
+	{
+		layout.edgeRanks[e] = ownedEdges[layout.faceBatches[CompactMesh::T(m.edgeHalfEdges[e])]]++;
+	}
+	layout.faceRanks.resize(m.GetNumberOfTriangles());
+	for (int32_t t = 0; t < m.GetNumberOfTriangles(); ++t)
+	{
+		layout.faceRanks[t] = ownedFaces[layout.faceBatches[t]]++;
+	}
+
+	// Each batch writes its vertices, then the points inside its edges, then the points inside its faces.
+	int64_t next = 0;
+	layout.vertexStarts.resize(numBatches);
+	layout.edgeStarts.resize(numBatches);
+	layout.faceStarts.resize(numBatches);
+	layout.batchEnds.resize(numBatches);
+	for (int b = 0; b < numBatches; ++b)
+	{
+		layout.vertexStarts[b] = next;
+		layout.edgeStarts[b] = layout.vertexStarts[b] + ownedVertices[b];
+		layout.faceStarts[b] = layout.edgeStarts[b] + ownedEdges[b] * (n - 1);
+		layout.batchEnds[b] = layout.faceStarts[b] + ownedFaces[b] * ((n - 1) * (n - 2) / 2);
+		next = layout.batchEnds[b];
+	}
+	layout.isolatedStart = next;
+	layout.numVertices = next + numIsolated;
+}
+
+void StreamingSubdivision::AddRings(const CompactMesh& m, std::vector<int32_t>& faces, std::vector<char>& faceMarks,
+	std::vector<char>& vertexMarks, std::vector<int32_t>& vertices)
+{
+	size_t begin = 0;
+	for (int ring = 0; ring < 2; ++ring)
+	{
+		size_t end = faces.size();
+		for (size_t i = begin; i < end; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				int32_t v = m.V(3 * faces[i] + k);
+				if (vertexMarks[v])
+					continue;
+				vertexMarks[v] = 1;
+				vertices.push_back(v);
+				for (int32_t c : m.GetFan(v))
+				{
+					int32_t t = CompactMesh::T(c);
+					if (!faceMarks[t])
+					{
+						faceMarks[t] = 1;
+						faces.push_back(t);
+					}
+				}
+			}
+		}
+		begin = end;
+	}
+}
+
+void StreamingSubdivision::GetPatch(const CompactMesh& m, const std::vector<int32_t>& batch, std::vector<char>& faceMarks,
+	std::vector<char>& vertexMarks, std::vector<int32_t>& vertexIndices, Patch& patch)
+{
+	std::vector<int32_t> faces = batch;
+	std::vector<int32_t> expanded;
+	for (int32_t t : faces)
+	{
+		faceMarks[t] = 1;
+	}
+	AddRings(m, faces, faceMarks, vertexMarks, expanded);
+	std::sort(faces.begin(), faces.end());
+
+	// The vertices keep the order they have in m, so the patch is numbered like the part of m it covers.
+	std::vector<int32_t> vertices;
+	for (int32_t t : faces)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			int32_t v = m.V(3 * t + k);
+			if (vertexIndices[v] < 0)
+			{
+				vertexIndices[v] = 0;
+				vertices.push_back(v);
+			}
+		}
+	}
+	std::sort(vertices.begin(), vertices.end());
+	std::vector<glm::dvec3> positions(vertices.size());
+	for (int32_t i = 0; i < vertices.size(); ++i)
+	{
+		vertexIndices[vertices[i]] = i;
+		positions[i] = m.positions[vertices[i]];
+	}
+
+	std::vector<int32_t> triangles(3 * faces.size());
+	patch.ancestors = faces;
+	patch.lattice.resize(6 * faces.size());
+	patch.inBatch.resize(faces.size());
+	for (int32_t i = 0; i < faces.size(); ++i)
+	{
+		int32_t t = faces[i];
+		for (int k = 0; k < 3; ++k)
+		{
+			triangles[3 * i + k] = vertexIndices[m.V(3 * t + k)];
+		}
+		// Corner 0 has all the weight of the first corner, corner 1 of the second, and corner 2 of neither.
+		const int32_t corners[6] = { 1, 0, 0, 1, 0, 0 };
+		std::copy(corners, corners + 6, &patch.lattice[6 * i]);
+		patch.inBatch[i] = std::binary_search(batch.begin(), batch.end(), t);
+	}
+	patch.n = 1;
+	patch.mesh = CompactMesh(positions, triangles);
+	patch.mesh.Initialize();
+
+	for (int32_t t : faces)
+	{
+		faceMarks[t] = 0;
+	}
+	for (int32_t v : expanded)
+	{
+		vertexMarks[v] = 0;
+	}
+	for (int32_t v : vertices)
+	{
+		vertexIndices[v] = -1;
+	}
+}
+
+void StreamingSubdivision::SubdividePatch(Patch& patch, bool last)
+{
+	int32_t numFaces = patch.mesh.GetNumberOfTriangles();
+	CompactMesh child = Subdivision::LoopSubdivision(patch.mesh);
+
+	// The even corners double their weights as n doubles, and the odd ones are the sums of the ends of their edges,
+	// in the order of the children in Subdivision.
+	std::vector<int32_t> ancestors(4 * numFaces);
+	std::vector<int32_t> lattice(24 * numFaces);
+	std::vector<char> inBatch(4 * numFaces);
+	Parallel::ForBlocks(numFaces, 4096, [&](int begin, int end)
+	{
+		for (int32_t t = begin; t < end; ++t)
+		{
+			const int32_t* v = &patch.lattice[6 * t];
+			int32_t points[12] = {
+				2 * v[0], 2 * v[1], 2 * v[2], 2 * v[3], 2 * v[4], 2 * v[5],
+				v[0] + v[2], v[1] + v[3], v[2] + v[4], v[3] + v[5], v[4] + v[0], v[5] + v[1]
+			};
+			// v0 w0 w2, w0 v1 w1, w1 v2 w2, w0 w1 w2, with vk at point k and wk at point 3 + k.
+			const int children[12] = { 0, 3, 5, 3, 1, 4, 4, 2, 5, 3, 4, 5 };
+			for (int i = 0; i < 12; ++i)
+			{
+				lattice[24 * t + 2 * i] = points[2 * children[i]];
+				lattice[24 * t + 2 * i + 1] = points[2 * children[i] + 1];
+			}
+			for (int k = 0; k < 4; ++k)
+			{
+				ancestors[4 * t + k] = patch.ancestors[t];
+				inBatch[4 * t + k] = patch.inBatch[t];
+			}
+		}
+	});
+	patch.mesh = std::move(child);
+	patch.ancestors.swap(ancestors);
+	patch.lattice.swap(lattice);
+	patch.inBatch.swap(inBatch);
+	patch.n *= 2;
+	if (last)
+		return;
+
+	std::vector<int32_t> faces;
+	for (int32_t t = 0; t < patch.mesh.GetNumberOfTriangles(); ++t)
+	{
+		if (patch.inBatch[t])
+			faces.push_back(t);
+	}
+	std::vector<char> keep = patch.inBatch;
+	std::vector<char> vertexMarks(patch.mesh.GetNumberOfVertices(), 0);
+	std::vector<int32_t> expanded;
+	AddRings(patch.mesh, faces, keep, vertexMarks, expanded);
+	KeepFaces(patch, keep);
+}
+
+void StreamingSubdivision::KeepFaces(Patch& patch, const std::vector<char>& keep)
+{
+	const CompactMesh& m = patch.mesh;
+	std::vector<int32_t> vertexIndices(m.GetNumberOfVertices(), -1);
+	for (int32_t t = 0; t < m.GetNumberOfTriangles(); ++t)
+	{
+		if (!keep[t])
+			continue;
+		for (int k = 0; k < 3; ++k)
+		{
+			vertexIndices[m.V(3 * t + k)] = 0;
+		}
+	}
+	std::vector<glm::dvec3> positions;
+	for (int32_t v = 0; v < m.GetNumberOfVertices(); ++v)
+	{
+		if (vertexIndices[v] < 0)
+			continue;
+		vertexIndices[v] = positions.size();
+		positions.push_back(m.positions[v]);
+	}
+
+	std::vector<int32_t> triangles;
+	int32_t kept = 0;
+	for (int32_t t = 0; t < m.GetNumberOfTriangles(); ++t)
+	{
+		if (!keep[t])
+			continue;
+		for (int k = 0; k < 3; ++k)
+		{
+			triangles.push_back(vertexIndices[m.V(3 * t + k)]);
+		}
+		patch.ancestors[kept] = patch.ancestors[t];
+		for (int i = 0; i < 6; ++i)
+		{
+			patch.lattice[6 * kept + i] = patch.lattice[6 * t + i];
+		}
+		patch.inBatch[kept] = patch.inBatch[t];
+		++kept;
+	}
+	patch.ancestors.resize(kept);
+	patch.lattice.resize(6 * kept);
+	patch.inBatch.resize(kept);
+	patch.mesh = CompactMesh(positions, triangles);
+	patch.mesh.Initialize();
+}
+
+int64_t StreamingSubdivision::GetVertexIndex(const CompactMesh& m, const Layout& layout, int32_t t, int32_t a, int32_t b)
+{
+	int32_t n = layout.n;
+	int32_t c = n - a - b;
+
+	// At a vertex of t.
+	if (a == n || b == n || c == n)
+	{
+		int32_t v = m.V(3 * t + (a == n ? 0 : (b == n ? 1 : 2)));
+		return layout.vertexStarts[layout.faceBatches[CompactMesh::T(m.vertexCorners[v])]] + layout.vertexRanks[v];
+	}
+
+	// Inside an edge of t: half-edge 3t + j runs from corner j to the next, which the point is s / n of the way to.
+	if (a == 0 || b == 0 || c == 0)
+	{
+		int32_t h = (c == 0) ? 3 * t : ((a == 0) ? 3 * t + 1 : 3 * t + 2);
+		int32_t s = (c == 0) ? b : ((a == 0) ? c : a);
+		int32_t e = m.E(CompactMesh::P(h));
+		int32_t first = m.edgeHalfEdges[e];
+		if (m.V(first) != m.V(h))
+			s = n - s;
+		return layout.edgeStarts[layout.faceBatches[CompactMesh::T(first)]] + (int64_t)layout.edgeRanks[e] * (n - 1) + (s - 1);
+	}
+
+	// Inside t, row by row of b.
+	int64_t inside = (int64_t)(n - 1) * (n - 2) / 2;
+	int64_t i = (int64_t)(b - 1) * (n - 1) - (int64_t)b * (b - 1) / 2 + (c - 1);
+	return layout.faceStarts[layout.faceBatches[t]] + layout.faceRanks[t] * inside + i;
+}
+
+double StreamingSubdivision::GetOrientation(const CompactMesh& m, const std::vector<char>& faces)
+{
+	for (int32_t t = 0; t < m.GetNumberOfTriangles(); ++t)
+	{
+		if (!faces[t])
+			continue;
+		const glm::dvec3& x0 = m.positions[m.V(3 * t)];
+		const glm::dvec3& x1 = m.positions[m.V(3 * t + 1)];
+		const glm::dvec3& x2 = m.positions[m.V(3 * t + 2)];
+		double alignment = glm::dot(m.faceNormals[t], glm::cross(x2 - x0, x1 - x0));
+		if (alignment != 0.0)
+			return (alignment > 0.0) ? 1.0 : -1.0;
+	}
+	return 1.0;
+}
+
+StreamingSubdivision::StreamingSubdivision() {}
+StreamingSubdivision::~StreamingSubdivision() {}
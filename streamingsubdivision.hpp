@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "compactmesh.hpp"
+#include "utilities.hpp"
+
+/** Loop subdivision written straight to disk, for meshes too large to hold once subdivided.
+ * Goal: subdivide a mesh that fits in memory many times over, into a file, a piece at a time.
+ *
+ * The faces of the mesh are put in batches along a Morton curve through their centers, so each batch is a compact region.
+ * A batch is subdivided as a patch of its own: its faces, and two rings of faces around them (the halo). A vertex of the
+ * subdivided batch only depends on the vertices within two rings of the faces around it, so its position is the one
+ * subdividing the whole mesh gives. After each level the patch is cut back to the children of the batch and two rings
+ * of the new faces, which is all the next level needs, so the halo stays thin as the levels go on.
+ *
+ * Every vertex after n = 2^levels has a place on the lattice of a face of the mesh: at one of its vertices, at one of
+ * the n - 1 points inside one of its edges, or at one of the (n - 1)(n - 2) / 2 points inside it. The batch holding
+ * the face of a vertex (the face of Vert::c), an edge (the face of its first half-edge) or a face writes the points of it,
+ * so each point is written once, and its index follows from where it is on the lattice and which batch holds it.
+ * The vertices of each batch take one run of indices; a vertex without faces comes after all of them.
+ * The faces are numbered as Subdivision numbers them, 4^levels per face of the mesh, so face k of the file is face k of
+ * the mesh Subdivision::LoopSubdivision() gives, and its positions agree with it up to rounding.
+ *
+ * The file is binary .ply, in the byte order of the machine: x, y, z as doubles, and three 32-bit indices per face.
+ * Each batch writes its vertices and faces where they go in the file as soon as it is done. The file is written under
+ * a temporary name and then renamed, like a mesh cache. The mesh cache format itself cannot be streamed: it holds every
+ * edge and corner of an initialized mesh, with 32-bit signed indices, so writing one takes the whole mesh in memory.
+ *
+ * Curvatures of the subdivided mesh can be summed up along the way: each batch computes them on its patch,
+ * where every vertex it writes has its whole one-ring, and adds in the vertices it writes.
+ * Faces of a patch are turned to face the way the faces of the whole mesh do, so signed curvatures keep their sign.
+ */
+class StreamingSubdivision
+{
+
+public:
+
+	// Subdivide an initialized mesh into a binary .ply file, with about batchFaces faces of m per batch,
+	// or GetDefaultBatchFaces() if batchFaces is 0.
+	static IOResult Subdivide(const CompactMesh& m, int levels, const std::string& file, int batchFaces = 0);
+
+	// The same, with the minimum, maximum and mean of each curvature over the vertices of the subdivided mesh with faces.
+	static IOResult Subdivide(const CompactMesh& m, int levels, const std::string& file,
+		const std::vector<Curvature>& curvatures, std::vector<Statistics>& statistics, int batchFaces = 0);
+
+	// The number of vertices and faces after levels of Loop subdivision of m.
+	static void GetCounts(const CompactMesh& m, int levels, uint64_t& numVertices, uint64_t& numFaces);
+
+	// The faces of the mesh per batch when none is given: about a quarter million faces of the subdivided mesh.
+	static int GetDefaultBatchFaces(int levels);
+
+private:
+
+	// A piece of the mesh being subdivided, and per face where it lies in the mesh that was given: the face it came from,
+	// the lattice points of its corners as the weights of the first two corners of that face (the third weight is n minus
+	// the other two), and whether it belongs to the batch. The faces are in the order of the faces they came from.
+	struct Patch
+	{
+		CompactMesh mesh;
+		std::vector<int32_t> ancestors;
+		std::vector<int32_t> lattice;
+		std::vector<char> inBatch;
+		int32_t n = 1;
+	};
+
+	// Where each point goes in the file: which batch writes the points of each vertex, edge and face of the mesh,
+	// their rank among those of the same kind in that batch, and the first vertex index of each batch.
+	struct Layout
+	{
+		int32_t n = 1;
+		std::vector<int32_t> faceBatches;
+		std::vector<int32_t> vertexRanks;
+		std::vector<int32_t> edgeRanks;
+		std::vector<int32_t> faceRanks;
+		std::vector<int64_t> vertexStarts;
+		std::vector<int64_t> edgeStarts;
+		std::vector<int64_t> faceStarts;
+		std::vector<int64_t> batchEnds;
+
+		// The vertices without faces come last.
+		int64_t isolatedStart = 0;
+		int64_t numVertices = 0;
+	};
+
+	// The faces of m in batches of about batchFaces, in Morton order of their centers; each batch in increasing order.
+	static std::vector<std::vector<int32_t>> GetBatches(const CompactMesh& m, int batchFaces);
+
+	static void GetLayout(const CompactMesh& m, const std::vector<std::vector<int32_t>>& batches, int levels, Layout& layout);
+
+	// Append the faces within two rings of the listed faces to the list, and mark them in faceMarks.
+	// The vertices whose fans were added are marked in vertexMarks and appended to vertices.
+	static void AddRings(const CompactMesh& m, std::vector<int32_t>& faces, std::vector<char>& faceMarks,
+		std::vector<char>& vertexMarks, std::vector<int32_t>& vertices);
+
+	// The faces of a batch and two rings of faces around them, at level 0.
+	// faceMarks, vertexMarks and vertexIndices have one entry per face and vertex of m, all 0, 0 and -1,
+	// and are left that way.
+	static void GetPatch(const CompactMesh& m, const std::vector<int32_t>& batch, std::vector<char>& faceMarks,
+		std::vector<char>& vertexMarks, std::vector<int32_t>& vertexIndices, Patch& patch);
+
+	// One level of Loop subdivision of a patch. Unless it is the last, the patch is then cut back to the faces
+	// of the batch and two rings around them.
+	static void SubdividePatch(Patch& patch, bool last);
+
+	// Keep the faces of the patch with keep[t] set, and the vertices they use, in order.
+	static void KeepFaces(Patch& patch, const std::vector<char>& keep);
+
+	// Index in the file of the lattice point at weights (a, b, n - a - b) of face t of m.
+	static int64_t GetVertexIndex(const CompactMesh& m, const Layout& layout, int32_t t, int32_t a, int32_t b);
+
+	// 1 if the face normals of m point the way of (x2 - x0) x (x1 - x0) over the corners of their triangles, -1 if not,
+	// from the first face of the list with an area.
+	static double GetOrientation(const CompactMesh& m, const std::vector<char>& faces);
+
+	StreamingSubdivision();
+	~StreamingSubdivision();
+
+};
@@ -0,0 +1,185 @@
+#include "streamlines.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+void Streamlines::Trace(Polyhedron* p, const std::vector<glm::dvec3>& field, double spacing, double length,
+	const glm::vec3& color, std::vector<LineVertex>& vertices)
+{
+	Trace(GetFaces(p), p, field, spacing, length, color, vertices);
+}
+
+std::vector<Streamlines::Face> Streamlines::GetFaces(Polyhedron* p)
+{
+	std::vector<Face> faces(p->tlist.size());
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(faces.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = p->tlist[i];
+			for (int k = 0; k < 3; ++k)
+			{
+				Corner* opposite = p->clist[3 * i + k].o;
+				faces[i].positions[k] = t.vertices[k]->GetPosition();
+				faces[i].vertices[k] = t.vertices[k]->index;
+				faces[i].opposite[k] = (opposite == NULL) ? -1 : opposite - p->clist.data();
+			}
+		}
+	});
+	return faces;
+}
+
+void Streamlines::Trace(const std::vector<Face>& faces, Polyhedron* p, const std::vector<glm::dvec3>& field, double spacing,
+	double length, const glm::vec3& color, std::vector<LineVertex>& vertices)
+{
+	const int BLOCK_SIZE = 4096;
+	int numTriangles = p->tlist.size();
+	int numBlocks = (numTriangles + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<std::vector<LineVertex>> blocks(numBlocks);
+	double seedArea = spacing * spacing;
+
+	Parallel::ForBlocks(numTriangles, BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<LineVertex>& segments = blocks[begin / BLOCK_SIZE];
+		std::vector<glm::dvec3> points;
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = p->tlist[i];
+			if (Hash(i) >= t.area / seedArea || glm::dot(field[i], field[i]) == 0)
+				continue;
+
+			// Out from the centroid one way, and then the other.
+			glm::dvec3 centroid(1.0 / 3.0);
+			for (int sign = 1; sign >= -1; sign -= 2)
+			{
+				points.clear();
+				Follow(faces, field, i, centroid, (double)sign * field[i], length, points);
+				for (int k = 0; k + 1 < points.size(); ++k)
+				{
+					segments.push_back(LineVertex((glm::vec3)points[k], color));
+					segments.push_back(LineVertex((glm::vec3)points[k + 1], color));
+				}
+			}
+		}
+	});
+
+	size_t offset = vertices.size();
+	std::vector<size_t> offsets(numBlocks + 1, offset);
+	for (int b = 0; b < numBlocks; ++b)
+	{
+		offsets[b + 1] = offsets[b] + blocks[b].size();
+	}
+	vertices.resize(offsets[numBlocks], LineVertex(glm::vec3(0.0f), color));
+	Parallel::For(numBlocks, [&](int b)
+	{
+		std::copy(blocks[b].begin(), blocks[b].end(), vertices.begin() + offsets[b]);
+	});
+}
+
+int Streamlines::TraceLinesOfCurvature(Polyhedron* p, double spacing, double length, std::vector<LineVertex>& vertices)
+{
+	PrincipalCurvatures principal = CurvatureTensor::GetPrincipalCurvatures(p);
+	std::vector<glm::dvec3> minorStream(p->tlist.size());
+	std::vector<glm::dvec3> majorStream(p->tlist.size());
+	CurvatureTensor::GetTriangleStreamlines(p, principal, minorStream, majorStream);
+
+	// The same colors as the principal directions along the edges.
+	std::vector<Face> faces = GetFaces(p);
+	size_t start = vertices.size();
+	Trace(faces, p, majorStream, spacing, length, glm::vec3(1.0f, 0.6f, 0.0f), vertices);
+	int majorCount = vertices.size() - start;
+	Trace(faces, p, minorStream, spacing, length, glm::vec3(0.0f, 1.0f, 1.0f), vertices);
+	return majorCount;
+}
+
+void Streamlines::Follow(const std::vector<Face>& faces, const std::vector<glm::dvec3>& field, int triangle, glm::dvec3 barycentric,
+	glm::dvec3 direction, double length, std::vector<glm::dvec3>& points)
+{
+	int seed = triangle;
+	double remaining = length;
+	for (int crossing = 0; crossing < MAXIMUM_CROSSINGS; ++crossing)
+	{
+		const Face& face = faces[triangle];
+		glm::dvec3 p0 = face.positions[0];
+		glm::dvec3 e1 = face.positions[1] - p0;
+		glm::dvec3 e2 = face.positions[2] - p0;
+		if (crossing == 0)
+			points.push_back(p0 + barycentric[1] * e1 + barycentric[2] * e2);
+
+		// The direction as a rate of change of the barycentric coordinates: direction = d1 e1 + d2 e2, and d0 = -d1 - d2.
+		double a = glm::dot(e1, e1);
+		double b = glm::dot(e1, e2);
+		double c = glm::dot(e2, e2);
+		double det = a * c - b * b;
+		if (det <= 0)
+			return;
+		double r1 = glm::dot(e1, direction);
+		double r2 = glm::dot(e2, direction);
+		glm::dvec3 rate(0.0, (c * r1 - b * r2) / det, (a * r2 - b * r1) / det);
+		rate[0] = -rate[1] - rate[2];
+
+		// The line leaves through the edge across from the first coordinate to reach 0.
+		int exit = -1;
+		double distance = std::numeric_limits<double>::max();
+		for (int k = 0; k < 3; ++k)
+		{
+			if (rate[k] < 0 && -barycentric[k] / rate[k] < distance)
+			{
+				distance = -barycentric[k] / rate[k];
+				exit = k;
+			}
+		}
+		// Also where it would go straight back out, as when the field turns it around on an edge.
+		if (exit == -1 || distance <= 0)
+			return;
+
+		if (distance >= remaining)
+		{
+			barycentric += remaining * rate;
+			points.push_back(p0 + barycentric[1] * e1 + barycentric[2] * e2);
+			return;
+		}
+		remaining -= distance;
+		barycentric += distance * rate;
+		for (int k = 0; k < 3; ++k)
+		{
+			barycentric[k] = (k == exit) ? 0.0 : std::max(barycentric[k], 0.0);
+		}
+		barycentric /= barycentric[0] + barycentric[1] + barycentric[2];
+		points.push_back(p0 + barycentric[1] * e1 + barycentric[2] * e2);
+
+		// Across the edge, with the coordinates of its endpoints carried over.
+		if (face.opposite[exit] == -1)
+			return;
+		int next = face.opposite[exit] / 3;
+		int across = face.opposite[exit] % 3;
+		int first = (faces[next].vertices[(across + 1) % 3] == face.vertices[(exit + 1) % 3]) ? (across + 1) % 3 : (across + 2) % 3;
+		glm::dvec3 nextBarycentric(0.0);
+		nextBarycentric[first] = barycentric[(exit + 1) % 3];
+		nextBarycentric[3 - across - first] = barycentric[(exit + 2) % 3];
+
+		glm::dvec3 nextDirection = field[next];
+		if (glm::dot(nextDirection, direction) < 0)
+			nextDirection = -nextDirection;
+		if (next == seed || glm::dot(nextDirection, direction) < MINIMUM_TURN_COSINE)
+			return;
+
+		triangle = next;
+		barycentric = nextBarycentric;
+		direction = nextDirection;
+	}
+}
+
+double Streamlines::Hash(int i)
+{
+	// The finalizer of splitmix64.
+	uint64_t x = (uint64_t)i + 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	x = x ^ (x >> 31);
+	return (x >> 11) * (1.0 / 9007199254740992.0);
+}
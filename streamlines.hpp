@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include "polyhedron.hpp"
+#include "curvature.hpp"
+#include "linevertex.hpp"
+
+/** Lines traced across the triangles of a mesh through a field of one direction per triangle,
+ * such as the principal directions from CurvatureTensor::GetTriangleStreamlines(), which makes them lines of curvature.
+ *
+ * A line starts at the centroid of a seed triangle and runs both ways. Within a triangle it goes straight along the
+ * direction of the triangle until it meets an edge, then crosses into the triangle on the other side and turns to
+ * its direction, taking whichever of the two signs is closer to the way it was going. It stops at a boundary,
+ * where the field turns too sharply (near an umbilic or another singular point), back in its seed triangle, or at its length.
+ *
+ * Every triangle is a seed with probability area / spacing^2, decided by a hash of its index, so there is about one
+ * line per spacing x spacing of surface, wherever it is, and the seeds can be picked and traced on any thread.
+ * The triangles are split over the threads in blocks, each block writes its segments on its own,
+ * and the blocks are copied into the output in order, so the result is the same on any number of threads.
+ *
+ * A line around a long loop of the mesh visits triangles far apart in memory, and a triangle reaches its corners and
+ * neighbours through the vertex, corner and triangle lists. So before tracing, everything a crossing reads is copied
+ * into one small record per triangle, and each step of a line touches one record.
+ */
+class Streamlines
+{
+
+public:
+
+	// Trace the lines of a field and append their segments to vertices, as pairs of GL_LINES endpoints in the given color.
+	// length is how far each line may run from its seed in each direction.
+	static void Trace(Polyhedron* p, const std::vector<glm::dvec3>& field, double spacing, double length,
+		const glm::vec3& color, std::vector<LineVertex>& vertices);
+
+	// Lines of curvature of both families in one buffer: those of the larger principal curvature first,
+	// then those of the smaller. Returns the number of vertices of the first family.
+	static int TraceLinesOfCurvature(Polyhedron* p, double spacing, double length, std::vector<LineVertex>& vertices);
+
+	// A line stops where the direction turns by more than this from one triangle to the next (as the cosine of the angle).
+	static constexpr double MINIMUM_TURN_COSINE = 0.5;
+
+	// Most triangles a line crosses in each direction, however short they are.
+	static const int MAXIMUM_CROSSINGS = 100000;
+
+private:
+
+	// What a line needs of a triangle: its corners, their vertices, and for each the corner (3 * triangle + k) across
+	// the edge opposite it, or -1 on a boundary.
+	struct Face
+	{
+		glm::dvec3 positions[3];
+		int vertices[3];
+		int opposite[3];
+	};
+
+	static std::vector<Face> GetFaces(Polyhedron* p);
+
+	static void Trace(const std::vector<Face>& faces, Polyhedron* p, const std::vector<glm::dvec3>& field, double spacing,
+		double length, const glm::vec3& color, std::vector<LineVertex>& vertices);
+
+	// Follow the field from a point of a triangle, given by its barycentric coordinates, along direction for up to length,
+	// and append the points where the line leaves each triangle, and the point where it ends.
+	static void Follow(const std::vector<Face>& faces, const std::vector<glm::dvec3>& field, int triangle, glm::dvec3 barycentric,
+		glm::dvec3 direction, double length, std::vector<glm::dvec3>& points);
+
+	// A number in [0, 1) that looks random, from the index of a triangle.
+	static double Hash(int i);
+
+	Streamlines();
+	~Streamlines();
+
+};
@@ -1,413 +1,691 @@
 #include "subdivision.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
 
 Polyhedron* Subdivision::LoopSubdivisionHeap(Polyhedron* p)
 {
-	int originalVertices = p->vlist.size();
-	int originalEdges = p->elist.size();
-	int originalFaces = p->tlist.size();
-
-	Polyhedron* loop = new Polyhedron(originalVertices + originalEdges, 3 * originalFaces + 2 * originalEdges, 4 * originalFaces);
+	// Moving the result onto the heap keeps the lists, and the pointers into them, where they are.
+	return new Polyhedron(LoopSubdivision(p));
+}
 
-	// Map that stores (edge.index, vert):
-	std::map<int, Vert*> oddVertices;
+Polyhedron Subdivision::LoopSubdivision(Polyhedron* p)
+{
+	// Every stage but the allocation of the lists runs in parallel. Each element of the new mesh is written
+	// by one thread, at an index known in advance, so the result does not depend on the number of threads.
+	Polyhedron loop;
+	loop.initializeTimes.Clear();
+	loop.initializeTimes.Begin("subdivide topology");
+	CompactMesh parent = GetTopology(p);
+	bool direct = IsOrientedManifold(parent);
+	CompactMesh child;
+	if (direct)
+		SubdivideTopology(parent, child);
+	else
+		child.cornerVertices = GetTriangles(parent);
+
+	loop.initializeTimes.Begin("subdivide vertices");
+	std::vector<glm::dvec3> positions = GetEvenAndOddPositions(p, parent);
+	parent = CompactMesh();
+
+	// The sizes of the new mesh are known up front, so size the lists once.
+	// Nothing is added to them afterwards, so the pointers handed out below stay valid.
+	loop.initializeTimes.Begin("allocate lists");
+	int numVertices = positions.size();
+	int numTriangles = child.GetNumberOfTriangles();
+	loop.vlist.resize(numVertices);
+	loop.tlist.resize(numTriangles);
+	loop.clist.resize(3 * numTriangles);
+
+	loop.initializeTimes.Begin("fill lists");
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = loop.vlist[i];
+			v.index = i;
+			v.x = positions[i].x;
+			v.y = positions[i].y;
+			v.z = positions[i].z;
+		}
+	});
+	Parallel::ForBlocks(numTriangles, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Triangle& t = loop.tlist[i];
+			t.index = i;
+			for (int k = 0; k < 3; ++k)
+			{
+				t.vertices[k] = &loop.vlist[child.V(3 * i + k)];
+			}
+		}
+	});
 
-	/** Even vertices:
-	 * We will compute the even vertices using the original vertices of the mesh.
-	 * These vertices are exact copies of the originals, but their positions are adjusted according to the Loop scheme.
-	 */
-	for (int i = 0; i < p->vlist.size(); ++i)
+	// Without a topology to go on, the new mesh is put together like any other.
+	if (!direct)
 	{
-		Vert even = CreateEvenVertex(&p->vlist[i]);
-		loop->vlist.push_back(even);
+		loop.Initialize();
+		return loop;
 	}
-	int numberOfEvenVertices = p->vlist.size();
 
-	/** Odd vertices:
-	 * We will compute the odd vertices using the edges of the mesh.
-	 * The new vertices will be stored in a map structure so we can keep track of the new (edge, vertex) pairs that are created.
-	 */
-	int count = numberOfEvenVertices;
-	for (int i  = 0; i < p->elist.size(); ++i)
-	{
-		// Use the edge to create the odd vertex.
-		Edge* e = &p->elist[i];
-		Vert odd = CreateOddVertex(e, count);
+	loop.initializeTimes.Begin("connect vertices to triangles");
+	ConnectVerticesToTriangles(p, child, loop);
 
-		// Add the odd vertex to both the map and the vlist.
-		loop->vlist.push_back(odd);
-		oddVertices.insert({ e->index, &loop->vlist[loop->vlist.size() - 1] });
-		count++;
-	}
+	loop.initializeTimes.Begin("link edges and corners");
+	LinkEdgesAndCorners(child, loop);
 
-	/** Topology:
-	* And now for the hard part!
-	* Go through each triangle of the original mesh.
-	* Look up the odd vertices for each of the edges in the given triangle.
-	* Since the evenVertices list was created by looping through the vlist, we are guaranteed that the indices match between lists.
-	* Therefore we may do all of our work using the evenVertices list instead of vlist.
-	* We then can carefully construct the four triangles.
-	*/ 
-	for (int i = 0; i < p->tlist.size(); ++i)
-	{
-		// Start with a triangle:
-		Triangle* t = &p->tlist[i];
-
-		//std::cout << "Creating vertices!" << std::endl;
-		// Even vertices:
-		Vert* v0 = &loop->vlist[t->vertices[0]->index];
-		Vert* v1 = &loop->vlist[t->vertices[1]->index];
-		Vert* v2 = &loop->vlist[t->vertices[2]->index];
-
-		// Odd vertices:
-		int w0Index = oddVertices[t->edges[0]->index]->index;
-		int w1Index = oddVertices[t->edges[1]->index]->index;
-		int w2Index = oddVertices[t->edges[2]->index]->index;
-		Vert* w0 = &loop->vlist[w0Index];
-		Vert* w1 = &loop->vlist[w1Index];
-		Vert* w2 = &loop->vlist[w2Index];
-
-		int tIndex = loop->tlist.size();
-
-		//std::cout << "Creating triangles: " << std::endl;
-		//std::cout << "Decomposing triangle: " << t->index << ": " << t->verts[0]->index << " " << t->verts[1]->index << " " << t->verts[2]->index << std::endl;
-
-		Triangle t1;
-		t1.index = tIndex;
-		t1.vertices[0] = v0;
-		t1.vertices[1] = w0;
-		t1.vertices[2] = w2;
-		//std::cout << "First triangle: " << v0->index << " " << w0->index << " " << w2->index << std::endl;
-
-		Triangle t2;
-		t2.index = tIndex + 1;
-		t2.vertices[0] = w0;
-		t2.vertices[1] = v1;
-		t2.vertices[2] = w1;
-		//std::cout << "Second triangle: " << w0->index << " " << v1->index << " " << w1->index << std::endl;
-
-		Triangle t3;
-		t3.index = tIndex + 2;
-		t3.vertices[0] = w1;
-		t3.vertices[1] = v2;
-		t3.vertices[2] = w2;
-		//std::cout << "Third triangle: " << w1->index << " " << v2->index << " " << w2->index << std::endl;
-
-		Triangle t4;
-		t4.index = tIndex + 3;
-		t4.vertices[0] = w0;
-		t4.vertices[1] = w1;
-		t4.vertices[2] = w2;
-		//std::cout << "Fourth triangle: " << w0->index << " " << w1->index << " " << w2->index << std::endl;
-		//std::cout << std::endl;
-
-		loop->tlist.push_back(t1);
-		loop->tlist.push_back(t2);
-		loop->tlist.push_back(t3);
-		loop->tlist.push_back(t4);
-	}
+	// The rest is geometry, computed as Initialize() computes it.
+	loop.initializeTimes.Begin("bounding sphere");
+	loop.ComputeBoundingSphere();
 
-	// Don't forget to initialize the clist!
-	Corner c;
-	loop->clist = std::vector<Corner>(3 * loop->tlist.size(), c);
+	loop.initializeTimes.Begin("normals and areas");
+	loop.ComputeNormalsAndArea();
+
+	// The vertex triangle lists are still in triangle order here, as in Initialize().
+	loop.initializeTimes.Begin("interpolate normals");
+	loop.InterpolateNormals();
+
+	loop.initializeTimes.Begin("order fans");
+	OrderFans(p, child, loop);
+	child = CompactMesh();
+
+	loop.initializeTimes.Begin("angle deficit");
+	MeshAnalysis::GetAngleDeficit(&loop);
+
+	loop.initializeTimes.Begin("curvature geometry");
+	MeshAnalysis::ComputeCurvatureGeometry(&loop);
+	loop.initializeTimes.End();
 	return loop;
 }
 
-Polyhedron Subdivision::LoopSubdivision(Polyhedron* p)
+void Subdivision::ConnectVerticesToTriangles(Polyhedron* p, const CompactMesh& child, Polyhedron& loop)
 {
-	Polyhedron loop;
-
-	// Map that stores (edge.index, vert):
-	std::map<int, Vert*> oddVertices;
-
-	/** Even vertices:
-	 * We will compute the even vertices using the original vertices of the mesh.
-	 * These vertices are exact copies of the originals, but their positions are adjusted according to the Loop scheme.
-	 */
-	for (int i = 0; i < p->vlist.size(); ++i)
+	// The lists are put in the arena one at a time, at their final sizes: an even vertex has as many triangles as before,
+	// and an odd vertex 6, or 3 on a boundary, where its valence is 4. Then every vertex fills its own list.
+	int numVertices = p->vlist.size();
+	int numAllVertices = loop.vlist.size();
+	loop.CreateArena(6 * loop.tlist.size());
+	for (int i = 0; i < numAllVertices; ++i)
 	{
-		Vert even = CreateEvenVertex(&p->vlist[i]);
-		loop.vlist.push_back(even);
+		int count = (i < numVertices) ? p->vlist[i].triangles.size() : (child.valences[i] == 4) ? 3 : 6;
+		loop.AttachToArena(loop.vlist[i].triangles, count);
+		loop.vlist[i].triangles.resize(count);
 	}
-	int numberOfEvenVertices = p->vlist.size();
 
-	/** Odd vertices:
-	 * We will compute the odd vertices using the edges of the mesh.
-	 * The new vertices will be stored in a map structure so we can keep track of the new (edge, vertex) pairs that are created.
-	 */
-	int count = numberOfEvenVertices;
-	for (int i  = 0; i < p->elist.size(); ++i)
+	// The triangles of a vertex go in index order, as ConnectVerticesToTriangles() leaves them,
+	// which is the order of the pointers into tlist. The corners at the boundary are found along the way.
+	// An even vertex has the triangle 4s + k for every old triangle s with the vertex at corner k,
+	// and its corner at the boundary is the one in the triangle of the old one.
+	const int32_t EVEN[3] = { 0, 4, 7 };
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
 	{
-		// Use the edge to create the odd vertex.
-		Edge* e = &p->elist[i];
-		Vert odd = CreateOddVertex(e, count);
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& parent = p->vlist[i];
+			Vert& v = loop.vlist[i];
+			for (int j = 0; j < parent.triangles.size(); ++j)
+			{
+				Triangle* s = parent.triangles[j];
+				int k = (s->vertices[0] == &parent) ? 0 : (s->vertices[1] == &parent) ? 1 : 2;
+				v.triangles[j] = &loop.tlist[4 * s->index + k];
+			}
+			std::sort(v.triangles.begin(), v.triangles.end());
+
+			Corner* b = parent.boundary;
+			v.boundary = (b == NULL) ? NULL : &loop.clist[12 * b->t->index + EVEN[b->index % 3]];
+		}
+	});
 
-		// Add the odd vertex to both the map and the vlist.
-		loop.vlist.push_back(odd);
-		oddVertices.insert({ e->index, &loop.vlist[loop.vlist.size() - 1] });
-		count++;
-	}
+	// An odd vertex has one fan. Swing back from its corner to the boundary, or once around to the corner after it,
+	// and take the triangles from there.
+	Parallel::ForBlocks(numAllVertices - numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = numVertices + begin; i < numVertices + end; ++i)
+		{
+			Vert& v = loop.vlist[i];
+			int32_t last = child.vertexCorners[i];
+			int32_t start = last;
+			int32_t back = child.SwingBack(start);
+			while (back >= 0 && back != last)
+			{
+				start = back;
+				back = child.SwingBack(start);
+			}
+			v.boundary = (back < 0) ? &loop.clist[start] : NULL;
+
+			int j = 0;
+			int32_t c = start;
+			do
+			{
+				v.triangles[j++] = &loop.tlist[CompactMesh::T(c)];
+				c = child.Swing(c);
+			} while (c >= 0 && c != start);
+			std::sort(v.triangles.begin(), v.triangles.end());
+		}
+	});
+}
 
-	/** Topology:
-	* And now for the hard part!
-	* Go through each triangle of the original mesh.
-	* Look up the odd vertices for each of the edges in the given triangle.
-	* Since the evenVertices list was created by looping through the vlist, we are guaranteed that the indices match between lists.
-	* Therefore we may do all of our work using the evenVertices list instead of vlist.
-	* We then can carefully construct the four triangles.
-	*/ 
-	for (int i = 0; i < p->tlist.size(); ++i)
-	{
-		// Start with a triangle:
-		Triangle* t = &p->tlist[i];
-
-		//std::cout << "Creating vertices!" << std::endl;
-		// Even vertices:
-		Vert* v0 = &loop.vlist[t->vertices[0]->index];
-		Vert* v1 = &loop.vlist[t->vertices[1]->index];
-		Vert* v2 = &loop.vlist[t->vertices[2]->index];
-
-		// Odd vertices:
-		int w0Index = oddVertices[t->edges[0]->index]->index;
-		int w1Index = oddVertices[t->edges[1]->index]->index;
-		int w2Index = oddVertices[t->edges[2]->index]->index;
-		Vert* w0 = &loop.vlist[w0Index];
-		Vert* w1 = &loop.vlist[w1Index];
-		Vert* w2 = &loop.vlist[w2Index];
-
-		int tIndex = loop.tlist.size();
-
-		//std::cout << "Creating triangles: " << std::endl;
-		//std::cout << "Decomposing triangle: " << t->index << ": " << t->verts[0]->index << " " << t->verts[1]->index << " " << t->verts[2]->index << std::endl;
-
-		Triangle t1;
-		t1.index = tIndex;
-		t1.vertices[0] = v0;
-		t1.vertices[1] = w0;
-		t1.vertices[2] = w2;
-		//std::cout << "First triangle: " << v0->index << " " << w0->index << " " << w2->index << std::endl;
-
-		Triangle t2;
-		t2.index = tIndex + 1;
-		t2.vertices[0] = w0;
-		t2.vertices[1] = v1;
-		t2.vertices[2] = w1;
-		//std::cout << "Second triangle: " << w0->index << " " << v1->index << " " << w1->index << std::endl;
-
-		Triangle t3;
-		t3.index = tIndex + 2;
-		t3.vertices[0] = w1;
-		t3.vertices[1] = v2;
-		t3.vertices[2] = w2;
-		//std::cout << "Third triangle: " << w1->index << " " << v2->index << " " << w2->index << std::endl;
-
-		Triangle t4;
-		t4.index = tIndex + 3;
-		t4.vertices[0] = w0;
-		t4.vertices[1] = w1;
-		t4.vertices[2] = w2;
-		//std::cout << "Fourth triangle: " << w0->index << " " << w1->index << " " << w2->index << std::endl;
-		//std::cout << std::endl;
-
-		loop.tlist.push_back(t1);
-		loop.tlist.push_back(t2);
-		loop.tlist.push_back(t3);
-		loop.tlist.push_back(t4);
+void Subdivision::LinkEdgesAndCorners(const CompactMesh& child, Polyhedron& loop)
+{
+	// Edge e runs from V(h) to V(N(h)) for its first half-edge h, whose triangle comes before the one across from it.
+	// Half-edge h is opposite corner P(h), and corner c is opposite half-edge N(c).
+	int numVertices = loop.vlist.size();
+	int numEdges = child.GetNumberOfEdges();
+	int numCorners = child.GetNumberOfCorners();
+	loop.elist.resize(numEdges);
+	for (Edge& e : loop.elist)
+	{
+		loop.AttachToArena(e.triangles, 2);
 	}
 
-	// Don't forget to initialize the clist!
-	Corner c;
-	loop.clist = std::vector<Corner>(3 * loop.tlist.size(), c);
-	return loop;
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(numEdges, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Edge& e = loop.elist[i];
+			int32_t h = child.edgeHalfEdges[i];
+			int32_t o = child.O(CompactMesh::P(h));
+			e.index = i;
+			e.vertices[0] = &loop.vlist[child.V(h)];
+			e.vertices[1] = &loop.vlist[child.V(CompactMesh::N(h))];
+			e.triangles.push_back(&loop.tlist[CompactMesh::T(h)]);
+			if (o >= 0)
+				e.triangles.push_back(&loop.tlist[CompactMesh::T(o)]);
+		}
+	});
+	Parallel::ForBlocks(numCorners, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Corner& c = loop.clist[i];
+			c.index = i;
+			c.v = &loop.vlist[child.V(i)];
+			c.e = &loop.elist[child.E(i)];
+			c.t = &loop.tlist[CompactMesh::T(i)];
+			c.n = &loop.clist[CompactMesh::N(i)];
+			c.p = &loop.clist[CompactMesh::P(i)];
+			c.o = (child.O(i) < 0) ? NULL : &loop.clist[child.O(i)];
+
+			// Half-edge i is edge i % 3 of its triangle, and opposite corner P(i).
+			c.t->edges[i % 3] = &loop.elist[child.E(CompactMesh::P(i))];
+		}
+	});
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = loop.vlist[i];
+			v.c = (child.vertexCorners[i] < 0) ? NULL : &loop.clist[child.vertexCorners[i]];
+			v.valence = child.valences[i];
+		}
+	});
+	loop.valenceDeficit = child.valenceDeficit;
 }
 
-
-
-
-
-glm::dvec3 Subdivision::GetAdjacentLinearCombination(Edge* e)
+void Subdivision::OrderFans(Polyhedron* p, const CompactMesh& child, Polyhedron& loop)
 {
-	const double LOOP_WEIGHT = (double)3.0 / 8.0;
-	Vert* v = e->vertices[0];
-	Vert* w = e->vertices[1];
-
-	glm::dvec3 vPosition = LOOP_WEIGHT * v->GetPosition();
-	glm::dvec3 wPosition = LOOP_WEIGHT * w->GetPosition();
-	return vPosition + wPosition;
+	// The fan of an even vertex is that of the old vertex, with each old triangle s replaced by the triangle 4s + k
+	// at corner k of s. Where several fans meet at the vertex, the others still follow in their old order,
+	// since 4s + k keeps the order of s. The fan of an odd vertex starts at its boundary corner,
+	// or at the corner after its own, as OrderVertexToTrianglePointers() does.
+	int numVertices = p->vlist.size();
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(loop.vlist.size(), BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Vert& v = loop.vlist[i];
+			if (i < numVertices)
+			{
+				Vert& parent = p->vlist[i];
+				for (int j = 0; j < parent.triangles.size(); ++j)
+				{
+					Triangle* s = parent.triangles[j];
+					int k = (s->vertices[0] == &parent) ? 0 : (s->vertices[1] == &parent) ? 1 : 2;
+					v.triangles[j] = &loop.tlist[4 * s->index + k];
+				}
+				continue;
+			}
+
+			int32_t start = (v.boundary != NULL) ? v.boundary->index : child.Swing(child.vertexCorners[i]);
+			int j = 0;
+			int32_t c = start;
+			do
+			{
+				v.triangles[j++] = &loop.tlist[CompactMesh::T(c)];
+				c = child.Swing(c);
+			} while (c >= 0 && c != start);
+		}
+	});
 }
 
-glm::dvec3 Subdivision::GetOppositeLinearCombination(Edge* e)
+CompactMesh Subdivision::LoopSubdivision(const CompactMesh& m)
 {
-	if (e->isBoundary())
+	std::vector<glm::dvec3> positions = GetEvenAndOddPositions(m);
+	if (!IsOrientedManifold(m))
 	{
-		std::cout << "ERROR: GetOppositeLinearCombination(Edge* e) should only be called for non-boundary edges!" << std::endl;
-		exit(-1);
+		CompactMesh loop(positions, GetTriangles(m));
+		loop.Initialize();
+		return loop;
 	}
 
-	const double LOOP_WEIGHT = (double)1.0 / 8.0;
-	Triangle* t1 = e->triangles[0];
-	Triangle* t2 = e->triangles[1];
+	CompactMesh loop;
+	SubdivideTopology(m, loop);
+	loop.positions = std::move(positions);
+	loop.InitializeFromCornerTable();
+	return loop;
+}
 
-	glm::dvec3 v1Position;
-	glm::dvec3 v2Position;
+bool Subdivision::IsOrientedManifold(const CompactMesh& m)
+{
+	// Every half-edge is on one edge. An edge with one or two of them, paired up, accounts for that many half-edges
+	// and that many minus one opposite corners, so anything else shows in the count.
+	// Each block counts its own unpaired corners, and the counts are added up in order.
+	int32_t numCorners = m.GetNumberOfCorners();
+	const int BLOCK_SIZE = 4096;
+	int numBlocks = (numCorners + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<int64_t> unpaired(numBlocks, 0);
+	std::vector<char> oriented(numBlocks, 1);
+	Parallel::ForBlocks(numCorners, BLOCK_SIZE, [&](int begin, int end)
+	{
+		int b = begin / BLOCK_SIZE;
+		for (int32_t c = begin; c < end; ++c)
+		{
+			// A triangle with a vertex twice is not a triangle of a manifold.
+			if (m.V(c) == m.V(CompactMesh::N(c)))
+			{
+				oriented[b] = 0;
+				return;
+			}
+
+			int32_t o = m.O(c);
+			if (o < 0)
+			{
+				++unpaired[b];
+				continue;
+			}
+
+			// Paired both ways, and the edge runs the other way in the other triangle.
+			if (m.O(o) != c || m.V(CompactMesh::N(c)) != m.V(CompactMesh::P(o)))
+			{
+				oriented[b] = 0;
+				return;
+			}
+		}
+	});
 
-	// Find the correct vertices that are opposite to the given edge.
-	for (int i = 0; i < 3; ++i)
+	int64_t total = 0;
+	for (int b = 0; b < numBlocks; ++b)
 	{
-		if (e->Contains(t1->vertices[i]) == -1)
+		if (!oriented[b])
+			return false;
+		total += unpaired[b];
+	}
+	return numCorners + total == 2 * (int64_t)m.GetNumberOfEdges();
+}
+
+CompactMesh Subdivision::GetTopology(Polyhedron* p)
+{
+	CompactMesh m;
+	int numVertices = p->vlist.size();
+	int numEdges = p->elist.size();
+	int numCorners = p->clist.size();
+	Corner* corners = p->clist.data();
+	const int BLOCK_SIZE = 4096;
+
+	m.positions.resize(numVertices);
+	m.vertexCorners.resize(numVertices);
+	m.valences.resize(numVertices);
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
 		{
-			Vert* v1 = t1->vertices[i];
-			v1Position = LOOP_WEIGHT * v1->GetPosition();
+			Vert& v = p->vlist[i];
+			m.positions[i] = v.GetPosition();
+			m.vertexCorners[i] = (v.c == NULL) ? -1 : v.c - corners;
+			m.valences[i] = v.valence;
 		}
-		if (e->Contains(t2->vertices[i]) == -1)
+	});
+	m.valenceDeficit = p->valenceDeficit;
+
+	m.cornerVertices.resize(numCorners);
+	m.cornerOpposites.resize(numCorners);
+	m.cornerEdges.resize(numCorners);
+	Parallel::ForBlocks(numCorners, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
 		{
-			Vert* v2 = t2->vertices[i];
-			v2Position = LOOP_WEIGHT * v2->GetPosition();
+			Corner& c = p->clist[i];
+			m.cornerVertices[i] = c.v->index;
+			m.cornerOpposites[i] = (c.o == NULL) ? -1 : c.o - corners;
+			m.cornerEdges[i] = c.e->index;
 		}
-	}
+	});
 
-	return v1Position + v2Position;
+	// The first half-edge of an edge is the one in its first triangle, which is the one opposite the edge's corner there.
+	m.edgeHalfEdges.resize(numEdges);
+	Parallel::ForBlocks(numEdges, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Edge& e = p->elist[i];
+			Triangle* t = e.triangles[0];
+			int j = 0;
+			while (t->edges[j] != &e)
+			{
+				++j;
+			}
+			m.edgeHalfEdges[i] = 3 * t->index + j;
+		}
+	});
+	return m;
 }
 
-glm::dvec3 Subdivision::GetBoundaryLinearCombination(Edge* e)
+std::vector<int32_t> Subdivision::GetTriangles(const CompactMesh& m)
 {
-	if (e->isBoundary())
+	// Half-edge 3t + j is opposite corner P(3t + j), so its edge is E(P(3t + j)).
+	int32_t numVertices = m.GetNumberOfVertices();
+	int32_t numTriangles = m.GetNumberOfTriangles();
+	std::vector<int32_t> triangles(12 * numTriangles);
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(numTriangles, BLOCK_SIZE, [&](int begin, int end)
 	{
-		std::cout << "ERROR: GetBoundaryLinearCombination(Edge* e) should only be called for boundary edges!" << std::endl;
-		exit(-1);
-	}
-	const double LOOP_WEIGHT = (double)1.0 / 2.0;
-	glm::dvec3 v1Position = LOOP_WEIGHT * e->vertices[0]->GetPosition();
-	glm::dvec3 v2Position = LOOP_WEIGHT * e->vertices[1]->GetPosition();
-	return v1Position + v2Position;
+		for (int32_t t = begin; t < end; ++t)
+		{
+			int32_t v0 = m.V(3 * t);
+			int32_t v1 = m.V(3 * t + 1);
+			int32_t v2 = m.V(3 * t + 2);
+			int32_t w0 = numVertices + m.E(CompactMesh::P(3 * t));
+			int32_t w1 = numVertices + m.E(CompactMesh::P(3 * t + 1));
+			int32_t w2 = numVertices + m.E(CompactMesh::P(3 * t + 2));
+
+			int32_t* child = &triangles[12 * t];
+			child[0] = v0; child[1] = w0;  child[2] = w2;
+			child[3] = w0; child[4] = v1;  child[5] = w1;
+			child[6] = w1; child[7] = v2;  child[8] = w2;
+			child[9] = w0; child[10] = w1; child[11] = w2;
+		}
+	});
+	return triangles;
 }
 
-Vert Subdivision::CreateOddVertex(Edge* e, int index)
+void Subdivision::SubdivideTopology(const CompactMesh& m, CompactMesh& child)
 {
-	glm::dvec3 position;
+	int32_t numVertices = m.GetNumberOfVertices();
+	int32_t numEdges = m.GetNumberOfEdges();
+	int32_t numTriangles = m.GetNumberOfTriangles();
+	int32_t numCorners = 12 * numTriangles;
+	child.cornerVertices = GetTriangles(m);
+
+	// The half-edges of the four triangles of t are 12t, ..., 12t + 11.
+	// HALVES[j] are the two halves of half-edge j of t: the one at its first vertex, then the one at its second.
+	// INSIDE pairs up the three new edges inside t with the sides of the middle triangle 4t + 3.
+	const int32_t HALVES[3][2] = { { 0, 3 }, { 4, 6 }, { 7, 2 } };
+	const int32_t INSIDE[3][2] = { { 1, 11 }, { 5, 9 }, { 8, 10 } };
+
+	// Corner c is opposite half-edge N(c), so when half-edges h and g are on the same edge, O(P(h)) = P(g).
+	// Each old triangle only writes the opposites of its own four.
+	child.cornerOpposites.resize(numCorners);
+	auto pair = [&](int32_t h, int32_t g)
+	{
+		child.cornerOpposites[CompactMesh::P(h)] = CompactMesh::P(g);
+	};
+	const int BLOCK_SIZE = 4096;
+	Parallel::ForBlocks(numTriangles, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int32_t t = begin; t < end; ++t)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				pair(12 * t + INSIDE[j][0], 12 * t + INSIDE[j][1]);
+				pair(12 * t + INSIDE[j][1], 12 * t + INSIDE[j][0]);
+
+				// Across the old edge, the half-edge runs the other way, so its first half meets this one's second.
+				int32_t o = m.O(CompactMesh::P(3 * t + j));
+				if (o < 0)
+				{
+					child.cornerOpposites[CompactMesh::P(12 * t + HALVES[j][0])] = -1;
+					child.cornerOpposites[CompactMesh::P(12 * t + HALVES[j][1])] = -1;
+					continue;
+				}
+				int32_t g = CompactMesh::N(o);
+				int32_t s = CompactMesh::T(g);
+				int32_t i = g % 3;
+				pair(12 * t + HALVES[j][0], 12 * s + HALVES[i][1]);
+				pair(12 * t + HALVES[j][1], 12 * s + HALVES[i][0]);
+			}
+		}
+	});
 
-	// Check if the edge is a boundary or not.
-	if (e->isBoundary())
+	// An edge gets its number at its first half-edge, which is the one with no half-edge before it on the same edge.
+	// The numbers are handed out in three passes over blocks of half-edges: each block counts its first half-edges,
+	// the counts are added up to where each block starts numbering, and each block numbers its own from there.
+	// The other half-edge of an edge comes after the first, in a block that may not be done yet, so it takes the number last.
+	auto isFirst = [&](int32_t h)
 	{
-		position = GetBoundaryLinearCombination(e);
-	}
-	else
+		int32_t o = child.O(CompactMesh::P(h));
+		return o < 0 || CompactMesh::N(o) > h;
+	};
+	int numBlocks = (numCorners + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<int32_t> offsets(numBlocks + 1, 0);
+	Parallel::ForBlocks(numCorners, BLOCK_SIZE, [&](int begin, int end)
+	{
+		int32_t count = 0;
+		for (int32_t h = begin; h < end; ++h)
+		{
+			count += isFirst(h) ? 1 : 0;
+		}
+		offsets[begin / BLOCK_SIZE + 1] = count;
+	});
+	for (int b = 0; b < numBlocks; ++b)
 	{
-		glm::dvec3 adjacent = GetAdjacentLinearCombination(e);
-		glm::dvec3 opposite = GetOppositeLinearCombination(e);
-		position = adjacent + opposite;
+		offsets[b + 1] += offsets[b];
 	}
-	Vert v(position.x, position.y, position.z);
-	v.index = index;
-	return v;
-}
 
-double Subdivision::Beta(int valence)
-{
-	if (valence <= 2)
+	child.cornerEdges.resize(numCorners);
+	child.edgeHalfEdges.resize(offsets[numBlocks]);
+	Parallel::ForBlocks(numCorners, BLOCK_SIZE, [&](int begin, int end)
 	{
-		std::cout << "ERROR: Only call Beta(int valence) for non-boundary vertices. " << std::endl;
-		exit(-1);
-	}
-	else if (valence == 3)
+		int32_t edge = offsets[begin / BLOCK_SIZE];
+		for (int32_t h = begin; h < end; ++h)
+		{
+			if (isFirst(h))
+			{
+				child.cornerEdges[CompactMesh::P(h)] = edge;
+				child.edgeHalfEdges[edge++] = h;
+			}
+		}
+	});
+	Parallel::ForBlocks(numCorners, BLOCK_SIZE, [&](int begin, int end)
 	{
-		return (double)3.0 / 16.0;
-	}
-	else
+		for (int32_t h = begin; h < end; ++h)
+		{
+			if (!isFirst(h))
+				child.cornerEdges[CompactMesh::P(h)] = child.cornerEdges[child.O(CompactMesh::P(h))];
+		}
+	});
+
+	// The last corner of an even vertex is in the triangle of its last old corner. The last corner of an odd vertex
+	// is in the middle triangle of the last old triangle on its edge, at the position of the edge there.
+	const int32_t EVEN[3] = { 0, 4, 7 };
+	child.vertexCorners.resize(numVertices + numEdges);
+	child.valences.resize(numVertices + numEdges);
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
 	{
-		return (double)3.0 / (8.0 * (double)valence);
+		for (int32_t v = begin; v < end; ++v)
+		{
+			int32_t c = m.vertexCorners[v];
+			child.vertexCorners[v] = (c < 0) ? -1 : 12 * CompactMesh::T(c) + EVEN[c % 3];
+			child.valences[v] = m.valences[v];
+		}
+	});
+	Parallel::ForBlocks(numEdges, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int32_t e = begin; e < end; ++e)
+		{
+			int32_t h = m.edgeHalfEdges[e];
+			int32_t o = m.O(CompactMesh::P(h));
+			int32_t last = (o < 0) ? h : CompactMesh::N(o);
+			child.vertexCorners[numVertices + e] = 12 * CompactMesh::T(last) + 9 + last % 3;
+			child.valences[numVertices + e] = (o < 0) ? 4 : 6;
+		}
+	});
+
+	// Vertices without triangles do not count. The valences of the even vertices are the old ones, so only the
+	// odd vertices add to the old deficit: 2 for each boundary edge.
+	child.valenceDeficit = m.valenceDeficit;
+	for (int32_t e = numVertices; e < numVertices + numEdges; ++e)
+	{
+		child.valenceDeficit += 6 - child.valences[e];
 	}
 }
 
-std::map<int, Vert*> Subdivision::GetConnectedVertices(Vert* v)
+std::vector<glm::dvec3> Subdivision::GetEvenAndOddPositions(Polyhedron* p, const CompactMesh& topology)
 {
-	std::map<int, Vert*> connectedVertices;
-	// Trace all of the triangles of the vertex v to find the other vertices.
-	for (int i = 0; i < v->GetNumberOfTriangles(); ++i)
+	int numVertices = p->vlist.size();
+	int numEdges = p->elist.size();
+	std::vector<glm::dvec3> positions(numVertices + numEdges);
+	const int BLOCK_SIZE = 4096;
+
+	/** Even vertices:
+	 * The vertices of the triangles of the vertex, each once, in index order.
+	 */
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
 	{
-		Triangle* t = v->triangles[i];
-		for (int j = 0; j < 3; ++j)
+		std::vector<int> connected;
+		std::vector<glm::dvec3> neighbours;
+		for (int i = begin; i < end; ++i)
 		{
-			Vert* w = t->vertices[j];
-			connectedVertices.insert({ w->index, w});
+			Vert& v = p->vlist[i];
+			connected.clear();
+			for (Triangle* t : v.triangles)
+			{
+				for (Vert* w : t->vertices)
+				{
+					if (w != &v)
+						connected.push_back(w->index);
+				}
+			}
+			std::sort(connected.begin(), connected.end());
+			connected.erase(std::unique(connected.begin(), connected.end()), connected.end());
+
+			neighbours.clear();
+			for (int w : connected)
+			{
+				neighbours.push_back(topology.positions[w]);
+			}
+			positions[i] = GetEvenPosition(topology.positions[i], v.valence, neighbours);
 		}
-	}
-	return connectedVertices;
+	});
+
+	/** Odd vertices:
+	 * The odd vertex of edge e is placed right after the even vertices, at numberOfEvenVertices + e.
+	 */
+	Parallel::ForBlocks(numEdges, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int e = begin; e < end; ++e)
+		{
+			positions[numVertices + e] = GetOddPosition(topology, topology.positions, topology.edgeHalfEdges[e]);
+		}
+	});
+	return positions;
 }
 
-glm::dvec3 Subdivision::GetAdjacentLinearCombination(Vert* v)
+std::vector<glm::dvec3> Subdivision::GetEvenAndOddPositions(const CompactMesh& m)
 {
-	std::map<int, Vert*> connectedVertices = GetConnectedVertices(v);
-	int n = v->valence;
+	int32_t numVertices = m.GetNumberOfVertices();
+	int32_t numEdges = m.GetNumberOfEdges();
+	std::vector<glm::dvec3> positions(numVertices + numEdges);
+	const int BLOCK_SIZE = 4096;
 
-	// Loop formula:
-	glm::dvec3 vPosition = v->GetPosition();
-	double scale = 1 - (n * Beta(n));
-	glm::dvec3 newPosition = scale * vPosition;
+	// The ring of a vertex can list a neighbour twice, where two fans meet, so sort it out first.
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		std::vector<int32_t> connected;
+		std::vector<glm::dvec3> neighbours;
+		for (int32_t v = begin; v < end; ++v)
+		{
+			CompactMesh::Range ring = m.GetRing(v);
+			connected.assign(ring.begin(), ring.end());
+			std::sort(connected.begin(), connected.end());
+			connected.erase(std::unique(connected.begin(), connected.end()), connected.end());
+
+			neighbours.clear();
+			for (int32_t w : connected)
+			{
+				if (w != v)
+					neighbours.push_back(m.positions[w]);
+			}
+			positions[v] = GetEvenPosition(m.positions[v], m.valences[v], neighbours);
+		}
+	});
 
-	for (auto it = connectedVertices.begin(); it != connectedVertices.end(); ++it)
+	Parallel::ForBlocks(numEdges, BLOCK_SIZE, [&](int begin, int end)
 	{
-		// Make sure not to count the original vertex itself!
-		if (it->first != v->index)
+		for (int32_t e = begin; e < end; ++e)
 		{
-			Vert* w = it->second;
-			glm::dvec3 wPosition = w->GetPosition();
-			newPosition += Beta(n) * wPosition;
+			positions[numVertices + e] = GetOddPosition(m, m.positions, m.edgeHalfEdges[e]);
 		}
-	}
-	return newPosition;
+	});
+	return positions;
 }
 
-glm::dvec3 Subdivision::GetBoundaryLinearCombination(Vert* v)
+glm::dvec3 Subdivision::GetEvenPosition(const glm::dvec3& position, int n, const std::vector<glm::dvec3>& neighbours)
 {
-	std::map<int, Vert*> connectedVertices = GetConnectedVertices(v);
-	int n = v->valence;
-
-	// Loop formula:
-	glm::dvec3 vPosition = v->GetPosition();
-	double scale = (double)3.0 / 4.0;
-	glm::dvec3 newPosition = scale * vPosition;
-
-	for (auto it = connectedVertices.begin(); it != connectedVertices.end(); ++it)
+	// Loop formula, or a fixed weighting for vertices with too few edges for it.
+	if (n < 3)
 	{
-		// Make sure not to count the original vertex itself!
-		if (it->first != v->index)
+		glm::dvec3 newPosition = ((double)3.0 / 4.0) * position;
+		for (const glm::dvec3& w : neighbours)
 		{
-			Vert* w = it->second;
-			glm::dvec3 wPosition = w->GetPosition();
-			newPosition += (double)1.0 / 8.0 * wPosition;
+			newPosition += (double)1.0 / 8.0 * w;
 		}
+		return newPosition;
+	}
+
+	double beta = Beta(n);
+	glm::dvec3 newPosition = (1 - (n * beta)) * position;
+	for (const glm::dvec3& w : neighbours)
+	{
+		newPosition += beta * w;
 	}
 	return newPosition;
 }
 
-Vert Subdivision::CreateEvenVertex(Vert* v)
+glm::dvec3 Subdivision::GetOddPosition(const CompactMesh& m, const std::vector<glm::dvec3>& positions, int32_t h)
+{
+	// Edge e runs from V(h) to V(N(h)), and P(h) is the corner across from it in the first of its triangles.
+	glm::dvec3 v0 = positions[m.V(h)];
+	glm::dvec3 v1 = positions[m.V(CompactMesh::N(h))];
+	int32_t o = m.O(CompactMesh::P(h));
+	if (o < 0)
+		return (double)1.0 / 2.0 * v0 + (double)1.0 / 2.0 * v1;
+
+	glm::dvec3 adjacent = (double)3.0 / 8.0 * v0 + (double)3.0 / 8.0 * v1;
+	glm::dvec3 opposite = (double)1.0 / 8.0 * positions[m.V(CompactMesh::P(h))] + (double)1.0 / 8.0 * positions[m.V(o)];
+	return adjacent + opposite;
+}
+
+double Subdivision::Beta(int valence)
 {
-	glm::dvec3 newPosition;
-	if (v->valence < 3)
+	if (valence <= 2)
+	{
+		std::cout << "ERROR: Only call Beta(int valence) for non-boundary vertices. " << std::endl;
+		exit(-1);
+	}
+	else if (valence == 3)
 	{
-		newPosition = GetBoundaryLinearCombination(v);
+		return (double)3.0 / 16.0;
 	}
 	else
 	{
-		newPosition = GetAdjacentLinearCombination(v);
+		return (double)3.0 / (8.0 * (double)valence);
 	}
-	Vert w;
-	w.index = v->index;
-	w.x = newPosition.x;
-	w.y = newPosition.y;
-	w.z = newPosition.z;
-	return w;
 }
 
-
-
-
-
-
-
-
-
-
-
 Subdivision::Subdivision() {}
 Subdivision::~Subdivision() {}
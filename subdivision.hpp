@@ -1,51 +1,86 @@
 #pragma once
 
-#include <map>
+#include <vector>
+#include <cstdint>
 #include "polyhedron.hpp"
+#include "compactmesh.hpp"
 
 /** Loop subdivision.
- * Goal: given a mesh, output a new mesh that has been subdivided according to Loop subdivision. */
+ * Goal: given a mesh, output a new mesh that has been subdivided according to Loop subdivision.
+ *
+ * Everything about the topology of the new mesh follows from the corner table of the old one, so nothing is searched for.
+ * With n vertices and e edges, vertex i keeps index i (the even vertices), the vertex added on edge j is n + j
+ * (the odd vertices), and triangle t is cut into 4t, ..., 4t + 3:
+ *
+ *     4t: v0 w0 w2    4t + 1: w0 v1 w1    4t + 2: w1 v2 w2    4t + 3: w0 w1 w2
+ *
+ * where vk is vertex k of t and wk the odd vertex on edge k. The two halves of an old edge meet the halves in the
+ * triangle across it, and the three new edges inside t meet the middle triangle, so the opposite corners are known;
+ * the edges are then numbered in order of first appearance, as Polyhedron::Initialize() numbers them; and the valences
+ * are those of the old vertices, and 6 (or 4 on a boundary) at the new ones. The corner table, edges and valences
+ * are written straight into flat arrays, and only the geometry (normals, areas, angles and what the curvatures cache)
+ * is computed on the new mesh, in the stages of Initialize() that compute it. The result is the same as Initialize()
+ * would make of the new triangles.
+ *
+ * Every element of the new mesh is made from a few elements of the old one and written at an index known in advance,
+ * so each stage is a parallel loop over the new vertices, edges, triangles or corners. Only the edge numbers need
+ * the number of edges before them, which is a sum over blocks of half-edges. Nothing depends on the number of threads.
+ *
+ * This needs every edge to have one or two triangles, with the same orientation on both sides.
+ * Anything else is subdivided the slow way: the new triangles are made, and then the whole mesh is initialized.
+ */
 class Subdivision
 {
 
 public:
 
-	// Loop subdivision algorithm.
+	// Loop subdivision of an initialized polyhedron. The result is initialized.
 	Polyhedron static LoopSubdivision(Polyhedron* p);
 	static Polyhedron* LoopSubdivisionHeap(Polyhedron* p);
 
+	// Loop subdivision of an initialized compact mesh, with the same vertex and triangle numbering as the above.
+	// The result is initialized.
+	static CompactMesh LoopSubdivision(const CompactMesh& m);
+
 private:
 
-	// Get the appropriate linear combination of adjacent vertices.
-	glm::dvec3 static GetAdjacentLinearCombination(Edge* e);
+	// The stencils are compiled from the same weights, and adaptive subdivision places its vertices by them.
+	friend class SubdivisionStencil;
+	friend class AdaptiveSubdivision;
 
-	// Get the appropriate linear combination of opposite vertices.
-	// NOTE: Only call this if the edge separates two triangles.
-	glm::dvec3 static GetOppositeLinearCombination(Edge* e);
+	// True if the corner table of m is that of an oriented manifold, possibly with boundary, which SubdivideTopology() needs.
+	static bool IsOrientedManifold(const CompactMesh& m);
 
-	// Get the appropriate linear combination for vertices on a boundary.
-	// NOTE: Only call this if the edge is a boundary.
-	glm::dvec3 static GetBoundaryLinearCombination(Edge* e);
+	// Write the corner table, edges, vertex corners and valences of the subdivided mesh into child, from those of m.
+	// Only cornerVertices, cornerOpposites, cornerEdges, edgeHalfEdges, vertexCorners and valences of m are read.
+	static void SubdivideTopology(const CompactMesh& m, CompactMesh& child);
 
-	// The odd vertices are the ones that get added by Loop subdivision.
-	// Creating an odd vertex involves the linear combinations described by the previous three functions.
-	Vert static CreateOddVertex(Edge* e, int index);
+	// The corner table, edges, vertex corners and valences of an initialized polyhedron, in the arrays of a compact mesh.
+	static CompactMesh GetTopology(Polyhedron* p);
 
-	// A weight needed to recompute the positions of mesh vertices.
-	// This choice of beta is not due to Loop himself, but to more recent papers.
-	double static Beta(int valence);
+	// The stages that put together loop, the subdivision of p with the topology child, in place of those of Initialize():
+	// the triangles of each vertex in index order and the corners at the boundary; the edges, corners and valences;
+	// and the triangles of each vertex in fan order, from the fans of p instead of by walking around every vertex.
+	static void ConnectVerticesToTriangles(Polyhedron* p, const CompactMesh& child, Polyhedron& loop);
+	static void LinkEdgesAndCorners(const CompactMesh& child, Polyhedron& loop);
+	static void OrderFans(Polyhedron* p, const CompactMesh& child, Polyhedron& loop);
 
-	// Find all vertices that are connected to the given vertex by an edge.
-	std::map<int, Vert*> static GetConnectedVertices(Vert* v);
+	// New positions: the even vertices first, then the odd vertices, from the mesh before subdivision.
+	static std::vector<glm::dvec3> GetEvenAndOddPositions(Polyhedron* p, const CompactMesh& topology);
+	static std::vector<glm::dvec3> GetEvenAndOddPositions(const CompactMesh& m);
 
-	// Adjacent linear combination for a vertex that is not on a boundary.
-	glm::dvec3 static GetAdjacentLinearCombination(Vert* v);
+	// The position of an even vertex of valence n, from its neighbours in increasing index order.
+	static glm::dvec3 GetEvenPosition(const glm::dvec3& position, int n, const std::vector<glm::dvec3>& neighbours);
 
-	// Boundary linear combination for a vertex that is not on a boundary.
-	glm::dvec3 static GetBoundaryLinearCombination(Vert* v);
+	// The position of the odd vertex on the edge of half-edge h, from the corner table and positions of m.
+	static glm::dvec3 GetOddPosition(const CompactMesh& m, const std::vector<glm::dvec3>& positions, int32_t h);
 
-	// Recompute a vertex.
-	Vert static CreateEvenVertex(Vert* v);
+	// The four triangles of each triangle of m, as three vertex indices each.
+	static std::vector<int32_t> GetTriangles(const CompactMesh& m);
+
+	// A weight needed to recompute the positions of mesh vertices.
+	// This choice of beta is not due to Loop himself, but to more recent papers.
+	double static Beta(int valence);
 
 
 	Subdivision();
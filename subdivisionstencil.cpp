@@ -0,0 +1,396 @@
+#include "subdivisionstencil.hpp"
+#include "subdivision.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STENCIL_X86
+#endif
+
+SubdivisionStencil::SubdivisionStencil() {}
+SubdivisionStencil::~SubdivisionStencil() {}
+
+void SubdivisionStencil::Build(const CompactMesh& base, int levels, Evaluation evaluation)
+{
+	this->levels = levels;
+	this->evaluation = evaluation;
+	width = (evaluation == Evaluation::LIMIT) ? 3 : 1;
+
+	// Start from the identity on the base vertices, and multiply a level onto it at a time.
+	// The mesh of each level is only needed for its connectivity.
+	Rows product;
+	numBaseVertices = base.GetNumberOfVertices();
+	product.offsets.resize(numBaseVertices + 1);
+	product.columns.resize(numBaseVertices);
+	product.weights.assign(numBaseVertices, 1.0);
+	for (int i = 0; i < numBaseVertices; ++i)
+	{
+		product.offsets[i] = i;
+		product.columns[i] = i;
+	}
+	product.offsets[numBaseVertices] = numBaseVertices;
+
+	topology = base;
+	for (int level = 0; level < levels; ++level)
+	{
+		Rows stencils;
+		GetLevelStencils(topology, stencils);
+		Rows next;
+		Multiply(stencils, 1, product, next);
+		product = std::move(next);
+		topology = Subdivision::LoopSubdivision(topology);
+	}
+
+	if (evaluation == Evaluation::LIMIT)
+	{
+		Rows masks;
+		GetLimitMasks(topology, masks);
+		Rows limit;
+		Multiply(masks, 3, product, limit);
+		product = std::move(limit);
+	}
+	rowOffsets = std::move(product.offsets);
+	columns = std::move(product.columns);
+	weights = std::move(product.weights);
+
+	// The way the face normals of the subdivided mesh were turned, from its first triangle with an area.
+	orientation = 1.0;
+	for (int32_t t = 0; t < topology.GetNumberOfTriangles(); ++t)
+	{
+		glm::dvec3 x0 = topology.positions[topology.V(3 * t)];
+		glm::dvec3 normal = glm::cross(topology.positions[topology.V(3 * t + 2)] - x0, topology.positions[topology.V(3 * t + 1)] - x0);
+		double alignment = glm::dot(normal, topology.faceNormals[t]);
+		if (alignment != 0 && !std::isnan(alignment))
+		{
+			orientation = (alignment > 0) ? 1.0 : -1.0;
+			break;
+		}
+	}
+}
+
+int SubdivisionStencil::GetNumberOfBaseVertices() const
+{
+	return numBaseVertices;
+}
+
+int SubdivisionStencil::GetNumberOfVertices() const
+{
+	return rowOffsets.empty() ? 0 : rowOffsets.size() - 1;
+}
+
+void SubdivisionStencil::Apply(const std::vector<glm::dvec3>& basePositions, std::vector<glm::dvec3>& positions,
+	std::vector<glm::dvec3>* normals) const
+{
+	if ((int)basePositions.size() != numBaseVertices)
+	{
+		std::cout << "ERROR: The stencils were built for " << numBaseVertices << " base vertices, not " << basePositions.size() << "." << std::endl;
+		exit(-1);
+	}
+	int numVertices = GetNumberOfVertices();
+	const int BLOCK_SIZE = 4096;
+
+	// x, y, z and a zero, so that a position is one load.
+	std::vector<double> base(4 * numBaseVertices);
+	Parallel::ForBlocks(numBaseVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			base[4 * i] = basePositions[i].x;
+			base[4 * i + 1] = basePositions[i].y;
+			base[4 * i + 2] = basePositions[i].z;
+			base[4 * i + 3] = 0.0;
+		}
+	});
+
+	positions.resize(numVertices);
+	bool limit = (evaluation == Evaluation::LIMIT) && normals != NULL;
+	std::vector<glm::dvec3> t1(limit ? numVertices : 0);
+	std::vector<glm::dvec3> t2(limit ? numVertices : 0);
+	bool avx2 = HasAvx2();
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		if (avx2)
+			ApplyAvx2(base.data(), begin, end, positions.data(), limit ? t1.data() : NULL, limit ? t2.data() : NULL);
+		else
+			ApplyScalar(base.data(), begin, end, positions.data(), limit ? t1.data() : NULL, limit ? t2.data() : NULL);
+	});
+	if (!limit)
+		return;
+
+	// The tangents follow the ring, so t1 x t2 points the way of (x2 - x0) x (x1 - x0).
+	// Where the fan is not one closed fan, the tangents are zero, and the normals of the triangles stand in.
+	normals->resize(numVertices);
+	Parallel::ForBlocks(numVertices, BLOCK_SIZE, [&](int begin, int end)
+	{
+		for (int32_t v = begin; v < end; ++v)
+		{
+			glm::dvec3 normal = glm::cross(t1[v], t2[v]);
+			if (topology.GetStar(v).size() < 3)
+			{
+				normal = glm::dvec3(0.0);
+				for (int32_t c : topology.GetFan(v))
+				{
+					glm::dvec3 x0 = positions[topology.V(c)];
+					normal += glm::cross(positions[topology.V(CompactMesh::P(c))] - x0, positions[topology.V(CompactMesh::N(c))] - x0);
+				}
+			}
+			(*normals)[v] = orientation * glm::normalize(normal);
+		}
+	});
+}
+
+CompactMesh SubdivisionStencil::GetMesh(const std::vector<glm::dvec3>& basePositions) const
+{
+	CompactMesh mesh = topology;
+	std::vector<glm::dvec3> normals;
+	Apply(basePositions, mesh.positions, &normals);
+	mesh.InitializeFromCornerTable();
+	if (evaluation == Evaluation::LIMIT)
+		mesh.normals = std::move(normals);
+	return mesh;
+}
+
+size_t SubdivisionStencil::GetMemoryUsage() const
+{
+	return rowOffsets.capacity() * sizeof(int64_t)
+		+ columns.capacity() * sizeof(int32_t)
+		+ weights.capacity() * sizeof(double);
+}
+
+void SubdivisionStencil::BuildRows(int numRows, int width, const std::function<void(int, std::vector<Entry>&)>& row, Rows& rows)
+{
+	const int BLOCK_SIZE = 4096;
+	int numBlocks = (numRows + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<Rows> blocks(numBlocks);
+	rows.offsets.assign(numRows + 1, 0);
+	Parallel::ForBlocks(numRows, BLOCK_SIZE, [&](int begin, int end)
+	{
+		Rows& block = blocks[begin / BLOCK_SIZE];
+		std::vector<Entry> entries;
+		for (int i = begin; i < end; ++i)
+		{
+			entries.clear();
+			row(i, entries);
+			std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.column < b.column; });
+
+			int64_t count = 0;
+			for (int k = 0; k < entries.size(); ++k)
+			{
+				if (k > 0 && entries[k].column == entries[k - 1].column)
+				{
+					for (int j = 0; j < width; ++j)
+					{
+						block.weights[block.weights.size() - width + j] += entries[k].weights[j];
+					}
+					continue;
+				}
+				block.columns.push_back(entries[k].column);
+				block.weights.insert(block.weights.end(), entries[k].weights, entries[k].weights + width);
+				++count;
+			}
+			rows.offsets[i + 1] = count;
+		}
+	});
+
+	for (int i = 0; i < numRows; ++i)
+	{
+		rows.offsets[i + 1] += rows.offsets[i];
+	}
+	rows.columns.resize(rows.offsets[numRows]);
+	rows.weights.resize(width * rows.offsets[numRows]);
+	Parallel::For(numBlocks, [&](int b)
+	{
+		int64_t offset = rows.offsets[b * BLOCK_SIZE];
+		std::copy(blocks[b].columns.begin(), blocks[b].columns.end(), rows.columns.begin() + offset);
+		std::copy(blocks[b].weights.begin(), blocks[b].weights.end(), rows.weights.begin() + width * offset);
+		blocks[b] = Rows();
+	});
+}
+
+void SubdivisionStencil::GetLevelStencils(const CompactMesh& m, Rows& stencils)
+{
+	// The weights Subdivision::GetEvenPosition() and Subdivision::GetOddPosition() use, on the same vertices.
+	int32_t numVertices = m.GetNumberOfVertices();
+	int32_t numEdges = m.GetNumberOfEdges();
+	BuildRows(numVertices + numEdges, 1, [&](int i, std::vector<Entry>& entries)
+	{
+		auto add = [&](int32_t column, double weight)
+		{
+			Entry entry = { column, { weight, 0.0, 0.0 } };
+			entries.push_back(entry);
+		};
+
+		if (i >= numVertices)
+		{
+			int32_t h = m.edgeHalfEdges[i - numVertices];
+			int32_t o = m.O(CompactMesh::P(h));
+			if (o < 0)
+			{
+				add(m.V(h), (double)1.0 / 2.0);
+				add(m.V(CompactMesh::N(h)), (double)1.0 / 2.0);
+				return;
+			}
+			add(m.V(h), (double)3.0 / 8.0);
+			add(m.V(CompactMesh::N(h)), (double)3.0 / 8.0);
+			add(m.V(CompactMesh::P(h)), (double)1.0 / 8.0);
+			add(m.V(o), (double)1.0 / 8.0);
+			return;
+		}
+
+		// Each neighbour once, however many times the ring lists it.
+		CompactMesh::Range ring = m.GetRing(i);
+		std::vector<int32_t> connected(ring.begin(), ring.end());
+		std::sort(connected.begin(), connected.end());
+		connected.erase(std::unique(connected.begin(), connected.end()), connected.end());
+		connected.erase(std::remove(connected.begin(), connected.end(), i), connected.end());
+
+		int n = m.valences[i];
+		double self = (n < 3) ? (double)3.0 / 4.0 : 1 - n * Subdivision::Beta(n);
+		double neighbour = (n < 3) ? (double)1.0 / 8.0 : Subdivision::Beta(n);
+		add(i, self);
+		for (int32_t w : connected)
+		{
+			add(w, neighbour);
+		}
+	}, stencils);
+}
+
+void SubdivisionStencil::GetLimitMasks(const CompactMesh& m, Rows& masks)
+{
+	BuildRows(m.GetNumberOfVertices(), 3, [&](int i, std::vector<Entry>& entries)
+	{
+		// The masks need one closed fan of at least three triangles; anything else stays where it is.
+		CompactMesh::Range ring = m.GetRing(i);
+		int n = ring.size();
+		if (m.GetStar(i).size() < 3)
+		{
+			Entry entry = { i, { 1.0, 0.0, 0.0 } };
+			entries.push_back(entry);
+			return;
+		}
+
+		double chi = 1.0 / (3.0 / (8.0 * Subdivision::Beta(n)) + n);
+		Entry self = { i, { 1 - n * chi, 0.0, 0.0 } };
+		entries.push_back(self);
+		for (int k = 0; k < n; ++k)
+		{
+			double angle = 2.0 * M_PI * k / n;
+			Entry entry = { ring[k], { chi, std::cos(angle), std::sin(angle) } };
+			entries.push_back(entry);
+		}
+	}, masks);
+}
+
+void SubdivisionStencil::Multiply(const Rows& stencils, int width, const Rows& product, Rows& result)
+{
+	// Row i of the result is the rows of the product that row i of the stencils takes, each times its weights.
+	BuildRows(stencils.offsets.size() - 1, width, [&](int i, std::vector<Entry>& entries)
+	{
+		for (int64_t k = stencils.offsets[i]; k < stencils.offsets[i + 1]; ++k)
+		{
+			const double* w = &stencils.weights[width * k];
+			int32_t row = stencils.columns[k];
+			for (int64_t l = product.offsets[row]; l < product.offsets[row + 1]; ++l)
+			{
+				double u = product.weights[l];
+				Entry entry = { product.columns[l], { w[0] * u, 0.0, 0.0 } };
+				for (int j = 1; j < width; ++j)
+				{
+					entry.weights[j] = w[j] * u;
+				}
+				entries.push_back(entry);
+			}
+		}
+	}, result);
+}
+
+void SubdivisionStencil::ApplyScalar(const double* base, int begin, int end, glm::dvec3* positions, glm::dvec3* t1, glm::dvec3* t2) const
+{
+	for (int i = begin; i < end; ++i)
+	{
+		glm::dvec3 p(0.0);
+		glm::dvec3 a(0.0);
+		glm::dvec3 b(0.0);
+		for (int64_t k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+		{
+			const double* x = base + 4 * (int64_t)columns[k];
+			const double* w = &weights[width * k];
+			for (int j = 0; j < 3; ++j)
+			{
+				p[j] = p[j] + w[0] * x[j];
+			}
+			if (t1 == NULL)
+				continue;
+			for (int j = 0; j < 3; ++j)
+			{
+				a[j] = a[j] + w[1] * x[j];
+				b[j] = b[j] + w[2] * x[j];
+			}
+		}
+		positions[i] = p;
+		if (t1 != NULL)
+		{
+			t1[i] = a;
+			t2[i] = b;
+		}
+	}
+}
+
+#ifdef STENCIL_X86
+
+// The same arithmetic as ApplyScalar(), with x, y and z in one register.
+// FMA is left out on purpose: fusing the multiplies and adds would round differently from the scalar loop.
+__attribute__((target("avx2")))
+void SubdivisionStencil::ApplyAvx2(const double* base, int begin, int end, glm::dvec3* positions, glm::dvec3* t1, glm::dvec3* t2) const
+{
+	double out[4];
+	for (int i = begin; i < end; ++i)
+	{
+		__m256d p = _mm256_setzero_pd();
+		__m256d a = _mm256_setzero_pd();
+		__m256d b = _mm256_setzero_pd();
+		for (int64_t k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+		{
+			__m256d x = _mm256_loadu_pd(base + 4 * (int64_t)columns[k]);
+			const double* w = &weights[width * k];
+			p = _mm256_add_pd(p, _mm256_mul_pd(_mm256_set1_pd(w[0]), x));
+			if (t1 == NULL)
+				continue;
+			a = _mm256_add_pd(a, _mm256_mul_pd(_mm256_set1_pd(w[1]), x));
+			b = _mm256_add_pd(b, _mm256_mul_pd(_mm256_set1_pd(w[2]), x));
+		}
+		_mm256_storeu_pd(out, p);
+		positions[i] = glm::dvec3(out[0], out[1], out[2]);
+		if (t1 != NULL)
+		{
+			_mm256_storeu_pd(out, a);
+			t1[i] = glm::dvec3(out[0], out[1], out[2]);
+			_mm256_storeu_pd(out, b);
+			t2[i] = glm::dvec3(out[0], out[1], out[2]);
+		}
+	}
+}
+
+bool SubdivisionStencil::HasAvx2()
+{
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+
+#else
+
+void SubdivisionStencil::ApplyAvx2(const double* base, int begin, int end, glm::dvec3* positions, glm::dvec3* t1, glm::dvec3* t2) const
+{
+	ApplyScalar(base, begin, end, positions, t1, t2);
+}
+
+bool SubdivisionStencil::HasAvx2()
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "compactmesh.hpp"
+
+/** Loop subdivision of one mesh compiled into a sparse matrix, for subdividing many deformations of it.
+ *
+ * Every position of the subdivided mesh is a fixed weighted sum of the positions of the base mesh: a level of
+ * subdivision is a linear map S from the old positions to the new ones, and n levels are the product S_n ... S_1,
+ * which only depends on the connectivity. Build() multiplies the levels out once, row by row, and keeps the product
+ * in CSR form along with the topology of the subdivided mesh. Apply() then subdivides new base positions in one pass
+ * over the matrix, with no topology to rebuild.
+ *
+ * The rows are the stencils of Subdivision::LoopSubdivision(), so the positions agree with subdividing level by level
+ * up to rounding: the same weights are multiplied out in another order.
+ *
+ * With Evaluation::LIMIT, the last level is followed by the masks that take a vertex to its point on the limit surface,
+ * and two tangent masks whose cross product is the normal there (Loop, 1987; Hoppe et al., 1994):
+ *
+ *     limit = (1 - n chi) v + chi sum p_i, with chi = 1 / (3 / (8 beta) + n),
+ *     t1 = sum cos(2 pi i / n) p_i, and t2 = sum sin(2 pi i / n) p_i,
+ *
+ * over the n neighbours p_i of the vertex, in fan order. They only hold where the fan is closed. A vertex on a boundary,
+ * or where several fans meet, keeps its position at the last level, and its normal is the sum of the normals of its triangles.
+ *
+ * Each entry holds the weights of the position and of both tangents side by side, so one pass reads every base position
+ * a row needs once and gives all three. The rows are split over the threads. A base position is padded to four doubles,
+ * which AVX2 multiplies and adds as one register where the processor has it; both paths do the same operations
+ * in the same order, and give the same bits.
+ */
+class SubdivisionStencil
+{
+
+public:
+
+	enum class Evaluation
+	{
+		// The positions after the last level.
+		LEVEL,
+
+		// The points and normals of the limit surface at the vertices of the last level.
+		LIMIT
+	};
+
+	SubdivisionStencil();
+	~SubdivisionStencil();
+
+	// Compile levels of Loop subdivision of an initialized compact mesh, in parallel.
+	void Build(const CompactMesh& base, int levels, Evaluation evaluation = Evaluation::LEVEL);
+
+	int GetNumberOfBaseVertices() const;
+	int GetNumberOfVertices() const;
+
+	// Positions of the subdivided mesh for new positions of the base vertices. With Evaluation::LIMIT, normals, if given,
+	// gets the unit normals of the limit surface, facing the same way as the face normals of the mesh given to Build().
+	void Apply(const std::vector<glm::dvec3>& basePositions, std::vector<glm::dvec3>& positions,
+		std::vector<glm::dvec3>* normals = NULL) const;
+
+	// The subdivided mesh for new base positions, initialized. With Evaluation::LIMIT, its vertex normals are the limit normals.
+	CompactMesh GetMesh(const std::vector<glm::dvec3>& basePositions) const;
+
+	// Bytes held by the matrix.
+	size_t GetMemoryUsage() const;
+
+	// The subdivided mesh with the base positions given to Build(), initialized.
+	CompactMesh topology;
+
+	// CSR form of the matrix: the entries of row i, for vertex i of the subdivided mesh, are [rowOffsets[i], rowOffsets[i+1]),
+	// in increasing column order. Entry k has the weights [width * k, width * (k + 1)): the position, then with
+	// Evaluation::LIMIT the two tangents.
+	std::vector<int64_t> rowOffsets;
+	std::vector<int32_t> columns;
+	std::vector<double> weights;
+
+	Evaluation evaluation = Evaluation::LEVEL;
+	int levels = 0;
+
+	// 3 with Evaluation::LIMIT, 1 without.
+	int width = 1;
+
+private:
+
+	// A sparse matrix in the CSR form above, and one entry of a row while it is put together.
+	struct Rows
+	{
+		std::vector<int64_t> offsets;
+		std::vector<int32_t> columns;
+		std::vector<double> weights;
+	};
+	struct Entry
+	{
+		int32_t column;
+		double weights[3];
+	};
+
+	// Make numRows rows of width weights per entry: row(i, entries) appends the entries of row i, in any order and
+	// possibly with a column more than once. Each row is sorted and its repeated columns added up. Blocks of rows are
+	// made in parallel, each into a buffer of its own, and copied into place in order.
+	static void BuildRows(int numRows, int width, const std::function<void(int, std::vector<Entry>&)>& row, Rows& rows);
+
+	// The Loop stencils of one level of subdivision of m: its vertices, then one vertex per edge.
+	static void GetLevelStencils(const CompactMesh& m, Rows& stencils);
+
+	// The limit and tangent masks at the vertices of m, three weights per entry.
+	static void GetLimitMasks(const CompactMesh& m, Rows& masks);
+
+	// stencils * product, where the stencils have width weights per entry and product has one.
+	static void Multiply(const Rows& stencils, int width, const Rows& product, Rows& result);
+
+	// One pass over rows [begin, end), with the base positions padded to four doubles each.
+	// The tangents are only written with Evaluation::LIMIT.
+	void ApplyScalar(const double* base, int begin, int end, glm::dvec3* positions, glm::dvec3* t1, glm::dvec3* t2) const;
+	void ApplyAvx2(const double* base, int begin, int end, glm::dvec3* positions, glm::dvec3* t1, glm::dvec3* t2) const;
+
+	static bool HasAvx2();
+
+	int numBaseVertices = 0;
+
+	// 1 if the face normals of topology point the way of (x2 - x0) x (x1 - x0) over the corners of their triangles, -1 if not.
+	double orientation = 1.0;
+
+};
@@ -0,0 +1,49 @@
+#include "tangentspace.hpp"
+
+TangentSpace::TangentSpace()
+	: origin(0.0), normal(0.0), e1(0.0), e2(0.0), curvatureTensor(0.0), curvatureTensorGlobal(0.0)
+{
+}
+
+TangentSpace::TangentSpace(Vert* v, const glm::dvec3& direction)
+	: origin(v->GetPosition()), normal(v->normal), curvatureTensor(0.0), curvatureTensorGlobal(0.0)
+{
+	e1 = glm::normalize(direction - glm::dot(direction, normal) * normal);
+	e2 = glm::cross(normal, e1);
+}
+
+glm::dvec2 TangentSpace::LocalCoordinates(const glm::dvec3& position) const
+{
+	glm::dvec3 offset = position - origin;
+	return glm::dvec2(glm::dot(offset, e1), glm::dot(offset, e2));
+}
+
+glm::dvec3 TangentSpace::GlobalCoordinates(const glm::dvec2& vector) const
+{
+	return vector.x * e1 + vector.y * e2;
+}
+
+glm::dmat2 TangentSpace::LocalCoordinates(const glm::dmat3& tensor) const
+{
+	// B^T S B: entry (i, j) is e_i . S e_j.
+	glm::dvec3 s1 = tensor * e1;
+	glm::dvec3 s2 = tensor * e2;
+	double xy = 0.5 * (glm::dot(e1, s2) + glm::dot(e2, s1));
+	glm::dmat2 local;
+	local[0][0] = glm::dot(e1, s1);
+	local[0][1] = xy;
+	local[1][0] = xy;
+	local[1][1] = glm::dot(e2, s2);
+	return local;
+}
+
+glm::dmat3 TangentSpace::GlobalCoordinates(const glm::dmat2& tensor) const
+{
+	// B T B^T = T11 e1 e1^T + T12 (e1 e2^T + e2 e1^T) + T22 e2 e2^T, column by column.
+	glm::dmat3 global;
+	for (int j = 0; j < 3; ++j)
+	{
+		global[j] = (tensor[0][0] * e1[j] + tensor[0][1] * e2[j]) * e1 + (tensor[0][1] * e1[j] + tensor[1][1] * e2[j]) * e2;
+	}
+	return global;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "geometry.hpp"
+
+/** The tangent plane of a vertex, with an orthonormal frame {e1, e2} in it.
+ *
+ * Positions and directions are converted between the world and the (a, b) coordinates of the frame,
+ * and so are symmetric tensors: a 2x2 tensor T in the plane is the 3x3 tensor B T B^T in the world,
+ * where the columns of B are e1 and e2, and a 3x3 tensor S is B^T S B in the plane.
+ */
+class TangentSpace
+{
+
+public:
+
+	TangentSpace();
+
+	// The plane through v normal to its vertex normal, with e1 along the projection of direction onto it.
+	TangentSpace(Vert* v, const glm::dvec3& direction);
+
+	// Coordinates of a point projected onto the plane, relative to the vertex.
+	glm::dvec2 LocalCoordinates(const glm::dvec3& position) const;
+
+	// The vector with the given coordinates in the frame.
+	glm::dvec3 GlobalCoordinates(const glm::dvec2& vector) const;
+
+	// A symmetric tensor from the world to the plane and back.
+	glm::dmat2 LocalCoordinates(const glm::dmat3& tensor) const;
+	glm::dmat3 GlobalCoordinates(const glm::dmat2& tensor) const;
+
+	glm::dvec3 origin;
+	glm::dvec3 normal;
+	glm::dvec3 e1;
+	glm::dvec3 e2;
+
+	// The curvature tensor of the vertex, in the frame and in the world.
+	glm::dmat2 curvatureTensor;
+	glm::dmat3 curvatureTensorGlobal;
+
+};
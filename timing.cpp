@@ -0,0 +1,78 @@
+#include "timing.hpp"
+
+#include <iomanip>
+
+Timer::Timer()
+{
+	Start();
+}
+Timer::~Timer() {}
+
+void Timer::Start()
+{
+	start = std::chrono::steady_clock::now();
+}
+
+double Timer::Milliseconds()
+{
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+double Timer::Seconds()
+{
+	return 0.001 * Milliseconds();
+}
+
+
+StageTimer::StageTimer() {}
+StageTimer::~StageTimer() {}
+
+void StageTimer::Begin(const std::string& name)
+{
+	End();
+	stages.push_back({ name, 0.0 });
+	running = true;
+	timer.Start();
+}
+
+void StageTimer::End()
+{
+	if (!running)
+		return;
+	stages.back().milliseconds = timer.Milliseconds();
+	running = false;
+}
+
+void StageTimer::Clear()
+{
+	stages.clear();
+	running = false;
+}
+
+const std::vector<StageTimer::Stage>& StageTimer::GetStages() const
+{
+	return stages;
+}
+
+double StageTimer::GetTotalMilliseconds() const
+{
+	double total = 0.0;
+	for (const Stage& stage : stages)
+	{
+		total += stage.milliseconds;
+	}
+	return total;
+}
+
+void StageTimer::Print(std::ostream& out) const
+{
+	std::ios::fmtflags flags = out.flags();
+	out << std::fixed << std::setprecision(1);
+	for (const Stage& stage : stages)
+	{
+		out << std::setw(32) << std::left << stage.name << std::right << std::setw(10) << stage.milliseconds << " ms" << std::endl;
+	}
+	out << std::setw(32) << std::left << "total" << std::right << std::setw(10) << GetTotalMilliseconds() << " ms" << std::endl;
+	out.flags(flags);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+
+/** Wall-clock stopwatch for timing the stages of mesh processing.
+ * The clock starts when the timer is constructed and can be restarted with Start(). */
+class Timer
+{
+
+public:
+
+	Timer();
+	~Timer();
+
+	// Restart the clock.
+	void Start();
+
+	// Time elapsed since the last start.
+	double Milliseconds();
+	double Seconds();
+
+private:
+
+	std::chrono::steady_clock::time_point start;
+
+};
+
+/** Wall time of each stage of a pipeline, such as Polyhedron::Initialize(), in the order the stages ran.
+ * Begin() ends the stage before it, so a pipeline is timed with one Begin() per stage and an End() at the end. */
+class StageTimer
+{
+
+public:
+
+	struct Stage
+	{
+		std::string name;
+		double milliseconds;
+	};
+
+	StageTimer();
+	~StageTimer();
+
+	// End the stage being timed, if any, and start timing the named one.
+	void Begin(const std::string& name);
+
+	// End the stage being timed.
+	void End();
+
+	// Forget every stage.
+	void Clear();
+
+	const std::vector<Stage>& GetStages() const;
+	double GetTotalMilliseconds() const;
+
+	// Write one line per stage and then the total.
+	void Print(std::ostream& out) const;
+
+private:
+
+	std::vector<Stage> stages;
+	Timer timer;
+	bool running = false;
+
+};
@@ -0,0 +1,122 @@
+#include "tokenizer.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+
+Tokenizer::Tokenizer(const char* data, size_t size)
+	: cursor(data), end(data + size) {}
+Tokenizer::~Tokenizer() {}
+
+std::vector<size_t> Tokenizer::SplitLines(const char* data, size_t size, int pieces, size_t minimumSize)
+{
+	if (minimumSize > 0)
+		pieces = std::min((size_t)pieces, size / minimumSize + 1);
+
+	std::vector<size_t> offsets;
+	offsets.push_back(0);
+	for (int i = 1; i < pieces; ++i)
+	{
+		// Move each cut forward to the next line end.
+		size_t cut = std::max(offsets.back(), size / pieces * i);
+		const char* newline = (const char*)memchr(data + cut, '\n', size - cut);
+		if (newline == NULL)
+			break;
+		cut = newline + 1 - data;
+		if (cut > offsets.back() && cut < size)
+			offsets.push_back(cut);
+	}
+	offsets.push_back(size);
+	return offsets;
+}
+
+bool Tokenizer::AtEnd() const
+{
+	return cursor >= end;
+}
+
+char Tokenizer::Peek() const
+{
+	return (cursor < end) ? *cursor : '\0';
+}
+
+bool Tokenizer::AtLineEnd()
+{
+	SkipSpaces();
+	return cursor >= end || *cursor == '\n' || *cursor == '\r';
+}
+
+void Tokenizer::NextLine()
+{
+	const char* newline = (const char*)memchr(cursor, '\n', end - cursor);
+	cursor = (newline != NULL) ? newline + 1 : end;
+}
+
+void Tokenizer::SkipSpaces()
+{
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+	{
+		++cursor;
+	}
+}
+
+bool Tokenizer::Accept(char c)
+{
+	if (cursor < end && *cursor == c)
+	{
+		++cursor;
+		return true;
+	}
+	return false;
+}
+
+std::string_view Tokenizer::Word()
+{
+	SkipSpaces();
+	const char* start = cursor;
+	while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\n' && *cursor != '\r')
+	{
+		++cursor;
+	}
+	return std::string_view(start, cursor - start);
+}
+
+bool Tokenizer::Number(double& value)
+{
+	SkipSpaces();
+
+	// from_chars() does not take a leading '+'.
+	const char* start = cursor;
+	if (start < end && *start == '+')
+		++start;
+
+	std::from_chars_result parsed = std::from_chars(start, end, value);
+	if (parsed.ec != std::errc())
+		return false;
+	cursor = parsed.ptr;
+	return true;
+}
+
+bool Tokenizer::Number(int& value)
+{
+	SkipSpaces();
+
+	const char* start = cursor;
+	if (start < end && *start == '+')
+		++start;
+
+	std::from_chars_result parsed = std::from_chars(start, end, value);
+	if (parsed.ec != std::errc())
+		return false;
+	cursor = parsed.ptr;
+	return true;
+}
+
+bool Tokenizer::NextNumber(double& value)
+{
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n'))
+	{
+		++cursor;
+	}
+	return Number(value);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/** Cursor over the text of a mesh file, shared by the .obj reader and the ascii .ply reader.
+ * The tokenizer reads straight out of a buffer (usually a MappedFile) and never copies:
+ * words come back as views into the buffer and numbers are parsed in place with std::from_chars.
+ *
+ * Line-oriented formats (.obj) use the "on this line" methods together with NextLine().
+ * Free-form formats (the .ply body) use NextNumber(), which reads across line ends.
+ */
+class Tokenizer
+{
+
+public:
+
+	Tokenizer(const char* data, size_t size);
+	~Tokenizer();
+
+	// Cut a buffer into pieces that start at the beginning of a line, for parsing in parallel.
+	// Makes up to the given number of pieces, but few enough that they are at least about minimumSize bytes.
+	// Returns the offset of the start of each piece, followed by size.
+	static std::vector<size_t> SplitLines(const char* data, size_t size, int pieces, size_t minimumSize);
+
+	bool AtEnd() const;
+
+	// The next character, or '\0' at the end of the buffer.
+	char Peek() const;
+
+	// True if only spaces and the line ending are left on this line.
+	bool AtLineEnd();
+
+	// Move to the start of the next line.
+	void NextLine();
+
+	// Skip spaces and tabs, but not line ends.
+	void SkipSpaces();
+
+	// Consume the character c if it is next.
+	bool Accept(char c);
+
+	// Read the next run of non-whitespace on this line. Empty at the end of the line.
+	std::string_view Word();
+
+	// Read a number on this line, after any spaces. Returns false (and leaves the cursor) if there is no number.
+	bool Number(double& value);
+	bool Number(int& value);
+
+	// Read the next number, skipping any whitespace including line ends.
+	bool NextNumber(double& value);
+
+private:
+
+	const char* cursor;
+	const char* end;
+
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 // this class contains convenient things like typedefs or enums.
 
 // typedefs:
@@ -34,3 +36,16 @@ struct Statistics {
 	Statistics(double _min, double _max, double _mean) 
 		: min(_min), max(_max), mean(_mean) {}
 };
+
+// Outcome of reading or writing a file: either success, or the reason it failed.
+struct IOResult {
+	bool success;
+	std::string message;
+
+	IOResult() : success(true) {}
+	IOResult(bool _success, std::string _message)
+		: success(_success), message(_message) {}
+
+	static IOResult Ok() { return IOResult(); }
+	static IOResult Error(std::string _message) { return IOResult(false, _message); }
+};